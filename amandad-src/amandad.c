@@ -167,6 +167,8 @@ GSList *serviceq = NULL;
 
 static event_handle_t *exit_event;
 static int exit_on_qlength = 0;
+static time_t last_activity = 0;	/* last request or service end */
+static int conn_linger = 0;		/* connect-linger */
 static char *auth = NULL;
 static kencrypt_type amandad_kencrypt = KENCRYPT_NONE;
 static char *global_error = NULL;
@@ -521,6 +523,8 @@ main(
      */
     security_accept(secdrv, amandad_get_security_conf, in, out, protocol_accept, NULL);
 
+    conn_linger = getconf_int(CNF_CONNECT_LINGER);
+
     /*
      * Schedule an event that will try to exit every 30 seconds if there
      * are no requests outstanding.
@@ -559,6 +563,14 @@ exit_check(
     if (g_slist_length(serviceq) > 0)
 	return;
 
+    /*
+     * With a stream auth, the server may keep the idle connection for
+     * connect-linger seconds to send more requests on it.
+     */
+    if (exit_on_qlength && conn_linger > 0 &&
+	time(NULL) - last_activity < conn_linger)
+	return;
+
     /*
      * If the caller asked us to never exit, then we're done
      */
@@ -601,6 +613,7 @@ protocol_accept(
 	}
 	return;
     }
+    last_activity = time(NULL);
 
     /* If we have global errors, let the remote system know immediately.
      * Unfortunately, we only get one ERROR line, so if there
@@ -2072,6 +2085,7 @@ service_delete(
     }
 
     serviceq = g_slist_remove(serviceq, (gpointer)as);
+    last_activity = time(NULL);
 
     amfree(as->cmd);
     amfree(as->arguments);
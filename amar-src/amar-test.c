@@ -1089,6 +1089,160 @@ test_header_vers(void)
     return 1;
 }
 
+/* test the trailer index */
+
+typedef struct index_state_s {
+    int nfiles;
+    guint16 filenum[2];
+    off_t offset[2];
+} index_state_t;
+
+static gboolean
+index_cb(
+	gpointer user_data,
+	guint16 filenum,
+	gpointer filename_buf,
+	gsize filename_len,
+	off_t offset)
+{
+    index_state_t *state = user_data;
+    const char *expected = state->nfiles? "File2" : "File1";
+
+    if (state->nfiles >= 2)
+	EXPECT_FAILURE("Too many index entries (filenum %d)", filenum);
+    if (filename_len != strlen(expected) ||
+	memcmp(filename_buf, expected, filename_len) != 0)
+	EXPECT_FAILURE("Index entry %d has the wrong filename", state->nfiles);
+
+    state->filenum[state->nfiles] = filenum;
+    state->offset[state->nfiles] = offset;
+    state->nfiles++;
+
+    return TRUE;
+}
+
+static int
+test_index(void)
+{
+    int fd;
+    char buf[1000];
+    gsize i;
+    off_t posn;
+    amar_t *arch;
+    amar_file_t *af;
+    amar_attr_t *at;
+    index_state_t istate = { 0, { 0, 0 }, { 0, 0 } };
+    GError *error = NULL;
+    gboolean ok;
+
+    for (i = 0; i < sizeof(buf); i++)
+	buf[i] = i % 251;
+
+    /* an archive without an index */
+    fd = open_temp(1);
+    arch = amar_new(fd, O_WRONLY, &error);
+    check_gerror(arch, error, "amar_new");
+    af = amar_new_file(arch, "File1", 0, NULL, &error);
+    check_gerror(af, error, "amar_new_file");
+    ok = amar_file_close(af, &error);
+    check_gerror(ok, error, "amar_file_close");
+    ok = amar_close(arch, &error);
+    check_gerror(ok, error, "amar_close");
+    close(fd);
+
+    fd = open_temp(0);
+    arch = amar_new(fd, O_RDONLY, &error);
+    check_gerror(arch, error, "amar_new");
+    ok = amar_read_index(arch, &istate, index_cb, &error);
+    check_gerror_matches(ok, error, "Archive has no index", "amar_read_index");
+    g_clear_error(&error);
+    amar_close(arch, NULL);
+    close(fd);
+
+    /* and one with an index */
+    fd = open_temp(1);
+    arch = amar_new(fd, O_WRONLY, &error);
+    check_gerror(arch, error, "amar_new");
+    amar_enable_index(arch);
+
+    af = amar_new_file(arch, "File1", 0, &posn, &error);
+    check_gerror(af, error, "amar_new_file");
+    at = amar_new_attr(af, 16, &error);
+    check_gerror(at, error, "amar_new_attr");
+    ok = amar_attr_add_data_buffer(at, buf, sizeof(buf), 1, &error);
+    check_gerror(ok, error, "amar_attr_add_data_buffer");
+    ok = amar_file_close(af, &error);
+    check_gerror(ok, error, "amar_file_close");
+
+    af = amar_new_file(arch, "File2", 0, &posn, &error);
+    check_gerror(af, error, "amar_new_file");
+    at = amar_new_attr(af, 17, &error);
+    check_gerror(at, error, "amar_new_attr");
+    ok = amar_attr_add_data_buffer(at, buf, 100, 1, &error);
+    check_gerror(ok, error, "amar_attr_add_data_buffer");
+    ok = amar_file_close(af, &error);
+    check_gerror(ok, error, "amar_file_close");
+
+    ok = amar_close(arch, &error);
+    check_gerror(ok, error, "amar_close");
+    close(fd);
+
+    /* a full read skips the index */
+    {
+	amar_attr_handling_t handling[] = {
+	    { 0, 2048, frag_cb, NULL },
+	};
+	expected_step_t steps[] = {
+	    EXPECT_START_FILE_STR(1, "File1", 0),
+	    EXPECT_ATTR_DATA(1, 16, buf, sizeof(buf), 1, 0),
+	    EXPECT_FINISH_FILE(1, 0),
+	    EXPECT_START_FILE_STR(2, "File2", 0),
+	    EXPECT_ATTR_DATA(2, 17, buf, 100, 1, 0),
+	    EXPECT_FINISH_FILE(2, 0),
+	    EXPECT_END(),
+	};
+	try_reading(steps, handling);
+    }
+
+    /* seek straight to the second file */
+    {
+	amar_attr_handling_t handling[] = {
+	    { 0, 2048, frag_cb, NULL },
+	};
+	expected_step_t steps[] = {
+	    EXPECT_START_FILE_STR(2, "File2", 0),
+	    EXPECT_ATTR_DATA(2, 17, buf, 100, 1, 0),
+	    EXPECT_FINISH_FILE(2, 0),
+	    EXPECT_END(),
+	};
+	expected_state_t state = { steps, 0 };
+
+	fd = open_temp(0);
+	arch = amar_new(fd, O_RDONLY, &error);
+	check_gerror(arch, error, "amar_new");
+	ok = amar_read_index(arch, &istate, index_cb, &error);
+	check_gerror(ok, error, "amar_read_index");
+	if (istate.nfiles != 2 || istate.filenum[0] != 1 ||
+	    istate.filenum[1] != 2 || istate.offset[0] <= 0 ||
+	    istate.offset[1] <= istate.offset[0])
+	    EXPECT_FAILURE("Bad index: %d entries", istate.nfiles);
+
+	ok = amar_seek(arch, istate.offset[1], &error);
+	check_gerror(ok, error, "amar_seek");
+	ok = amar_read(arch, &state, handling, file_start_cb, file_finish_cb,
+		       NULL, &error);
+	if (ok || error)
+	    check_gerror(ok, error, "amar_read");
+	if (steps[state.curstep].kind != EXP_END)
+	    EXPECT_FAILURE("Stopped reading early at step %d", state.curstep);
+	ok = amar_close(arch, &error);
+	check_gerror(ok, error, "amar_close");
+	close(fd);
+    }
+
+    return 1;
+}
+
 /****
  * Driver
  */
@@ -1112,6 +1266,7 @@ main(int argc, char **argv)
 	TU_TEST(test_no_header, 90),
 	TU_TEST(test_invalid_eof, 90),
 	TU_TEST(test_header_vers, 90),
+	TU_TEST(test_index, 90),
 	TU_END()
     };
 
@@ -78,6 +78,39 @@ typedef struct record_s {
  * writing straight out of the user's buffers? */
 #define WRITE_BUFFER_SIZE (512*1024)
 
+/* The index is written by amar_close as AMAR_ATTR_INDEX records of file 0,
+ * each entry being the offset of the header record preceding a file (8
+ * bytes), its filenum (2 bytes), and its filename (4 bytes of size, then the
+ * name).  It is followed by a last AMAR_ATTR_INDEX record holding the offset
+ * of the first one and INDEX_MAGIC, so a reader can find it from the end. */
+#define INDEX_FILENUM 0
+#define INDEX_MAGIC "AMARIDX1"
+#define INDEX_TRAILER_SIZE (8 + 8)
+#define INDEX_ENTRY_SIZE (8 + 2 + 4)
+
+static void
+put_uint64(
+    gchar   *ptr,
+    guint64  v)
+{
+    guint32 hi = htonl((guint32)(v >> 32));
+    guint32 lo = htonl((guint32)(v & 0xffffffff));
+
+    memcpy(ptr, &hi, 4);
+    memcpy(ptr + 4, &lo, 4);
+}
+
+static guint64
+get_uint64(
+    gchar *ptr)
+{
+    guint32 hi, lo;
+
+    memcpy(&hi, ptr, 4);
+    memcpy(&lo, ptr + 4, 4);
+    return ((guint64)ntohl(hi) << 32) | ntohl(lo);
+}
+
 typedef struct amar_file_attr_handling_s {
     guint16  filenum;
     guint16  attrid;
@@ -116,6 +149,11 @@ struct amar_s {
     off_t     record;		/* record number			*/
     GHashTable *files;		/* List of all amar_file_t		*/
     gboolean  seekable;		/* does lseek() work on this fd?	*/
+    GByteArray *index;		/* index entries, if writing an index	*/
+
+    /* held while writing records, as attributes can be written by several
+     * threads at once (amar_attr_add_data_fd_in_thread) */
+    GMutex   *mutex;
 
     /* internal buffer; on writing, this is WRITE_BUFFER_SIZE bytes, and
      * always has at least RECORD_SIZE bytes free. */
@@ -236,6 +274,38 @@ write_record(
     return TRUE;
 }
 
+static gboolean
+write_index(
+	amar_t *archive,
+	GError **error)
+{
+    amar_file_t index_file;
+    off_t       index_offset = archive->position;
+    gsize       offset = 0;
+    gchar       trailer[INDEX_TRAILER_SIZE];
+
+    bzero(&index_file, sizeof(index_file));
+    index_file.archive = archive;
+    index_file.filenum = INDEX_FILENUM;
+
+    /* the entries, in as many records as needed */
+    do {
+	gsize size = MIN(archive->index->len - offset, MAX_RECORD_DATA_SIZE);
+	gboolean eoa = (offset + size == archive->index->len);
+
+	if (!write_record(archive, &index_file, AMAR_ATTR_INDEX, eoa,
+			  archive->index->data + offset, size, error))
+	    return FALSE;
+	offset += size;
+    } while (offset < archive->index->len);
+
+    /* and where they start */
+    put_uint64(trailer, index_offset);
+    memcpy(trailer + 8, INDEX_MAGIC, 8);
+    return write_record(archive, &index_file, AMAR_ATTR_INDEX, 1,
+			trailer, INDEX_TRAILER_SIZE, error);
+}
+
 /*
  * Public functions
  */
@@ -260,6 +330,8 @@ amar_new(
     archive->seekable = TRUE; /* assume seekable until lseek() fails */
     archive->files = g_hash_table_new(g_int_hash, g_int_equal);
     archive->buf = NULL;
+    archive->index = NULL;
+    archive->mutex = g_mutex_new();
 
     if (mode == O_WRONLY) {
 	archive->buf = g_malloc(WRITE_BUFFER_SIZE);
@@ -293,11 +365,17 @@ amar_close(
     /* verify all files are done */
     g_assert(g_hash_table_size(archive->files) == 0);
 
+    if (archive->mode == O_WRONLY && archive->index &&
+	!write_index(archive, error))
+	success = FALSE;
+
     if (archive->mode == O_WRONLY && !flush_buffer(archive, error))
 	success = FALSE;
 
     g_hash_table_destroy(archive->files);
     if (archive->buf) g_free(archive->buf);
+    if (archive->index) g_byte_array_free(archive->index, TRUE);
+    g_mutex_free(archive->mutex);
     amfree(archive);
 
     return success;
@@ -317,6 +395,16 @@ amar_record(
     return archive->record;
 }
 
+void
+amar_enable_index(
+    amar_t *archive)
+{
+    g_assert(archive->mode == O_WRONLY);
+    g_assert(archive->maxfilenum == 0);
+
+    archive->index = g_byte_array_new();
+}
+
 /*
  * Writing
  */
@@ -347,7 +435,8 @@ amar_new_file(
 
     /* pick a new, unused filenum */
 
-    if (g_hash_table_size(archive->files) == 65535) {
+    /* 65536 filenums, less MAGIC_FILENUM and INDEX_FILENUM */
+    if (g_hash_table_size(archive->files) == 65534) {
 	g_set_error(error, amar_error_quark(), ENOSPC,
 		    "No more file numbers available");
 	return NULL;
@@ -358,8 +447,11 @@ amar_new_file(
 
 	archive->maxfilenum++;
 
-	/* MAGIC_FILENUM can't be used because it matches the header record text */
-	if (archive->maxfilenum == MAGIC_FILENUM) {
+	/* MAGIC_FILENUM can't be used because it matches the header record
+	 * text, and INDEX_FILENUM, reached when maxfilenum wraps, holds the
+	 * index */
+	if (archive->maxfilenum == MAGIC_FILENUM ||
+	    archive->maxfilenum == INDEX_FILENUM) {
 	    continue;
 	}
 
@@ -382,11 +474,31 @@ amar_new_file(
     file->attributes = g_hash_table_new_full(g_int_hash, g_int_equal, NULL, g_free);
     g_hash_table_insert(archive->files, &file->filenum, file);
 
-    /* record the current position and write a header there, if desired */
-    if (header_offset) {
-	*header_offset = archive->position;
+    g_mutex_lock(archive->mutex);
+
+    /* record the current position and write a header there, if desired; the
+     * index needs one for every file */
+    if (header_offset || archive->index) {
+	off_t offset = archive->position;
+
+	if (header_offset)
+	    *header_offset = offset;
 	if (!write_header(archive, error))
 	    goto error_exit;
+
+	if (archive->index) {
+	    gchar entry[INDEX_ENTRY_SIZE];
+	    guint16 filenum = htons(file->filenum);
+	    guint32 len = htonl(filename_len);
+
+	    put_uint64(entry, offset);
+	    memcpy(entry + 8, &filenum, 2);
+	    memcpy(entry + 10, &len, 4);
+	    g_byte_array_append(archive->index, (guint8 *)entry,
+				INDEX_ENTRY_SIZE);
+	    g_byte_array_append(archive->index, (guint8 *)filename_buf,
+				filename_len);
+	}
     }
 
     /* add a filename record */
@@ -394,9 +506,11 @@ amar_new_file(
 		      1, filename_buf, filename_len, error))
 	goto error_exit;
 
+    g_mutex_unlock(archive->mutex);
     return file;
 
 error_exit:
+    g_mutex_unlock(archive->mutex);
     if (file) {
 	g_hash_table_remove(archive->files, &file->filenum);
 	g_hash_table_destroy(file->attributes);
@@ -450,9 +564,11 @@ amar_file_close(
 
     /* write an EOF record */
     if (success) {
+	g_mutex_lock(archive->mutex);
 	if (!write_record(archive, file, AMAR_ATTR_EOF, 1,
 			  NULL, 0, error))
 	    success = FALSE;
+	g_mutex_unlock(archive->mutex);
     }
 
     /* remove from archive->file list */
@@ -522,9 +638,11 @@ amar_attr_close_no_remove(
     /* write an empty record with EOA_BIT set if we haven't ended
      * this attribute already */
     if (!attribute->wrote_eoa) {
+	g_mutex_lock(archive->mutex);
 	if (!write_record(archive, file, attribute->attrid,
 			  1, NULL, 0, error))
 	    rv = FALSE;
+	g_mutex_unlock(archive->mutex);
 	attribute->wrote_eoa = TRUE;
     }
 
@@ -571,9 +689,13 @@ amar_attr_add_data_buffer(
 		rec_eoa = TRUE;
 	}
 
+	g_mutex_lock(archive->mutex);
 	if (!write_record(archive, file, attribute->attrid,
-			  rec_eoa, data, rec_data_size, error))
+			  rec_eoa, data, rec_data_size, error)) {
+	    g_mutex_unlock(archive->mutex);
 	    return FALSE;
+	}
+	g_mutex_unlock(archive->mutex);
 
 	data = (gchar *)data + rec_data_size;
 	size -= rec_data_size;
@@ -646,21 +768,27 @@ amar_attr_add_data_fd(
 
 	if (size == 0) {
 	    if (eoa && !attribute->wrote_eoa) {
+		g_mutex_lock(archive->mutex);
 		if (!write_record(archive, file, attribute->attrid,
 				  1, buf, size, error)) {
 		    filesize = -1;
 		}
+		g_mutex_unlock(archive->mutex);
 	    }
 	    break;
 	}
 
 	short_read = (size < MAX_RECORD_DATA_SIZE);
 
+	/* the data read is interleaved with that of the other threads */
+	g_mutex_lock(archive->mutex);
 	if (!write_record(archive, file, attribute->attrid,
 	    eoa && short_read, buf, size, error)) {
+	    g_mutex_unlock(archive->mutex);
 	    filesize = -1;
 	    break;
 	}
+	g_mutex_unlock(archive->mutex);
 
 	filesize += size;
 	attribute->size += size;
@@ -1111,6 +1239,11 @@ amar_read_cb(
 			break;
 		}
 		continue;
+	    } else if (attrid == AMAR_ATTR_INDEX) {
+		/* only used by amar_read_index */
+		hp->buf_offset += (RECORD_SIZE + datasize);
+		hp->buf_len    -= (RECORD_SIZE + datasize);
+		continue;
 	    } else if (attrid == AMAR_ATTR_FILENAME) {
 		if (fs) {
 		    /* TODO: warn - previous file did not end correctly */
@@ -1468,6 +1601,10 @@ amar_read(
 			break;
 		}
 		continue;
+	    } else if (attrid == AMAR_ATTR_INDEX) {
+		/* only used by amar_read_index */
+		buf_skip(archive, &hp, datasize);
+		continue;
 	    } else if (attrid == AMAR_ATTR_FILENAME) {
 		/* for filenames, we need the whole filename in the buffer */
 		if (!buf_atleast(archive, &hp, datasize))
@@ -1677,3 +1814,132 @@ void amar_set_error(
     amar_stop_read(archive);
     read_done(archive->hp);
 }
+
+gboolean
+amar_seek(
+    amar_t *archive,
+    off_t   offset,
+    GError **error)
+{
+    g_assert(archive->mode == O_RDONLY);
+
+    if (lseek(archive->fd, offset, SEEK_SET) < 0) {
+	g_set_error(error, amar_error_quark(), errno,
+		    "Error seeking in amanda archive: %s", strerror(errno));
+	return FALSE;
+    }
+    archive->position = offset;
+
+    return TRUE;
+}
+
+gboolean
+amar_read_index(
+    amar_t *archive,
+    gpointer user_data,
+    amar_index_callback_t index_cb,
+    GError **error)
+{
+    gchar    trailer[RECORD_SIZE + INDEX_TRAILER_SIZE];
+    gchar    rec[RECORD_SIZE];
+    gchar   *index = NULL;
+    gchar   *p;
+    gsize    index_len = 0;
+    off_t    end;
+    off_t    pos;
+    guint16  filenum;
+    guint16  attrid;
+    guint32  datasize;
+    gboolean eoa;
+    gboolean success = TRUE;
+
+    g_assert(archive->mode == O_RDONLY);
+
+    /* the last record points to the first one of the index */
+    end = lseek(archive->fd, 0, SEEK_END);
+    if (end < 0) {
+	g_set_error(error, amar_error_quark(), errno,
+		    "Error seeking in amanda archive: %s", strerror(errno));
+	return FALSE;
+    }
+    if (lseek(archive->fd, archive->position, SEEK_SET) < 0) {
+	g_set_error(error, amar_error_quark(), errno,
+		    "Error seeking in amanda archive: %s", strerror(errno));
+	return FALSE;
+    }
+    if (end < (off_t)(HEADER_SIZE + sizeof(trailer)) ||
+	pread(archive->fd, trailer, sizeof(trailer),
+	      end - sizeof(trailer)) != sizeof(trailer)) {
+	g_set_error(error, amar_error_quark(), ENOENT,
+		    "Archive has no index");
+	return FALSE;
+    }
+    GETRECORD(trailer, filenum, attrid, datasize, eoa);
+    if (filenum != INDEX_FILENUM || attrid != AMAR_ATTR_INDEX ||
+	datasize != INDEX_TRAILER_SIZE || !eoa ||
+	memcmp(trailer + RECORD_SIZE + 8, INDEX_MAGIC, 8) != 0) {
+	g_set_error(error, amar_error_quark(), ENOENT,
+		    "Archive has no index");
+	return FALSE;
+    }
+    pos = get_uint64(trailer + RECORD_SIZE);
+
+    /* read the entries */
+    do {
+	if (pos + (off_t)RECORD_SIZE > end ||
+	    pread(archive->fd, rec, RECORD_SIZE, pos) != RECORD_SIZE) {
+	    g_set_error(error, amar_error_quark(), EINVAL,
+			"Archive index is truncated, position = %lld",
+			(long long)pos);
+	    g_free(index);
+	    return FALSE;
+	}
+	GETRECORD(rec, filenum, attrid, datasize, eoa);
+	if (filenum != INDEX_FILENUM || attrid != AMAR_ATTR_INDEX ||
+	    datasize > MAX_RECORD_DATA_SIZE ||
+	    pos + (off_t)(RECORD_SIZE + datasize) > end) {
+	    g_set_error(error, amar_error_quark(), EINVAL,
+			"Invalid archive index record, position = %lld",
+			(long long)pos);
+	    g_free(index);
+	    return FALSE;
+	}
+	index = g_realloc(index, index_len + datasize + 1);
+	if (pread(archive->fd, index + index_len, datasize,
+		  pos + RECORD_SIZE) != (ssize_t)datasize) {
+	    g_set_error(error, amar_error_quark(), EINVAL,
+			"Archive index is truncated, position = %lld",
+			(long long)pos);
+	    g_free(index);
+	    return FALSE;
+	}
+	index_len += datasize;
+	pos += RECORD_SIZE + datasize;
+    } while (!eoa);
+
+    for (p = index; p + INDEX_ENTRY_SIZE <= index + index_len; ) {
+	off_t   offset = get_uint64(p);
+	guint32 len;
+
+	memcpy(&filenum, p + 8, 2);
+	filenum = ntohs(filenum);
+	memcpy(&len, p + 10, 4);
+	len = ntohl(len);
+	p += INDEX_ENTRY_SIZE;
+	if (len > (gsize)(index + index_len - p)) {
+	    g_set_error(error, amar_error_quark(), EINVAL,
+			"Archive index entry for file %d is truncated",
+			(int)filenum);
+	    success = FALSE;
+	    break;
+	}
+	if (!index_cb(user_data, filenum, p, len, offset)) {
+	    success = FALSE;
+	    break;
+	}
+	p += len;
+    }
+
+    g_free(index);
+    return success;
+}
@@ -50,6 +50,7 @@ enum {
     /* internal-use only attributes */
     AMAR_ATTR_FILENAME = 0,
     AMAR_ATTR_EOF = 1,
+    AMAR_ATTR_INDEX = 2,
 
     /* anything above this value can be used by the application */
     AMAR_ATTR_APP_START = 16,
@@ -75,6 +76,13 @@ off_t amar_size(amar_t *archive);
 /* Return the record number of the archive if opened in read mode */
 off_t amar_record(amar_t *archive);
 
+/* Write an index of the files when the archive is closed, so that a reader
+ * can find a file without reading the whole archive (see amar_read_index).
+ * A header record is then written before each file.  This must be called
+ * before the first amar_new_file.  Older readers do not accept an archive
+ * with an index. */
+void amar_enable_index(amar_t *archive);
+
 /* create a new 'file' object on the archive.  The filename is treated as a
  * binary blob, but if filename_len is zero, then its length will be calculated
  * with strlen().  A zero-length filename_buf is not allowed.
@@ -152,7 +160,10 @@ off_t amar_attr_add_data_fd(
 
 /* Same but do it in a new thread
  * Return immediately
- * Caller should not use the archive, next call must be attr->close
+ * Caller should not use the attribute, next call must be attr->close.  The
+ * other attributes and files of the archive can be written meanwhile, also
+ * from threads; the records of each are interleaved in the archive as the
+ * data is read.
  */
 off_t amar_attr_add_data_fd_in_thread(
 	    amar_attr_t *attribute,
@@ -311,3 +322,42 @@ void amar_set_error(
     amar_t *archive,
     char *msg);
 
+/* amar_read_index calls this function for each file in the index.
+ *
+ * @param user_data: the pointer passed to amar_read_index
+ * @param filenum: the file number of the file
+ * @param filename_buf: the filename of the file
+ * @param filename_len: the length of the filename
+ * @param offset: the offset of the header record preceding the file
+ * @returns: FALSE if the amar_read_index call should be aborted
+ */
+typedef gboolean (*amar_index_callback_t)(
+	gpointer user_data,
+	guint16  filenum,
+	gpointer filename_buf,
+	gsize filename_len,
+	off_t offset);
+
+/* Read the index written by an archive with amar_enable_index.  The archive
+ * must be opened in read mode on a seekable file that starts with the archive
+ * and ends with it.  If any of the callbacks return FALSE, this function
+ * returns FALSE but does not set its error parameter.
+ *
+ * @returns: FALSE on error, with code ENOENT if there is no index
+ */
+gboolean amar_read_index(
+	amar_t *archive,
+	gpointer user_data,
+	amar_index_callback_t index_cb,
+	GError **error);
+
+/* Set the position of an archive opened in read mode, so that the next
+ * amar_read starts at offset, which must be that of a header record.
+ * amar_read then reads until the end of the archive unless a callback stops
+ * it; a file_finish_cb returning FALSE after the wanted file does that.
+ */
+gboolean amar_seek(
+	amar_t *archive,
+	off_t offset,
+	GError **error);
+
@@ -33,6 +33,8 @@ static struct option long_options[] = {
     {"verbose"         , 0, NULL,  4},
     {"file"            , 1, NULL,  5},
     {"version"         , 0, NULL,  6},
+    {"index"           , 0, NULL,  7},
+    {"jobs"            , 1, NULL,  8},
     {NULL, 0, NULL, 0}
 };
 
@@ -40,7 +42,7 @@ static void
 usage(void)
 {
     printf("Usage: amarchiver [--version|--create|--list|--extract] [--verbose]* [--file file]\n");
-    printf("            [filename]*\n");
+    printf("            [--index] [--jobs N] [filename]*\n");
     exit(1);
 }
 
@@ -52,16 +54,23 @@ error_exit(const char *action, GError *gerror)
     exit(1);
 }
 
+typedef struct create_job_s {
+    char        *filename;
+    amar_file_t *file;
+    amar_attr_t *attribute;
+    off_t        filesize;
+    GError      *gerror;
+} create_job_t;
+
 static void
-do_create(char *opt_file, int opt_verbose, int argc, char **argv)
+do_create(char *opt_file, int opt_verbose, gboolean opt_index, int opt_jobs,
+	  int argc, char **argv)
 {
     FILE *output = stdout;
     amar_t *archive;
-    amar_file_t *file;
-    amar_attr_t *attribute;
+    create_job_t *jobs;
     GError *gerror = NULL;
-    int i, fd_out, fd_in;
-    off_t filesize = 0;
+    int i, j, nb_jobs, fd_out, fd_in;
 
     if (opt_file != NULL && !g_str_equal(opt_file, "-")) {
 	fd_out = open(opt_file, O_CREAT|O_WRONLY|O_TRUNC, 0660);
@@ -75,40 +84,68 @@ do_create(char *opt_file, int opt_verbose, int argc, char **argv)
     archive = amar_new(fd_out, O_WRONLY, &gerror);
     if (!archive)
 	error_exit("amar_new", gerror);
+    if (opt_index)
+	amar_enable_index(archive);
 
+    jobs = g_new0(create_job_t, opt_jobs);
     i = 0;
     while (i<argc) {
-	fd_in = open(argv[i], O_RDONLY);
-	if (fd_in < 0) {
-	    g_fprintf(stderr, "open of '%s' failed: %s\n", argv[i], strerror(errno));
+	/* read up to opt_jobs files at once, their data is interleaved */
+	nb_jobs = 0;
+	while (i<argc && nb_jobs < opt_jobs) {
+	    create_job_t *job = &jobs[nb_jobs];
+
+	    fd_in = open(argv[i], O_RDONLY);
+	    if (fd_in < 0) {
+		g_fprintf(stderr, "open of '%s' failed: %s\n", argv[i], strerror(errno));
+		i++;
+		continue;
+	    }
+	    job->filename = argv[i];
+	    job->gerror = NULL;
+	    job->file = amar_new_file(archive, argv[i], strlen(argv[i]), NULL, &gerror);
+	    if (!job->file)
+		error_exit("amar_new_file", gerror);
+	    job->attribute = amar_new_attr(job->file, AMAR_ATTR_GENERIC_DATA, &gerror);
+	    if (!job->attribute)
+		error_exit("amar_new_attr", gerror);
+
+	    if (opt_jobs > 1) {
+		struct stat stat_buf;
+
+		job->filesize = 0;
+		if (fstat(fd_in, &stat_buf) == 0)
+		    job->filesize = stat_buf.st_size;
+		/* the thread closes fd_in */
+		amar_attr_add_data_fd_in_thread(job->attribute, fd_in, 1,
+						&job->gerror);
+	    } else {
+		job->filesize = amar_attr_add_data_fd(job->attribute, fd_in, 1,
+						      &job->gerror);
+		close(fd_in);
+	    }
+	    nb_jobs++;
 	    i++;
-	    continue;
 	}
-	filesize = 0;
-	file = amar_new_file(archive, argv[i], strlen(argv[i]), NULL, &gerror);
-	if (!file)
-	    error_exit("amar_new_file", gerror);
-	attribute = amar_new_attr(file, AMAR_ATTR_GENERIC_DATA, &gerror);
-	if (!attribute)
-	    error_exit("amar_new_attr", gerror);
-
-	filesize += amar_attr_add_data_fd(attribute, fd_in, 1, &gerror);
-	if (gerror)
-	    error_exit("amar_attr_add_data_fd", gerror);
-
-	if (!amar_attr_close(attribute, &gerror))
-	    error_exit("amar_attr_close", gerror);
-	if (!amar_file_close(file, &gerror))
-	    error_exit("amar_file_close", gerror);
 
-	if (opt_verbose == 1) {
-	    g_fprintf(output,"%s\n", argv[i]);
-	} else if (opt_verbose > 1) {
-	    g_fprintf(output,"%llu %s\n", (unsigned long long)filesize, argv[i]);
+	for (j = 0; j < nb_jobs; j++) {
+	    create_job_t *job = &jobs[j];
+
+	    if (!amar_attr_close(job->attribute, &gerror))
+		error_exit("amar_attr_close", gerror);
+	    if (job->gerror)
+		error_exit("amar_attr_add_data_fd", job->gerror);
+	    if (!amar_file_close(job->file, &gerror))
+		error_exit("amar_file_close", gerror);
+
+	    if (opt_verbose == 1) {
+		g_fprintf(output,"%s\n", job->filename);
+	    } else if (opt_verbose > 1) {
+		g_fprintf(output,"%llu %s\n", (unsigned long long)job->filesize, job->filename);
+	    }
 	}
-	close(fd_in);
-	i++;
     }
+    g_free(jobs);
 
     if (!amar_close(archive, &gerror))
 	error_exit("amar_close", gerror);
@@ -119,12 +156,13 @@ struct read_user_data {
     gboolean verbose;
     char **argv;
     int argc;
+    guint16 filenum;	/* if not 0, the only file to extract */
 };
 
 static gboolean
 extract_file_start_cb(
 	gpointer user_data,
-	uint16_t filenum G_GNUC_UNUSED,
+	uint16_t filenum,
 	gpointer filename_buf,
 	gsize filename_len,
 	gboolean *ignore G_GNUC_UNUSED,
@@ -144,23 +182,106 @@ extract_file_start_cb(
 		*ignore = FALSE;
 	}
     }
+    if (ud->filenum && filenum != ud->filenum)
+	*ignore = TRUE;
 
     return TRUE;
 }
 
 static gboolean
 extract_file_finish_cb(
-	gpointer user_data G_GNUC_UNUSED,
-	uint16_t filenum G_GNUC_UNUSED,
+	gpointer user_data,
+	uint16_t filenum,
 	gpointer *file_data,
 	gboolean truncated)
 {
+    struct read_user_data *ud = user_data;
+
     if (truncated)
 	g_fprintf(stderr, _("Data for '%s' may have been truncated\n"),
 		(char *)*file_data);
 
     g_free(*file_data);
 
+    /* stop reading once the only file to extract is done */
+    return !(ud->filenum && filenum == ud->filenum);
+}
+
+typedef struct index_match_s {
+    guint16 filenum;
+    off_t   offset;
+} index_match_t;
+
+struct index_user_data {
+    struct read_user_data *ud;
+    GArray *matches;
+};
+
+static gboolean
+extract_index_cb(
+	gpointer user_data,
+	guint16  filenum,
+	gpointer filename_buf,
+	gsize filename_len,
+	off_t offset)
+{
+    struct index_user_data *iud = user_data;
+    struct read_user_data *ud = iud->ud;
+    index_match_t match;
+    int i;
+
+    for (i = 0; i < ud->argc; i++) {
+	if (strlen(ud->argv[i]) == filename_len
+	    && memcmp(ud->argv[i], filename_buf, filename_len) == 0) {
+	    match.filenum = filenum;
+	    match.offset = offset;
+	    g_array_append_val(iud->matches, match);
+	    break;
+	}
+    }
+
+    return TRUE;
+}
+
+/* extract the files named in ud by seeking to them, if the archive has an
+ * index; return FALSE if it has none */
+static gboolean
+extract_with_index(
+	amar_t *archive,
+	struct read_user_data *ud,
+	amar_attr_handling_t *handling)
+{
+    struct index_user_data iud;
+    GArray *matches;
+    GError *gerror = NULL;
+    guint i;
+
+    matches = g_array_new(FALSE, FALSE, sizeof(index_match_t));
+    iud.ud = ud;
+    iud.matches = matches;
+
+    if (!amar_read_index(archive, &iud, extract_index_cb, &gerror)) {
+	g_array_free(matches, TRUE);
+	if (gerror && gerror->code == ENOENT) {
+	    g_error_free(gerror);
+	    return FALSE;
+	}
+	error_exit("amar_read_index", gerror);
+    }
+
+    for (i = 0; i < matches->len; i++) {
+	index_match_t *match = &g_array_index(matches, index_match_t, i);
+
+	ud->filenum = match->filenum;
+	if (!amar_seek(archive, match->offset, &gerror))
+	    error_exit("amar_seek", gerror);
+	if (!amar_read(archive, ud, handling, extract_file_start_cb,
+		       extract_file_finish_cb, NULL, &gerror) && gerror)
+	    error_exit("amar_read", gerror);
+    }
+    ud->filenum = 0;
+    g_array_free(matches, TRUE);
+
     return TRUE;
 }
 
@@ -267,6 +388,7 @@ do_extract(
     ud.argv = argv;
     ud.argc = argc;
     ud.verbose = opt_verbose;
+    ud.filenum = 0;
 
     if (opt_file && !g_str_equal(opt_file, "-")) {
 	fd_in = open(opt_file, O_RDONLY);
@@ -281,6 +403,13 @@ do_extract(
     if (!archive)
 	error_exit("amar_new", gerror);
 
+    /* read only the requested files if we can find them */
+    if (argc && fd_in != fileno(stdin) &&
+	extract_with_index(archive, &ud, handling)) {
+	amar_close(archive, NULL);
+	return;
+    }
+
 //    if (!amar_read(archive, &ud, handling, extract_file_start_cb,
 //		   extract_file_finish_cb, NULL, &gerror)) {
 //	if (gerror)
@@ -360,6 +489,8 @@ int main(
     int   opt_extract   = 0;
     int   opt_list      = 0;
     int   opt_verbose   = 0;
+    int   opt_index     = 0;
+    int   opt_jobs      = 1;
     char *opt_file      = NULL;
 
     glib_init();
@@ -385,6 +516,14 @@ int main(
 	case 6: printf("amarchiver %s\n", VERSION);
 		exit(0);
 		break;
+	case 7: opt_index = 1;
+		break;
+	case 8: opt_jobs = atoi(optarg);
+		if (opt_jobs < 1) {
+		    g_fprintf(stderr,"--jobs must be at least 1\n");
+		    usage();
+		}
+		break;
 	}
     }
     argc -= optind;
@@ -401,7 +540,7 @@ int main(
     }
 
     if (opt_create > 0)
-	do_create(opt_file, opt_verbose, argc, argv);
+	do_create(opt_file, opt_verbose, opt_index, opt_jobs, argc, argv);
     else if (opt_extract > 0)
 	do_extract(opt_file, opt_verbose, argc, argv);
     else if (opt_list > 0)
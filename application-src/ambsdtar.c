@@ -47,6 +47,7 @@
  * TAR-BLOCKSIZE   (default does not add --block-size option,
  *                  using tar's default)
  * VERBOSE
+ * SHARD           (i/n, back up only shard i of n of the top-level entries)
  */
 
 #include "amanda.h"
@@ -125,10 +126,10 @@ static void ambsdtar_backup(application_argument_t *argument);
 static void ambsdtar_restore(application_argument_t *argument);
 static void ambsdtar_validate(application_argument_t *argument);
 static void ambsdtar_index(application_argument_t *argument);
-static void ambsdtar_build_exinclude(dle_t *dle,
-				     int *nb_exclude, char **file_exclude,
-				     int *nb_include, char **file_include,
-				     char *dirname, messagelist_t *mlist);
+static int ambsdtar_build_exinclude(dle_t *dle,
+				    int *nb_exclude, char **file_exclude,
+				    int *nb_include, char **file_include,
+				    char *dirname, messagelist_t *mlist);
 static char *ambsdtar_get_timestamps(application_argument_t *argument,
 				     int level,
 				     FILE *mesgstream, int command);
@@ -147,6 +148,9 @@ static char *state_dir;
 static char *bsdtar_target;
 static int bsdtar_onefilesystem;
 static int bsdtar_sparse;
+static char *bsdtar_shard_value = NULL;
+static int bsdtar_shard = 0;
+static int bsdtar_nb_shards = 0;
 static GSList *normal_message = NULL;
 static GSList *ignore_message = NULL;
 static GSList *strange_message = NULL;
@@ -188,6 +192,7 @@ static struct option long_options[] = {
     {"verbose"         , 1, NULL, 36},
     {"sparse"          , 1, NULL, 37},
     {"target"          , 1, NULL, 38},
+    {"shard"           , 1, NULL, 39},
     {NULL, 0, NULL, 0}
 };
 
@@ -480,6 +485,9 @@ main(
 	case 38: amfree(bsdtar_target);
 		 bsdtar_target = g_strdup(optarg);
 		 break;
+	case 39: amfree(bsdtar_shard_value);
+		 bsdtar_shard_value = g_strdup(optarg);
+		 break;
 	case ':':
 	case '?':
 		break;
@@ -513,6 +521,11 @@ main(
 	}
     }
 
+    /* a bad SHARD is rejected by selfcheck, estimate and backup */
+    if (bsdtar_shard_value) {
+	parse_shard(bsdtar_shard_value, &bsdtar_shard, &bsdtar_nb_shards);
+    }
+
     argument.argc = argc - optind;
     argument.argv = argv + optind;
 
@@ -568,6 +581,9 @@ main(
     if (bsdtar_target) {
 	g_debug("TARGET %s", bsdtar_target);
     }
+    if (bsdtar_nb_shards > 1) {
+	g_debug("SHARD %d/%d", bsdtar_shard, bsdtar_nb_shards);
+    }
     g_debug("ONE-FILE-SYSTEM %s", bsdtar_onefilesystem? "yes":"no");
     {
 	amregex_t *rp;
@@ -712,6 +728,15 @@ ambsdtar_selfcheck(
 			"command-options", option)));
     }
 
+    if (bsdtar_shard_value && bsdtar_nb_shards == 0) {
+	delete_message(ambsdtar_print_message(build_message(
+			AMANDA_FILE, __LINE__, 3702021, MSG_ERROR, 4,
+			"value", bsdtar_shard_value,
+			"disk", argument->dle.disk,
+			"device", argument->dle.device,
+			"hostname", argument->host)));
+    }
+
     if (bsdtar_path) {
 	char *bsdtar_realpath;
 	message_t *message;
@@ -837,6 +862,12 @@ ambsdtar_estimate(
 	error("Invalid '%s' COMMAND-OPTIONS", option);
     }
 
+    if (bsdtar_shard_value && bsdtar_nb_shards == 0) {
+	fprintf(stdout, "ERROR bad SHARD property value '%s'\n",
+		bsdtar_shard_value);
+	error("bad SHARD property value '%s'", bsdtar_shard_value);
+    }
+
     if (state_dir && strlen(state_dir) == 0)
 	state_dir = NULL;
     if (state_dir) {
@@ -856,6 +887,7 @@ ambsdtar_estimate(
 	char *dirname;
 	int   nb_exclude;
 	int   nb_include;
+	int   shard_ok;
 	messagelist_t mlist = NULL;
 	messagelist_t mesglist = NULL;
 
@@ -864,7 +896,7 @@ ambsdtar_estimate(
 	} else {
 	    dirname = argument->dle.device;
 	}
-	ambsdtar_build_exinclude(&argument->dle,
+	shard_ok = ambsdtar_build_exinclude(&argument->dle,
 				 &nb_exclude, &file_exclude,
 				 &nb_include, &file_include, dirname, &mlist);
 	for (mesglist = mlist; mesglist != NULL; mesglist = mesglist->next){
@@ -876,8 +908,13 @@ ambsdtar_estimate(
 	g_slist_free(mlist);
 	mlist = NULL;
 
-	run_calcsize(argument->config, "BSDTAR", argument->dle.disk, dirname,
-		     argument->level, file_exclude, file_include);
+	if (shard_ok) {
+	    run_calcsize(argument->config, "BSDTAR", argument->dle.disk,
+			 dirname, argument->level, file_exclude, file_include);
+	} else {
+	    fprintf(stdout, "ERROR Can't build SHARD %d/%d\n",
+		    bsdtar_shard, bsdtar_nb_shards);
+	}
 
 	if (argument->verbose == 0) {
 	    if (file_exclude)
@@ -924,6 +961,13 @@ ambsdtar_estimate(
 
 	amfree(timestamps);
 
+	if (!argv_ptr) {
+	    errmsg = g_strdup_printf(_("Can't build SHARD %d/%d"),
+				     bsdtar_shard, bsdtar_nb_shards);
+	    size = -1;
+	    goto common_exit;
+	}
+
 	start_time = curclock();
 
 	if ((nullfd = open("/dev/null", O_RDWR)) == -1) {
@@ -1039,7 +1083,8 @@ common_exit:
 		unlink(file_include);
         }
 
-	g_ptr_array_free_full(argv_ptr);
+	if (argv_ptr)
+	    g_ptr_array_free_full(argv_ptr);
 	amfree(bsdtar_path);
 	amfree(incrname);
 
@@ -1296,6 +1341,12 @@ ambsdtar_backup(
 	exit(1);
     }
 
+    if (bsdtar_shard_value && bsdtar_nb_shards == 0) {
+	fprintf(mesgstream, "sendbackup: error [bad SHARD property value '%s']\n",
+		bsdtar_shard_value);
+	exit(1);
+    }
+
     if (state_dir && strlen(state_dir) == 0)
 	state_dir = NULL;
     if (state_dir) {
@@ -1347,6 +1398,12 @@ ambsdtar_backup(
     g_slist_free(mlist);
     mlist = NULL;
 
+    if (!argv_ptr) {
+	fprintf(mesgstream, "sendbackup: error [Can't build SHARD %d/%d]\n",
+		bsdtar_shard, bsdtar_nb_shards);
+	exit(1);
+    }
+
     if (argument->dle.create_index) {
 	tarpid = pipespawnv(bsdtar_path, STDIN_PIPE|STDOUT_PIPE|STDERR_PIPE, 1,
 			&dumpin, &data_out, &outf, (char **)argv_ptr->pdata);
@@ -1984,7 +2041,7 @@ ambsdtar_index(
     amfree(cmd);
 }
 
-static void
+static int
 ambsdtar_build_exinclude(
     dle_t  *dle,
     int    *nb_exclude,
@@ -1998,6 +2055,7 @@ ambsdtar_build_exinclude(
     int n_include = 0;
     char *exclude = NULL;
     char *include = NULL;
+    int   rval = 1;
 
     if (dle->exclude_file) n_exclude += dle->exclude_file->nb_element;
     if (dle->exclude_list) n_exclude += dle->exclude_list->nb_element;
@@ -2006,6 +2064,12 @@ ambsdtar_build_exinclude(
 
     if (n_exclude > 0) exclude = build_exclude(dle, mlist);
     if (n_include > 0) include = build_include(dle, dirname, mlist);
+    if (bsdtar_nb_shards > 1) {
+	rval = build_shard_exinclude(dle, dirname, &include, &exclude,
+				     bsdtar_shard, bsdtar_nb_shards, mlist);
+	n_exclude = exclude ? 1 : 0;
+	n_include = include ? 1 : 0;
+    }
 
     if (nb_exclude)
 	*nb_exclude = n_exclude;
@@ -2020,6 +2084,8 @@ ambsdtar_build_exinclude(
 	*file_include = include;
     else
 	amfree(include);
+
+    return rval;
 }
 
 static char *
@@ -2197,9 +2263,13 @@ ambsdtar_build_argv(
 	dirname = argument->dle.device;
     }
 
-    ambsdtar_build_exinclude(&argument->dle,
-			     &nb_exclude, file_exclude,
-			     &nb_include, file_include, dirname, mlist);
+    if (!ambsdtar_build_exinclude(&argument->dle,
+				  &nb_exclude, file_exclude,
+				  &nb_include, file_include, dirname, mlist)) {
+	/* never back up more than the shard */
+	g_ptr_array_free(argv_ptr, TRUE);
+	return NULL;
+    }
 
     g_ptr_array_add(argv_ptr, g_strdup(bsdtar_realpath));
 
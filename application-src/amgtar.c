@@ -60,6 +60,7 @@
  * TAR-BLOCKSIZE   (default does not add --blocking-factor option,
  *                  using tar's default)
  * VERBOSE
+ * SHARD           (i/n, back up only shard i of n of the top-level entries)
  */
 
 #include "amanda.h"
@@ -112,6 +113,10 @@ static amregex_t init_re_table[] = {
 };
 static amregex_t *re_table;
 
+/* DAR ranges closer than this are merged; reading through a small gap
+ * costs less than restarting the transfer at a new offset. */
+#define DAR_MERGE_GAP (1024*1024)
+
 /* local functions */
 int main(int argc, char **argv);
 
@@ -151,10 +156,10 @@ static void amgtar_backup(application_argument_t *argument);
 static void amgtar_restore(application_argument_t *argument);
 static void amgtar_validate(application_argument_t *argument);
 static void amgtar_index(application_argument_t *argument);
-static void amgtar_build_exinclude(dle_t *dle,
-				   int *nb_exclude, char **file_exclude,
-				   int *nb_include, char **file_includei,
-				   char *dirname, messagelist_t *mlist);
+static int amgtar_build_exinclude(dle_t *dle,
+				  int *nb_exclude, char **file_exclude,
+				  int *nb_include, char **file_includei,
+				  char *dirname, messagelist_t *mlist);
 static char *amgtar_get_incrname(application_argument_t *argument, int level,
 				 FILE *mesgstream, int command);
 static void check_no_check_device(void);
@@ -176,6 +181,9 @@ static int gnutar_checkdevice;
 static int gnutar_no_unquote;
 static int gnutar_sparse;
 static int gnutar_sparse_set = 0;
+static char *gnutar_shard_value = NULL;
+static int gnutar_shard = 0;
+static int gnutar_nb_shards = 0;
 static GSList *normal_message = NULL;
 static GSList *ignore_message = NULL;
 static GSList *strange_message = NULL;
@@ -231,6 +239,7 @@ static struct option long_options[] = {
     {"cmd-from-sendbackup=s"  , 1, NULL, 44},
     {"cmd-to-sendbackup=s"    , 1, NULL, 45},
     {"server-backup-result"   , 1, NULL, 46},
+    {"shard"                  , 1, NULL, 47},
     {NULL, 0, NULL, 0}
 };
 
@@ -592,6 +601,9 @@ main(
 		 break;
 	case 46: argument.server_backup_result = 1;
 		 break;
+	case 47: amfree(gnutar_shard_value);
+		 gnutar_shard_value = g_strdup(optarg);
+		 break;
 	case ':':
 	case '?':
 		break;
@@ -713,6 +725,11 @@ main(
 	}
     }
 
+    /* a bad SHARD is rejected by selfcheck, estimate and backup */
+    if (gnutar_shard_value) {
+	parse_shard(gnutar_shard_value, &gnutar_shard, &gnutar_nb_shards);
+    }
+
     argument.argc = argc - optind;
     argument.argv = argv + optind;
 
@@ -770,6 +787,9 @@ main(
     if (gnutar_target) {
 	dbprintf("TARGET %s\n", gnutar_target);
     }
+    if (gnutar_nb_shards > 1) {
+	dbprintf("SHARD %d/%d\n", gnutar_shard, gnutar_nb_shards);
+    }
     dbprintf("ONE-FILE-SYSTEM %s\n", gnutar_onefilesystem? "yes":"no");
     dbprintf("SPARSE %s\n", gnutar_sparse? "yes":"no");
     dbprintf("NO-UNQUOTE %s\n", gnutar_no_unquote? "yes":"no");
@@ -1022,6 +1042,15 @@ amgtar_selfcheck(
 		"command-options", option)));
     }
 
+    if (gnutar_shard_value && gnutar_nb_shards == 0) {
+	delete_message(amgtar_print_message(build_message(
+		AMANDA_FILE, __LINE__, 3700016, MSG_ERROR, 4,
+		"value", gnutar_shard_value,
+		"disk", argument->dle.disk,
+		"device", argument->dle.device,
+		"hostname", argument->host)));
+    }
+
     if (gnutar_path) {
 	char *gnutar_realpath = NULL;
 	message_t *message;
@@ -1142,10 +1171,17 @@ amgtar_estimate(
 	error("Invalid '%s' COMMAND-OPTIONS", option);
     }
 
+    if (gnutar_shard_value && gnutar_nb_shards == 0) {
+	fprintf(stderr, "ERROR bad SHARD property value '%s'\n",
+		gnutar_shard_value);
+	error("bad SHARD property value '%s'", gnutar_shard_value);
+    }
+
     if (argument->calcsize) {
 	char *dirname;
 	int   nb_exclude;
 	int   nb_include;
+	int   shard_ok;
 	messagelist_t mlist = NULL;
 	messagelist_t mesglist = NULL;
 
@@ -1155,7 +1191,7 @@ amgtar_estimate(
 	    dirname = argument->dle.device;
 	}
 
-	amgtar_build_exinclude(&argument->dle,
+	shard_ok = amgtar_build_exinclude(&argument->dle,
 			       &nb_exclude, &file_exclude,
 			       &nb_include, &file_include, dirname, &mlist);
 	for (mesglist = mlist; mesglist != NULL; mesglist = mesglist->next){
@@ -1167,8 +1203,13 @@ amgtar_estimate(
 	g_slist_free(mlist);
 	mlist = NULL;
 
-	run_calcsize(argument->config, "GNUTAR", argument->dle.disk, dirname,
-		     argument->level, file_exclude, file_include);
+	if (shard_ok) {
+	    run_calcsize(argument->config, "GNUTAR", argument->dle.disk,
+			 dirname, argument->level, file_exclude, file_include);
+	} else {
+	    fprintf(stdout, "ERROR Can't build SHARD %d/%d\n",
+		    gnutar_shard, gnutar_nb_shards);
+	}
 
 	if (argument->verbose == 0) {
 	    if (file_exclude)
@@ -1215,6 +1256,13 @@ amgtar_estimate(
 	g_slist_free(mlist);
 	mlist = NULL;
 
+	if (!argv_ptr) {
+	    errmsg = g_strdup_printf(_("Can't build SHARD %d/%d"),
+				     gnutar_shard, gnutar_nb_shards);
+	    size = -1;
+	    goto common_exit;
+	}
+
 	start_time = curclock();
 
 	if ((nullfd = open("/dev/null", O_RDWR)) == -1) {
@@ -1322,7 +1370,8 @@ common_exit:
 		unlink(file_include);
         }
 
-	g_ptr_array_free_full(argv_ptr);
+	if (argv_ptr)
+	    g_ptr_array_free_full(argv_ptr);
 	amfree(incrname);
 
 	aclose(nullfd);
@@ -1417,6 +1466,12 @@ amgtar_backup(
 	error("Invalid '%s' COMMAND-OPTIONS", option);
     }
 
+    if (gnutar_shard_value && gnutar_nb_shards == 0) {
+	fprintf(mesgstream, "? bad SHARD property value '%s'\n",
+		gnutar_shard_value);
+	error("bad SHARD property value '%s'", gnutar_shard_value);
+    }
+
     if (argument->cmd_from_sendbackup >= 0) {
 	cmdin = fdopen(argument->cmd_from_sendbackup, "r");
 	if (!cmdin) {
@@ -1456,6 +1511,12 @@ amgtar_backup(
     }
     g_slist_free(mlist);
 
+    if (!argv_ptr) {
+	fprintf(mesgstream, "sendbackup: error [Can't build SHARD %d/%d]\n",
+		gnutar_shard, gnutar_nb_shards);
+	exit(1);
+    }
+
     tarpid = pipespawnv(gnutar_realpath, STDIN_PIPE|STDERR_PIPE, 1,
 			&dumpin, &dataf, &outf, (char **)argv_ptr->pdata);
     /* close the write ends of the pipes */
@@ -1897,14 +1958,28 @@ amgtar_restore(
 		fprintf(dar_file,"DAR 0:-1\n");
 		g_debug("full dar: 0:-1");
 	    } else {
-		int   previous_block = -1;
+		GHashTable *include_hash = g_hash_table_new(g_str_hash,
+							    g_str_equal);
+		off_t       previous_block = -1;
+		off_t       range_start = -1;
+		off_t       range_end = -1;
+		gboolean    match_all = FALSE;
+		guint       i;
+
+		/* index the requested paths without their leading '.'; "." or
+		 * "./" is the whole DLE */
+		for (i = 0; i < include_array->len; i++) {
+		    char *ii = g_ptr_array_index(include_array, i);
+		    if (g_str_equal(ii + 1, "") || g_str_equal(ii + 1, "/"))
+			match_all = TRUE;
+		    g_hash_table_insert(include_hash, ii + 1, ii);
+		}
 
 		while (fgets(line, 32768, recover_state_file) != NULL) {
 		    off_t     block_no = g_ascii_strtoull(line, NULL, 0);
 		    gboolean  match    = FALSE;
 		    char     *filename = strchr(line, ' ');
-		    char     *ii;
-		    guint     i;
+		    char     *slash;
 
 		    if (!filename)
 			continue;
@@ -1915,20 +1990,19 @@ amgtar_restore(
 
 		    g_debug("recover_dump_state_file: %lld %s",
 					 (long long)block_no, filename);
-		    for (i = 0; i < include_array->len; i++) {
-			size_t strlenii;
-
-			ii = g_ptr_array_index(include_array, i);
-			ii++; // remove leading '.'
-			//g_debug("check %s : %s :", filename, ii);
-			strlenii = strlen(ii);
-			if (g_str_equal(filename, ii) == 1 ||
-			    (strlenii < strlen(filename) &&
-			     strncmp(filename, ii, strlenii) == 0 &&
-			     filename[strlenii] == '/')) {
-			    //g_debug("match %s", ii);
-			    match = TRUE;
-			    break;
+
+		    /* match the file itself or any of its parent directories */
+		    if (match_all ||
+			g_hash_table_lookup(include_hash, filename)) {
+			match = TRUE;
+		    } else {
+			for (slash = strchr(filename + 1, '/');
+			     slash != NULL && !match;
+			     slash = strchr(slash + 1, '/')) {
+			    *slash = '\0';
+			    match = g_hash_table_lookup(include_hash,
+							filename) != NULL;
+			    *slash = '/';
 			}
 		    }
 
@@ -1941,19 +2015,42 @@ amgtar_restore(
 				(long long)previous_block,
 				(long long)block_no * 512 - 1,
 				(long long)block_no);
-			fprintf(dar_file, "DAR %lld:%lld\n",
-				(long long)previous_block * 512,
-				(long long)block_no * 512- 1);
+			if (range_start >= 0 &&
+			    previous_block * 512 - range_end <= DAR_MERGE_GAP) {
+			    /* cheaper to read through the gap than to seek */
+			    range_end = block_no * 512 - 1;
+			} else {
+			    if (range_start >= 0) {
+				fprintf(dar_file, "DAR %lld:%lld\n",
+					(long long)range_start,
+					(long long)range_end);
+			    }
+			    range_start = previous_block * 512;
+			    range_end = block_no * 512 - 1;
+			}
 			previous_block = -1;
 		    }
 		}
 		fclose(recover_state_file);
+		g_hash_table_destroy(include_hash);
 		if (previous_block >= 0) {
 		    g_debug("restore block %lld (%lld) to END",
 			    (long long)previous_block * 512,
 			    (long long)previous_block);
+		    if (range_start >= 0 &&
+			previous_block * 512 - range_end <= DAR_MERGE_GAP) {
+			previous_block = range_start / 512;
+		    } else if (range_start >= 0) {
+			fprintf(dar_file, "DAR %lld:%lld\n",
+				(long long)range_start,
+				(long long)range_end);
+		    }
 		    fprintf(dar_file, "DAR %lld:-1\n",
 			    (long long)previous_block * 512);
+		} else if (range_start >= 0) {
+		    fprintf(dar_file, "DAR %lld:%lld\n",
+			    (long long)range_start,
+			    (long long)range_end);
 		}
 	    }
 	} else {
@@ -2127,7 +2224,7 @@ amgtar_index(
     amfree(cmd);
 }
 
-static void
+static int
 amgtar_build_exinclude(
     dle_t  *dle,
     int    *nb_exclude,
@@ -2141,6 +2238,7 @@ amgtar_build_exinclude(
     int n_include = 0;
     char *exclude = NULL;
     char *include = NULL;
+    int   rval = 1;
 
     if (dle->exclude_file) n_exclude += dle->exclude_file->nb_element;
     if (dle->exclude_list) n_exclude += dle->exclude_list->nb_element;
@@ -2149,6 +2247,12 @@ amgtar_build_exinclude(
 
     if (n_exclude > 0) exclude = build_exclude(dle, mlist);
     if (n_include > 0) include = build_include(dle, dirname, mlist);
+    if (gnutar_nb_shards > 1) {
+	rval = build_shard_exinclude(dle, dirname, &include, &exclude,
+				     gnutar_shard, gnutar_nb_shards, mlist);
+	n_exclude = exclude ? 1 : 0;
+	n_include = include ? 1 : 0;
+    }
 
     if (nb_exclude)
 	*nb_exclude = n_exclude;
@@ -2163,6 +2267,8 @@ amgtar_build_exinclude(
 	*file_include = include;
     else
 	amfree(include);
+
+    return rval;
 }
 
 static char *
@@ -2385,9 +2491,13 @@ GPtrArray *amgtar_build_argv(
 	dirname = argument->dle.device;
     }
 
-    amgtar_build_exinclude(&argument->dle,
-			   &nb_exclude, file_exclude,
-			   &nb_include, file_include, dirname, mlist);
+    if (!amgtar_build_exinclude(&argument->dle,
+				&nb_exclude, file_exclude,
+				&nb_include, file_include, dirname, mlist)) {
+	/* never back up more than the shard */
+	g_ptr_array_free(argv_ptr, TRUE);
+	return NULL;
+    }
 
     g_ptr_array_add(argv_ptr, g_strdup(gnutar_realpath));
 
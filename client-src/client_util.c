@@ -438,6 +438,199 @@ build_include(
 }
 
 
+/* FNV-1a of the top-level name of an include entry ("./name/..."), so that
+ * the shard of an entry is the same on every run. */
+static guint32
+shard_hash(
+    const char *entry)
+{
+    guint32 hash = 2166136261U;
+    const char *p = entry;
+
+    if (strncmp(p, "./", 2) == 0)
+	p += 2;
+    for (; *p != '\0' && *p != '/'; p++) {
+	hash ^= (guchar)*p;
+	hash *= 16777619U;
+    }
+    return hash;
+}
+
+/* Escape the wildcards of a name, so that tar excludes only that name. */
+static char *
+escape_exclude(
+    const char *name)
+{
+    GString *strbuf = g_string_new(NULL);
+    const char *p;
+
+    for (p = name; *p != '\0'; p++) {
+	if (*p == '\\' || *p == '*' || *p == '?' || *p == '[')
+	    g_string_append_c(strbuf, '\\');
+	g_string_append_c(strbuf, *p);
+    }
+    return g_string_free(strbuf, FALSE);
+}
+
+int
+build_shard_exinclude(
+    dle_t         *dle,
+    char const    *dirname,
+    char         **include,
+    char         **exclude,
+    int            shard,
+    int            nb_shards,
+    messagelist_t *mlist)
+{
+    GPtrArray *entries = g_ptr_array_new_with_free_func(g_free);
+    FILE *file_include;
+    FILE *file_exclude;
+    char *ainc;
+    guint i;
+    int nb_include = 0;
+    int nb_exp = 0;
+    gboolean top_dir = FALSE;
+
+    if (dle->include_file) nb_include += dle->include_file->nb_element;
+    if (dle->include_list) nb_include += dle->include_list->nb_element;
+
+    if (nb_include > 0) {
+	/* the entries of the include list */
+	if (*include == NULL) {
+	    /* build_include failed, the error is already in mlist */
+	    goto error;
+	}
+	if ((file_include = fopen(*include, "r")) == NULL) {
+	    *mlist = g_slist_append(*mlist, build_message(
+				__FILE__, __LINE__, 4600006, MSG_ERROR, 2,
+				"include", *include,
+				"errno"  , errno));
+	    goto error;
+	}
+	while ((ainc = pgets(file_include)) != NULL) {
+	    if (ainc[0] == '\0')
+		g_free(ainc);
+	    else
+		g_ptr_array_add(entries, ainc);
+	}
+	fclose(file_include);
+    } else {
+	/* the entries of the top-level directory */
+	DIR *d;
+	struct dirent *entry;
+	int set_root;
+	int save_errno;
+
+	set_root = set_root_privs(1);
+	d = opendir(dirname);
+	save_errno = errno;
+	if (d) {
+	    while ((entry = readdir(d)) != NULL) {
+		if (is_dot_or_dotdot(entry->d_name))
+		    continue;
+		g_ptr_array_add(entries, g_strconcat("./", entry->d_name, NULL));
+	    }
+	    closedir(d);
+	}
+	if (set_root)
+	    set_root_privs(0);
+	if (!d) {
+	    *mlist = g_slist_append(*mlist, build_message(
+				__FILE__, __LINE__, 4600009, MSG_ERROR, 2,
+				"dirname", dirname,
+				"errno"  , save_errno));
+	    goto error;
+	}
+
+	/* The first shard also holds the directory itself: it backs up "."
+	 * and excludes the entries of the other shards, so that the
+	 * directory of a listed incremental still lists them all. */
+	top_dir = (shard == 1);
+	if (!top_dir &&
+	    (*include = build_name(dle->disk, "include", mlist)) == NULL) {
+	    goto error;
+	}
+    }
+
+    if (top_dir) {
+	if (*exclude == NULL &&
+	    (*exclude = build_name(dle->disk, "exclude", mlist)) == NULL) {
+	    goto error;
+	}
+	if ((file_exclude = fopen(*exclude, "a")) == NULL) {
+	    *mlist = g_slist_append(*mlist, build_message(
+				__FILE__, __LINE__, 4600003, MSG_ERROR, 2,
+				"exclude", *exclude,
+				"errno"  , errno));
+	    goto error;
+	}
+	for (i = 0; i < entries->len; i++) {
+	    char *entry = g_ptr_array_index(entries, i);
+
+	    if ((int)(shard_hash(entry) % nb_shards) == shard - 1) {
+		nb_exp++;
+	    } else {
+		char *escaped = escape_exclude(entry);
+		g_fprintf(file_exclude, "%s\n", escaped);
+		g_free(escaped);
+	    }
+	}
+	fclose(file_exclude);
+    } else {
+	if ((file_include = fopen(*include, "w")) == NULL) {
+	    *mlist = g_slist_append(*mlist, build_message(
+				__FILE__, __LINE__, 4600007, MSG_ERROR, 2,
+				"include", *include,
+				"errno"  , errno));
+	    goto error;
+	}
+	for (i = 0; i < entries->len; i++) {
+	    char *entry = g_ptr_array_index(entries, i);
+
+	    if ((int)(shard_hash(entry) % nb_shards) == shard - 1) {
+		g_fprintf(file_include, "%s\n", entry);
+		nb_exp++;
+	    }
+	}
+	fclose(file_include);
+    }
+    g_ptr_array_free(entries, TRUE);
+
+    dbprintf("shard %d/%d of %s: %d entries%s\n", shard, nb_shards,
+	     dle->disk, nb_exp, top_dir ? " and the directory" : "");
+
+    return 1;
+
+error:
+    g_ptr_array_free(entries, TRUE);
+    return 0;
+}
+
+int
+parse_shard(
+    const char *str,
+    int        *shard,
+    int        *nb_shards)
+{
+    char *end;
+    long  s, n;
+
+    s = strtol(str, &end, 10);
+    if (end == str || *end != '/')
+	return 0;
+    str = end + 1;
+    n = strtol(str, &end, 10);
+    if (end == str || *end != '\0')
+	return 0;
+    if (n < 1 || n > 1024 || s < 1 || s > n)
+	return 0;
+
+    *shard = (int)s;
+    *nb_shards = (int)n;
+    return 1;
+}
+
+
 void
 parse_options(
     char         *str,
@@ -2137,3 +2330,267 @@ build_re_table(
     return new_re_table;
 }
 
+
+#ifdef TEST
+
+/* Add the lines of filename to names; unescape exclude patterns if unescape */
+static void
+read_names(
+    const char *filename,
+    GHashTable *names,
+    gboolean    unescape)
+{
+    FILE *file;
+    char *line;
+
+    if ((file = fopen(filename, "r")) == NULL)
+	return;
+    while ((line = pgets(file)) != NULL) {
+	if (unescape) {
+	    char *p, *q;
+
+	    for (p = q = line; *p != '\0'; p++) {
+		if (*p == '\\' && p[1] != '\0')
+		    p++;
+		*q++ = *p;
+	    }
+	    *q = '\0';
+	}
+	g_hash_table_insert(names, line, line);
+    }
+    fclose(file);
+}
+
+/*
+ * Build each shard of dirname and check that every entry is in exactly one
+ * shard, and that only the first shard, without an include list, backs up
+ * the directory itself.
+ */
+static gboolean
+check_shards(
+    const char *name,
+    dle_t      *dle,
+    const char *dirname,
+    GPtrArray  *all,
+    int         nb_shards)
+{
+    GHashTable *seen = g_hash_table_new_full(g_str_hash, g_str_equal,
+					     g_free, NULL);
+    gboolean    has_include = dle->include_file || dle->include_list;
+    gboolean    ok = TRUE;
+    int         shard;
+    guint       i;
+
+    for (shard = 1; ok && shard <= nb_shards; shard++) {
+	GHashTable *names = g_hash_table_new_full(g_str_hash, g_str_equal,
+						  g_free, NULL);
+	GHashTableIter iter;
+	gpointer    key;
+	messagelist_t mlist = NULL;
+	char       *include = NULL;
+	char       *exclude = NULL;
+	gboolean    top_dir = !has_include && shard == 1;
+
+	if (has_include)
+	    include = build_include(dle, dirname, &mlist);
+	if (!build_shard_exinclude(dle, dirname, &include, &exclude,
+				   shard, nb_shards, &mlist)) {
+	    g_fprintf(stderr, "%s: shard %d failed\n", name, shard);
+	    ok = FALSE;
+	} else if ((include == NULL) != top_dir) {
+	    g_fprintf(stderr, "%s: shard %d %s an include file\n", name, shard,
+		      include ? "has" : "has no");
+	    ok = FALSE;
+	} else if (include) {
+	    read_names(include, names, FALSE);
+	} else {
+	    /* "." less the entries of the other shards */
+	    read_names(exclude, names, TRUE);
+	    for (i = 0; i < all->len; i++) {
+		char *entry = g_ptr_array_index(all, i);
+
+		if (g_hash_table_lookup(names, entry))
+		    g_hash_table_remove(names, entry);
+		else
+		    g_hash_table_insert(names, g_strdup(entry), NULL);
+	    }
+	}
+
+	g_hash_table_iter_init(&iter, names);
+	while (ok && g_hash_table_iter_next(&iter, &key, NULL)) {
+	    if (g_hash_table_lookup(seen, key)) {
+		g_fprintf(stderr, "%s: %s is in two shards\n", name,
+			  (char *)key);
+		ok = FALSE;
+	    }
+	    g_hash_table_insert(seen, g_strdup(key), GINT_TO_POINTER(1));
+	}
+
+	if (include)
+	    unlink(include);
+	if (exclude)
+	    unlink(exclude);
+	amfree(include);
+	amfree(exclude);
+	g_hash_table_destroy(names);
+	slist_free_full(mlist, (GDestroyNotify)delete_message);
+    }
+
+    if (ok && g_hash_table_size(seen) != all->len) {
+	g_fprintf(stderr, "%s: %u entries in the shards, %u expected\n", name,
+		  g_hash_table_size(seen), all->len);
+	ok = FALSE;
+    }
+    for (i = 0; ok && i < all->len; i++) {
+	if (!g_hash_table_lookup(seen, g_ptr_array_index(all, i))) {
+	    g_fprintf(stderr, "%s: %s is in no shard\n", name,
+		      (char *)g_ptr_array_index(all, i));
+	    ok = FALSE;
+	}
+    }
+
+    g_fprintf(stderr, "%s %s\n", ok ? "PASS" : "FAIL", name);
+    g_hash_table_destroy(seen);
+    return ok;
+}
+
+static gboolean
+check_parse_shard(void)
+{
+    static struct {
+	const char *str;
+	int valid;
+	int shard;
+	int nb_shards;
+    } tests[] = {
+	{ "1/3", 1, 1, 3 },
+	{ "3/3", 1, 3, 3 },
+	{ "1/1", 1, 1, 1 },
+	{ "1024/1024", 1, 1024, 1024 },
+	{ "0/3", 0, 0, 0 },
+	{ "4/3", 0, 0, 0 },
+	{ "1/0", 0, 0, 0 },
+	{ "1/1025", 0, 0, 0 },
+	{ "a/3", 0, 0, 0 },
+	{ "/3", 0, 0, 0 },
+	{ "1/", 0, 0, 0 },
+	{ "1/3x", 0, 0, 0 },
+	{ "13", 0, 0, 0 },
+	{ "", 0, 0, 0 },
+    };
+    gboolean ok = TRUE;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(tests); i++) {
+	int shard = 0, nb_shards = 0;
+	int valid = parse_shard(tests[i].str, &shard, &nb_shards);
+
+	if (valid != tests[i].valid ||
+	    (valid && (shard != tests[i].shard ||
+		       nb_shards != tests[i].nb_shards))) {
+	    g_fprintf(stderr, "parse_shard(\"%s\"): got %d %d/%d\n",
+		      tests[i].str, valid, shard, nb_shards);
+	    ok = FALSE;
+	}
+    }
+
+    g_fprintf(stderr, "%s parse_shard\n", ok ? "PASS" : "FAIL");
+    return ok;
+}
+
+int
+main(
+    int		argc G_GNUC_UNUSED,
+    char **	argv G_GNUC_UNUSED)
+{
+    static char *special[] = { "a*b", "q?", "[x]", "back\\slash", "sp ace" };
+    GPtrArray *all = g_ptr_array_new_with_free_func(g_free);
+    GPtrArray *included = g_ptr_array_new_with_free_func(g_free);
+    char       dirname[] = "/tmp/amclient_util-test.XXXXXX";
+    dle_t      dle;
+    messagelist_t mlist = NULL;
+    char      *include = NULL;
+    char      *exclude = NULL;
+    char      *path;
+    gboolean   ok = TRUE;
+    guint      i;
+
+    glib_init();
+
+    setlocale(LC_MESSAGES, "C");
+    textdomain("amanda");
+
+    safe_fd(-1, 0);
+
+    set_pname("client_util");
+
+    config_init(CONFIG_INIT_CLIENT|CONFIG_INIT_GLOBAL, NULL);
+
+    /* build_name makes the include and exclude files there */
+    if (mkdir(AMANDA_TMPDIR, 0700) != 0 && errno != EEXIST) {
+	g_fprintf(stderr, "mkdir %s: %s\n", AMANDA_TMPDIR, strerror(errno));
+	return 1;
+    }
+
+    if (mkdtemp(dirname) == NULL) {
+	g_fprintf(stderr, "mkdtemp: %s\n", strerror(errno));
+	return 1;
+    }
+    for (i = 0; i < 40; i++)
+	g_ptr_array_add(all, g_strdup_printf("./e%02u", i));
+    for (i = 0; i < G_N_ELEMENTS(special); i++)
+	g_ptr_array_add(all, g_strconcat("./", special[i], NULL));
+    for (i = 0; i < all->len; i++) {
+	char *entry = g_ptr_array_index(all, i);
+
+	path = g_strconcat(dirname, entry + 1, NULL);
+	if (mkdir(path, 0700) != 0) {
+	    g_fprintf(stderr, "mkdir %s: %s\n", path, strerror(errno));
+	    ok = FALSE;
+	}
+	g_free(path);
+	if (entry[2] == 'e' && entry[3] == '1')
+	    g_ptr_array_add(included, g_strdup(entry));
+    }
+
+    init_dle(&dle);
+    dle.disk = "client_util-test";
+    dle.device = dirname;
+
+    ok &= check_parse_shard();
+    ok &= check_shards("one shard of the directory", &dle, dirname, all, 1);
+    ok &= check_shards("three shards of the directory", &dle, dirname, all, 3);
+    ok &= check_shards("seven shards of the directory", &dle, dirname, all, 7);
+
+    dle.include_file = new_sl();
+    dle.include_file = append_sl(dle.include_file, "./e1*");
+    ok &= check_shards("three shards of the include list", &dle, dirname,
+		       included, 3);
+    free_sl(dle.include_file);
+    dle.include_file = NULL;
+
+    /* no shard rather than the whole directory */
+    path = g_strconcat(dirname, "/missing", NULL);
+    if (build_shard_exinclude(&dle, path, &include, &exclude, 1, 3, &mlist) ||
+	mlist == NULL || include || exclude) {
+	g_fprintf(stderr, "FAIL missing directory\n");
+	ok = FALSE;
+    } else {
+	g_fprintf(stderr, "PASS missing directory\n");
+    }
+    g_free(path);
+    slist_free_full(mlist, (GDestroyNotify)delete_message);
+
+    for (i = 0; i < all->len; i++) {
+	path = g_strconcat(dirname, (char *)g_ptr_array_index(all, i) + 1, NULL);
+	rmdir(path);
+	g_free(path);
+    }
+    rmdir(dirname);
+    g_ptr_array_free(all, TRUE);
+    g_ptr_array_free(included, TRUE);
+
+    return ok ? 0 : 1;
+}
+
+#endif /* TEST */
@@ -77,6 +77,35 @@ typedef struct regex_s {
 
 char *build_exclude(dle_t *dle, messagelist_t *mlist);
 char *build_include(dle_t *dle, char const *dirname, messagelist_t *mlist);
+
+/* Restrict a backup to one shard of a DLE, so that a large DLE can be
+ * defined as several DLEs that are dumped in parallel.  The entries of the
+ * include file, or of dirname if there is no include list, are partitioned
+ * by a hash of their top-level name, and only those of the shard are kept.
+ * Without an include list, the first shard also holds dirname itself: its
+ * include file is NULL, so that "." is backed up, and the entries of the
+ * other shards are added to the exclude file.
+ *
+ * @param dle: the dle.
+ * @param dirname: the directory that is backed up.
+ * @param include: (in/out) the include file from build_include, or NULL;
+ *                 set to the include file of the shard.
+ * @param exclude: (in/out) the exclude file from build_exclude, or NULL.
+ * @param shard: the shard, from 1 to nb_shards.
+ * @param nb_shards: the number of shards.
+ * @param mlist: the list of messages.
+ * @returns: 1 on success, 0 if the shard can't be built; the backup must
+ *           then fail rather than back up the whole directory.
+ */
+int build_shard_exinclude(dle_t *dle, char const *dirname, char **include,
+			  char **exclude, int shard, int nb_shards,
+			  messagelist_t *mlist);
+
+/* Parse a SHARD property, "i/n".
+ *
+ * @returns: 1 if valid, setting shard and nb_shards.
+ */
+int parse_shard(const char *str, int *shard, int *nb_shards);
 void parse_options(char *str,
 		   dle_t *dle,
 		   am_feature_t *features,
@@ -91,6 +91,8 @@ typedef struct disk_estimates_s {
     char *qdirname;
     pid_t child;
     int done;
+    int have_dev;	/* st_dev is the device holding (or named by) dirname */
+    dev_t st_dev;
     dle_t *dle;
     int dle_scripts_exit_status;
     level_estimate_t est[DUMP_LEVELS];
@@ -103,6 +105,7 @@ static char *our_feature_string = NULL;
 static g_option_t *g_options = NULL;
 static gboolean amandates_started = FALSE;
 static int host_scripts_exit_status = 0;
+static int max_estimates_per_device = 0;
 
 /* local functions */
 int main(int argc, char **argv);
@@ -463,6 +466,7 @@ main(
 	return 1;
     }
 
+    max_estimates_per_device = getconf_int(CNF_MAX_ESTIMATES_PER_DEVICE);
     dumpsrunning = 0;
     need_wait = 0;
     done = 0;
@@ -550,6 +554,23 @@ main(
 		if(est1 != NULL) {
 		    continue;			/* spindle conflict */
 		}
+	    } else if (max_estimates_per_device > 0 && est->have_dev) {
+		/*
+		 * Without a spindle, limit the number of estimates
+		 * reading the same filesystem device.
+		 */
+		int on_device = 0;
+		for(est1 = est_list; est1 != NULL; est1 = est1->next) {
+		    if(est1->child == 0 || est == est1 || est1->done) {
+			continue;
+		    }
+		    if(est1->have_dev && est1->st_dev == est->st_dev) {
+			on_device++;
+		    }
+		}
+		if(on_device >= max_estimates_per_device) {
+		    continue;			/* device is busy */
+		}
 	    }
 	    break;				/* start this estimate */
 	}
@@ -710,6 +731,18 @@ dle_add_diskest(
 	newp->dirname = g_strdup("");
 	newp->qdirname = g_strdup("");
     }
+    if (*newp->dirname == '/') {
+	struct stat stat_buf;
+
+	if (stat(newp->dirname, &stat_buf) == 0) {
+	    newp->have_dev = 1;
+	    /* a raw device names the disk itself, not the /dev filesystem */
+	    if (S_ISBLK(stat_buf.st_mode) || S_ISCHR(stat_buf.st_mode))
+		newp->st_dev = stat_buf.st_rdev;
+	    else
+		newp->st_dev = stat_buf.st_dev;
+	}
+    }
     levellist = dle->levellist;
     while (levellist != NULL) {
 	am_level_t *alevel = (am_level_t *)levellist->data;
@@ -1482,6 +1482,8 @@ set_message(
 	msg = "Invalid '%{command-options}' COMMAND-OPTIONS";
     } else if (message->code == 3700015) {
 	msg = "bad DAR property value '%{property_value}'";
+    } else if (message->code == 3700016) {
+	msg = "bad SHARD property value '%{value}'";
 
     } else if (message->code == 3701000) {
 	msg = "%{disk}";
@@ -1526,6 +1528,8 @@ set_message(
         msg = "Invalid '%{command-options}' COMMAND-OPTIONS";
     } else if (message->code == 3702020) {
         msg = "No STATE-DIR";
+    } else if (message->code == 3702021) {
+	msg = "bad SHARD property value '%{value}'";
 
     } else if (message->code == 4600000) {
 	msg = "%{errmsg}";
@@ -1545,6 +1549,8 @@ set_message(
 	msg = "Can't create include file '%{include}': %{errnostr}";
     } else if (message->code == 4600008) {
 	msg = "Nothing found to include for disk '%{disk}'";
+    } else if (message->code == 4600009) {
+	msg = "Can't open directory '%{dirname}': %{errnostr}";
 
     } else {
 	msg = "no message for code '%{code}'";
@@ -70,6 +70,7 @@ typedef enum {
     CONF_LOGFILE,		CONF_DISKDIR,		CONF_DISKSIZE,
     CONF_INDEXDIR,		CONF_NETUSAGE,		CONF_INPARALLEL,
     CONF_DUMPORDER,		CONF_TIMEOUT,		CONF_TPCHANGER,
+    CONF_DUMP_TO_IDLE_TAPER,	CONF_HOLDING_STRIPE,
     CONF_RUNTAPES,		CONF_DEFINE,		CONF_DUMPTYPE,
     CONF_TAPETYPE,		CONF_INTERFACE,		CONF_PRINTER,
     CONF_MAILER,
@@ -153,10 +154,11 @@ typedef enum {
     /* client conf */
     CONF_CONF,			CONF_INDEX_SERVER,	CONF_TAPE_SERVER,
     CONF_SSH_KEYS,		CONF_GNUTAR_LIST_DIR,	CONF_AMANDATES,
-    CONF_AMDUMP_SERVER,		CONF_HOSTNAME,
+    CONF_AMDUMP_SERVER,		CONF_HOSTNAME,		CONF_MAX_ESTIMATES_PER_DEVICE,
 
     /* protocol config */
     CONF_REP_TRIES,		CONF_CONNECT_TRIES,	CONF_REQ_TRIES,
+    CONF_CONNECT_PARALLEL,	CONF_CONNECT_LINGER,
 
     /* debug config */
     CONF_DEBUG_DAYS,
@@ -190,6 +192,7 @@ typedef enum {
     /* part_cache_type */
     CONF_PART_SIZE,		CONF_PART_CACHE_TYPE,	CONF_PART_CACHE_DIR,
     CONF_PART_CACHE_MAX_SIZE,	CONF_DISK,		CONF_MEMORY,
+    CONF_PART_SIZE_MAX,
 
     /* host-limit */
     CONF_RECOVERY_LIMIT,	CONF_SAME_HOST,		CONF_DUMP_LIMIT,
@@ -924,6 +927,7 @@ keytab_t client_keytab[] = {
     { "CTIMEOUT", CONF_CTIMEOUT },
     { "COMMENT", CONF_COMMENT },
     { "CONF", CONF_CONF },
+    { "CONNECT_LINGER", CONF_CONNECT_LINGER },
     { "CONNECT_TRIES", CONF_CONNECT_TRIES },
     { "DEBUG_AMANDAD", CONF_DEBUG_AMANDAD },
     { "DEBUG_AMIDXTAPED", CONF_DEBUG_AMIDXTAPED },
@@ -955,6 +959,7 @@ keytab_t client_keytab[] = {
     { "KRB5KEYTAB", CONF_KRB5KEYTAB },
     { "KRB5PRINCIPAL", CONF_KRB5PRINCIPAL },
     { "MAILER", CONF_MAILER },
+    { "MAX_ESTIMATES_PER_DEVICE", CONF_MAX_ESTIMATES_PER_DEVICE },
     { "ORDER", CONF_ORDER },
     { "PLUGIN", CONF_PLUGIN },
     { "PRE_AMCHECK", CONF_PRE_AMCHECK },
@@ -1049,6 +1054,8 @@ keytab_t server_keytab[] = {
     { "COMPRATE", CONF_COMPRATE },
     { "COMPRESS", CONF_COMPRESS },
     { "COMPRESS_INDEX", CONF_COMPRESS_INDEX },
+    { "CONNECT_LINGER", CONF_CONNECT_LINGER },
+    { "CONNECT_PARALLEL", CONF_CONNECT_PARALLEL },
     { "CONNECT_TRIES", CONF_CONNECT_TRIES },
     { "CTIMEOUT", CONF_CTIMEOUT },
     { "CUSTOM", CONF_CUSTOM },
@@ -1086,6 +1093,7 @@ keytab_t server_keytab[] = {
     { "DUMPUSER", CONF_DUMPUSER },
     { "DUMP_LIMIT", CONF_DUMP_LIMIT },
     { "DUMP_SELECTION", CONF_DUMP_SELECTION },
+    { "DUMP_TO_IDLE_TAPER", CONF_DUMP_TO_IDLE_TAPER },
     { "EJECT_VOLUME", CONF_EJECT_VOLUME },
     { "ERASE_VOLUME", CONF_ERASE_VOLUME },
     { "ERASE_ON_FAILURE", CONF_ERASE_ON_FAILURE },
@@ -1111,6 +1119,7 @@ keytab_t server_keytab[] = {
     { "HIDDEN", CONF_HIDDEN },
     { "HIGH", CONF_HIGH },
     { "HOLDINGDISK", CONF_HOLDING },
+    { "HOLDING_STRIPE", CONF_HOLDING_STRIPE },
     { "IGNORE", CONF_IGNORE },
     { "INCLUDE", CONF_INCLUDE },
     { "INCLUDEFILE", CONF_INCLUDEFILE },
@@ -1162,6 +1171,7 @@ keytab_t server_keytab[] = {
     { "PART_CACHE_MAX_SIZE", CONF_PART_CACHE_MAX_SIZE },
     { "PART_CACHE_TYPE", CONF_PART_CACHE_TYPE },
     { "PART_SIZE", CONF_PART_SIZE },
+    { "PART_SIZE_MAX", CONF_PART_SIZE_MAX },
     { "PLUGIN", CONF_PLUGIN },
     { "PRE_AMCHECK", CONF_PRE_AMCHECK },
     { "POLICY", CONF_POLICY },
@@ -1382,6 +1392,7 @@ conf_var_t client_var [] = {
    { CONF_KRB5KEYTAB         , CONFTYPE_STR     , read_str     , CNF_KRB5KEYTAB         , NULL },
    { CONF_KRB5PRINCIPAL      , CONFTYPE_STR     , read_str     , CNF_KRB5PRINCIPAL      , NULL },
    { CONF_CONNECT_TRIES      , CONFTYPE_INT     , read_int     , CNF_CONNECT_TRIES      , validate_positive },
+   { CONF_CONNECT_LINGER     , CONFTYPE_INT     , read_int     , CNF_CONNECT_LINGER     , validate_nonnegative },
    { CONF_REP_TRIES          , CONFTYPE_INT     , read_int     , CNF_REP_TRIES          , validate_positive },
    { CONF_REQ_TRIES          , CONFTYPE_INT     , read_int     , CNF_REQ_TRIES          , validate_positive },
    { CONF_DEBUG_DAYS         , CONFTYPE_INT     , read_int     , CNF_DEBUG_DAYS         , NULL },
@@ -1409,6 +1420,7 @@ conf_var_t client_var [] = {
    { CONF_APPLICATION        , CONFTYPE_STR     , read_dapplication, DUMPTYPE_APPLICATION, NULL },
    { CONF_SCRIPT             , CONFTYPE_STR     , read_dpp_script, DUMPTYPE_SCRIPTLIST, NULL },
    { CONF_HOSTNAME           , CONFTYPE_STR     , read_str     , CNF_HOSTNAME           , NULL },
+   { CONF_MAX_ESTIMATES_PER_DEVICE, CONFTYPE_INT, read_int     , CNF_MAX_ESTIMATES_PER_DEVICE, validate_nonnegative },
    { CONF_UNKNOWN            , CONFTYPE_INT     , NULL         , CNF_CNF                , NULL }
 };
 
@@ -1432,6 +1444,7 @@ conf_var_t server_var [] = {
    { CONF_INDEXDIR             , CONFTYPE_STR      , read_str         , CNF_INDEXDIR             , NULL },
    { CONF_TAPETYPE             , CONFTYPE_IDENT    , read_ident       , CNF_TAPETYPE             , NULL },
    { CONF_HOLDING              , CONFTYPE_IDENTLIST, read_holdingdisk , CNF_HOLDINGDISK          , NULL },
+   { CONF_HOLDING_STRIPE       , CONFTYPE_BOOLEAN  , read_bool        , CNF_HOLDING_STRIPE       , NULL },
    { CONF_DUMPCYCLE            , CONFTYPE_INT      , read_int         , CNF_DUMPCYCLE            , validate_nonnegative },
    { CONF_RUNSPERCYCLE         , CONFTYPE_INT      , read_int         , CNF_RUNSPERCYCLE         , validate_runspercycle },
    { CONF_RUNTAPES             , CONFTYPE_INT      , read_int         , CNF_RUNTAPES             , validate_nonnegative },
@@ -1443,6 +1456,7 @@ conf_var_t server_var [] = {
    { CONF_NETUSAGE             , CONFTYPE_INT      , read_int         , CNF_NETUSAGE             , validate_positive },
    { CONF_INPARALLEL           , CONFTYPE_INT      , read_int         , CNF_INPARALLEL           , validate_positive },
    { CONF_DUMPORDER            , CONFTYPE_STR      , read_str         , CNF_DUMPORDER            , NULL },
+   { CONF_DUMP_TO_IDLE_TAPER   , CONFTYPE_BOOLEAN  , read_bool        , CNF_DUMP_TO_IDLE_TAPER   , NULL },
    { CONF_MAXDUMPS             , CONFTYPE_INT      , read_int         , CNF_MAXDUMPS             , validate_positive },
    { CONF_MAX_DLE_BY_VOLUME    , CONFTYPE_INT      , read_int         , CNF_MAX_DLE_BY_VOLUME    , validate_positive },
    { CONF_ETIMEOUT             , CONFTYPE_INT      , read_int         , CNF_ETIMEOUT             , validate_non_zero },
@@ -1472,6 +1486,8 @@ conf_var_t server_var [] = {
    { CONF_AMRECOVER_CHANGER    , CONFTYPE_STR      , read_str         , CNF_AMRECOVER_CHANGER    , NULL },
    { CONF_AMRECOVER_CHECK_LABEL, CONFTYPE_BOOLEAN  , read_bool        , CNF_AMRECOVER_CHECK_LABEL, NULL },
    { CONF_CONNECT_TRIES        , CONFTYPE_INT      , read_int         , CNF_CONNECT_TRIES        , validate_positive },
+   { CONF_CONNECT_PARALLEL     , CONFTYPE_INT      , read_int         , CNF_CONNECT_PARALLEL     , validate_nonnegative },
+   { CONF_CONNECT_LINGER       , CONFTYPE_INT      , read_int         , CNF_CONNECT_LINGER       , validate_nonnegative },
    { CONF_REP_TRIES            , CONFTYPE_INT      , read_int         , CNF_REP_TRIES            , validate_positive },
    { CONF_REQ_TRIES            , CONFTYPE_INT      , read_int         , CNF_REQ_TRIES            , validate_positive },
    { CONF_DEBUG_DAYS           , CONFTYPE_INT      , read_int         , CNF_DEBUG_DAYS           , NULL },
@@ -1527,6 +1543,7 @@ conf_var_t tapetype_var [] = {
    { CONF_PART_CACHE_TYPE      , CONFTYPE_PART_CACHE_TYPE, read_part_cache_type, TAPETYPE_PART_CACHE_TYPE    , NULL },
    { CONF_PART_CACHE_DIR       , CONFTYPE_STR            , read_str            , TAPETYPE_PART_CACHE_DIR     , NULL },
    { CONF_PART_CACHE_MAX_SIZE  , CONFTYPE_INT64          , read_int64          , TAPETYPE_PART_CACHE_MAX_SIZE, validate_nonnegative },
+   { CONF_PART_SIZE_MAX        , CONFTYPE_INT64          , read_int64          , TAPETYPE_PART_SIZE_MAX      , validate_nonnegative },
    { CONF_UNKNOWN              , CONFTYPE_INT            , NULL                , TAPETYPE_TAPETYPE           , NULL }
 };
 
@@ -1731,12 +1748,48 @@ get_token_name(
     return(kt->keyword);
 }
 
+/* Hash of each keytable used by lookup_keyword, keyed by the address of the
+ * keytable.  Each maps the lowercase keyword to its first entry in the
+ * table; the keytables are static, so these live until exit. */
+static GHashTable *keytable_hashes = NULL;
+
+static GHashTable *
+get_keytable_hash(
+    keytab_t *kt)
+{
+    GHashTable *hash;
+    keytab_t *kwp;
+
+    if (!keytable_hashes)
+	keytable_hashes = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+    hash = g_hash_table_lookup(keytable_hashes, kt);
+    if (hash)
+	return hash;
+
+    hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (kwp = kt; kwp->keyword != NULL; kwp++) {
+	char *key = g_ascii_strdown(kwp->keyword, -1);
+
+	if (g_hash_table_lookup(hash, key))
+	    g_free(key);
+	else
+	    g_hash_table_insert(hash, key, kwp);
+    }
+    /* the entry that ends the table, for the words that are not keywords */
+    g_hash_table_insert(hash, g_strdup(""), kwp);
+    g_hash_table_insert(keytable_hashes, kt, hash);
+
+    return hash;
+}
+
 static tok_t
 lookup_keyword(
     char *	str)
 {
+    GHashTable *hash;
     keytab_t *kwp;
-    char *str1 = g_strdup(str);
+    char *str1 = g_ascii_strdown(str, -1);
     char *p = str1;
 
     /* Fold '-' to '_' in the token.  Note that this modifies str1
@@ -1746,9 +1799,10 @@ lookup_keyword(
 	p++;
     }
 
-    for(kwp = keytable; kwp->keyword != NULL; kwp++) {
-	if (strcasecmp(kwp->keyword, str1) == 0) break;
-    }
+    hash = get_keytable_hash(keytable);
+    kwp = g_hash_table_lookup(hash, str1);
+    if (!kwp)
+	kwp = g_hash_table_lookup(hash, "");
 
     amfree(str1);
     return kwp->token;
@@ -2848,6 +2902,7 @@ init_tapetype_defaults(void)
     conf_init_part_cache_type(&tpcur.value[TAPETYPE_PART_CACHE_TYPE], PART_CACHE_TYPE_NONE);
     conf_init_str(&tpcur.value[TAPETYPE_PART_CACHE_DIR], "");
     conf_init_int64(&tpcur.value[TAPETYPE_PART_CACHE_MAX_SIZE], CONF_UNIT_K, 0);
+    conf_init_int64(&tpcur.value[TAPETYPE_PART_SIZE_MAX], CONF_UNIT_K, 0);
 }
 
 static void
@@ -6646,12 +6701,14 @@ init_defaults(
     conf_init_str   (&conf_data[CNF_INDEXDIR]             , "/usr/adm/amanda/index");
     conf_init_ident    (&conf_data[CNF_TAPETYPE]             , "DEFAULT_TAPE");
     conf_init_identlist(&conf_data[CNF_HOLDINGDISK]          , NULL);
+    conf_init_bool     (&conf_data[CNF_HOLDING_STRIPE]       , 0);
     conf_init_int      (&conf_data[CNF_DUMPCYCLE]            , CONF_UNIT_NONE, 10);
     conf_init_int      (&conf_data[CNF_RUNSPERCYCLE]         , CONF_UNIT_NONE, 0);
     conf_init_int      (&conf_data[CNF_TAPECYCLE]            , CONF_UNIT_NONE, 15);
     conf_init_int      (&conf_data[CNF_NETUSAGE]             , CONF_UNIT_K   , 80000);
     conf_init_int      (&conf_data[CNF_INPARALLEL]           , CONF_UNIT_NONE, 10);
     conf_init_str   (&conf_data[CNF_DUMPORDER]            , "ttt");
+    conf_init_bool     (&conf_data[CNF_DUMP_TO_IDLE_TAPER]   , 0);
     conf_init_int      (&conf_data[CNF_BUMPPERCENT]          , CONF_UNIT_NONE, 0);
     conf_init_int64    (&conf_data[CNF_BUMPSIZE]             , CONF_UNIT_K   , (gint64)10*1024);
     conf_init_real     (&conf_data[CNF_BUMPMULT]             , 1.5);
@@ -6698,6 +6755,8 @@ init_defaults(
     conf_init_str      (&conf_data[CNF_REST_SSL_KEY]         , NULL);
     conf_init_bool     (&conf_data[CNF_USETIMESTAMPS]        , 1);
     conf_init_int      (&conf_data[CNF_CONNECT_TRIES]        , CONF_UNIT_NONE, 3);
+    conf_init_int      (&conf_data[CNF_CONNECT_PARALLEL]     , CONF_UNIT_NONE, 64);
+    conf_init_int      (&conf_data[CNF_CONNECT_LINGER]       , CONF_UNIT_NONE, 10);
     conf_init_int      (&conf_data[CNF_REP_TRIES]            , CONF_UNIT_NONE, 5);
     conf_init_int      (&conf_data[CNF_REQ_TRIES]            , CONF_UNIT_NONE, 3);
     conf_init_int      (&conf_data[CNF_DEBUG_DAYS]           , CONF_UNIT_NONE, AMANDA_DEBUG_DAYS);
@@ -6742,6 +6801,7 @@ init_defaults(
     conf_init_str(&conf_data[CNF_TAPERSCAN], NULL);
     conf_init_str(&conf_data[CNF_CATALOG], NULL);
     conf_init_str(&conf_data[CNF_HOSTNAME], NULL);
+    conf_init_int(&conf_data[CNF_MAX_ESTIMATES_PER_DEVICE], CONF_UNIT_NONE, 0);
 
     /* reset internal variables */
     config_clear_errors();
@@ -513,6 +513,7 @@ typedef enum {
     CNF_NETUSAGE,
     CNF_INPARALLEL,
     CNF_DUMPORDER,
+    CNF_DUMP_TO_IDLE_TAPER,
     CNF_BUMPPERCENT,
     CNF_BUMPSIZE,
     CNF_BUMPMULT,
@@ -545,6 +546,8 @@ typedef enum {
     CNF_USETIMESTAMPS,
     CNF_REP_TRIES,
     CNF_CONNECT_TRIES,
+    CNF_CONNECT_PARALLEL,
+    CNF_CONNECT_LINGER,
     CNF_REQ_TRIES,
     CNF_DEBUG_AMANDAD,
     CNF_DEBUG_RECOVERY,
@@ -567,6 +570,7 @@ typedef enum {
     CNF_RESERVED_TCP_PORT,
     CNF_UNRESERVED_TCP_PORT,
     CNF_HOLDINGDISK,
+    CNF_HOLDING_STRIPE,
     CNF_AUTOLABEL,
     CNF_META_AUTOLABEL,
     CNF_DEBUG_DAYS,
@@ -598,6 +602,7 @@ typedef enum {
     CNF_SSL_DIR,
     CNF_SSL_CHECK_FINGERPRINT,
     CNF_HOSTNAME,
+    CNF_MAX_ESTIMATES_PER_DEVICE,
     CNF_CNF /* sentinel */
 } confparm_key;
 
@@ -722,6 +727,7 @@ typedef enum {
     TAPETYPE_PART_CACHE_TYPE,
     TAPETYPE_PART_CACHE_DIR,
     TAPETYPE_PART_CACHE_MAX_SIZE,
+    TAPETYPE_PART_SIZE_MAX,
     TAPETYPE_TAPETYPE /* sentinel */
 } tapetype_key;
 
@@ -778,6 +784,7 @@ char *tapetype_key_to_name(int parm);
 #define tapetype_get_part_cache_type(ttyp)     (val_t_to_part_cache_type(tapetype_getconf((ttyp), TAPETYPE_PART_CACHE_TYPE)))
 #define tapetype_get_part_cache_dir(ttyp)      (val_t_to_str(tapetype_getconf((ttyp), TAPETYPE_PART_CACHE_DIR)))
 #define tapetype_get_part_cache_max_size(ttyp) (val_t_to_int64(tapetype_getconf((ttyp), TAPETYPE_PART_CACHE_MAX_SIZE)))
+#define tapetype_get_part_size_max(ttyp)       (val_t_to_int64(tapetype_getconf((ttyp), TAPETYPE_PART_SIZE_MAX)))
 
 /*
  * Dumptype parameter access
@@ -111,10 +111,14 @@ typedef struct proto {
     char *(*conf_fn)(char *, void *);	/* configuration function */
     security_status_t  status;
     event_handle_t    *event_handle;
+    gboolean connect_in_thread;		/* security_connect from a thread */
+    struct timeval sendtime;		/* when the REQ was sent */
+    gboolean resent;			/* the REQ was sent more than once */
 } proto_t;
 
 #define	CONNECT_WAIT	5	/* secs between connect attempts */
 #define ACK_WAIT	10	/* time (secs) to wait for ACK - keep short */
+#define ACK_WAIT_MAX	60	/* upper bound of the adaptive ACK wait */
 #define RESET_TRIES	2	/* num restarts (reboot/crash) */
 #define CURTIME	(time(0) - proto_init_time) /* time relative to start */
 
@@ -128,6 +132,22 @@ static time_t proto_init_time;
 static int nb_thread = 0;
 static GMutex *protocol_mutex;
 
+/*
+ * Connections being established, limited to max_connect (0 for no limit);
+ * the requests over the limit wait in connect_queue.
+ */
+static int max_connect = 0;
+static int nb_connect = 0;
+static GQueue *connect_queue = NULL;
+
+/*
+ * Smoothed ACK round-trip time and its variation, in milliseconds, as TCP
+ * does for its retransmit timeout.  A busy client or server makes the ACK
+ * wait grow instead of resending requests that are only slow.
+ */
+static long ack_srtt = 0;
+static long ack_rttvar = 0;
+
 /* local functions */
 
 static const char *action2str(p_action_t);
@@ -138,6 +158,9 @@ static void connect_thread_callback(void *cookie,
 				    security_handle_t *	security_handle,
 				    security_status_t	status);
 
+static void start_connect(proto_t *p);
+static time_t ack_timeout(void);
+static void ack_rtt_sample(proto_t *p);
 static void connect_callback(void *cookie);
 static void connect_callbackX(void *, security_handle_t *, security_status_t);
 static void connect_wait_callback(void *);
@@ -162,6 +185,9 @@ protocol_init(void)
 
     proto_init_time = time(NULL);
     protocol_mutex = g_mutex_new();
+    connect_queue = g_queue_new();
+    max_connect = getconf_int(CNF_CONNECT_PARALLEL);
+    security_set_conn_linger(getconf_int(CNF_CONNECT_LINGER));
 }
 
 /*
@@ -205,6 +231,7 @@ protocol_sendreq(
     p->continuation = continuation;
     p->datap = datap;
     p->event_handle = NULL;
+    p->resent = FALSE;
 
     proto_debug(1, _("protocol: security_connect: host %s -> p %p\n"),
 		    hostname, p);
@@ -213,7 +240,8 @@ protocol_sendreq(
 	get_platform_and_distro(&platform, &distro);
     }
 
-    if (distro != NULL &&
+    p->connect_in_thread =
+	distro != NULL &&
 	!g_str_equal(distro, "mac") &&
 #if defined HAVE_FUNC_GETSERVBYNAME_R_4 || defined HAVE_FUNC_GETSERVBYNAME_R_5 || defined HAVE_FUNC_GETSERVBYNAME_R_6
 	1 &&
@@ -234,7 +262,26 @@ protocol_sendreq(
 #ifdef SSH_SECURITY
 	 security_driver == &ssh_security_driver ||
 #endif
-	 0)) {
+	 0);
+    start_connect(p);
+}
+
+/*
+ * Start connecting p, or queue it if max_connect connections are already
+ * being established.
+ */
+static void
+start_connect(
+    proto_t *p)
+{
+    if (max_connect > 0 && nb_connect >= max_connect) {
+	proto_debug(1, _("protocol: start_connect: p %p: queued\n"), p);
+	g_queue_push_tail(connect_queue, p);
+	return;
+    }
+
+    nb_connect++;
+    if (p->connect_in_thread) {
 	g_thread_create(connect_thread, (gpointer)p, TRUE, NULL);
 	g_mutex_lock(protocol_mutex);
 	nb_thread++;
@@ -312,6 +359,13 @@ connect_callback(
 
     proto_debug(1, _("protocol: connect_callback: p %p\n"), p);
 
+    /* let a queued request take our place */
+    nb_connect--;
+    while (!g_queue_is_empty(connect_queue) &&
+	   (max_connect == 0 || nb_connect < max_connect)) {
+	start_connect(g_queue_pop_head(connect_queue));
+    }
+
     switch (p->status) {
     case S_OK:
 	state_machine(p, PA_START, NULL);
@@ -358,7 +412,7 @@ connect_wait_callback(
     proto_t *p = cookie;
 
     event_release((event_handle_t *)p->security_handle);
-    if (
+    p->connect_in_thread = (
 #ifdef BSDTCP_SECURITY
 	 p->security_driver == &bsdtcp_security_driver ||
 #endif
@@ -372,18 +426,8 @@ connect_wait_callback(
 #ifdef SSH_SECURITY
 	 p->security_driver == &ssh_security_driver ||
 #endif
-	 0) {
-	g_thread_create(connect_thread, (gpointer)p, TRUE, NULL);
-	g_mutex_lock(protocol_mutex);
-	nb_thread++;
-	g_mutex_unlock(protocol_mutex);
-    } else {
-	// bsd_security_driver		no connect,all use same socket
-	// bsdudp_security_driver	no connect,all use same socket
-	// krb5_security_driver		untested
-	security_connect(p->security_driver, p->hostname, p->conf_fn, connect_callbackX,
-			 p, p->datap);
-    }
+	 0);
+    start_connect(p);
 }
 
 
@@ -592,15 +636,65 @@ s_sendreq(
      * Remember when this request was first sent
      */
     p->curtime = CURTIME;
+    gettimeofday(&p->sendtime, NULL);
 
     /*
      * Move to the ackwait state
      */
     p->state = s_ackwait;
-    p->timeout = ACK_WAIT;
+    p->timeout = ack_timeout();
     return (PA_PENDING);
 }
 
+/*
+ * The time to wait for an ACK: the smoothed round-trip time plus four
+ * times its variation, never less than ACK_WAIT nor more than ACK_WAIT_MAX.
+ */
+static time_t
+ack_timeout(void)
+{
+    long wait_ms = ack_srtt + 4 * ack_rttvar;
+    time_t wait = (wait_ms + 999) / 1000;
+
+    if (wait < ACK_WAIT)
+	wait = ACK_WAIT;
+    if (wait > ACK_WAIT_MAX)
+	wait = ACK_WAIT_MAX;
+    return wait;
+}
+
+/*
+ * Add the round-trip time of p's REQ to the estimate.  The ACK of a REQ
+ * that was sent more than once can't be matched to one send, so it is
+ * ignored.
+ */
+static void
+ack_rtt_sample(
+    proto_t *p)
+{
+    struct timeval now;
+    long rtt;
+
+    if (p->resent)
+	return;
+
+    gettimeofday(&now, NULL);
+    rtt = (now.tv_sec - p->sendtime.tv_sec) * 1000 +
+	  (now.tv_usec - p->sendtime.tv_usec) / 1000;
+    if (rtt < 0)
+	return;
+
+    if (ack_srtt == 0 && ack_rttvar == 0) {
+	ack_srtt = rtt;
+	ack_rttvar = rtt / 2;
+    } else {
+	ack_rttvar += (ABS(ack_srtt - rtt) - ack_rttvar) / 4;
+	ack_srtt += (rtt - ack_srtt) / 8;
+    }
+    proto_debug(1, _("protocol: ACK after %ldms, srtt %ldms rttvar %ldms\n"),
+		rtt, ack_srtt, ack_rttvar);
+}
+
 /*
  * The acknowledge wait state.  We can enter here two ways:
  *
@@ -636,6 +730,7 @@ s_ackwait(
 	    return (PA_ABORT);
 	}
 
+	p->resent = TRUE;
 	p->state = s_sendreq;
 	return (PA_CONTINUE);
     }
@@ -655,6 +750,7 @@ s_ackwait(
      * wait for the reply.
      */
     case P_ACK:
+	ack_rtt_sample(p);
 	p->state = s_repwait;
 	p->timeout = p->repwait;
 	return (PA_PENDING);
@@ -716,6 +812,7 @@ s_repwait(
 	 * We still have some tries left.  Resend the request.
 	 */
 	p->resettries--;
+	p->resent = TRUE;
 	p->state = s_sendreq;
 	p->reqtries = getconf_int(CNF_REQ_TRIES);
 	return (PA_CONTINUE);
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2013-2016 Carbonite, Inc.  All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+ *
+ * Contact information: Carbonite Inc., 756 N Pastoria Ave
+ * Sunnyvale, CA 94085, or: http://www.zmanda.com
+ */
+
+#include "amanda.h"
+#include "testutils.h"
+#include "security-util.h"
+
+/* the open connections, from security-util.c */
+extern GSList *connq;
+
+/* the peer end of the socketpair of the connection made by fake_conn */
+static int peer_fd = -1;
+
+/*
+ * Utils
+ */
+
+/* Get a connection to hostname, as a driver's connect does, and give it a
+ * socketpair if it is a new one.
+ */
+static struct tcp_conn *
+fake_conn(
+    const char *hostname)
+{
+    struct tcp_conn *rc = sec_tcp_conn_get(NULL, hostname, 0);
+    int sv[2];
+
+    if (rc->read == -1) {
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+	    g_critical("socketpair: %s", strerror(errno));
+	}
+	rc->read = sv[0];
+	rc->write = dup(sv[0]);
+	aclose(peer_fd);
+	peer_fd = sv[1];
+    }
+    return rc;
+}
+
+/* Drop our reference, as security_close_connection does */
+static void
+release_conn(
+    struct tcp_conn *rc)
+{
+    struct sec_handle rh;
+
+    memset(&rh, 0, sizeof(rh));
+    rh.hostname = rc->hostname;
+    rh.rc = rc;
+    tcpm_close_connection(&rh, rc->hostname);
+}
+
+static gboolean
+in_connq(
+    struct tcp_conn *rc)
+{
+    return g_slist_find(connq, rc) != NULL;
+}
+
+/*
+ * Tests
+ */
+
+/****
+ * Without connect-linger, the last reference closes the connection
+ */
+static gboolean
+test_no_linger(void)
+{
+    struct tcp_conn *rc;
+    char c;
+
+    security_set_conn_linger(0);
+    rc = fake_conn("nolinger");
+    release_conn(rc);
+
+    if (in_connq(rc)) {
+	tu_dbg("connection is still in connq\n");
+	return FALSE;
+    }
+    if (read(peer_fd, &c, 1) != 0) {
+	tu_dbg("peer did not get EOF\n");
+	return FALSE;
+    }
+    return TRUE;
+}
+
+/****
+ * An idle connection is handed to the next request to the same host
+ */
+static gboolean
+test_reuse(void)
+{
+    struct tcp_conn *rc, *rc2;
+
+    security_set_conn_linger(60);
+    rc = fake_conn("reuse");
+    release_conn(rc);
+
+    if (!in_connq(rc) || rc->refcnt != 0 || rc->linger_source == 0) {
+	tu_dbg("connection is not lingering\n");
+	return FALSE;
+    }
+
+    rc2 = fake_conn("reuse");
+    if (rc2 != rc) {
+	tu_dbg("a new connection was made\n");
+	return FALSE;
+    }
+    if (rc->refcnt != 1 || rc->linger_source != 0) {
+	tu_dbg("refcnt %d, linger_source %u\n", rc->refcnt, rc->linger_source);
+	return FALSE;
+    }
+    return TRUE;
+}
+
+/****
+ * An idle connection the peer wrote to (or closed) is not reused
+ */
+static gboolean
+test_stale(void)
+{
+    struct tcp_conn *rc, *rc2;
+
+    security_set_conn_linger(60);
+    rc = fake_conn("stale");
+    release_conn(rc);
+
+    if (write(peer_fd, "x", 1) != 1) {
+	tu_dbg("write to the peer failed: %s\n", strerror(errno));
+	return FALSE;
+    }
+
+    rc2 = fake_conn("stale");
+    if (rc2 == rc) {
+	tu_dbg("the stale connection was reused\n");
+	return FALSE;
+    }
+    if (in_connq(rc) || rc->read != -1) {
+	tu_dbg("the stale connection was not closed\n");
+	return FALSE;
+    }
+    return TRUE;
+}
+
+/****
+ * An idle connection is closed once connect-linger expires
+ */
+static gboolean
+test_linger_expired(void)
+{
+    struct tcp_conn *rc;
+    time_t start = time(NULL);
+    char c;
+
+    security_set_conn_linger(1);
+    rc = fake_conn("expire");
+    release_conn(rc);
+
+    if (!in_connq(rc)) {
+	tu_dbg("connection is not lingering\n");
+	return FALSE;
+    }
+
+    /* the timeout is not an event, so event_loop would return at once */
+    while (in_connq(rc) && time(NULL) - start < 10) {
+	g_main_context_iteration(NULL, TRUE);
+    }
+
+    if (in_connq(rc)) {
+	tu_dbg("connection was not closed after connect-linger\n");
+	return FALSE;
+    }
+    if (read(peer_fd, &c, 1) != 0) {
+	tu_dbg("peer did not get EOF\n");
+	return FALSE;
+    }
+    return TRUE;
+}
+
+/*
+ * Main driver
+ */
+
+int
+main(int argc, char **argv)
+{
+    static TestUtilsTest tests[] = {
+	TU_TEST(test_no_linger, 90),
+	TU_TEST(test_reuse, 90),
+	TU_TEST(test_stale, 90),
+	TU_TEST(test_linger_expired, 90),
+	TU_END()
+    };
+
+    glib_init();
+
+    return testutils_run_tests(argc, argv, tests);
+}
@@ -42,6 +42,7 @@
 #include "security-util.h"
 #include "stream.h"
 #include "sockaddr-util.h"
+#include <poll.h>
 
 /*
  * This is a queue of open connections
@@ -50,10 +51,18 @@ GSList *connq = NULL;
 static int newhandle = 1;
 static event_id_t newevent = 1;
 
+/*
+ * Seconds an unused connection stays in connq, see security_set_conn_linger
+ */
+static int conn_linger = 0;
+
 /*
  * Local functions
  */
 static void sec_tcp_conn_put(struct tcp_conn *rc);
+static void sec_tcp_conn_close(struct tcp_conn *rc);
+static gboolean sec_tcp_conn_reusable(struct tcp_conn *rc);
+static gboolean sec_tcp_conn_linger_expired(gpointer data);
 static void recvpkt_callback(void *, void *, ssize_t);
 static void stream_read_callback(void *);
 static void stream_read_sync_callback(void *);
@@ -2024,6 +2033,7 @@ sec_tcp_conn_get(
     int		want_new)
 {
     GSList *iter;
+    GSList *stale = NULL;
     struct tcp_conn *rc = NULL;
 
     auth_debug(1, _("sec_tcp_conn_get: %s %s\n"), dle_hostname, hostname);
@@ -2032,24 +2042,45 @@ sec_tcp_conn_get(
     if (want_new == 0) {
 	for (iter = connq; iter != NULL; iter = iter->next) {
 	    rc = (struct tcp_conn *)iter->data;
+	    /* a lingering connection that is already being closed */
+	    if (rc->refcnt == 0 && rc->idle_since == 0)
+		continue;
 	    if (!rc->errmsg &&
 		strcasecmp(hostname, rc->hostname) == 0 &&
 		((!dle_hostname && !rc->dle_hostname) ||
 		 (dle_hostname && rc->dle_hostname && strcasecmp(dle_hostname, rc->dle_hostname) == 0))) {
-		break;
+		if (rc->refcnt > 0 || sec_tcp_conn_reusable(rc))
+		    break;
+		rc->idle_since = 0;
+		stale = g_slist_prepend(stale, rc);
 	    }
 	}
 
 	if (iter != NULL) {
+	    if (rc->refcnt == 0)
+		auth_debug(1, _("sec_tcp_conn_get: reusing idle connection to %s\n"),
+			   rc->hostname);
 	    rc->refcnt++;
+	    rc->idle_since = 0;
+	    rc->toclose = 0;
+	    if (rc->linger_source) {
+		g_source_remove(rc->linger_source);
+		rc->linger_source = 0;
+	    }
 	    auth_debug(1,
 		      _("sec_tcp_conn_get: exists, refcnt to %s is now %d\n"),
 		       rc->hostname, rc->refcnt);
 	    g_mutex_unlock(security_mutex);
+	    for (iter = stale; iter != NULL; iter = iter->next)
+		sec_tcp_conn_close((struct tcp_conn *)iter->data);
+	    g_slist_free(stale);
 	    return (rc);
 	}
     }
     g_mutex_unlock(security_mutex);
+    for (iter = stale; iter != NULL; iter = iter->next)
+	sec_tcp_conn_close((struct tcp_conn *)iter->data);
+    g_slist_free(stale);
 
     auth_debug(1, _("sec_tcp_conn_get: creating new handle\n"));
     /*
@@ -2084,16 +2115,46 @@ sec_tcp_conn_get(
     return (rc);
 }
 
+void
+security_set_conn_linger(
+    int seconds)
+{
+    conn_linger = seconds;
+}
+
+/*
+ * Can the idle connection rc be handed to a new request?  It must not be
+ * older than conn_linger, and the peer must not have sent anything, an EOF
+ * included, since its last request.
+ */
+static gboolean
+sec_tcp_conn_reusable(
+    struct tcp_conn *rc)
+{
+    struct pollfd pfd;
+
+    if (time(NULL) - rc->idle_since >= conn_linger)
+	return FALSE;
+
+    pfd.fd = rc->read;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) == 0;
+}
+
 /*
  * Delete a reference to a connection, and close it if it is the last
- * reference.
+ * reference.  A connection we initiated is instead kept idle for
+ * conn_linger seconds, even after security_close_connection, so that the
+ * next request to the host (the next dump of a dumper) skips the connect
+ * and authentication.  It is closed by a timeout when conn_linger expires;
+ * that timeout is not an amanda event, so it doesn't keep event_loop
+ * running.  The connection is checked again before it is reused.
  */
 static void
 sec_tcp_conn_put(
     struct tcp_conn *rc)
 {
-    amwait_t status;
-
     assert(rc->refcnt > 0);
     --rc->refcnt;
     auth_debug(1, _("sec_tcp_conn_put: decrementing refcnt for %s to %d\n"),
@@ -2101,6 +2162,62 @@ sec_tcp_conn_put(
     if (rc->refcnt > 0) {
 	return;
     }
+
+    if (conn_linger > 0 && rc->accept_fn == NULL &&
+	!rc->errmsg && rc->handle != H_EOF && rc->read != -1) {
+	auth_debug(1, _("sec_tcp_conn_put: keeping idle connection to %s\n"),
+		   rc->hostname);
+	if (rc->ev_read != NULL) {
+	    event_release(rc->ev_read);
+	    rc->ev_read = NULL;
+	}
+	rc->ev_read_refcnt = 0;
+	g_mutex_lock(security_mutex);
+	rc->idle_since = time(NULL);
+	rc->linger_source = g_timeout_add(conn_linger * 1000,
+					  sec_tcp_conn_linger_expired, rc);
+	g_mutex_unlock(security_mutex);
+	return;
+    }
+
+    sec_tcp_conn_close(rc);
+}
+
+/*
+ * Close an idle connection once it has lingered for conn_linger seconds,
+ * unless sec_tcp_conn_get took it in the meantime.
+ */
+static gboolean
+sec_tcp_conn_linger_expired(
+    gpointer data)
+{
+    struct tcp_conn *rc = data;
+    gboolean expired;
+
+    g_mutex_lock(security_mutex);
+    expired = (rc->refcnt == 0 && rc->idle_since != 0);
+    if (expired)
+	rc->idle_since = 0;
+    rc->linger_source = 0;
+    g_mutex_unlock(security_mutex);
+
+    if (expired) {
+	auth_debug(1, _("sec_tcp_conn_linger_expired: closing idle connection to %s\n"),
+		   rc->hostname);
+	sec_tcp_conn_close(rc);
+    }
+    return FALSE;
+}
+
+/*
+ * Close a connection and remove it from connq.
+ */
+static void
+sec_tcp_conn_close(
+    struct tcp_conn *rc)
+{
+    amwait_t status;
+
     auth_debug(1, _("sec_tcp_conn_put: closing connection to %s\n"), rc->hostname);
     if (rc->read != -1)
 	aclose(rc->read);
@@ -2142,6 +2259,10 @@ sec_tcp_conn_put(
     if (rc->errmsg != NULL)
 	amfree(rc->errmsg);
     g_mutex_lock(security_mutex);
+    if (rc->linger_source) {
+	g_source_remove(rc->linger_source);
+	rc->linger_source = 0;
+    }
     connq = g_slist_remove(connq, rc);
     g_mutex_unlock(security_mutex);
     amfree(rc->pkt);
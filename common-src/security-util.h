@@ -135,6 +135,8 @@ struct tcp_conn {
     SSL                *ssl;
 #endif
     gboolean            paused;
+    time_t		idle_since;		/* lingering since, if refcnt == 0 */
+    guint		linger_source;		/* closes it when conn_linger expires */
 };
 
 
@@ -523,4 +523,9 @@ void security_stream_close_async(security_stream_t *, void (*fn)(void *, ssize_t
 
 extern GMutex *security_mutex;
 
+/* Keep connections of the stream-based drivers open for this many seconds
+ * after their last handle is closed, so that a new request to the same host
+ * can reuse them.  0 (the default) closes them at once. */
+void security_set_conn_linger(int seconds);
+
 #endif	/* SECURITY_H */
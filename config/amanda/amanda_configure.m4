@@ -202,6 +202,7 @@ AC_CHECK_HEADERS(
 	stdlib.h \
 	strings.h \
 	rpc/rpc.h \
+	sys/epoll.h \
 	sys/file.h \
 	sys/ioctl.h \
 	sys/ipc.h \
@@ -242,6 +243,7 @@ AC_STRUCT_TM
 AMANDA_SOCKLEN_T_EQUIV
 AMANDA_CHECK_TYPE(sa_family_t, unsigned short, sys/socket.h)
 AMANDA_CHECK_TYPE(in_port_t, unsigned short, netinet/in.h)
+AC_CHECK_MEMBERS([struct stat.st_mtim], [], [], [[#include <sys/stat.h>]])
 CF_WAIT
 CF_WAIT_INT
 
@@ -367,6 +369,7 @@ ICE_CHECK_DECL(eaccess,unistd.h)
 ICE_CHECK_DECL(clock_gettime,time.h)
 AX_FUNC_WHICH_GETSERVBYNAME_R
 AC_CHECK_FUNCS(sem_timedwait)
+AC_CHECK_FUNCS(fallocate posix_fadvise sync_file_range)
 
 #
 # Devices
@@ -0,0 +1,460 @@
+#! @PERL@
+# Copyright (c) 2013-2016 Carbonite, Inc.  All Rights Reserved.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+#
+# Contact information: Carbonite Inc., 756 N Pastoria Ave
+# Sunnyvale, CA 94086, USA, or: http://www.zmanda.com
+
+# This is a tool to measure the throughput of the transfer elements, the
+# holding disk and devices, producing results that can be compared between
+# releases.
+
+use lib '@amperldir@';
+use strict;
+use warnings;
+
+use Getopt::Long;
+use Time::HiRes qw( time );
+use JSON;
+
+use Amanda::Device qw( :constants );
+use Amanda::Debug qw( :logging );
+use Amanda::Util qw( :constants );
+use Amanda::Config qw( :init :getconf );
+use Amanda::MainLoop;
+use Amanda::Xfer qw( :constants );
+use Amanda::Header;
+
+# command-line options
+my $opt_size = 256 * 1024 * 1024;
+my @opt_block_sizes = ( 32 * 1024, 256 * 1024, 1024 * 1024 );
+my @opt_ring_sizes = ( 1024 * 1024, 16 * 1024 * 1024 );
+my @opt_parallel = ( 1, 4 );
+my @opt_tests;
+my $opt_holding_dir;
+my $opt_json = 0;
+my $opt_force = 0;
+my $opt_config;
+my @opt_devices;
+
+my @all_tests = qw( memory xor crc pipe holding device );
+
+sub parse_size {
+    my ($str) = @_;
+
+    my ($num, $suff) = ($str =~ /^([0-9]+)\s*(.*)$/);
+    die "Invalid size '$str'\n" unless (defined $num);
+    my $mult = Amanda::Config::find_multiplier($suff);
+    die "Invalid suffix '$suff'\n" unless ($mult);
+    return $num * $mult;
+}
+
+sub parse_list {
+    my ($str, $parse) = @_;
+
+    return map { $parse->($_) } split(/,/, $str);
+}
+
+##
+# Running transfers
+
+# Run PARALLEL copies of a transfer at the same time and return a result
+# hashref.  MAKE is called with the index of each copy and returns a hashref
+# with the keys
+#   xfer - the Amanda::Xfer to run
+#   started - (optional) sub called once the transfer is started
+#   msg - (optional) sub called with each message of the transfer
+#   done - (optional) sub called when the transfer is done; returns an error
+#	   message or undef
+# The result gives the total bytes moved, the elapsed time, and the element
+# which the XMSG_STATS messages identify as the bottleneck.
+sub run_xfers {
+    my %params = @_;
+    my $parallel = $params{'PARALLEL'};
+    my @runs = map { $params{'MAKE'}->($_) } (0 .. $parallel-1);
+    my $running = $parallel;
+    my ($error, $bytes, $bottleneck, $bottleneck_busy) = (undef, 0, undef, 0);
+    my $start_time = time;
+
+    for my $run (@runs) {
+	$run->{'xfer'}->start(sub {
+	    my ($src, $msg, $xfer) = @_;
+
+	    $run->{'msg'}->($msg) if $run->{'msg'};
+	    if ($msg->{'type'} == $XMSG_ERROR) {
+		$error = $msg->{'message'} unless defined $error;
+	    } elsif ($msg->{'type'} == $XMSG_STATS) {
+		# the source's output is the amount of data moved
+		$bytes += $msg->{'bytes_out'}
+		    if $msg->{'elt'} == $run->{'source'};
+		if ($msg->{'busy'} > $bottleneck_busy) {
+		    $bottleneck = ref $msg->{'elt'};
+		    $bottleneck =~ s/^Amanda::Xfer:://;
+		    $bottleneck_busy = $msg->{'busy'};
+		}
+	    } elsif ($msg->{'type'} == $XMSG_DONE) {
+		if ($run->{'done'}) {
+		    my $err = $run->{'done'}->();
+		    $error = $err if defined $err and !defined $error;
+		}
+		Amanda::MainLoop::quit() if (--$running == 0);
+	    }
+	});
+	$run->{'started'}->() if $run->{'started'};
+    }
+    Amanda::MainLoop::run();
+
+    my $duration = time - $start_time;
+    $duration = 0.001 if $duration <= 0;
+
+    return {
+	bytes => $bytes,
+	seconds => sprintf("%.3f", $duration) + 0,
+	mb_per_sec => sprintf("%.2f", $bytes / $duration / 1048576) + 0,
+	bottleneck => $bottleneck,
+	bottleneck_busy => int($bottleneck_busy * 100),
+	($error? (error => $error) : ()),
+    };
+}
+
+# a source with a different seed for each parallel copy
+sub make_source {
+    my ($i) = @_;
+
+    return Amanda::Xfer::Source::Random->new($opt_size, 0x5eed + $i);
+}
+
+##
+# Benchmarks.  Each returns the result hashref of run_xfers, except
+# bench_device which returns one for the write and one for the read.
+
+# pull/push glue between two elements, in memory
+sub bench_memory {
+    my ($parallel) = @_;
+
+    return run_xfers(PARALLEL => $parallel, MAKE => sub {
+	my $src = make_source(@_);
+	return { source => $src, xfer => Amanda::Xfer->new([
+		    $src, Amanda::Xfer::Dest::Null->new(0) ]) };
+    });
+}
+
+# an extra copy of every byte
+sub bench_xor {
+    my ($parallel) = @_;
+
+    return run_xfers(PARALLEL => $parallel, MAKE => sub {
+	my $src = make_source(@_);
+	return { source => $src, xfer => Amanda::Xfer->new([
+		    $src, Amanda::Xfer::Filter::Xor->new(0x55),
+		    Amanda::Xfer::Dest::Null->new(0) ]) };
+    });
+}
+
+# crc computation
+sub bench_crc {
+    my ($parallel) = @_;
+
+    return run_xfers(PARALLEL => $parallel, MAKE => sub {
+	my $src = make_source(@_);
+	return { source => $src, xfer => Amanda::Xfer->new([
+		    $src, Amanda::Xfer::Filter::Crc->new(),
+		    Amanda::Xfer::Dest::Null->new(0) ]) };
+    });
+}
+
+# the fd glue paths, through an external 'cat'
+sub bench_pipe {
+    my ($parallel) = @_;
+
+    return run_xfers(PARALLEL => $parallel, MAKE => sub {
+	my $src = make_source(@_);
+	return { source => $src, xfer => Amanda::Xfer->new([
+		    $src, Amanda::Xfer::Filter::Process->new([ 'cat' ], 0, 0, 0, 0),
+		    Amanda::Xfer::Dest::Null->new(0) ]) };
+    });
+}
+
+# holding disk writes, with RING_SIZE bytes of buffer
+sub bench_holding {
+    my ($parallel, $ring_size) = @_;
+
+    return run_xfers(PARALLEL => $parallel, MAKE => sub {
+	my ($i) = @_;
+	my $src = make_source($i);
+	my $dest = Amanda::Xfer::Dest::Holding->new($ring_size);
+	my $filename = "$opt_holding_dir/ambench.$$.$i";
+	my $hdr = make_header();
+	my $no_room;
+
+	return {
+	    source => $src,
+	    xfer => Amanda::Xfer->new([ $src, $dest ]),
+	    started => sub {
+		$dest->start_chunk($hdr, $filename, $opt_size + 1024 * 1024);
+	    },
+	    msg => sub {
+		my ($msg) = @_;
+		$no_room = 1
+		    if $msg->{'type'} == $XMSG_CHUNK_DONE and $msg->{'no_room'};
+	    },
+	    done => sub {
+		my $err = $dest->finish_chunk();
+		unlink($filename);
+		return $err || ($no_room? "no room in $opt_holding_dir" : undef);
+	    },
+	};
+    });
+}
+
+# write and read back a volume on DEVICE_NAME
+sub bench_device {
+    my ($device_name, $block_size, $ring_size) = @_;
+    my @results;
+
+    my $device = open_device($device_name, $block_size);
+    my $hdr = make_header();
+    my $dest;
+
+    my $write = run_xfers(PARALLEL => 1, MAKE => sub {
+	my $src = make_source(@_);
+	$dest = Amanda::Xfer::Dest::Taper::Splitter->new($device, $ring_size,
+							  0, 0);
+	return {
+	    source => $src,
+	    xfer => Amanda::Xfer->new([ $src, $dest ]),
+	    started => sub { $dest->start_part(0, $hdr); },
+	};
+    });
+    $write->{'operation'} = 'write';
+    push @results, $write;
+    if (!$device->finish()) {
+	$write->{'error'} ||= $device->error_or_status();
+    }
+    return @results if $write->{'error'};
+
+    if (!$device->start($ACCESS_READ, undef, undef) or !$device->seek_file(1)) {
+	push @results, { operation => 'read', error => $device->error_or_status() };
+	return @results;
+    }
+    my $read = run_xfers(PARALLEL => 1, MAKE => sub {
+	my $src = Amanda::Xfer::Source::Device->new($device);
+	return { source => $src, xfer => Amanda::Xfer->new([
+		    $src, Amanda::Xfer::Dest::Null->new(0) ]) };
+    });
+    $read->{'operation'} = 'read';
+    push @results, $read;
+    $device->finish();
+
+    return @results;
+}
+
+sub make_header {
+    my $hdr = Amanda::Header->new();
+
+    $hdr->{'type'} = $Amanda::Header::F_DUMPFILE;
+    $hdr->{'name'} = "ambench";
+    $hdr->{'disk'} = "/bench";
+    $hdr->{'datestamp'} = "X";
+    $hdr->{'program'} = "AMBENCH";
+    return $hdr;
+}
+
+# open DEVICE_NAME with the given block size and start it for writing.  Like
+# amtapetype, refuse to overwrite a volume with an Amanda label unless -f is
+# given, except for one written by ambench.
+sub open_device {
+    my ($device_name, $block_size) = @_;
+
+    my $device = Amanda::Device->new($device_name);
+    if ($device->status() != $DEVICE_STATUS_SUCCESS) {
+	die("Could not open device $device_name: ".$device->error()."\n");
+    }
+    if (!$device->configure(1)) {
+	die("Errors configuring $device_name: " . $device->error_or_status() . "\n");
+    }
+    if (!$device->property_set('BLOCK_SIZE', $block_size)) {
+	die("Error setting block size on $device_name: " . $device->error_or_status() . "\n");
+    }
+
+    if (!$opt_force) {
+	my $status = $device->read_label();
+	if ($status == $DEVICE_STATUS_SUCCESS and $device->volume_label
+	    and $device->volume_label !~ /^ambench-/) {
+	    die("Volume in device $device_name has Amanda label '" .
+		$device->volume_label . "'. Giving up.\n");
+	}
+    }
+
+    if (!$device->start($ACCESS_WRITE, "ambench-$$", undef)) {
+	die("Error writing label on $device_name: " . $device->error_or_status() . "\n");
+    }
+
+    return $device;
+}
+
+##
+# Output
+
+sub report {
+    my ($result) = @_;
+
+    if ($opt_json) {
+	print JSON->new->canonical->encode($result), "\n";
+	return;
+    }
+
+    my $what = $result->{'test'};
+    $what .= " $result->{'device'} $result->{'operation'}" if $result->{'device'};
+    my @params;
+    push @params, "block $result->{'block_size'}" if $result->{'block_size'};
+    push @params, "ring $result->{'ring_size'}" if $result->{'ring_size'};
+    push @params, "x$result->{'parallel'}" if $result->{'parallel'};
+    my $line = sprintf("%-30s %-28s", $what, join(' ', @params));
+    if ($result->{'error'}) {
+	$line .= " ERROR: $result->{'error'}";
+    } else {
+	$line .= sprintf(" %9.2f MB/s", $result->{'mb_per_sec'});
+	$line .= " (bottleneck: $result->{'bottleneck'}, $result->{'bottleneck_busy'}% busy)"
+	    if $result->{'bottleneck'};
+    }
+    print "$line\n";
+}
+
+sub usage {
+    print STDERR <<EOF;
+Usage: ambench [-h] [-f] [-j] [-s size] [-b blocksizes] [-r ringsizes]
+	       [-p parallel] [-t tests] [-H holding-dir]
+	       [ [-o config_override] ... ] [config] [device ...]
+        -h   Display this message
+        -f   Overwrite volumes even if they have an Amanda label
+        -j   Print one JSON object per result instead of a table
+        -s   Bytes to transfer in each run (default 256m)
+        -b   Comma-separated block sizes for the device tests
+             (default 32k,256k,1m)
+        -r   Comma-separated ring sizes (memory buffers) for the holding
+             and device tests (default 1m,16m)
+        -p   Comma-separated numbers of parallel transfers for the
+             memory, xor, crc, pipe and holding tests (default 1,4)
+        -t   Comma-separated tests to run, among
+             @all_tests
+             (default: all that apply)
+        -H   Holding directory for the holding test
+        -o   Overwrite configuration parameter (such as device properties)
+    Sizes can include an optional suffix (k, m, or g)
+
+    Each device is written with a volume labeled ambench-PID, which is then
+    read back.  If CONFIG is specified, devices and their properties are
+    loaded from the corresponding amanda.conf.
+EOF
+    exit(1);
+}
+
+## Application initialization
+
+Amanda::Util::setup_application("ambench", "server", $CONTEXT_CMDLINE, "amanda", "amanda");
+config_init(0, undef);
+
+my $config_overrides = new_config_overrides($#ARGV+1);
+
+debug("Arguments: " . join(' ', @ARGV));
+Getopt::Long::Configure(qw(bundling));
+GetOptions(
+    'version' => \&Amanda::Util::version_opt,
+    'help|usage|?|h' => \&usage,
+    'f' => \$opt_force,
+    'j' => \$opt_json,
+    's=s' => sub { $opt_size = parse_size($_[1]); },
+    'b=s' => sub { @opt_block_sizes = parse_list($_[1], \&parse_size); },
+    'r=s' => sub { @opt_ring_sizes = parse_list($_[1], \&parse_size); },
+    'p=s' => sub { @opt_parallel = parse_list($_[1], sub {
+	die "Invalid parallel count '$_[0]'\n" unless $_[0] =~ /^[1-9][0-9]*$/;
+	return $_[0];
+    }); },
+    't=s' => sub { @opt_tests = split(/,/, $_[1]); },
+    'H=s' => \$opt_holding_dir,
+    'o=s' => sub { add_config_override_opt($config_overrides, $_[1]); },
+) or usage();
+
+set_config_overrides($config_overrides);
+# device names contain a colon, so a first argument without one is a config
+if (@ARGV and $ARGV[0] !~ /:/) {
+    $opt_config = shift @ARGV;
+    config_init($CONFIG_INIT_EXPLICIT_NAME, $opt_config);
+} else {
+    config_init(0, undef);
+}
+@opt_devices = @ARGV;
+
+my ($cfgerr_level, @cfgerr_errors) = config_errors();
+if ($cfgerr_level >= $CFGERR_WARNINGS) {
+    config_print_errors();
+    if ($cfgerr_level >= $CFGERR_ERRORS) {
+	die("errors processing config file");
+    }
+}
+
+if (!@opt_tests) {
+    @opt_tests = qw( memory xor crc pipe );
+    push @opt_tests, 'holding' if defined $opt_holding_dir;
+    push @opt_tests, 'device' if @opt_devices;
+}
+for my $test (@opt_tests) {
+    usage() unless grep { $_ eq $test } @all_tests;
+}
+die "The holding test needs a holding directory (-H)\n"
+    if (grep { $_ eq 'holding' } @opt_tests and !defined $opt_holding_dir);
+die "The device test needs at least one device\n"
+    if (grep { $_ eq 'device' } @opt_tests and !@opt_devices);
+
+Amanda::Util::finish_setup($RUNNING_AS_ANY);
+
+my %bench = (
+    memory => \&bench_memory,
+    xor => \&bench_xor,
+    crc => \&bench_crc,
+    pipe => \&bench_pipe,
+);
+
+for my $test (@opt_tests) {
+    if ($bench{$test}) {
+	for my $parallel (@opt_parallel) {
+	    my $result = $bench{$test}->($parallel);
+	    report({ %$result, test => $test, parallel => $parallel });
+	}
+    } elsif ($test eq 'holding') {
+	for my $ring_size (@opt_ring_sizes) {
+	    for my $parallel (@opt_parallel) {
+		my $result = bench_holding($parallel, $ring_size);
+		report({ %$result, test => $test, parallel => $parallel,
+			 ring_size => $ring_size });
+	    }
+	}
+    } elsif ($test eq 'device') {
+	for my $device_name (@opt_devices) {
+	    for my $block_size (@opt_block_sizes) {
+		for my $ring_size (@opt_ring_sizes) {
+		    for my $result (bench_device($device_name, $block_size, $ring_size)) {
+			report({ %$result, test => $test, device => $device_name,
+				 block_size => $block_size, ring_size => $ring_size });
+		    }
+		}
+	    }
+	}
+    }
+}
+
+Amanda::Util::finish_application();
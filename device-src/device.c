@@ -225,6 +225,9 @@ static void simple_property_free(SimpleProperty *o);
 static void default_device_open_device(Device * self, char * device_name,
 				    char * device_type, char * device_node);
 static gboolean default_device_configure(Device *self, gboolean use_global_config);
+static DeviceWriteResult default_device_write_blocks(Device *self,
+					guint nblocks, DeviceBlock *blocks,
+					guint *nwritten);
 static gboolean default_device_property_get_ex(Device * self, DevicePropertyId id,
 					       GValue * val,
 					       PropertySurety *surety,
@@ -350,6 +353,7 @@ device_class_init (DeviceClass * device_class)
 
     device_class->open_device = default_device_open_device;
     device_class->configure = default_device_configure;
+    device_class->write_blocks = default_device_write_blocks;
     device_class->property_get_ex = default_device_property_get_ex;
     device_class->property_set_ex = default_device_property_set_ex;
     g_object_class->finalize = device_finalize;
@@ -1325,6 +1329,67 @@ device_write_block (Device * self, guint size, gpointer block)
     return (*klass->write_block)(self,size, block);
 }
 
+/* Devices that can't do better write the blocks one at a time */
+static DeviceWriteResult
+default_device_write_blocks(
+    Device      *self,
+    guint        nblocks,
+    DeviceBlock *blocks,
+    guint       *nwritten)
+{
+    DeviceClass *klass = DEVICE_GET_CLASS(self);
+    DeviceWriteResult result = WRITE_SUCCEED;
+    guint i;
+
+    for (i = 0; i < nblocks; i++) {
+	result = (*klass->write_block)(self, blocks[i].size, blocks[i].data);
+	if (result != WRITE_SUCCEED)
+	    break;
+	if (self->is_eom) {
+	    i++;
+	    break;
+	}
+    }
+
+    *nwritten = i;
+    return result;
+}
+
+DeviceWriteResult
+device_write_blocks (Device * self, guint nblocks, DeviceBlock * blocks,
+		     guint * nwritten)
+{
+    DeviceClass *klass;
+    DeviceWriteResult result;
+    guint i;
+
+    g_assert(IS_DEVICE (self));
+    g_assert(nblocks > 0);
+    g_assert(blocks != NULL);
+    g_assert(nwritten != NULL);
+    g_assert(self->in_file);
+    g_assert(!selfp->wrote_short_block);
+    g_assert(IS_WRITABLE_ACCESS_MODE(self->access_mode));
+
+    for (i = 0; i < nblocks; i++) {
+	g_assert(blocks[i].data != NULL);
+	g_assert(blocks[i].size > 0);
+	g_assert(blocks[i].size <= self->block_size);
+	g_assert(i == nblocks-1 || blocks[i].size == self->block_size);
+    }
+
+    klass = DEVICE_GET_CLASS(self);
+    g_assert(klass);
+    g_assert(klass->write_blocks);
+    result = (*klass->write_blocks)(self, nblocks, blocks, nwritten);
+
+    /* the short block only ends the file if it was actually written */
+    if (*nwritten == nblocks && blocks[nblocks-1].size < self->block_size)
+	selfp->wrote_short_block = TRUE;
+
+    return result;
+}
+
 gboolean
 device_start_file (Device * self, dumpfile_t * jobInfo) {
     DeviceClass * klass;
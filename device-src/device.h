@@ -57,6 +57,12 @@ typedef enum {
     WRITE_FULL		/* nothing was written, volume is full        */
 } DeviceWriteResult;
 
+/* One block of a batch given to device_write_blocks */
+typedef struct DeviceBlock {
+    gpointer data;
+    guint size;
+} DeviceBlock;
+
 #define IS_WRITABLE_ACCESS_MODE(mode) ((mode) == ACCESS_WRITE || \
                                        (mode) == ACCESS_APPEND)
 
@@ -197,6 +203,9 @@ struct _DeviceClass {
     gboolean (* start_file) (Device * self, dumpfile_t * info);
     DeviceWriteResult (* write_block) (Device * self, guint size,
 				       gpointer data);
+    DeviceWriteResult (* write_blocks) (Device * self, guint nblocks,
+					DeviceBlock * blocks,
+					guint * nwritten);
     gboolean (* finish_file) (Device * self);
     gboolean (* init_seek_file) (Device * self, guint file);
     dumpfile_t* (* seek_file) (Device * self, guint file);
@@ -350,6 +359,15 @@ gboolean        device_start_file       (Device * self,
 DeviceWriteResult device_write_block	(Device * self,
                                          guint size,
                                          gpointer data);
+/* Write nblocks blocks in order; every block but the last must be exactly
+ * block_size.  Stops early on error or when the device reaches LEOM, and
+ * sets *nwritten to the number of blocks written; the caller resubmits the
+ * rest.  A short last block ends the file only once it has been written,
+ * like a short block given to device_write_block. */
+DeviceWriteResult device_write_blocks	(Device * self,
+                                         guint nblocks,
+                                         DeviceBlock * blocks,
+                                         guint * nwritten);
 gboolean 	device_finish_file	(Device * self);
 gboolean	device_init_seek_file	(Device * self,
 					guint file);
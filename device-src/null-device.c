@@ -69,6 +69,9 @@ static gboolean null_device_finish (Device * pself);
 static gboolean null_device_start_file(Device * self, dumpfile_t * jobInfo);
 static DeviceWriteResult null_device_write_block(Device * self, guint size,
 						 gpointer data);
+static DeviceWriteResult null_device_write_blocks(Device * self, guint nblocks,
+						  DeviceBlock * blocks,
+						  guint * nwritten);
 static gboolean null_device_finish_file(Device * self);
 static Device* null_device_factory(char * device_name, char * device_type, char * device_node);
 
@@ -181,6 +184,7 @@ null_device_class_init (NullDeviceClass * c)
     device_class->finish = null_device_finish;
     device_class->start_file = null_device_start_file;
     device_class->write_block = null_device_write_block;
+    device_class->write_blocks = null_device_write_blocks;
     device_class->finish_file = null_device_finish_file;
 }
 
@@ -298,6 +302,21 @@ null_device_write_block (Device * pself, guint size G_GNUC_UNUSED,
     return WRITE_SUCCEED;
 }
 
+static DeviceWriteResult
+null_device_write_blocks (Device * pself, guint nblocks,
+	    DeviceBlock * blocks G_GNUC_UNUSED, guint * nwritten) {
+    NullDevice * self;
+    self = NULL_DEVICE(pself);
+
+    *nwritten = 0;
+    if (device_in_error(self)) return WRITE_FAILED;
+
+    pself->block += nblocks;
+    *nwritten = nblocks;
+
+    return WRITE_SUCCEED;
+}
+
 static gboolean
 null_device_finish_file(Device * pself) {
 
@@ -49,6 +49,12 @@
 #define MONITOR_FREE_SPACE_EVERY_KB 102400
 #define MONITOR_FREE_SPACE_CLOSELY_WITHIN_BLOCKS 128
 
+/* Maximum number of blocks given to a single writev() */
+#define VFS_DEVICE_MAX_IOV 64
+
+/* With DROP_CACHE, drop read data from the page cache every this many bytes */
+#define VFS_DEVICE_DROP_READ_EVERY (16*1024*1024)
+
 void vfs_device_register(void);
 
 /* here are local prototypes */
@@ -72,6 +78,10 @@ static Device * vfs_device_factory(char * device_name, char * device_type, char
 static DeviceStatusFlags vfs_device_read_label(Device * dself);
 static DeviceWriteResult vfs_device_write_block(Device * self, guint size,
 						gpointer data);
+static DeviceWriteResult vfs_device_write_blocks(Device * self, guint nblocks,
+						 DeviceBlock * blocks,
+						 guint * nwritten);
+static DeviceWriteResult vfs_device_write_no_space(VfsDevice * self);
 static int vfs_device_read_block(Device * self, gpointer data, int * size_req, int max_block);
 
 /* Various helper functions. */
@@ -84,8 +94,11 @@ static gboolean vfs_validate(Device *dself);
 
 static gboolean check_is_dir(VfsDevice * self, const char * name);
 static char * file_number_to_file_name(VfsDevice * self, guint file);
-static gboolean file_number_to_file_name_functor(const char * filename,
-                                                 gpointer datap);
+static gboolean vfs_index_load(VfsDevice *self);
+static void vfs_index_invalidate(VfsDevice *self);
+static void vfs_index_add(VfsDevice *self, guint file, const char *path);
+static void vfs_index_set_size(VfsDevice *self, guint file, guint64 size);
+static void vfs_index_remove(VfsDevice *self, guint file);
 static gboolean vfs_device_set_max_volume_usage_fn(Device *dself,
 			    DevicePropertyBase *base, GValue *val,
 			    PropertySurety surety, PropertySource source);
@@ -113,6 +126,23 @@ static gboolean property_set_use_data_fn(Device *dself,
 static gboolean property_set_leom_fn(Device *dself,
 			    DevicePropertyBase *base, GValue *val,
 			    PropertySurety surety, PropertySource source);
+static gboolean property_set_preallocate_fn(Device *dself,
+			    DevicePropertyBase *base, GValue *val,
+			    PropertySurety surety, PropertySource source);
+static gboolean property_set_write_behind_fn(Device *dself,
+			    DevicePropertyBase *base, GValue *val,
+			    PropertySurety surety, PropertySource source);
+static gboolean property_set_drop_cache_fn(Device *dself,
+			    DevicePropertyBase *base, GValue *val,
+			    PropertySurety surety, PropertySource source);
+
+/* page cache control */
+static void vfs_device_cache_start_file(VfsDevice *self);
+static void vfs_device_cache_write(VfsDevice *self, guint64 size);
+static void vfs_device_preallocate(VfsDevice *self, off_t end);
+static void vfs_device_cache_written(VfsDevice *self);
+static void vfs_device_cache_finish_file(VfsDevice *self);
+static void vfs_device_cache_read(VfsDevice *self);
 //static char* lockfile_name(VfsDevice * self, guint file);
 static gboolean open_lock(VfsDevice * self, int file, gboolean exclusive);
 static void promote_volume_lock(VfsDevice * self);
@@ -124,8 +154,6 @@ static gboolean check_dir_empty_functor(const char * filename,
 static int search_vfs_directory(VfsDevice *self, const char * regex,
 			SearchDirectoryFunctor functor, gpointer user_data);
 static gint get_last_file_number(VfsDevice * self);
-static gboolean get_last_file_number_functor(const char * filename,
-                                             gpointer datap);
 static char * make_new_file_name(VfsDevice * self, const dumpfile_t * ji);
 static gboolean try_unlink(const char * file);
 
@@ -150,6 +178,15 @@ DevicePropertyBase device_property_slow_write;
 DevicePropertyBase device_property_use_data;
 #define PROPERTY_USE_DATA (device_property_use_data.ID)
 
+DevicePropertyBase device_property_preallocate;
+#define PROPERTY_PREALLOCATE (device_property_preallocate.ID)
+
+DevicePropertyBase device_property_write_behind;
+#define PROPERTY_WRITE_BEHIND (device_property_write_behind.ID)
+
+DevicePropertyBase device_property_drop_cache;
+#define PROPERTY_DROP_CACHE (device_property_drop_cache.ID)
+
 void vfs_device_register(void) {
     static const char * device_prefix_list[] = { "file", NULL };
 
@@ -162,6 +199,15 @@ void vfs_device_register(void) {
     device_property_fill_and_register(&device_property_use_data,
                                       G_TYPE_STRING, "use_data",
       "Should VFS device use the data subdir?");
+    device_property_fill_and_register(&device_property_preallocate,
+                                      G_TYPE_UINT64, "preallocate",
+      "Preallocate the space of each file by this many bytes at a time");
+    device_property_fill_and_register(&device_property_write_behind,
+                                      G_TYPE_UINT64, "write_behind",
+      "Start writing the data to disk every this many bytes");
+    device_property_fill_and_register(&device_property_drop_cache,
+                                      G_TYPE_BOOLEAN, "drop_cache",
+      "Should VFS device drop the data it writes and reads from the page cache?");
 
     register_device(vfs_device_factory, device_prefix_list);
 }
@@ -213,6 +259,16 @@ vfs_device_init (
     self->checked_fs_free_bytes = G_MAXUINT64;
     self->checked_fs_free_time = 0;
     self->checked_fs_free_bytes = G_MAXUINT64;
+    self->file_index = NULL;
+    self->file_index_dir = NULL;
+    self->preallocate = 0;
+    self->write_behind = 0;
+    self->drop_cache = FALSE;
+    self->file_base = 0;
+    self->preallocated_to = 0;
+    self->synced_to = 0;
+    self->waited_to = 0;
+    self->dropped_to = 0;
     self->clear_and_prepare_label = &vfs_clear_and_prepare_label;
     self->release_file = &vfs_release_file;
     self->update_volume_size = &vfs_update_volume_size;
@@ -275,6 +331,20 @@ vfs_device_init (
     device_set_simple_property(dself, PROPERTY_MEDIUM_ACCESS_TYPE,
 	    &response, PROPERTY_SURETY_GOOD, PROPERTY_SOURCE_DETECTED);
     g_value_unset(&response);
+
+    g_value_init(&response, G_TYPE_UINT64);
+    g_value_set_uint64(&response, 0);
+    device_set_simple_property(dself, PROPERTY_PREALLOCATE,
+	    &response, PROPERTY_SURETY_GOOD, PROPERTY_SOURCE_DEFAULT);
+    device_set_simple_property(dself, PROPERTY_WRITE_BEHIND,
+	    &response, PROPERTY_SURETY_GOOD, PROPERTY_SOURCE_DEFAULT);
+    g_value_unset(&response);
+
+    g_value_init(&response, G_TYPE_BOOLEAN);
+    g_value_set_boolean(&response, FALSE);
+    device_set_simple_property(dself, PROPERTY_DROP_CACHE,
+	    &response, PROPERTY_SURETY_GOOD, PROPERTY_SOURCE_DEFAULT);
+    g_value_unset(&response);
 }
 
 static void
@@ -291,6 +361,7 @@ vfs_device_class_init(
     device_class->start_file = vfs_device_start_file;
     device_class->read_label = vfs_device_read_label;
     device_class->write_block = vfs_device_write_block;
+    device_class->write_blocks = vfs_device_write_blocks;
     device_class->read_block = vfs_device_read_block;
     device_class->finish_file = vfs_device_finish_file;
     device_class->seek_file = vfs_device_seek_file;
@@ -340,6 +411,24 @@ vfs_device_base_init(
 	    device_simple_property_get_fn,
 	    NULL);
 
+    device_class_register_property(device_class, PROPERTY_PREALLOCATE,
+	    (PROPERTY_ACCESS_GET_MASK | PROPERTY_ACCESS_SET_MASK) &
+			(~ PROPERTY_ACCESS_SET_INSIDE_FILE_WRITE),
+	    device_simple_property_get_fn,
+	    property_set_preallocate_fn);
+
+    device_class_register_property(device_class, PROPERTY_WRITE_BEHIND,
+	    (PROPERTY_ACCESS_GET_MASK | PROPERTY_ACCESS_SET_MASK) &
+			(~ PROPERTY_ACCESS_SET_INSIDE_FILE_WRITE),
+	    device_simple_property_get_fn,
+	    property_set_write_behind_fn);
+
+    device_class_register_property(device_class, PROPERTY_DROP_CACHE,
+	    (PROPERTY_ACCESS_GET_MASK | PROPERTY_ACCESS_SET_MASK) &
+			(~ PROPERTY_ACCESS_SET_INSIDE_FILE_WRITE),
+	    device_simple_property_get_fn,
+	    property_set_drop_cache_fn);
+
     /* add the ability to set LEOM to FALSE, for testing purposes */
     device_class_register_property(device_class, PROPERTY_LEOM,
 	    PROPERTY_ACCESS_GET_MASK | PROPERTY_ACCESS_SET_BEFORE_START,
@@ -377,6 +466,51 @@ vfs_device_set_enforce_max_volume_usage_fn(
     return device_simple_property_set_fn(dself, base, val, surety, source);
 }
 
+static gboolean
+property_set_preallocate_fn(
+    Device *dself,
+    DevicePropertyBase *base,
+    GValue *val,
+    PropertySurety surety,
+    PropertySource source)
+{
+    VfsDevice *self = VFS_DEVICE(dself);
+
+    self->preallocate = g_value_get_uint64(val);
+
+    return device_simple_property_set_fn(dself, base, val, surety, source);
+}
+
+static gboolean
+property_set_write_behind_fn(
+    Device *dself,
+    DevicePropertyBase *base,
+    GValue *val,
+    PropertySurety surety,
+    PropertySource source)
+{
+    VfsDevice *self = VFS_DEVICE(dself);
+
+    self->write_behind = g_value_get_uint64(val);
+
+    return device_simple_property_set_fn(dself, base, val, surety, source);
+}
+
+static gboolean
+property_set_drop_cache_fn(
+    Device *dself,
+    DevicePropertyBase *base,
+    GValue *val,
+    PropertySurety surety,
+    PropertySource source)
+{
+    VfsDevice *self = VFS_DEVICE(dself);
+
+    self->drop_cache = g_value_get_boolean(val);
+
+    return device_simple_property_set_fn(dself, base, val, surety, source);
+}
+
 static gboolean
 property_get_monitor_free_space_fn(
     Device *dself,
@@ -547,6 +681,8 @@ static void vfs_device_finalize(
         device_finish(dself);
     }
 
+    vfs_index_invalidate(self);
+
     if(G_OBJECT_CLASS(parent_class)->finalize)
         (* G_OBJECT_CLASS(parent_class)->finalize)(obj_self);
 
@@ -595,73 +731,311 @@ static gboolean check_is_dir(
 }
 
 typedef struct {
-    VfsDevice * self;
-    int count;
-    char * result;
-} fnfn_data;
+    char *name;		/* relative to dir_name */
+    guint64 size;
+} VfsIndexEntry;
+
+static gint
+vfs_index_compare(
+    gconstpointer a,
+    gconstpointer b,
+    gpointer user_data G_GNUC_UNUSED)
+{
+    guint fa = GPOINTER_TO_UINT(a);
+    guint fb = GPOINTER_TO_UINT(b);
+
+    return (fa < fb) ? -1 : (fa > fb);
+}
+
+static void
+vfs_index_entry_free(
+    gpointer data)
+{
+    VfsIndexEntry *entry = (VfsIndexEntry *)data;
+
+    g_free(entry->name);
+    g_free(entry);
+}
+
+static void
+vfs_index_invalidate(
+    VfsDevice *self)
+{
+    if (self->file_index) {
+	g_tree_destroy(self->file_index);
+	self->file_index = NULL;
+    }
+    amfree(self->file_index_dir);
+}
+
+/* sub-second timestamps, where the system has them, so that a change made
+ * by someone else in the same second as ours is still noticed */
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+#define VFS_MTIME_NS(st) ((long)(st)->st_mtim.tv_nsec)
+#define VFS_CTIME_NS(st) ((long)(st)->st_ctim.tv_nsec)
+#else
+#define VFS_MTIME_NS(st) 0L
+#define VFS_CTIME_NS(st) 0L
+#endif
+
+static void
+vfs_index_set_dir_stat(
+    VfsDevice *self,
+    struct stat *dir_stat)
+{
+    self->file_index_mtime = dir_stat->st_mtime;
+    self->file_index_ctime = dir_stat->st_ctime;
+    self->file_index_mtime_ns = VFS_MTIME_NS(dir_stat);
+    self->file_index_ctime_ns = VFS_CTIME_NS(dir_stat);
+    self->file_index_dirsize = dir_stat->st_size;
+}
 
-/* A SearchDirectoryFunctor. */
 static gboolean
-file_number_to_file_name_functor(const char *filename,
-                                 gpointer datap) {
-    char *result_tmp;
-    struct stat file_status;
-    fnfn_data *data = (fnfn_data*)datap;
+vfs_index_match_dir_stat(
+    VfsDevice *self,
+    struct stat *dir_stat)
+{
+    return self->file_index_mtime == dir_stat->st_mtime &&
+	   self->file_index_ctime == dir_stat->st_ctime &&
+	   self->file_index_mtime_ns == VFS_MTIME_NS(dir_stat) &&
+	   self->file_index_ctime_ns == VFS_CTIME_NS(dir_stat) &&
+	   self->file_index_dirsize == dir_stat->st_size;
+}
 
-    result_tmp = g_strjoin(NULL, data->self->dir_name, "/", filename, NULL);
+/* Remember the state of the directory, after we changed it ourselves */
+static void
+vfs_index_stamp(
+    VfsDevice *self)
+{
+    struct stat dir_stat;
 
-    /* Just to be thorough, let's check that it's a real
-       file. */
-    if (0 != stat(result_tmp, &file_status)) {
-	g_warning(_("Cannot stat file %s (%s), ignoring it"), result_tmp, strerror(errno));
-    } else if (!S_ISREG(file_status.st_mode)) {
-	g_warning(_("%s is not a regular file, ignoring it"), result_tmp);
+    if (!self->file_index)
+	return;
+
+    if (stat(self->dir_name, &dir_stat) != 0) {
+	vfs_index_invalidate(self);
+	return;
+    }
+    vfs_index_set_dir_stat(self, &dir_stat);
+}
+
+/* A SearchDirectoryFunctor; only the names are read here */
+static gboolean
+vfs_index_load_functor(
+    const char *filename,
+    gpointer user_data)
+{
+    VfsDevice *self = VFS_DEVICE(user_data);
+    VfsIndexEntry *entry;
+    guint64 file;
+
+    file = g_ascii_strtoull(filename, NULL, 10); /* Guaranteed to work. */
+    if (file > G_MAXINT) {
+	g_warning(_("Super-large device file %s found, ignoring"), filename);
+    } else if (g_tree_lookup(self->file_index, GUINT_TO_POINTER(file))) {
+	g_warning("Found multiple names for file number %d, ignoring file %s/%s",
+		  (int)file, self->dir_name, filename);
     } else {
-        data->count ++;
-        if (data->result == NULL) {
-            data->result = result_tmp;
-            result_tmp = NULL;
-        }
+	entry = g_new(VfsIndexEntry, 1);
+	entry->name = g_strdup(filename);
+	entry->size = 0;
+	g_tree_insert(self->file_index, GUINT_TO_POINTER(file), entry);
+	if ((gint)file > self->file_index_last)
+	    self->file_index_last = file;
+    }
+
+    return TRUE;
+}
+
+/* Make sure the file index is up to date.  The directory is only scanned
+ * the first time, or when it was changed by someone else since we last
+ * looked at it; otherwise this costs a single stat().  The scan only reads
+ * the names, like the lookups it replaces.  Returns FALSE if the directory
+ * can't be read. */
+static gboolean
+vfs_index_load(
+    VfsDevice *self)
+{
+    struct stat dir_stat;
+    gboolean have_stat;
+
+    have_stat = (stat(self->dir_name, &dir_stat) == 0);
+    if (have_stat && self->file_index &&
+	g_str_equal(self->file_index_dir, self->dir_name) &&
+	vfs_index_match_dir_stat(self, &dir_stat)) {
+	return TRUE;
+    }
+
+    vfs_index_invalidate(self);
+    self->file_index = g_tree_new_full(vfs_index_compare, NULL, NULL,
+				       vfs_index_entry_free);
+    self->file_index_dir = g_strdup(self->dir_name);
+    self->file_index_last = -1;
+    self->file_index_sized = FALSE;
+    self->file_index_bytes = 0;
+
+    if (search_vfs_directory(self, "^[0-9]+\\.",
+			     vfs_index_load_functor, self) < 0) {
+	vfs_index_invalidate(self);
+	return FALSE;
+    }
+
+    /* the stat was done before the scan, so a change made during the scan
+     * makes the next call scan again */
+    if (have_stat) {
+	vfs_index_set_dir_stat(self, &dir_stat);
+    } else {
+	self->file_index_mtime = self->file_index_ctime = 0;
+	self->file_index_mtime_ns = self->file_index_ctime_ns = 0;
+	self->file_index_dirsize = -1;
     }
-    amfree(result_tmp);
     return TRUE;
 }
 
-/* This function finds the filename for a given file number. We search
- * for a filesystem file matching the regex /^0*$device_file\./; if
- * there is more than one such file we make a warning and take an
- * arbitrary one. */
+/* A GTraverseFunc */
+static gboolean
+vfs_index_size_functor(
+    gpointer key G_GNUC_UNUSED,
+    gpointer value,
+    gpointer data)
+{
+    VfsDevice *self = VFS_DEVICE(data);
+    VfsIndexEntry *entry = (VfsIndexEntry *)value;
+    char *full_filename;
+    struct stat stat_buf;
+
+    full_filename = g_strjoin(NULL, self->dir_name, "/", entry->name, NULL);
+    if (stat(full_filename, &stat_buf) < 0) {
+        /* Log it and keep going. */
+	g_warning(_("Couldn't stat file %s: %s"), full_filename, strerror(errno));
+	entry->size = 0;
+    } else {
+	entry->size = stat_buf.st_size;
+	self->file_index_bytes += entry->size;
+    }
+
+    amfree(full_filename);
+    return FALSE;
+}
+
+/* Read the size of every file in the index, the first time it is needed */
+static void
+vfs_index_size(
+    VfsDevice *self)
+{
+    if (self->file_index_sized)
+	return;
+
+    self->file_index_bytes = 0;
+    g_tree_foreach(self->file_index, vfs_index_size_functor, self);
+    self->file_index_sized = TRUE;
+}
+
+/* The following functions keep a loaded index in sync with the changes we
+ * make to the directory; they do nothing if the index is not loaded. */
+static void
+vfs_index_add(
+    VfsDevice *self,
+    guint file,
+    const char *path)
+{
+    VfsIndexEntry *entry;
+    const char *base;
+
+    if (!self->file_index)
+	return;
+
+    base = strrchr(path, '/');
+    entry = g_new(VfsIndexEntry, 1);
+    entry->name = g_strdup(base ? base + 1 : path);
+    entry->size = 0;
+    g_tree_replace(self->file_index, GUINT_TO_POINTER(file), entry);
+    if ((gint)file > self->file_index_last)
+	self->file_index_last = file;
+    vfs_index_stamp(self);
+}
+
+static void
+vfs_index_set_size(
+    VfsDevice *self,
+    guint file,
+    guint64 size)
+{
+    VfsIndexEntry *entry;
+
+    if (!self->file_index)
+	return;
+
+    entry = g_tree_lookup(self->file_index, GUINT_TO_POINTER(file));
+    if (entry) {
+	self->file_index_bytes += size - entry->size;
+	entry->size = size;
+    }
+}
+
+static gboolean
+vfs_index_last_functor(
+    gpointer key,
+    gpointer value G_GNUC_UNUSED,
+    gpointer data)
+{
+    *(gint *)data = GPOINTER_TO_UINT(key);
+    return FALSE;
+}
+
+static void
+vfs_index_remove(
+    VfsDevice *self,
+    guint file)
+{
+    VfsIndexEntry *entry;
+
+    if (!self->file_index)
+	return;
+
+    entry = g_tree_lookup(self->file_index, GUINT_TO_POINTER(file));
+    if (entry) {
+	self->file_index_bytes -= entry->size;
+	g_tree_remove(self->file_index, GUINT_TO_POINTER(file));
+    }
+    if ((gint)file == self->file_index_last) {
+	self->file_index_last = -1;
+	g_tree_foreach(self->file_index, vfs_index_last_functor,
+		       &self->file_index_last);
+    }
+    vfs_index_stamp(self);
+}
+
+/* This function finds the filename for a given file number, from the
+ * file index.  If there is more than one file with that number, the index
+ * warned about it when it was built and kept an arbitrary one. */
 static char *
 file_number_to_file_name(
     VfsDevice *self,
     guint device_file)
 {
-    char *regex;
-    fnfn_data data;
-
-    data.self = self;
-    data.count = 0;
-    data.result = NULL;
+    VfsIndexEntry *entry;
+    struct stat file_status;
+    char *result;
 
-    regex = g_strdup_printf("^0*%u\\.", device_file);
+    if (!vfs_index_load(self))
+	return NULL;
 
-    search_vfs_directory(self, regex,
-                         file_number_to_file_name_functor, &data);
+    entry = g_tree_lookup(self->file_index, GUINT_TO_POINTER(device_file));
+    if (!entry)
+	return NULL;
 
-    amfree(regex);
+    result = g_strjoin(NULL, self->dir_name, "/", entry->name, NULL);
 
-    if (data.count == 0) {
-        g_assert(data.result == NULL);
-        return NULL;
-    } else if (data.count > 1) {
-	g_warning("Found multiple names for file number %d, choosing file %s",
-                device_file, data.result);
-        return data.result;
-    } else {
-        g_assert(data.result != NULL);
-        return data.result;
+    /* Just to be thorough, let's check that it's a real file. */
+    if (0 != stat(result, &file_status)) {
+	g_warning(_("Cannot stat file %s (%s), ignoring it"), result, strerror(errno));
+	amfree(result);
+    } else if (!S_ISREG(file_status.st_mode)) {
+	g_warning(_("%s is not a regular file, ignoring it"), result);
+	amfree(result);
     }
-    g_assert_not_reached();
+    return result;
 }
 
 /* This function returns the dynamically-allocated lockfile name for a
@@ -694,39 +1068,17 @@ static void promote_volume_lock(VfsDevice * self G_GNUC_UNUSED) {
 static void demote_volume_lock(VfsDevice * self G_GNUC_UNUSED) {
 }
 
-/* A SearchDirectoryFunctor */
-static gboolean
-update_volume_size_functor(const char *filename,
-                           gpointer user_data)
-{
-    char *full_filename;
-    struct stat stat_buf;
-    VfsDevice *self = VFS_DEVICE(user_data);
-
-    full_filename = g_strjoin(NULL, self->dir_name, "/", filename, NULL);
-
-    if (stat(full_filename, &stat_buf) < 0) {
-        /* Log it and keep going. */
-	g_warning(_("Couldn't stat file %s: %s"), full_filename, strerror(errno));
-        amfree(full_filename);
-        return TRUE;
-    }
-
-    amfree(full_filename);
-    self->volume_bytes += stat_buf.st_size;
-
-    return TRUE;
-}
-
 static void
 vfs_update_volume_size(
     Device *dself)
 {
     VfsDevice *self = VFS_DEVICE(dself);
-    self->volume_bytes = 0;
-    search_vfs_directory(self, "^[0-9]+\\.",
-                         update_volume_size_functor, self);
 
+    self->volume_bytes = 0;
+    if (vfs_index_load(self)) {
+	vfs_index_size(self);
+	self->volume_bytes = self->file_index_bytes;
+    }
 }
 
 static void
@@ -864,6 +1216,7 @@ vfs_clear_and_prepare_label(
     VfsDevice *self = VFS_DEVICE(dself);
 
     self->release_file(dself);
+    vfs_index_invalidate(self);
 
     /* Delete any extant data, except our volume lock. */
     delete_vfs_files(self);
@@ -1035,26 +1388,11 @@ vfs_device_write_block(
 	}
     }
 
+    vfs_device_cache_write(self, size);
     result = vfs_device_robust_write(self, data, size);
 
     if (result == RESULT_NO_SPACE) {
-	DeviceWriteResult dwr = self->leom ? WRITE_SPACE : WRITE_FAILED;
-	if (ftruncate(self->open_file_fd,
-		      dself->bytes_written + VFS_DEVICE_LABEL_SIZE) == -1) {
-	    g_debug("ftruncate failed: %s", strerror(errno));
-	    dwr = WRITE_FAILED;
-	}
-	if (lseek(self->open_file_fd,
-		  dself->bytes_written + VFS_DEVICE_LABEL_SIZE,
-		  SEEK_SET) == -1) {
-	    g_debug("ftruncate failed: %s", strerror(errno));
-	    dwr = WRITE_FAILED;
-	}
-	if (fsync(self->open_file_fd) == -1) {
-	    g_debug("fsync failed: %s", strerror(errno));
-	    dwr = WRITE_FAILED;
-	}
-	return dwr;
+	return vfs_device_write_no_space(self);
     } else if (result != RESULT_SUCCESS) {
 	/* vfs_device_robust_write set error status appropriately */
         return WRITE_FAILED;
@@ -1066,7 +1404,101 @@ vfs_device_write_block(
     g_mutex_lock(dself->device_mutex);
     dself->bytes_written += size;
     g_mutex_unlock(dself->device_mutex);
+    vfs_device_cache_written(self);
+
+    return WRITE_SUCCEED;
+}
+
+/* Drop the partially-written data after running out of space, so that the
+ * file ends with the last block that was completely written. */
+static DeviceWriteResult
+vfs_device_write_no_space(
+    VfsDevice *self)
+{
+    Device *dself = DEVICE(self);
+    DeviceWriteResult dwr = self->leom ? WRITE_SPACE : WRITE_FAILED;
+
+    if (ftruncate(self->open_file_fd,
+		  dself->bytes_written + VFS_DEVICE_LABEL_SIZE) == -1) {
+	g_debug("ftruncate failed: %s", strerror(errno));
+	dwr = WRITE_FAILED;
+    }
+    if (lseek(self->open_file_fd,
+	      dself->bytes_written + VFS_DEVICE_LABEL_SIZE,
+	      SEEK_SET) == -1) {
+	g_debug("ftruncate failed: %s", strerror(errno));
+	dwr = WRITE_FAILED;
+    }
+    if (fsync(self->open_file_fd) == -1) {
+	g_debug("fsync failed: %s", strerror(errno));
+	dwr = WRITE_FAILED;
+    }
+    return dwr;
+}
+
+/* Write up to VFS_DEVICE_MAX_IOV blocks with a single writev().  Near the
+ * end of the volume, fall back to one block at a time so that LEOM and
+ * PEOM are detected on the right block. */
+static DeviceWriteResult
+vfs_device_write_blocks(
+    Device      *dself,
+    guint        nblocks,
+    DeviceBlock *blocks,
+    guint       *nwritten)
+{
+    VfsDevice *self = VFS_DEVICE(dself);
+    struct iovec iov[VFS_DEVICE_MAX_IOV];
+    guint64 size = 0;
+    guint n, i;
+
+    *nwritten = 0;
+    if (device_in_error(self)) return WRITE_FAILED;
+
+    g_assert(self->open_file_fd >= 0);
+
+    n = min(nblocks, VFS_DEVICE_MAX_IOV);
+    for (i = 0; i < n; i++) {
+	iov[i].iov_base = blocks[i].data;
+	iov[i].iov_len = blocks[i].size;
+	size += blocks[i].size;
+    }
+
+    if (self->slow_write || check_at_leom(self, size) ||
+	check_at_peom(self, size)) {
+	return parent_class->write_blocks(dself, nblocks, blocks, nwritten);
+    }
+
+    vfs_device_cache_write(self, size);
+    if (full_writev(self->open_file_fd, iov, (int)n) < 0) {
+	if (0
+#ifdef EFBIG
+	    || errno == EFBIG
+#endif
+#ifdef ENOSPC
+	    || errno == ENOSPC
+#endif
+	   ) {
+	    device_set_error(dself,
+		    g_strdup_printf(_("No space left on device: %s"), strerror(errno)),
+		    DEVICE_STATUS_VOLUME_ERROR);
+	    return vfs_device_write_no_space(self);
+	}
+	device_set_error(dself,
+		g_strdup_printf(_("Error writing device fd %d: %s"),
+				self->open_file_fd, strerror(errno)),
+		DEVICE_STATUS_VOLUME_ERROR);
+	return WRITE_FAILED;
+    }
+
+    self->volume_bytes += size;
+    self->checked_bytes_used += size;
+    dself->block += n;
+    g_mutex_lock(dself->device_mutex);
+    dself->bytes_written += size;
+    g_mutex_unlock(dself->device_mutex);
+    vfs_device_cache_written(self);
 
+    *nwritten = n;
     return WRITE_SUCCEED;
 }
 
@@ -1101,6 +1533,7 @@ vfs_device_read_block(
 	dself->bytes_read += size;
 	g_mutex_unlock(dself->device_mutex);
 	dself->block++;
+	vfs_device_cache_read(self);
         return size;
     case RESULT_NO_DATA:
         dself->is_eof = TRUE;
@@ -1189,84 +1622,44 @@ vfs_device_finish(
     return TRUE;
 }
 
-typedef struct {
-    VfsDevice *self;
-    int rval;
-} glfn_data;
-
-/* A SearchDirectoryFunctor. */
-static gboolean
-get_last_file_number_functor(
-    const char *filename,
-    gpointer datap)
-{
-    guint64 file;
-    glfn_data *data = (glfn_data *)datap;
-
-    file = g_ascii_strtoull(filename, NULL, 10); /* Guaranteed to work. */
-    if (file > G_MAXINT) {
-	g_warning(_("Super-large device file %s found, ignoring"), filename);
-        return TRUE;
-    }
-    /* This condition is needlessly complex due to sign issues. */
-    if (data->rval < 0 || ((guint)data->rval) < file) {
-        data->rval = file;
-    }
-    return TRUE;
-}
-
 static gint
 get_last_file_number(
     VfsDevice *self)
 {
-    glfn_data data;
-    int count;
     Device *dself = DEVICE(self);
-    data.self = self;
-    data.rval = -1;
-
-    count = search_vfs_directory(self, "^[0-9]+\\.",
-                                 get_last_file_number_functor, &data);
 
-    if (count <= 0) {
+    if (!vfs_index_load(self) || g_tree_nnodes(self->file_index) == 0) {
         /* Somebody deleted something important while we weren't looking. */
 	device_set_error(dself,
 	    g_strdup(_("Error identifying VFS device contents!")),
 	    DEVICE_STATUS_DEVICE_ERROR | DEVICE_STATUS_VOLUME_ERROR);
         return -1;
-    } else {
-        g_assert(data.rval >= 0);
     }
 
-    return data.rval;
+    g_assert(self->file_index_last >= 0);
+    return self->file_index_last;
 }
 
 typedef struct {
-    VfsDevice * self;
     guint request;
     int best_found;
 } gnfn_data;
 
-/* A SearchDirectoryFunctor. */
+/* A GTraverseFunc; the index is sorted, so stop at the first match */
 static gboolean
 get_next_file_number_functor(
-    const char *filename,
+    gpointer key,
+    gpointer value G_GNUC_UNUSED,
     gpointer datap)
 {
-    guint      file;
+    guint      file = GPOINTER_TO_UINT(key);
     gnfn_data *data = (gnfn_data*)datap;
 
-    file = g_ascii_strtoull(filename, NULL, 10); /* Guaranteed to work. */
-    if (file > G_MAXINT) {
-	g_warning(_("Super-large device file %s found, ignoring"), filename);
-        return TRUE;
-    }
-    /* This condition is needlessly complex due to sign issues. */
-    if (file >= data->request &&
-        (data->best_found < 0 || file < (guint)data->best_found)) {
+    if (file >= data->request) {
         data->best_found = file;
+        return TRUE;
     }
-    return TRUE;
+    return FALSE;
 }
 
 /* Returns the file number equal to or greater than the given requested
@@ -1277,16 +1670,9 @@ get_next_file_number(
     guint request)
 {
     gnfn_data data;
-    int count;
     Device *dself = DEVICE(self);
-    data.self = self;
-    data.request = request;
-    data.best_found = -1;
-
-    count = search_vfs_directory(self, "^[0-9]+\\.",
-                                 get_next_file_number_functor, &data);
 
-    if (count <= 0) {
+    if (!vfs_index_load(self) || g_tree_nnodes(self->file_index) == 0) {
         /* Somebody deleted something important while we weren't looking. */
 	device_set_error(dself,
 	    g_strdup(_("Error identifying VFS device contents!")),
@@ -1294,6 +1680,13 @@ get_next_file_number(
         return -1;
     }
 
+    if (g_tree_lookup(self->file_index, GUINT_TO_POINTER(request)))
+	return request;
+
+    data.request = request;
+    data.best_found = -1;
+    g_tree_foreach(self->file_index, get_next_file_number_functor, &data);
+
     /* Could be -1. */
     return data.best_found;
 }
@@ -1357,6 +1750,7 @@ vfs_device_start_file_open(
         self->release_file(dself);
         return FALSE;
     }
+    vfs_index_add(self, dself->file, self->file_name);
 
     return TRUE;
 }
@@ -1399,6 +1793,7 @@ vfs_device_start_file(
     if (!self->device_start_file_open(dself, ji)) {
 	return FALSE;
     }
+    vfs_device_cache_start_file(self);
 
     if (!vfs_write_amanda_header(self, ji)) {
 	/* vfs_write_amanda_header sets error status if necessary */
@@ -1424,6 +1819,7 @@ vfs_device_finish_file(
     Device *dself)
 {
     VfsDevice *self = VFS_DEVICE(dself);
+    struct stat file_stat;
 
     if (!dself->in_file)
 	return TRUE;
@@ -1432,6 +1828,11 @@ vfs_device_finish_file(
     dself->in_file = FALSE;
     g_mutex_unlock(dself->device_mutex);
 
+    if (self->open_file_fd >= 0) {
+	vfs_device_cache_finish_file(self);
+	if (fstat(self->open_file_fd, &file_stat) == 0)
+	    vfs_index_set_size(self, dself->file, file_stat.st_size);
+    }
     self->release_file(dself);
 
     if (device_in_error(self)) return FALSE;
@@ -1516,6 +1917,11 @@ vfs_device_seek_file(
         self->release_file(dself);
         return NULL;
     }
+    self->dropped_to = 0;
+#ifdef HAVE_POSIX_FADVISE
+    if (self->drop_cache)
+	(void)posix_fadvise(self->open_file_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
 
     result = vfs_device_robust_read(self, header_buffer,
                                     &header_buffer_size);
@@ -1729,6 +2135,7 @@ vfs_device_recycle_file(
     }
 
     self->volume_bytes -= file_size;
+    vfs_index_remove(self, filenum);
     self->release_file(dself);
     return TRUE;
 }
@@ -1742,6 +2149,7 @@ vfs_device_erase(
     if (!open_lock(self, 0, TRUE))
         return FALSE;
 
+    vfs_index_invalidate(self);
     delete_vfs_files(self);
     if (device_in_error(dself)) return FALSE;
 
@@ -1805,6 +2213,171 @@ vfs_device_robust_read(
     return RESULT_SUCCESS;
 }
 
+/*
+ * Page cache control.
+ *
+ * PREALLOCATE reserves the space of the file ahead of the writes, so that
+ * the filesystem can lay it out in large extents; the unused part is given
+ * back when the file is finished.  WRITE_BEHIND starts the writeback of
+ * every WRITE_BEHIND bytes as soon as they are written, and waits for the
+ * previous window, so that dirty pages don't pile up and get flushed in
+ * bursts.  DROP_CACHE drops the data that is on disk from the page cache,
+ * both when writing and when reading, so that a large backup or restore
+ * doesn't evict everything else.
+ */
+
+static void
+vfs_device_drop_range(
+    VfsDevice *self,
+    off_t offset,
+    off_t len)
+{
+#ifdef HAVE_POSIX_FADVISE
+    if (self->drop_cache)
+	(void)posix_fadvise(self->open_file_fd, offset, len, POSIX_FADV_DONTNEED);
+#else
+    (void)self;
+    (void)offset;
+    (void)len;
+#endif
+}
+
+/* Called once the file is opened for writing, before its header is written */
+static void
+vfs_device_cache_start_file(
+    VfsDevice *self)
+{
+    self->file_base = lseek(self->open_file_fd, 0, SEEK_CUR);
+    if (self->file_base < 0)
+	self->file_base = 0;
+    self->preallocated_to = self->file_base;
+    self->synced_to = self->file_base;
+    self->waited_to = self->file_base;
+    vfs_device_preallocate(self, self->file_base + VFS_DEVICE_LABEL_SIZE);
+}
+
+/* Called before size bytes of data are written */
+static void
+vfs_device_cache_write(
+    VfsDevice *self,
+    guint64 size)
+{
+    Device *dself = DEVICE(self);
+
+    vfs_device_preallocate(self, self->file_base + VFS_DEVICE_LABEL_SIZE +
+				 dself->bytes_written + size);
+}
+
+/* Make sure the space up to end is allocated */
+static void
+vfs_device_preallocate(
+    VfsDevice *self,
+    off_t end)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+    off_t len;
+
+    if (self->preallocate == 0 || self->preallocated_to < 0 ||
+	end <= self->preallocated_to)
+	return;
+
+    len = max((off_t)self->preallocate, end - self->preallocated_to);
+    if (fallocate(self->open_file_fd, FALLOC_FL_KEEP_SIZE,
+		  self->preallocated_to, len) == -1) {
+	/* not supported by this filesystem, or no space; the write will
+	 * tell */
+	g_debug("fallocate failed: %s", strerror(errno));
+	self->preallocated_to = -1;
+	return;
+    }
+    self->preallocated_to += len;
+#else
+    (void)self;
+    (void)end;
+#endif
+}
+
+/* Called after data was written */
+static void
+vfs_device_cache_written(
+    VfsDevice *self)
+{
+    Device *dself = DEVICE(self);
+    off_t offset;
+
+    if (self->write_behind == 0)
+	return;
+
+    offset = self->file_base + VFS_DEVICE_LABEL_SIZE + dself->bytes_written;
+    if (offset - self->synced_to < (off_t)self->write_behind)
+	return;
+
+#ifdef HAVE_SYNC_FILE_RANGE
+    /* start the writeback of this window */
+    (void)sync_file_range(self->open_file_fd, self->synced_to,
+			  offset - self->synced_to, SYNC_FILE_RANGE_WRITE);
+
+    /* and wait for the previous one, which should be done by now */
+    if (self->synced_to > self->waited_to) {
+	(void)sync_file_range(self->open_file_fd, self->waited_to,
+			      self->synced_to - self->waited_to,
+			      SYNC_FILE_RANGE_WAIT_BEFORE |
+			      SYNC_FILE_RANGE_WRITE |
+			      SYNC_FILE_RANGE_WAIT_AFTER);
+	vfs_device_drop_range(self, self->waited_to,
+			      self->synced_to - self->waited_to);
+	self->waited_to = self->synced_to;
+    }
+#endif
+    self->synced_to = offset;
+}
+
+/* Called before a file that was written is closed */
+static void
+vfs_device_cache_finish_file(
+    VfsDevice *self)
+{
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+    struct stat file_stat;
+
+    /* give back the space preallocated past the end of the file */
+    if (self->preallocate > 0 && self->preallocated_to > 0 &&
+	fstat(self->open_file_fd, &file_stat) == 0 &&
+	self->preallocated_to > file_stat.st_size) {
+	if (ftruncate(self->open_file_fd, file_stat.st_size) == -1)
+	    g_debug("ftruncate failed: %s", strerror(errno));
+    }
+#endif
+
+    if (self->drop_cache) {
+	/* the pages must be clean before they can be dropped */
+	if (fsync(self->open_file_fd) == -1)
+	    g_debug("fsync failed: %s", strerror(errno));
+	vfs_device_drop_range(self, self->file_base, 0);
+    }
+}
+
+/* Called after data was read */
+static void
+vfs_device_cache_read(
+    VfsDevice *self)
+{
+    off_t offset;
+
+    if (!self->drop_cache)
+	return;
+
+    offset = lseek(self->open_file_fd, 0, SEEK_CUR);
+    if (offset < 0)
+	return;
+    if (offset < self->dropped_to)
+	self->dropped_to = 0;	/* seek_block went back */
+    if (offset - self->dropped_to >= VFS_DEVICE_DROP_READ_EVERY) {
+	vfs_device_drop_range(self, self->dropped_to, offset - self->dropped_to);
+	self->dropped_to = offset;
+    }
+}
+
 IoResult
 vfs_device_robust_write(
     VfsDevice *self,
@@ -77,6 +77,31 @@ typedef struct {
 
     /* and how many bytes have been written since the last check? */
     guint64 checked_bytes_used;
+
+    /* in-memory index of the volume files (file number -> name and size),
+     * rebuilt from the directory when the directory changes under us; the
+     * sizes are only read when the volume size is needed */
+    GTree *file_index;
+    char *file_index_dir;
+    time_t file_index_mtime;
+    time_t file_index_ctime;
+    long file_index_mtime_ns;
+    long file_index_ctime_ns;
+    off_t file_index_dirsize;
+    gint file_index_last;
+    gboolean file_index_sized;
+    guint64 file_index_bytes;
+
+    /* page cache control: PREALLOCATE, WRITE_BEHIND and DROP_CACHE */
+    guint64 preallocate;
+    guint64 write_behind;
+    gboolean drop_cache;
+    off_t file_base;		/* offset of the current file's header */
+    off_t preallocated_to;	/* offset up to which space is allocated */
+    off_t synced_to;		/* end of the last write-behind window */
+    off_t waited_to;		/* end of the last window known on disk */
+    off_t dropped_to;		/* offset up to which reads were dropped */
+
     gboolean (* clear_and_prepare_label)(Device *dself, char *label, char *timestamp);
     void (* release_file)(Device *dself);
     void (* update_volume_size)(Device *dself);
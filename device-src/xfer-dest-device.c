@@ -97,6 +97,46 @@ do_block(
     return TRUE;
 }
 
+static gboolean
+do_blocks(
+    XferDestDevice *self,
+    guint nblocks,
+    DeviceBlock *blocks)
+{
+    XferElement *elt = XFER_ELEMENT(self);
+    guint nwritten;
+
+    while (nblocks > 0) {
+	if (device_write_blocks(self->device, nblocks, blocks, &nwritten)
+							!= WRITE_SUCCEED) {
+	    xfer_cancel_with_error(elt, "%s: %s",
+		    self->device->device_name, device_error_or_status(self->device));
+	    wait_until_xfer_cancelled(elt->xfer);
+	    return FALSE;
+	}
+
+	/* a write that makes no progress would loop forever */
+	if (nwritten == 0) {
+	    xfer_cancel_with_error(elt, "%s: no block written",
+		    self->device->device_name);
+	    wait_until_xfer_cancelled(elt->xfer);
+	    return FALSE;
+	}
+
+	/* check for LEOM */
+	if (self->cancel_at_leom && self->device->is_eom) {
+	    xfer_cancel_with_error(elt, "%s: LEOM detected", self->device->device_name);
+	    wait_until_xfer_cancelled(elt->xfer);
+	    return FALSE;
+	}
+
+	blocks += nwritten;
+	nblocks -= nwritten;
+    }
+
+    return TRUE;
+}
+
 static void
 push_buffer_impl(
     XferElement *elt,
@@ -153,14 +193,25 @@ push_buffer_impl(
     }
 
     /* write any whole blocks directly from the push buffer */
-    while (len >= self->block_size) {
-	if (!do_block(self, self->block_size, buf)) {
+    if (len >= self->block_size) {
+	guint nblocks = len / self->block_size;
+	DeviceBlock *blocks = g_new(DeviceBlock, nblocks);
+	guint i;
+	gboolean ok;
+
+	for (i = 0; i < nblocks; i++) {
+	    blocks[i].data = (char *)buf + i * self->block_size;
+	    blocks[i].size = self->block_size;
+	}
+	ok = do_blocks(self, nblocks, blocks);
+	g_free(blocks);
+	if (!ok) {
 	    g_free(to_free);
 	    return;
 	}
 
-	buf = (gpointer)(self->block_size + (char *)buf);
-	len -= self->block_size;
+	buf = (gpointer)(nblocks * self->block_size + (char *)buf);
+	len -= nblocks * self->block_size;
     }
 
     /* and finally store any leftover data in the partial buffer */
@@ -843,11 +843,25 @@ write_slab_to_device(
     XferElement *elt = XFER_ELEMENT(self);
     gchar *buf = slab->base;
     gsize remaining = slab->size;
+    guint nblocks = (slab->size + self->block_size - 1) / self->block_size;
+    DeviceBlock *blocks = g_new(DeviceBlock, nblocks);
+    guint i, nwritten;
+
+    /* hand the whole slab to the device in one call */
+    for (i = 0; i < nblocks; i++) {
+	blocks[i].data = buf + i * self->block_size;
+	blocks[i].size = MIN(self->block_size, slab->size - i * self->block_size);
+    }
 
-    while (remaining && !elt->cancelled) {
-	gsize write_size = MIN(self->block_size, remaining);
+    i = 0;
+    while (i < nblocks && !elt->cancelled) {
 	DeviceWriteResult ok;
-	ok = device_write_block(self->device, write_size, buf);
+	ok = device_write_blocks(self->device, nblocks - i, blocks + i, &nwritten);
+	for (; nwritten > 0; nwritten--, i++) {
+	    crc32_add((uint8_t *)blocks[i].data, blocks[i].size, &elt->crc);
+	    self->slab_bytes_written += blocks[i].size;
+	    remaining -= blocks[i].size;
+	}
 	if (ok != WRITE_SUCCEED) {
             self->bytes_written += slab->size - remaining;
 
@@ -855,14 +869,11 @@ write_slab_to_device(
              * differently/fatally? or at least with a warning? */
 	    self->last_part_successful = FALSE;
 	    self->no_more_parts = FALSE;
+	    g_free(blocks);
 	    return FALSE;
 	}
-
-	crc32_add((uint8_t *)buf, write_size, &elt->crc);
-	buf += write_size;
-	self->slab_bytes_written += write_size;
-	remaining -= write_size;
     }
+    g_free(blocks);
 
     if (elt->cancelled) {
 	self->last_part_successful = FALSE;
@@ -76,7 +76,8 @@ typedef struct XferDestTaperSplitter {
      * constant for the lifetime of the element.
      */
 
-    /* Maximum size of each part (bytes) */
+    /* Maximum size of each part (bytes); it only changes between parts, see
+     * next_part_size */
     guint64 part_size;
 
     /* the device's need for streaming (it's assumed that all subsequent devices
@@ -120,6 +121,9 @@ typedef struct XferDestTaperSplitter {
     guint64 bytes_to_read_from_slices;
     guint64 max_memory;
 
+    /* part size to use from the next new part, or 0 */
+    guint64 next_part_size;
+
     /* part number in progress */
     volatile guint64 partnum;
 
@@ -164,6 +168,9 @@ typedef struct {
 
 } XferDestTaperSplitterClass;
 
+/* most blocks handed to device_write_blocks at once */
+#define SPLITTER_MAX_BLOCKS 64
+
 /*
  * Debug logging
  */
@@ -564,6 +571,10 @@ device_thread_write_part(
 	   (!elt->shm_ring || !elt->shm_ring->mc->cancelled)) {
 	DeviceWriteResult ok;
 	gboolean eof_flag;
+	DeviceBlock blocks[SPLITTER_MAX_BLOCKS];
+	guint nblocks, nwritten, i;
+	char *ring;
+	gsize ring_size, read_offset;
 
 	/* wait for at least one block, and (if necessary) prebuffer */
 	gsize to_writeX = device_thread_wait_for_block(self, &eof_flag);
@@ -581,25 +592,61 @@ device_thread_write_part(
 		goto part_done_unlock;
 	    }
 
-	    if (self->mem_ring)
-		g_mutex_unlock(self->mem_ring->mutex);
-	    DBG(8, "writing %ju bytes to device", (uintmax_t)to_write);
-
 	    /* note that it's OK to reference these ring_* vars here, as they
 	     * are static at this point */
 	    if (self->mem_ring) {
-		buf = self->mem_ring->buffer + self->mem_ring->read_offset;
+		ring = self->mem_ring->buffer;
+		ring_size = self->mem_ring->ring_size;
+		read_offset = self->mem_ring->read_offset;
 	    } else {
-		buf = elt->shm_ring->data + elt->shm_ring->mc->read_offset;
+		ring = elt->shm_ring->data;
+		ring_size = elt->shm_ring->ring_size;
+		read_offset = elt->shm_ring->mc->read_offset;
+	    }
+	    buf = ring + read_offset;
+
+	    /* batch the whole blocks that are contiguous in the ring, but do
+	     * not go past the block that ends the part */
+	    nblocks = 1;
+	    if (to_write == self->device->block_size) {
+		nblocks = MIN(to_writeX, ring_size - read_offset) / to_write;
+		nblocks = MIN(nblocks, SPLITTER_MAX_BLOCKS);
+		if (self->part_size) {
+		    guint64 left = self->part_size - self->part_bytes_written;
+		    nblocks = MIN(nblocks, (left + to_write - 1) / to_write);
+		}
+		if (nblocks == 0)
+		    nblocks = 1;
+	    }
+	    for (i = 0; i < nblocks; i++) {
+		blocks[i].data = (char *)buf + i * to_write;
+		blocks[i].size = to_write;
 	    }
-	    ok = device_write_block(self->device, (guint)to_write, buf);
 
-	    if (ok == WRITE_SPACE)
-	    ok = retry_write(self, to_write, buf);
+	    if (self->mem_ring)
+		g_mutex_unlock(self->mem_ring->mutex);
+	    DBG(8, "writing %u blocks of %ju bytes to device", nblocks, (uintmax_t)to_write);
+
+	    ok = device_write_blocks(self->device, nblocks, blocks, &nwritten);
+
+	    if (ok == WRITE_SPACE) {
+		ok = retry_write(self, to_write, blocks[nwritten].data);
+		if (ok == WRITE_SUCCEED)
+		    nwritten++;
+	    }
 
 	    if (self->mem_ring)
 		g_mutex_lock(self->mem_ring->mutex);
 
+	    /* account for the blocks that made it to the device, even if a
+	     * later one failed */
+	    for (i = 0; i < nwritten; i++) {
+		crc32_add((uint8_t *)blocks[i].data, to_write, &elt->crc);
+		self->part_bytes_written += to_write;
+		device_thread_consume_block(self, to_write);
+		to_writeX -= to_write;
+	    }
+
 	    if (ok == WRITE_FAILED) {
 		part_status = PART_FAILED;
 		goto part_done_unlock;
@@ -611,11 +658,6 @@ device_thread_write_part(
 		goto part_done_unlock;
 	    }
 
-	    crc32_add((uint8_t *)(buf),
-			 to_write, &elt->crc);
-	    self->part_bytes_written += to_write;
-	    device_thread_consume_block(self, to_write);
-
 	    if (self->part_size && self->part_bytes_written >= self->part_size) {
 		part_status = PART_EOP;
 		goto part_done_unlock;
@@ -623,7 +665,6 @@ device_thread_write_part(
 		part_status = PART_LEOM;
 		goto part_done_unlock;
 	    }
-	    to_writeX -= to_write;
 	}
     }
 part_done_unlock:
@@ -986,6 +1027,13 @@ start_part_impl(
     g_assert(self->paused);
     g_assert(!self->no_more_parts);
 
+    /* a retried part must be written again with the same size */
+    if (!retry_part && self->next_part_size) {
+	DBG(1, "part size %ju", (uintmax_t)self->next_part_size);
+	self->part_size = self->next_part_size;
+	self->next_part_size = 0;
+    }
+
     if (self->part_header)
 	dumpfile_free(self->part_header);
     self->part_header = dumpfile_copy(header);
@@ -1066,6 +1114,27 @@ cache_inform_impl(
     g_mutex_unlock(self->part_slices_mutex);
 }
 
+static void
+set_part_size_impl(
+    XferDestTaper *xdt,
+    guint64 part_size)
+{
+    XferDestTaperSplitter *self = XFER_DEST_TAPER_SPLITTER(xdt);
+
+    /* a part size of 0 means no splitting, which can't be turned on or off
+     * in the middle of a dump */
+    if (!part_size || !self->part_size)
+	return;
+
+    /* rounded up to the next multiple of block_size, as in the constructor */
+    part_size = ((part_size + self->block_size - 1)
+			/ self->block_size) * self->block_size;
+
+    g_mutex_lock(self->state_mutex);
+    self->next_part_size = part_size;
+    g_mutex_unlock(self->state_mutex);
+}
+
 static guint64
 get_part_bytes_written_impl(
     XferDestTaper *xdtself)
@@ -1199,6 +1268,7 @@ class_init(
     xdt_klass->use_device = use_device_impl;
     xdt_klass->cache_inform = cache_inform_impl;
     xdt_klass->get_part_bytes_written = get_part_bytes_written_impl;
+    xdt_klass->set_part_size = set_part_size_impl;
     xdt_klass->new_space_available = new_space_available_impl;
     goc->finalize = finalize_impl;
 
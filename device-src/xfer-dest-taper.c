@@ -150,6 +150,20 @@ xfer_dest_taper_get_part_bytes_written(
 	return 0;
 }
 
+void
+xfer_dest_taper_set_part_size(
+    XferElement *elt,
+    guint64 part_size)
+{
+    XferDestTaperClass *klass;
+    g_assert(IS_XFER_DEST_TAPER(elt));
+
+    klass = XFER_DEST_TAPER_GET_CLASS(elt);
+    assert(klass);
+    if (klass->set_part_size)
+	klass->set_part_size(XFER_DEST_TAPER(elt), part_size);
+}
+
 void
 xfer_dest_taper_new_space_available(
     XferElement *elt,
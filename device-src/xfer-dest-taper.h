@@ -53,6 +53,7 @@ typedef struct {
 			 off_t length);
     void (*new_space_available)(XferDestTaper *self, int made_space);
     guint64 (*get_part_bytes_written)(XferDestTaper *self);
+    void (*set_part_size)(XferDestTaper *self, guint64 part_size);
 } XferDestTaperClass;
 
 /* Start writing the next part to the given device.  The part will be written
@@ -109,4 +110,14 @@ void xfer_dest_taper_new_space_available(
 guint64 xfer_dest_taper_get_part_bytes_written(
     XferElement *self);
 
+/* Change the maximum size of the parts that are started afterward; a retried
+ * part keeps its size.  Elements that can't change it ignore this call.
+ *
+ * @param self: the XferDestTaper object
+ * @param part_size: the new part size, in bytes
+ */
+void xfer_dest_taper_set_part_size(
+    XferElement *self,
+    guint64 part_size);
+
 #endif
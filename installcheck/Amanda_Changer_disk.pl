@@ -18,7 +18,7 @@
 # Contact information: Carbonite Inc., 756 N Pastoria Ave
 # Sunnyvale, CA 94086, USA, or: http://www.zmanda.com
 
-use Test::More tests => 19;
+use Test::More tests => 20;
 use File::Path;
 use strict;
 use warnings;
@@ -466,5 +466,27 @@ Amanda::MainLoop::run();
     Amanda::MainLoop::run();
 }
 
+# show reads the labels from the volume header files
+{
+    my @shown;
+
+    $chg->show(
+	slots => "3-5",
+	user_msg => sub {
+	    my ($msg) = @_;
+	    push @shown, [ $msg->{'code'}, $msg->{'slot'}, $msg->{'label'} ];
+	},
+	finished_cb => make_cb(sub {
+	    is_deeply([ @shown ], [
+		[ 1100016, 3, undef ],
+		[ 1100015, 4, "FOO?BAR" ],
+		[ 1100016, 5, undef ],
+		], "show reads the labels of the requested slots");
+
+	    Amanda::MainLoop::quit();
+	}));
+    Amanda::MainLoop::run();
+}
+
 $chg->quit();
 rmtree($taperoot);
@@ -47,7 +47,7 @@ $ENV{'AMANDA_CATALOG'} = 'SQLite';
 Amanda::Debug::dbopen("installcheck");
 Installcheck::log_test_output();
 
-plan tests => 96;
+plan tests => 100;
 
 # set up and load a simple config
 my $testconf = Installcheck::Run::setup();
@@ -79,6 +79,48 @@ is_deeply([ $catalog->get_parts(@$dumps) ], [],
 }
 $catalog->quit();
 
+# bulk mode must leave all the indexes and the original cache size behind
+sub index_names {
+    my ($cat) = @_;
+    my $names = $cat->{'dbh'}->selectcol_arrayref(
+	"SELECT name FROM sqlite_master WHERE type='index' AND name NOT LIKE 'sqlite_%'");
+    return [ sort map { uc } @$names ];
+}
+my @all_indexes = sort map { uc } qw(VOLUMES_storage_id VOLUMES_pool_id VOLUMES_meta_id
+	HOSTS_config_id DISKS_host_id IMAGES_disk_id COPYS_image_id
+	COPYS_storage_id PARTS_copy_id PARTS_volume_id);
+{
+    my $load_cat = Amanda::DB::Catalog2->new(undef, create => 1, drop_tables => 1, load => 1);
+    is_deeply(index_names($load_cat), \@all_indexes,
+	"all indexes are created after a bulk load");
+    $load_cat->quit();
+}
+
+{
+    my $bulk_cat = Amanda::DB::Catalog2->new(undef, create => 1, drop_tables => 1,
+					     empty => 1, bulk => 1);
+    # a file truncated after the CONFIG section makes the import die
+    my $import_file = "$Installcheck::TMP/catalog-truncated-import";
+    open(my $fh, ">", $import_file) or die("Could not write '$import_file': $!");
+    print $fh "VERSION:\n$Amanda::DB::Catalog2::DB_VERSION\n\nCONFIG\n";
+    close($fh);
+    eval { $bulk_cat->import_from_file($import_file); };
+    like($@, qr/not STORAGE/,
+	"import of a truncated file fails");
+    $bulk_cat->end_bulk();
+    unlink($import_file);
+    is_deeply(index_names($bulk_cat), \@all_indexes,
+	"deferred indexes are created by end_bulk after a failed import");
+
+    my $dbh = $bulk_cat->{'dbh'};
+    $dbh->do("PRAGMA cache_size = -1234");
+    $bulk_cat->begin_bulk();
+    $bulk_cat->end_bulk();
+    is(($dbh->selectrow_array("PRAGMA cache_size"))[0], -1234,
+	"end_bulk restores the cache size in use before begin_bulk");
+    $bulk_cat->quit();
+}
+
 # and add some logfiles to query, and a corresponding tapelist, while also gathering
 # a list of parts and dumps for comparison with the results from Amanda::DB::Catalog.
 # also add some files to holding disk
@@ -18,7 +18,7 @@
 # Contact information: Carbonite Inc., 756 N Pastoria Ave
 # Sunnyvale, CA 94086, USA, or: http://www.zmanda.com
 
-use Test::More tests => 16;
+use Test::More tests => 17;
 use strict;
 use warnings;
 use File::Path;
@@ -123,6 +123,12 @@ make_holding(
     [ $holding3, '20070306123456', 'olfactory', '/stinky', 1 ],
 );
 
+# a manifest is not a holding file of its own
+open(my $mfh, ">", "$holding2/20070306123456/audio._var.manifest")
+    or die("opening manifest: $!");
+print $mfh "AMANDA: HOLDING MANIFEST 1\n";
+close($mfh);
+
 is_deeply([ sort(+Amanda::Holding::disks()) ],
     [ sort($holding1, $holding2) ],
     "all active holding disks, but not inactive (defined but not used) disks");
@@ -187,6 +193,7 @@ ok(Amanda::Holding::file_unlink("$holding2/20070306123456/audio._var"),
 ok(!-f "$holding2/20070306123456/audio._var", "..first chunk gone");
 ok(!-f "$holding2/20070306123456/audio._var.1", "..second chunk gone");
 ok(!-f "$holding2/20070306123456/audio._var.2", "..third chunk gone");
+ok(!-f "$holding2/20070306123456/audio._var.manifest", "..manifest gone");
 
 rmtree($holding1);
 rmtree($holding2);
@@ -17,7 +17,7 @@
 # Contact information: Carbonite Inc., 756 N Pastoria Ave
 # Sunnyvale, CA 94086, USA, or: http://www.zmanda.com
 
-use Test::More tests => 29;
+use Test::More tests => 35;
 use File::Path;
 use Data::Dumper;
 use strict;
@@ -32,7 +32,7 @@ use Amanda::Device qw( :constants );
 use Amanda::Debug;
 use Amanda::Header;
 use Amanda::Xfer;
-use Amanda::Taper::Scribe qw( get_splitting_args_from_config );
+use Amanda::Taper::Scribe qw( get_splitting_args_from_config get_adaptive_part_size );
 use Amanda::MainLoop;
 use Amanda::DB::Catalog2;
 
@@ -943,5 +943,50 @@ is_deeply(
 	       . "using part cache type 'none'"},
     "part_* parameters handled correctly when specified");
 
+is_deeply(
+    { get_splitting_args_from_config(
+	part_size => 300,
+	part_cache_type => 'none',
+	part_size_max_kb => 1,
+    ) },
+    { allow_split => 1, part_size => 300, part_cache_type => 'none',
+      part_size_max => 1024 },
+    "part_size_max is passed for a tapetype part size");
+
+is_deeply(
+    { get_splitting_args_from_config(
+	dle_tape_splitsize => 200,
+	part_size => 300,
+	part_size_max => 1024,
+    ) },
+    { allow_split => 1, part_size => 200, part_cache_type => 'memory',
+      part_cache_max_size => 1024*1024*10 },
+    ".. but not when the dumptype sets tape_splitsize");
+
+##
+# test get_adaptive_part_size
+
+my $mb = 1024*1024;
+
+is(get_adaptive_part_size(min => 100*$mb, max => 1000*$mb, size => 100*$mb,
+			  samples => [ [ 100*$mb, 1.0 ] ]),
+    200*$mb,
+    "adaptive part size tries a larger part when all parts had the same size");
+
+is(get_adaptive_part_size(min => 100*$mb, max => 4000*$mb, size => 200*$mb,
+			  samples => [ [ 100*$mb, 3.0 ], [ 200*$mb, 4.0 ] ]),
+    400*$mb,
+    "adaptive part size grows, at most twofold, when the overhead per part is large");
+
+is(get_adaptive_part_size(min => 100*$mb, max => 4000*$mb, size => 400*$mb,
+			  samples => [ [ 100*$mb, 1.0 ], [ 200*$mb, 2.0 ], [ 400*$mb, 4.0 ] ]),
+    200*$mb,
+    "adaptive part size shrinks when there is no overhead per part");
+
+is(get_adaptive_part_size(min => 100*$mb, max => 4000*$mb, size => 150*$mb,
+			  samples => [], failed => 1),
+    100*$mb,
+    "adaptive part size is halved, down to the minimum, when a part fails");
+
 $storage->quit();
 rmtree($taperoot);
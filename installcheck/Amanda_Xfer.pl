@@ -18,7 +18,7 @@
 # Contact information: Carbonite Inc., 756 N Pastoria Ave
 # Sunnyvale, CA 94086, USA, or: http://www.zmanda.com
 
-use Test::More tests => 68;
+use Test::More tests => 76;
 use File::Path;
 use Data::Dumper;
 use strict;
@@ -505,7 +505,7 @@ pass("Two simultaneous transfers run to completion");
 }
 
 SKIP: {
-    skip "not built with server", 45 unless Amanda::Util::built_with_component("server");
+    skip "not built with server", 53 unless Amanda::Util::built_with_component("server");
 
     my $disk_cache_dir = "$Installcheck::TMP";
     my $RANDOM_SEED = 0xFACADE;
@@ -868,9 +868,11 @@ SKIP: {
 
     my $holding_base = "$Installcheck::TMP/source-holding";
     my $holding_file;
-    # create a sequence of holding chunks, each 2MB.
+    # create a sequence of holding chunks, each 2MB.  Only the first
+    # $nchained chunks (default all) are linked by cont_filename.
     sub make_holding_files {
-	my ($nchunks) = @_;
+	my ($nchunks, $nchained) = @_;
+	$nchained = $nchunks if !defined $nchained;
 	my $block = 'a' x 32768;
 
 	rmtree($holding_base);
@@ -888,7 +890,7 @@ SKIP: {
 	    $hdr->{'name'} = "localhost";
 	    $hdr->{'disk'} = "/home";
 	    $hdr->{'program'} = "INSTALLCHECK";
-	    if ($i != $nchunks-1) {
+	    if ($i < $nchained-1) {
 		$hdr->{'cont_filename'} = "$holding_base/file" . ($i+1);
 	    }
 
@@ -937,6 +939,30 @@ SKIP: {
 	  'e896f9b1:1997824' ]
 	);
 
+    # more blocks than one device_write_blocks batch, with a short last block
+    test_taper_dest(
+	Amanda::Xfer::Source::Random->new(1024*1024*2+1000, $RANDOM_SEED),
+	sub {
+	    my ($first_dev) = @_;
+	    Amanda::Xfer::Dest::Taper::Splitter->new($first_dev, 128*1024,
+						     0, 0);
+	},
+	[ "PART-1-2098152-OK",
+	  "DONE" ],
+	undef,
+	"Amanda::Xfer::Dest::Taper::Splitter - batched writes, short last block");
+    test_recovery_source(
+	Amanda::Xfer::Dest::Null->new($RANDOM_SEED),
+	[ 1 => [ 1, ], ],
+	[
+	  'READY',
+	  'PART',
+	  'BYTES-2098152',
+	  'DONE'
+	],
+	undef,
+	);
+
     test_taper_dest(
 	Amanda::Xfer::Source::Random->new(1024*1024*3.1, $RANDOM_SEED),
 	sub {
@@ -1166,6 +1192,27 @@ SKIP: {
 	  'ab6d231b:2097152' ]
 	);
 
+    test_taper_dest(
+	Amanda::Xfer::Source::Random->new(1024*1024*2+1000, $RANDOM_SEED),
+	sub {
+	    my ($first_dev) = @_;
+	    Amanda::Xfer::Dest::Taper::Cacher->new($first_dev, 128*1024, 0, 0, undef),
+	},
+	[ "PART-1-2098152-OK", "DONE" ],
+	undef,
+	"Amanda::Xfer::Dest::Taper::Cacher - batched writes, short last block");
+    test_recovery_source(
+	Amanda::Xfer::Dest::Null->new($RANDOM_SEED),
+	[ 1 => [ 1 ], ],
+	[
+	  'READY',
+	  'PART',
+	  'BYTES-2098152',
+	  'DONE'
+	],
+	undef,
+	);
+
     test_taper_dest(
 	Amanda::Xfer::Source::Random->new(1024*1024*4.1, $RANDOM_SEED),
 	sub {
@@ -1213,6 +1260,74 @@ SKIP: {
 	. "acts as a source and supplies cache_inform",
 	disable_leom => 1);
 
+    ##
+    # test the holding manifest
+
+    # read a holding file to a Dest::Null; return the size read and the error
+    sub read_holding_file {
+	my ($filename) = @_;
+	my $src = Amanda::Xfer::Source::Holding->new($filename);
+	my $xfer = Amanda::Xfer->new([ $src, Amanda::Xfer::Dest::Null->new(0) ]);
+	my ($crc, $size, $err);
+
+	$xfer->start(sub {
+	    my ($src, $msg, $xfer) = @_;
+	    if ($msg->{'type'} == $XMSG_ERROR) {
+		$err = $msg->{'message'};
+	    } elsif ($msg->{'type'} == $XMSG_CRC &&
+		     $msg->{'elt'}->isa("Amanda::Xfer::Source::Holding")) {
+		($crc, $size) = ($msg->{'crc'}, $msg->{'size'});
+	    } elsif ($msg->{'type'} == $XMSG_DONE) {
+		Amanda::MainLoop::quit();
+	    }
+	}, 0, -1);
+	$src->start_recovery();
+	Amanda::MainLoop::run();
+
+	return ($crc, $size, $err);
+    }
+
+    sub write_manifest {
+	my ($chunks, $end) = @_;
+	open(my $fh, ">", "$holding_base/file0.manifest")
+	    or die("Could not open manifest: $!");
+	print $fh "AMANDA: HOLDING MANIFEST 1\n";
+	for my $chunk (@$chunks) {
+	    print $fh "CHUNK $chunk->[1] $chunk->[2] $chunk->[0]\n";
+	}
+	print $fh "END " . scalar(@$chunks) . "\n" if $end;
+	close($fh);
+    }
+
+    # all the chunks have the same data, get its crc from a one-chunk file
+    my ($chunk_crc) = read_holding_file(make_holding_files(1));
+    my $chunk_size = 2*1024*1024;
+    my @chunks = map { [ "$holding_base/file$_", $chunk_size, $chunk_crc ] } (0..2);
+
+    # the cont_filename chain stops at file1, so reading all three chunks
+    # shows the manifest was used
+    $holding_file = make_holding_files(3, 2);
+    write_manifest(\@chunks, 1);
+    my ($crc, $size, $err) = read_holding_file($holding_file);
+    is_deeply([ $size, $err ], [ 3*$chunk_size, undef ],
+	"Source::Holding reads the chunks listed by a good manifest");
+
+    write_manifest(\@chunks, 0);
+    ($crc, $size, $err) = read_holding_file($holding_file);
+    is_deeply([ $size, $err ], [ 2*$chunk_size, undef ],
+	"Source::Holding follows cont_filename if the manifest is truncated");
+
+    write_manifest([ @chunks[0,1], [ $chunks[2][0], $chunk_size/2, $chunk_crc ] ], 1);
+    ($crc, $size, $err) = read_holding_file($holding_file);
+    is_deeply([ $size, $err ], [ 2*$chunk_size, undef ],
+	"Source::Holding follows cont_filename if the manifest doesn't match the chunks");
+
+    $holding_file = make_holding_files(3);
+    write_manifest([ $chunks[0], [ $chunks[1][0], $chunk_size, 'deadbeef' ], $chunks[2] ], 1);
+    ($crc, $size, $err) = read_holding_file($holding_file);
+    like($err, qr/holding file '\Q$holding_base\E\/file1' has crc \w+, but its manifest has deadbeef/,
+	"Source::Holding cancels the transfer on a crc mismatch");
+
     ##
     # test the cache_inform method
 
@@ -151,6 +151,9 @@ The exit status of the application
 Runs the C< restore > command to restore the C< objects > to the
 current working directory, supplying it with C< data >.
 The optional C< level > argument (defaulting to 0) specifies the level of the backup
+The optional C< recover_dump_state_file > argument is passed to the application,
+and what it writes to its state stream (fd 3), such as the DAR ranges, is
+returned.
 Returns a hashref:
 
 =over
@@ -159,6 +162,10 @@ Returns a hashref:
 
 Any output from the application
 
+=item C< dar >
+
+The output on fd 3, if C< recover_dump_state_file > was given
+
 =item C< exit_status >
 
 The exit status of the application
@@ -587,13 +594,20 @@ sub restore {
 
     my $msgs;
     my $errs;
-    my $exit_status = _exec($self, 'restore', ['--level', $args{'level'}, @{$args{'objects'}}], {
+    my $dar;
+    my @args = ('--level', $args{'level'});
+    my %fds = (
         0 => {'child_mode' => 'r', 'write' => $args{'data'}, sigpipe => $args{'data_sigpipe'}},
         1 => {'child_mode' => 'w', 'save_to' => \$msgs},
         2 => {'child_mode' => 'w', 'save_to' => \$errs},
-    });
+    );
+    if (defined $args{'recover_dump_state_file'}) {
+        push @args, '--recover-dump-state-file', $args{'recover_dump_state_file'};
+        $fds{3} = {'child_mode' => 'w', 'save_to' => \$dar};
+    }
+    my $exit_status = _exec($self, 'restore', [@args, @{$args{'objects'}}], \%fds);
 
-    {'msgs' => $msgs, 'errs' => $errs, 'exit_status' => $exit_status};
+    {'msgs' => $msgs, 'errs' => $errs, 'dar' => $dar, 'exit_status' => $exit_status};
 }
 
 # XXX: index?
@@ -0,0 +1,84 @@
+# Copyright (c) 2013-2016 Carbonite, Inc.  All Rights Reserved.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+# for more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program; if not, write to the Free Software Foundation, Inc.,
+# 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+#
+# Contact information: Carbonite Inc., 756 N Pastoria Ave
+# Sunnyvale, CA 94086, USA, or: http://www.zmanda.com
+
+use Test::More tests => 9;
+use strict;
+use warnings;
+
+use lib '@amperldir@';
+use Installcheck;
+use Installcheck::Run qw(run run_get run_err vtape_dir);
+use Installcheck::Mock;
+use Amanda::Util;
+use Amanda::Debug;
+use File::Path qw(rmtree mkpath);
+use JSON;
+
+Amanda::Debug::dbopen("installcheck");
+Installcheck::log_test_output();
+
+ok(run_err('ambench', '-t', 'nosuchtest'),
+    "'ambench' with an unknown test returns an error exit status");
+like($Installcheck::Run::stderr, qr(\AUsage: )i,
+    ".. and gives usage message on stderr");
+
+my $out = run_get('ambench', '-j', '-s', '1m', '-p', '1,2', '-t', 'memory,crc');
+my @results = map { decode_json($_) } split(/\n/, $out);
+is(scalar @results, 4,
+    "memory and crc tests with two parallel settings give four results");
+is_deeply([ map { $_->{'bytes'} } @results ],
+    [ 1048576, 2097152, 1048576, 2097152 ],
+    ".. which count all of the bytes transferred");
+ok(!grep({ $_->{'error'} } @results), ".. without error");
+
+my $drive = vtape_dir() . '/drive0';
+rmtree($drive);
+mkpath($drive);
+mkpath(vtape_dir() . '/slot1');
+symlink "../slot1", "$drive/data";
+
+$out = run_get('ambench', '-j', '-s', '1m', '-b', '32k', '-r', '1m',
+	       '-t', 'device', "file:$drive");
+@results = map { decode_json($_) } split(/\n/, $out);
+is_deeply([ map { "$_->{'operation'} $_->{'bytes'}" } @results ],
+    [ "write 1048576", "read 1048576" ],
+    "device test writes and reads back a vtape");
+ok(!grep({ $_->{'error'} } @results), ".. without error");
+
+rmtree($drive);
+rmtree(vtape_dir() . '/slot1');
+
+SKIP: {
+    skip "not built with ndmp and server", 2 unless
+	Amanda::Util::built_with_component("ndmp") and
+	Amanda::Util::built_with_component("server");
+
+    # the tape simulator behind ndmjob goes through the same NDMP channel
+    # and image stream code as a filer
+    my $ndmp = Installcheck::Mock::NdmpServer->new();
+    $out = run_get('ambench', '-j', '-f', '-s', '1m', '-b', '32k', '-r', '1m',
+		   '-t', 'device',
+		   "ndmp:127.0.0.1:$ndmp->{'port'}\@$ndmp->{'drive'}");
+    @results = map { decode_json($_) } split(/\n/, $out);
+    is_deeply([ map { "$_->{'operation'} $_->{'bytes'}" } @results ],
+	[ "write 1048576", "read 1048576" ],
+	"device test writes and reads back through the NDMP tape simulator");
+    ok(!grep({ $_->{'error'} } @results), ".. without error");
+    $ndmp->cleanup();
+}
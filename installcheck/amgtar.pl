@@ -18,7 +18,7 @@
 # Contact information: Carbonite Inc., 756 N Pastoria Ave
 # Sunnyvale, CA 94086, USA, or: http://www.zmanda.com
 
-use Test::More tests => 47;
+use Test::More tests => 50;
 
 use lib '@amperldir@';
 use strict;
@@ -165,6 +165,28 @@ ok(-f "$rest_dir/foo", "foo restored");
 ok(-d "$rest_dir/bar", "bar/ restored");
 ok(-d "$rest_dir/bar", "bar/baz/bat/ restored");
 
+# DAR ranges planned from the recover dump state file
+my $state_file = "$root_dir/dump_state";
+open(my $state_fh, ">", $state_file) or die("$state_file: $!");
+print $state_fh "0 /foo\n4 /bar\n8 /bar/baz\n12 /sym\n16 /a\n";
+close($state_fh);
+$app->add_property('dar', 'YES');
+chdir($rest_dir);
+$restore = $app->restore('objects' => ['.'], 'data' => $backup->{'data'},
+			 'recover_dump_state_file' => $state_file);
+is($restore->{'dar'}, "DAR 0:-1\n", "DAR of '.' is the whole dump")
+    or diag($restore->{'errs'});
+$restore = $app->restore('objects' => ['./'], 'data' => $backup->{'data'},
+			 'recover_dump_state_file' => $state_file);
+is($restore->{'dar'}, "DAR 0:-1\n", "DAR of './' is the whole dump")
+    or diag($restore->{'errs'});
+$restore = $app->restore('objects' => ['./bar'], 'data' => $backup->{'data'},
+			 'recover_dump_state_file' => $state_file);
+is($restore->{'dar'}, "DAR 2048:6143\n", "DAR of './bar' is the range of bar")
+    or diag($restore->{'errs'});
+chdir($orig_cur_dir);
+$app->delete_property('dar');
+
 $app->add_property('GNUTAR-PATH' => '/do/not/exists');
 $restore = $app->restore('objects' => ['./foo', './bar'], 'data' => $backup->{'data'}, data_sigpipe => 1);
 is($restore->{'exit_status'}, 256, "error status of 1 if GNUTAR-PATH does not exists");
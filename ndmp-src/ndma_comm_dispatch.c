@@ -3024,6 +3024,9 @@ ndmp_sxa_fh_add_file (struct ndm_session *sess,
 
 			ndmfhdb_add_file (ixlog, tagc,
 				file->unix_path, &file->fstat);
+			if (ca->job.index_build)
+				ndmfhdb_build_add_file (ca->job.index_build,
+					file->unix_path, &file->fstat);
 		}
 	NDMS_ENDWITH
 
@@ -3062,6 +3065,10 @@ ndmp_sxa_fh_add_dir (struct ndm_session *sess,
 					/* goodness */
 					ndmfhdb_add_dirnode_root (ixlog,
 						tagc, dir->node);
+					if (ca->job.index_build)
+						ndmfhdb_build_add_dirnode_root (
+							ca->job.index_build,
+							dir->node);
 					ca->job.root_node = dir->node;
 				} else {
 					/* ungoodness */
@@ -3091,6 +3098,9 @@ ndmp_sxa_fh_add_dir (struct ndm_session *sess,
 
 			ndmfhdb_add_dir (ixlog, tagc,
 				dir->unix_name, dir->parent, dir->node);
+			if (ca->job.index_build)
+				ndmfhdb_build_add_dir (ca->job.index_build,
+					dir->unix_name, dir->parent, dir->node);
 
 			ca->job.n_dir_entry++;
 		}
@@ -3124,6 +3134,9 @@ ndmp_sxa_fh_add_node (struct ndm_session *sess,
 
 			ndmfhdb_add_node (ixlog, tagc,
 				node->fstat.node.value, &node->fstat);
+			if (ca->job.index_build)
+				ndmfhdb_build_add_node (ca->job.index_build,
+					node->fstat.node.value, &node->fstat);
 		}
 	NDMS_ENDWITH
 
@@ -358,6 +358,43 @@ args_to_job_recover_nlist (void)
  */
 
 FILE *		jndex_open (void);
+FILE *		jndex_open_fhdb (void);
+
+/*
+ * An index written along with a file history database is not
+ * sorted ("##ndmjob -U" on the 2nd line). Its few DE and CM
+ * entries are then found by reading it through.
+ */
+static int	jndex_unsorted;
+
+static int
+jndex_next (FILE *fp, char *key, char *buf, unsigned max_buf)
+{
+	int		rc;
+
+	if (!jndex_unsorted)
+		return ndmbstf_getline (fp, buf, max_buf);
+
+	while ((rc = ndmbstf_getline (fp, buf, max_buf)) >= 0) {
+		if (strncmp (buf, key, strlen (key)) == 0)
+			return rc;
+	}
+	return rc;
+}
+
+static int
+jndex_first (FILE *fp, char *key, char *buf, unsigned max_buf)
+{
+	int		rc;
+
+	if (!jndex_unsorted)
+		return ndmbstf_first (fp, key, buf, max_buf);
+
+	if (fseeko (fp, 0, SEEK_SET) == -1)
+		return -3;
+	rc = jndex_next (fp, key, buf, max_buf);
+	return rc == EOF ? 0 : rc;
+}
 
 
 int
@@ -375,10 +412,22 @@ jndex_doit (void)
 	ndmjob_log (1, "Processing input index (-J%s)", J_index_file);
 
 	if (n_file_arg > 0) {
-		rc = ndmfhdb_add_fh_info_to_nlist (fp, nlist, n_file_arg);
+		FILE *	bfp = jndex_open_fhdb();
+
+		if (!bfp && jndex_unsorted) {
+			fclose (fp);
+			error_byebye ("-J%s is not sorted and has no file history database",
+				J_index_file);
+			/* no return */
+		}
+
+		rc = ndmfhdb_add_fh_info_to_nlist (bfp ? bfp : fp,
+					nlist, n_file_arg);
 		if (rc < 0) {
 			/* toast one way or another */
 		}
+		if (bfp)
+			fclose (bfp);
 	}
 
 	jndex_fetch_post_backup_data_env(fp);
@@ -435,7 +484,9 @@ jndex_open (void)
 		/* no return */
 	}
 
-	if (strcmp (buf, "##ndmjob -J\n") != 0) {
+	if (strcmp (buf, "##ndmjob -U\n") == 0) {
+		jndex_unsorted = 1;
+	} else if (strcmp (buf, "##ndmjob -J\n") != 0) {
 		fclose (fp);
 		error_byebye ("Bad 2nd line in -J%s", J_index_file);
 		/* no return */
@@ -446,6 +497,24 @@ jndex_open (void)
 	return fp;
 }
 
+/*
+ * The binary file history database written next to the index
+ * by -I, if there is one.
+ */
+FILE *
+jndex_open_fhdb (void)
+{
+	char		name[NDMOS_CONST_PATH_MAX];
+	FILE *		fp;
+
+	snprintf (name, sizeof name, "%s.fhdb", J_index_file);
+	fp = fopen (name, "r");
+	if (fp)
+		ndmjob_log (1, "Reading file history (%s)", name);
+
+	return fp;
+}
+
 
 int
 jndex_tattle (void)
@@ -566,7 +635,7 @@ jndex_fetch_post_backup_data_env (FILE *fp)
 	char *		p;
 	char *		q;
 
-	rc = ndmbstf_first (fp, "DE ", buf, sizeof buf);
+	rc = jndex_first (fp, "DE ", buf, sizeof buf);
 	if (rc <= 0) {
 		return rc;	/* error or not found */
 	}
@@ -596,7 +665,7 @@ jndex_fetch_post_backup_data_env (FILE *fp)
 
 		n_ji_environment++;
 
-		rc = ndmbstf_getline (fp, buf, sizeof buf);
+		rc = jndex_next (fp, "DE ", buf, sizeof buf);
 		if (rc <= 0) {
 			break;
 		}
@@ -619,7 +688,7 @@ jndex_fetch_post_backup_media (FILE *fp)
 	int		rc;
 	char		buf[512];
 
-	rc = ndmbstf_first (fp, "CM ", buf, sizeof buf);
+	rc = jndex_first (fp, "CM ", buf, sizeof buf);
 	if (rc <= 0) {
 		return rc;	/* error or not found */
 	}
@@ -638,7 +707,7 @@ jndex_fetch_post_backup_media (FILE *fp)
 		}
 		n_ji_media++;
 
-		rc = ndmbstf_getline (fp, buf, sizeof buf);
+		rc = jndex_next (fp, "CM ", buf, sizeof buf);
 		if (rc <= 0) {
 			break;
 		}
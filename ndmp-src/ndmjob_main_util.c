@@ -56,6 +56,22 @@ start_index_file (void)
 		}
 		index_fp = ifp;
 		fprintf (ifp, "##ndmjob -I\n");
+
+		/* and the binary database used for lookups by -J */
+		if (atoi(I_index_file) == 0) {
+			char *	fhdb_file = g_strdup_printf ("%s.fhdb",
+							I_index_file);
+			struct ndmfhdb_build *fhb;
+
+			fhb = ndmfhdb_build_start (fhdb_file);
+			if (!fhb)
+				ndmjob_log (1, "Warning: can't create %s",
+					fhdb_file);
+			else
+				fprintf (ifp, "##ndmjob -U\n");
+			the_session.control_acb.job.index_build = fhb;
+			g_free (fhdb_file);
+		}
 	} else {
 		index_fp = stderr;
 	}
@@ -66,10 +82,37 @@ start_index_file (void)
 int
 sort_index_file (void)
 {
+	int		have_fhdb = 0;
+
+	if (the_session.control_acb.job.index_build) {
+		ndmjob_log (1, "building file history database");
+		if (ndmfhdb_build_finish (
+				the_session.control_acb.job.index_build) < 0) {
+			ndmjob_log (1, "Warning: file history database failed");
+		} else {
+			ndmjob_log (1, "file history database done");
+			have_fhdb = 1;
+		}
+		the_session.control_acb.job.index_build = 0;
+	}
+
 	if (I_index_file && strcmp (I_index_file, "-") != 0 &&
 	    atoi(I_index_file) == 0) {
 		char		cmd[512];
 
+		if (have_fhdb) {
+			/*
+			 * -J looks the files up in the database, and
+			 * reads the few other entries of the index through,
+			 * so the index is left unsorted ("##ndmjob -U"
+			 * on the 2nd line).
+			 */
+			fclose (index_fp);
+			index_fp = stderr;
+			ndmjob_log (1, "index left unsorted");
+			return 0;
+		}
+
 		fprintf (index_fp, "##ndmjob -J\n"); /* sorts to 2nd line */
 		fclose (index_fp);
 		index_fp = stderr;	/* in case anything else happens */
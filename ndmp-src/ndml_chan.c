@@ -37,6 +37,13 @@
 
 #include "ndmlib.h"
 
+#ifdef NDMOS_OPTION_USE_EPOLL_FOR_CHAN_POLL
+#include <sys/epoll.h>
+
+static void	ndmchan_poll_forget (int fd);
+#else
+#define ndmchan_poll_forget(fd)
+#endif /* NDMOS_OPTION_USE_EPOLL_FOR_CHAN_POLL */
 
 
 /*
@@ -75,6 +82,8 @@ ndmchan_setbuf (struct ndmchan *ch, char *data, unsigned data_size)
 int
 ndmchan_start_mode (struct ndmchan *ch, int fd, int chan_mode)
 {
+	/* a new fd may reuse the number of one closed behind our back */
+	ndmchan_poll_forget (fd);
 	ch->fd = fd;
 	ch->mode = chan_mode;
 	return 0;
@@ -157,6 +166,7 @@ ndmchan_close_set_errno (struct ndmchan *ch, int err_no)
 {
 	ch->eof = 1;
 	if (ch->fd >= 0) {
+		ndmchan_poll_forget (ch->fd);
 		close (ch->fd);
 		ch->fd = -1;
 	}
@@ -637,3 +647,213 @@ ndmos_chan_poll (struct ndmchan *chtab[], unsigned n_chtab, int milli_timo)
 
 #endif /* NDMOS_OPTION_USE_POLL_FOR_CHAN_POLL */
 
+#ifdef NDMOS_OPTION_USE_EPOLL_FOR_CHAN_POLL
+/*
+ * epoll(7) keeps the registrations in the kernel, so a quantum
+ * only tells it about the fds whose wanted events changed,
+ * instead of handing over the whole table every time.
+ *
+ * ep_events[fd] is what is registered for fd, or -1. The kernel
+ * drops a registration when the fd is closed, and the number
+ * may then be reused, so ndmchan_start_mode() and the close
+ * functions forget it. An event for an fd we do not know means
+ * it was closed some other way while a copy of it lives on
+ * (e.g. in a child); the set is then rebuilt.
+ *
+ * HUP and ERR are reported even for an fd registered with no
+ * events. Such an fd is removed from the set and marked
+ * EP_MUTED, so it stays out until a channel checks it again,
+ * instead of being added back and waking every quantum.
+ */
+
+#define EP_MUTED		(-2)
+
+static int		ep_fd = -1;
+static int *		ep_events;
+static int		ep_n_events;
+
+static void
+ndmchan_poll_reset (void)
+{
+	int			i;
+
+	if (ep_fd >= 0)
+		close (ep_fd);
+	ep_fd = -1;
+	for (i = 0; i < ep_n_events; i++)
+		ep_events[i] = -1;
+}
+
+static void
+ndmchan_poll_forget (int fd)
+{
+	struct epoll_event	ev;
+
+	if (fd < 0 || fd >= ep_n_events || ep_events[fd] == -1)
+		return;
+
+	if (ep_events[fd] >= 0) {
+		NDMOS_MACRO_ZEROFILL (&ev);
+		epoll_ctl (ep_fd, EPOLL_CTL_DEL, fd, &ev);
+	}
+	ep_events[fd] = -1;
+}
+
+static void
+ndmchan_poll_mute (int fd)
+{
+	ndmchan_poll_forget (fd);
+	ep_events[fd] = EP_MUTED;
+}
+
+/*
+ * Make the registration of fd match want. Returns -1 if fd can
+ * not be polled (regular files), which is always ready anyway.
+ */
+static int
+ndmchan_poll_update (int fd, int want)
+{
+	struct epoll_event	ev;
+	int			op, i;
+
+	if (fd >= ep_n_events) {
+		int		n = fd + 64;
+		int *		tab = NDMOS_API_MALLOC (n * sizeof *tab);
+
+		for (i = 0; i < ep_n_events; i++)
+			tab[i] = ep_events[i];
+		for (; i < n; i++)
+			tab[i] = -1;
+		if (ep_events)
+			NDMOS_API_FREE (ep_events);
+		ep_events = tab;
+		ep_n_events = n;
+	}
+
+	if (ep_events[fd] == want)
+		return 0;
+	if (ep_events[fd] == EP_MUTED && want == 0)
+		return 0;
+
+	NDMOS_MACRO_ZEROFILL (&ev);
+	ev.events = want;
+	ev.data.fd = fd;
+	op = ep_events[fd] < 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+	if (epoll_ctl (ep_fd, op, fd, &ev) < 0) {
+		if (errno == EEXIST)
+			op = EPOLL_CTL_MOD;
+		else if (errno == ENOENT)
+			op = EPOLL_CTL_ADD;
+		else
+			return -1;
+		if (epoll_ctl (ep_fd, op, fd, &ev) < 0)
+			return -1;
+	}
+	ep_events[fd] = want;
+	return 0;
+}
+
+int
+ndmos_chan_poll (struct ndmchan *chtab[], unsigned n_chtab, int milli_timo)
+{
+	struct ndmchan *	ch;
+	struct epoll_event	evtab[32];
+	int			n_always = 0;
+	int			n_ready = 0;
+	int			rc, i, j, want;
+	unsigned		k;
+
+	if (ep_fd < 0) {
+		ep_fd = epoll_create (32);
+		if (ep_fd < 0)
+			return -1;
+		fcntl (ep_fd, F_SETFD, FD_CLOEXEC);
+	}
+
+	/*
+	 * Channels not being checked keep their registration, with
+	 * no events, so that they cost nothing until they are again.
+	 * A channel sharing its fd with another adds to its events.
+	 */
+	for (k = 0; k < n_chtab; k++) {
+		ch = chtab[k];
+		if (ch->fd < 0)
+			continue;
+
+		want = 0;
+		for (i = 0; i < n_chtab; i++) {
+			if (chtab[i]->fd != ch->fd || !chtab[i]->check)
+				continue;
+
+			switch (chtab[i]->mode) {
+			case NDMCHAN_MODE_LISTEN:
+			case NDMCHAN_MODE_READCHK:
+			case NDMCHAN_MODE_READ:
+				want |= EPOLLIN;
+				break;
+
+			case NDMCHAN_MODE_WRITE:
+				want |= EPOLLOUT;
+				break;
+			}
+		}
+
+		if (ndmchan_poll_update (ch->fd, want) < 0 && ch->check) {
+			ch->ready = 1;
+			n_always++;
+		}
+	}
+
+	rc = epoll_wait (ep_fd, evtab, 32, n_always ? 0 : milli_timo);
+	if (rc < 0)
+		return n_always ? n_always : rc;
+
+	for (j = 0; j < rc; j++) {
+		int		fd = evtab[j].data.fd;
+		int		matched = 0;
+
+		for (k = 0; k < n_chtab; k++) {
+			ch = chtab[k];
+			if (ch->fd != fd || !ch->check)
+				continue;
+			matched = 1;
+
+			switch (ch->mode) {
+			case NDMCHAN_MODE_LISTEN:
+			case NDMCHAN_MODE_READCHK:
+			case NDMCHAN_MODE_READ:
+				if (evtab[j].events & (EPOLLIN|EPOLLHUP|EPOLLERR)) {
+					ch->ready = 1;
+					n_ready++;
+				}
+				break;
+
+			case NDMCHAN_MODE_WRITE:
+				if (evtab[j].events & (EPOLLOUT|EPOLLHUP|EPOLLERR)) {
+					ch->ready = 1;
+					n_ready++;
+				}
+				break;
+			}
+		}
+
+		if (matched)
+			continue;
+
+		/*
+		 * HUP or ERR on an fd nobody is waiting for is reported
+		 * even with no events; mute it until it is checked again.
+		 */
+		if (fd < ep_n_events && ep_events[fd] >= 0) {
+			ndmchan_poll_mute (fd);
+		} else {
+			ndmchan_poll_reset ();
+			break;
+		}
+	}
+
+	return n_ready + n_always;
+}
+
+#endif /* NDMOS_OPTION_USE_EPOLL_FOR_CHAN_POLL */
+
@@ -147,6 +147,11 @@ ndmfhdb_open (FILE *fp, struct ndmfhdb *fhcb)
 
 	fhcb->fp = fp;
 
+	rc = ndmfhdb_bin_open (fp, fhcb);
+	if (rc != 0) {
+		return rc > 0 ? 0 : -1;
+	}
+
 	rc = ndmfhdb_dirnode_root (fhcb);
 	if (rc > 0) {
 		fhcb->use_dir_node = 1;
@@ -248,6 +253,10 @@ ndmfhdb_dir_lookup (struct ndmfhdb *fhcb, unsigned long long dir_node,
 	char		key[256+128];
 	char		linebuf[2048];
 
+	if (fhcb->bin) {
+		return ndmfhdb_bin_dir_lookup (fhcb, dir_node, name, node_p);
+	}
+
 	sprintf (key, "DHd %llu ", dir_node);
 	p = NDMOS_API_STREND(key);
 
@@ -282,6 +291,10 @@ ndmfhdb_node_lookup (struct ndmfhdb *fhcb, unsigned long long node,
 	char		key[128];
 	char		linebuf[2048];
 
+	if (fhcb->bin) {
+		return ndmfhdb_bin_node_lookup (fhcb, node, fstat);
+	}
+
 	sprintf (key, "DHn %llu UNIX ", node);
 
 	p = NDMOS_API_STREND(key);
@@ -327,6 +340,10 @@ ndmfhdb_file_lookup (struct ndmfhdb *fhcb, char *path,
 	char		key[2048];
 	char		linebuf[2048];
 
+	if (fhcb->bin) {
+		return ndmfhdb_bin_file_lookup (fhcb, path, fstat);
+	}
+
 	sprintf (key, "DHf ");
 	p = NDMOS_API_STREND(key);
 
@@ -0,0 +1,726 @@
+/*
+ * Copyright (c) 2001,2002
+ *	Traakan, Inc., Los Altos, CA
+ *	All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice unmodified, this list of conditions, and the following
+ *    disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Project:  NDMJOB
+ * Ident:    $Id: $
+ *
+ * Description:
+ *	Binary File History Database. See ndmlib.h.
+ *
+ *	The file is a header followed by three tables of fixed size
+ *	records, each sorted for binary search, and a heap holding
+ *	the names and the fstat strings (see ndm_fstat_to_str()).
+ *
+ *	  node table	node, stat offset
+ *	  dir table	dir_node, node, name offset, name hash, name length
+ *	  file table	path hash, path offset, stat offset
+ *
+ *	Numbers are big-endian, and heap offsets are relative to the
+ *	start of the heap. While building, each table and the heap
+ *	are appended to their own temporary file as the FH posts
+ *	arrive. Only the tables are sorted at the end, in place.
+ */
+
+
+#include "ndmlib.h"
+#include <sys/mman.h>
+
+#define FHDB_HEADER_SIZE	64
+#define FHDB_NODE_REC		16
+#define FHDB_DIR_REC		32
+#define FHDB_FILE_REC		24
+#define FHDB_STAT_MAX		128
+
+static char *fhdb_suffix[4] = { ".node", ".dir", ".file", ".heap" };
+
+
+static void
+fhdb_put32 (unsigned char *p, unsigned long v)
+{
+	p[0] = (v >> 24) & 0xff;
+	p[1] = (v >> 16) & 0xff;
+	p[2] = (v >> 8) & 0xff;
+	p[3] = v & 0xff;
+}
+
+static unsigned long
+fhdb_get32 (unsigned char *p)
+{
+	return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+	     | ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+
+static void
+fhdb_put64 (unsigned char *p, unsigned long long v)
+{
+	fhdb_put32 (p, (unsigned long)(v >> 32));
+	fhdb_put32 (p + 4, (unsigned long)(v & 0xffffffffUL));
+}
+
+static unsigned long long
+fhdb_get64 (unsigned char *p)
+{
+	return ((unsigned long long)fhdb_get32 (p) << 32) | fhdb_get32 (p + 4);
+}
+
+/* FNV-1a */
+static unsigned long long
+fhdb_hash (char *s)
+{
+	unsigned long long	h = 14695981039346656037ULL;
+
+	while (*s) {
+		h ^= (unsigned char)*s++;
+		h *= 1099511628211ULL;
+	}
+
+	return h;
+}
+
+static int
+fhdb_cmp64 (unsigned long long a, unsigned long long b)
+{
+	return a < b ? -1 : a > b;
+}
+
+
+
+
+/*
+ * Building
+ ****************************************************************
+ */
+
+struct ndmfhdb_build *
+ndmfhdb_build_start (char *filename)
+{
+	struct ndmfhdb_build *	fhb;
+	char			tmpname[NDMOS_CONST_PATH_MAX];
+	int			i;
+
+	fhb = NDMOS_MACRO_NEW (struct ndmfhdb_build);
+	if (!fhb)
+		return 0;
+	NDMOS_MACRO_ZEROFILL (fhb);
+
+	fhb->filename = NDMOS_API_STRDUP (filename);
+	for (i = 0; i < 4; i++) {
+		snprintf (tmpname, sizeof tmpname, "%s%s",
+			filename, fhdb_suffix[i]);
+		fhb->fp[i] = fopen (tmpname, "w+");
+		if (!fhb->fp[i]) {
+			ndmfhdb_build_abort (fhb);
+			return 0;
+		}
+	}
+
+	return fhb;
+}
+
+static unsigned long long
+fhdb_heap_add (struct ndmfhdb_build *fhb, char *s)
+{
+	unsigned long long	off = fhb->heap_len;
+	size_t			len = strlen (s) + 1;
+
+	if (fwrite (s, 1, len, fhb->fp[3]) != len)
+		fhb->error = 1;
+	fhb->heap_len += len;
+
+	return off;
+}
+
+static void
+fhdb_rec_add (struct ndmfhdb_build *fhb, int table,
+  unsigned char *rec, size_t len)
+{
+	if (fwrite (rec, 1, len, fhb->fp[table]) != len)
+		fhb->error = 1;
+	fhb->n_rec[table]++;
+}
+
+int
+ndmfhdb_build_add_file (struct ndmfhdb_build *fhb,
+  char *raw_name, ndmp9_file_stat *fstat)
+{
+	unsigned char	rec[FHDB_FILE_REC];
+	char		statbuf[100];
+
+	ndm_fstat_to_str (fstat, statbuf);
+
+	fhdb_put64 (rec, fhdb_hash (raw_name));
+	fhdb_put64 (rec + 8, fhdb_heap_add (fhb, raw_name));
+	fhdb_put64 (rec + 16, fhdb_heap_add (fhb, statbuf));
+	fhdb_rec_add (fhb, 2, rec, sizeof rec);
+
+	return fhb->error ? -1 : 0;
+}
+
+int
+ndmfhdb_build_add_dir (struct ndmfhdb_build *fhb,
+  char *raw_name, ndmp9_u_quad dir_node, ndmp9_u_quad node)
+{
+	unsigned char	rec[FHDB_DIR_REC];
+
+	fhdb_put64 (rec, dir_node);
+	fhdb_put64 (rec + 8, node);
+	fhdb_put64 (rec + 16, fhdb_heap_add (fhb, raw_name));
+	fhdb_put32 (rec + 24, (unsigned long)fhdb_hash (raw_name));
+	fhdb_put32 (rec + 28, strlen (raw_name));
+	fhdb_rec_add (fhb, 1, rec, sizeof rec);
+
+	return fhb->error ? -1 : 0;
+}
+
+int
+ndmfhdb_build_add_node (struct ndmfhdb_build *fhb,
+  ndmp9_u_quad node, ndmp9_file_stat *fstat)
+{
+	unsigned char	rec[FHDB_NODE_REC];
+	char		statbuf[100];
+
+	ndm_fstat_to_str (fstat, statbuf);
+
+	fhdb_put64 (rec, node);
+	fhdb_put64 (rec + 8, fhdb_heap_add (fhb, statbuf));
+	fhdb_rec_add (fhb, 0, rec, sizeof rec);
+
+	return fhb->error ? -1 : 0;
+}
+
+int
+ndmfhdb_build_add_dirnode_root (struct ndmfhdb_build *fhb,
+  ndmp9_u_quad root_node)
+{
+	fhb->root_node = root_node;
+	fhb->have_root = 1;
+
+	return 0;
+}
+
+/*
+ * Ties are broken on the heap offset, i.e. the order of
+ * arrival, so a lookup finds the first entry posted.
+ */
+
+static int
+fhdb_node_cmp (const void *a, const void *b)
+{
+	unsigned char *	p = (unsigned char *)a;
+	unsigned char *	q = (unsigned char *)b;
+	int		rc;
+
+	rc = fhdb_cmp64 (fhdb_get64 (p), fhdb_get64 (q));
+	if (rc == 0)
+		rc = fhdb_cmp64 (fhdb_get64 (p + 8), fhdb_get64 (q + 8));
+	return rc;
+}
+
+static int
+fhdb_dir_cmp (const void *a, const void *b)
+{
+	unsigned char *	p = (unsigned char *)a;
+	unsigned char *	q = (unsigned char *)b;
+	int		rc;
+
+	rc = fhdb_cmp64 (fhdb_get64 (p), fhdb_get64 (q));
+	if (rc == 0)
+		rc = fhdb_cmp64 (fhdb_get32 (p + 24), fhdb_get32 (q + 24));
+	if (rc == 0)
+		rc = fhdb_cmp64 (fhdb_get64 (p + 16), fhdb_get64 (q + 16));
+	return rc;
+}
+
+static int
+fhdb_file_cmp (const void *a, const void *b)
+{
+	unsigned char *	p = (unsigned char *)a;
+	unsigned char *	q = (unsigned char *)b;
+	int		rc;
+
+	rc = fhdb_cmp64 (fhdb_get64 (p), fhdb_get64 (q));
+	if (rc == 0)
+		rc = fhdb_cmp64 (fhdb_get64 (p + 8), fhdb_get64 (q + 8));
+	return rc;
+}
+
+static int
+fhdb_sort_table (FILE *fp, unsigned long long n_rec, size_t rec_size,
+  int (*cmp)(const void *, const void *))
+{
+	size_t		len = n_rec * rec_size;
+	void *		map;
+
+	if (n_rec < 2)
+		return 0;
+
+	if (fflush (fp) != 0)
+		return -1;
+
+	map = mmap (0, len, PROT_READ|PROT_WRITE, MAP_SHARED, fileno (fp), 0);
+	if (map == MAP_FAILED)
+		return -1;
+
+	qsort (map, n_rec, rec_size, cmp);
+
+	return munmap (map, len);
+}
+
+static int
+fhdb_copy (FILE *from, FILE *to)
+{
+	char		buf[64*1024];
+	size_t		n;
+
+	if (fflush (from) != 0 || fseeko (from, 0, SEEK_SET) != 0)
+		return -1;
+
+	while ((n = fread (buf, 1, sizeof buf, from)) > 0) {
+		if (fwrite (buf, 1, n, to) != n)
+			return -1;
+	}
+
+	return ferror (from) ? -1 : 0;
+}
+
+/*
+ * Sort the tables and write the database. The builder is
+ * freed in any case.
+ */
+int
+ndmfhdb_build_finish (struct ndmfhdb_build *fhb)
+{
+	unsigned char	hdr[FHDB_HEADER_SIZE];
+	FILE *		fp;
+	int		i, rc = -1;
+
+	if (fhb->error)
+		goto out;
+
+	if (fhdb_sort_table (fhb->fp[0], fhb->n_rec[0], FHDB_NODE_REC,
+				fhdb_node_cmp) < 0
+	 || fhdb_sort_table (fhb->fp[1], fhb->n_rec[1], FHDB_DIR_REC,
+				fhdb_dir_cmp) < 0
+	 || fhdb_sort_table (fhb->fp[2], fhb->n_rec[2], FHDB_FILE_REC,
+				fhdb_file_cmp) < 0)
+		goto out;
+
+	NDMOS_MACRO_ZEROFILL (&hdr);
+	memcpy (hdr, NDMFHDB_BIN_MAGIC, 8);
+	fhdb_put64 (hdr + 8, fhb->have_root);
+	fhdb_put64 (hdr + 16, fhb->root_node);
+	fhdb_put64 (hdr + 24, fhb->n_rec[0]);
+	fhdb_put64 (hdr + 32, fhb->n_rec[1]);
+	fhdb_put64 (hdr + 40, fhb->n_rec[2]);
+	fhdb_put64 (hdr + 48, fhb->heap_len);
+
+	fp = fopen (fhb->filename, "w");
+	if (!fp)
+		goto out;
+
+	rc = 0;
+	if (fwrite (hdr, 1, sizeof hdr, fp) != sizeof hdr)
+		rc = -1;
+	for (i = 0; i < 4 && rc == 0; i++)
+		rc = fhdb_copy (fhb->fp[i], fp);
+	if (fclose (fp) != 0)
+		rc = -1;
+	if (rc < 0)
+		unlink (fhb->filename);
+
+  out:
+	ndmfhdb_build_abort (fhb);
+	return rc;
+}
+
+/*
+ * Drop the temporary files and free the builder.
+ */
+void
+ndmfhdb_build_abort (struct ndmfhdb_build *fhb)
+{
+	char		tmpname[NDMOS_CONST_PATH_MAX];
+	int		i;
+
+	for (i = 0; i < 4; i++) {
+		if (fhb->fp[i]) {
+			fclose (fhb->fp[i]);
+			snprintf (tmpname, sizeof tmpname, "%s%s",
+				fhb->filename, fhdb_suffix[i]);
+			unlink (tmpname);
+		}
+	}
+	NDMOS_API_FREE (fhb->filename);
+	NDMOS_API_FREE (fhb);
+}
+
+
+
+
+/*
+ * Lookups
+ ****************************************************************
+ */
+
+/*
+ * Called by ndmfhdb_open(). Returns 1 if fp is a binary
+ * database, 0 if it is not, <0 on error.
+ */
+int
+ndmfhdb_bin_open (FILE *fp, struct ndmfhdb *fhcb)
+{
+	unsigned char	hdr[FHDB_HEADER_SIZE];
+
+	if (fseeko (fp, 0, SEEK_SET) != 0)
+		return -1;
+	if (fread (hdr, 1, sizeof hdr, fp) != sizeof hdr
+	 || memcmp (hdr, NDMFHDB_BIN_MAGIC, 8) != 0)
+		return 0;
+
+	fhcb->bin = 1;
+	fhcb->use_dir_node = fhdb_get64 (hdr + 8) != 0;
+	fhcb->root_node = fhdb_get64 (hdr + 16);
+	fhcb->n_node = fhdb_get64 (hdr + 24);
+	fhcb->n_dir = fhdb_get64 (hdr + 32);
+	fhcb->n_file = fhdb_get64 (hdr + 40);
+
+	fhcb->node_off = FHDB_HEADER_SIZE;
+	fhcb->dir_off = fhcb->node_off + fhcb->n_node * FHDB_NODE_REC;
+	fhcb->file_off = fhcb->dir_off + fhcb->n_dir * FHDB_DIR_REC;
+	fhcb->heap_off = fhcb->file_off + fhcb->n_file * FHDB_FILE_REC;
+
+	return 1;
+}
+
+static int
+fhdb_read (struct ndmfhdb *fhcb, off_t off, void *buf, size_t len)
+{
+	if (fseeko (fhcb->fp, off, SEEK_SET) != 0)
+		return -1;
+	if (fread (buf, 1, len, fhcb->fp) != len)
+		return -1;
+	return 0;
+}
+
+/*
+ * Read a NUL terminated string of at most max_buf-1 bytes
+ * from the heap.
+ */
+static int
+fhdb_read_str (struct ndmfhdb *fhcb, unsigned long long off,
+  char *buf, size_t max_buf)
+{
+	size_t		n;
+
+	if (fseeko (fhcb->fp, fhcb->heap_off + off, SEEK_SET) != 0)
+		return -1;
+	n = fread (buf, 1, max_buf - 1, fhcb->fp);
+	buf[n] = 0;
+	if (strlen (buf) == max_buf - 1)
+		return -1;	/* too long */
+	return 0;
+}
+
+/*
+ * Index of the first record of the table for which cmp(rec,key)
+ * is >= 0. The record is left in rec.
+ */
+static long long
+fhdb_lower_bound (struct ndmfhdb *fhcb, off_t table_off,
+  unsigned long long n_rec, size_t rec_size,
+  int (*cmp)(unsigned char *rec, void *key), void *key,
+  unsigned char *rec)
+{
+	unsigned long long	lo = 0, hi = n_rec, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (fhdb_read (fhcb, table_off + mid * rec_size,
+				rec, rec_size) < 0)
+			return -1;
+		if ((*cmp)(rec, key) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < n_rec && fhdb_read (fhcb, table_off + lo * rec_size,
+					rec, rec_size) < 0)
+		return -1;
+
+	return lo;
+}
+
+static int
+fhdb_node_key_cmp (unsigned char *rec, void *key)
+{
+	return fhdb_cmp64 (fhdb_get64 (rec), *(unsigned long long *)key);
+}
+
+struct fhdb_dir_key {
+	unsigned long long	dir_node;
+	unsigned long		hash;
+};
+
+static int
+fhdb_dir_key_cmp (unsigned char *rec, void *key)
+{
+	struct fhdb_dir_key *	k = key;
+	int			rc;
+
+	rc = fhdb_cmp64 (fhdb_get64 (rec), k->dir_node);
+	if (rc == 0)
+		rc = fhdb_cmp64 (fhdb_get32 (rec + 24), k->hash);
+	return rc;
+}
+
+static int
+fhdb_file_key_cmp (unsigned char *rec, void *key)
+{
+	return fhdb_cmp64 (fhdb_get64 (rec), *(unsigned long long *)key);
+}
+
+int
+ndmfhdb_bin_node_lookup (struct ndmfhdb *fhcb, unsigned long long node,
+  ndmp9_file_stat *fstat)
+{
+	unsigned char	rec[FHDB_NODE_REC];
+	char		statbuf[FHDB_STAT_MAX];
+	long long	ix;
+	int		rc;
+
+	ix = fhdb_lower_bound (fhcb, fhcb->node_off, fhcb->n_node,
+			FHDB_NODE_REC, fhdb_node_key_cmp, &node, rec);
+	if (ix < 0)
+		return -1;
+	if ((unsigned long long)ix == fhcb->n_node || fhdb_get64 (rec) != node)
+		return 0;
+
+	if (fhdb_read_str (fhcb, fhdb_get64 (rec + 8),
+			statbuf, sizeof statbuf) < 0)
+		return -1;
+
+	rc = ndm_fstat_from_str (fstat, statbuf);
+	if (rc < 0)
+		return rc;
+
+	return 1;
+}
+
+int
+ndmfhdb_bin_dir_lookup (struct ndmfhdb *fhcb, unsigned long long dir_node,
+  char *name, unsigned long long *node_p)
+{
+	unsigned char		rec[FHDB_DIR_REC];
+	char			namebuf[NDMOS_CONST_PATH_MAX];
+	struct fhdb_dir_key	key;
+	unsigned long		len = strlen (name);
+	long long		ix;
+
+	if (len >= sizeof namebuf)
+		return 0;
+
+	key.dir_node = dir_node;
+	key.hash = (unsigned long)fhdb_hash (name) & 0xffffffffUL;
+
+	ix = fhdb_lower_bound (fhcb, fhcb->dir_off, fhcb->n_dir,
+			FHDB_DIR_REC, fhdb_dir_key_cmp, &key, rec);
+	if (ix < 0)
+		return -1;
+
+	/* hash collisions are rare, but do happen */
+	for (; (unsigned long long)ix < fhcb->n_dir; ix++) {
+		if (fhdb_read (fhcb, fhcb->dir_off + ix * FHDB_DIR_REC,
+				rec, sizeof rec) < 0)
+			return -1;
+		if (fhdb_dir_key_cmp (rec, &key) != 0)
+			break;
+		if (fhdb_get32 (rec + 28) != len)
+			continue;
+		if (fhdb_read (fhcb, fhcb->heap_off + fhdb_get64 (rec + 16),
+				namebuf, len) < 0)
+			return -1;
+		if (memcmp (namebuf, name, len) == 0) {
+			*node_p = fhdb_get64 (rec + 8);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int
+ndmfhdb_bin_file_lookup (struct ndmfhdb *fhcb, char *path,
+  ndmp9_file_stat *fstat)
+{
+	unsigned char		rec[FHDB_FILE_REC];
+	char			namebuf[NDMOS_CONST_PATH_MAX];
+	char			statbuf[FHDB_STAT_MAX];
+	unsigned long long	hash = fhdb_hash (path);
+	size_t			len = strlen (path) + 1;
+	long long		ix;
+	int			rc;
+
+	/* the name is read with one extra byte to catch longer ones */
+	if (len >= sizeof namebuf)
+		return 0;
+
+	ix = fhdb_lower_bound (fhcb, fhcb->file_off, fhcb->n_file,
+			FHDB_FILE_REC, fhdb_file_key_cmp, &hash, rec);
+	if (ix < 0)
+		return -1;
+
+	for (; (unsigned long long)ix < fhcb->n_file; ix++) {
+		if (fhdb_read (fhcb, fhcb->file_off + ix * FHDB_FILE_REC,
+				rec, sizeof rec) < 0)
+			return -1;
+		if (fhdb_get64 (rec) != hash)
+			break;
+		if (fhdb_read_str (fhcb, fhdb_get64 (rec + 8),
+				namebuf, len + 1) < 0)
+			continue;	/* longer than path */
+		if (strcmp (namebuf, path) != 0)
+			continue;
+
+		if (fhdb_read_str (fhcb, fhdb_get64 (rec + 16),
+				statbuf, sizeof statbuf) < 0)
+			return -1;
+		rc = ndm_fstat_from_str (fstat, statbuf);
+		if (rc < 0)
+			return rc;
+		return 1;
+	}
+
+	return 0;
+}
+
+
+
+#ifdef SELF_TEST
+/*
+ * Build a database from the posts of a small tree, sent in
+ * scrambled order, then check every lookup, a few misses, and
+ * paths at the limit of the lookup buffer.
+ */
+static int
+check (int ok, char *what, char *name)
+{
+	if (!ok)
+		printf ("FAIL %s '%.40s'\n", what, name);
+	return ok ? 0 : 1;
+}
+
+int
+main (int ac, char *av[])
+{
+	struct ndmfhdb_build *	fhb;
+	struct ndmfhdb		fhcb;
+	ndmp9_file_stat		fstat;
+	char			name[64];
+	char			longpath[NDMOS_CONST_PATH_MAX + 1];
+	FILE *			fp;
+	int			i, k, n = 1000, n_fail = 0, rc;
+
+	if (ac != 2) {
+		printf ("usage: %s FILE\n", av[0]);
+		return 1;
+	}
+
+	fhb = ndmfhdb_build_start (av[1]);
+	if (!fhb) {
+		perror (av[1]);
+		return 2;
+	}
+
+	ndmfhdb_build_add_dirnode_root (fhb, 2);
+	for (i = 0; i < n; i++) {
+		k = (i * 7919) % n;
+		NDMOS_MACRO_ZEROFILL (&fstat);
+		fstat.size.valid = NDMP9_VALIDITY_VALID;
+		fstat.size.value = k;
+
+		sprintf (name, "f%d", k);
+		ndmfhdb_build_add_dir (fhb, name, 2, 100 + k);
+		ndmfhdb_build_add_node (fhb, 100 + k, &fstat);
+		sprintf (name, "/f%d", k);
+		ndmfhdb_build_add_file (fhb, name, &fstat);
+	}
+
+	/* the longest path that fits the lookup buffer, and one more */
+	NDMOS_MACRO_ZEROFILL (&fstat);
+	memset (longpath, 'a', sizeof longpath);
+	longpath[0] = '/';
+	longpath[NDMOS_CONST_PATH_MAX - 2] = 0;
+	ndmfhdb_build_add_file (fhb, longpath, &fstat);
+	longpath[NDMOS_CONST_PATH_MAX - 2] = 'b';
+	longpath[NDMOS_CONST_PATH_MAX - 1] = 0;
+	ndmfhdb_build_add_file (fhb, longpath, &fstat);
+
+	if (ndmfhdb_build_finish (fhb) < 0) {
+		printf ("build failed\n");
+		return 3;
+	}
+
+	fp = fopen (av[1], "r");
+	if (!fp || ndmfhdb_open (fp, &fhcb) < 0 || !fhcb.bin) {
+		printf ("open failed\n");
+		return 4;
+	}
+
+	for (k = 0; k < n; k++) {
+		sprintf (name, "/f%d", k);
+		rc = ndmfhdb_lookup (&fhcb, name, &fstat);
+		n_fail += check (rc == 1 && fstat.size.value == (unsigned)k,
+				"dirnode lookup", name);
+		rc = ndmfhdb_bin_file_lookup (&fhcb, name, &fstat);
+		n_fail += check (rc == 1 && fstat.size.value == (unsigned)k,
+				"file lookup", name);
+	}
+
+	sprintf (name, "/f%d", n);
+	n_fail += check (ndmfhdb_lookup (&fhcb, name, &fstat) == 0,
+			"dirnode miss", name);
+	n_fail += check (ndmfhdb_bin_file_lookup (&fhcb, name, &fstat) == 0,
+			"file miss", name);
+
+	longpath[NDMOS_CONST_PATH_MAX - 2] = 0;
+	n_fail += check (ndmfhdb_bin_file_lookup (&fhcb, longpath, &fstat) == 1,
+			"longest path", longpath);
+	longpath[NDMOS_CONST_PATH_MAX - 2] = 'b';
+	n_fail += check (ndmfhdb_bin_file_lookup (&fhcb, longpath, &fstat) == 0,
+			"too long path", longpath);
+
+	fclose (fp);
+
+	printf ("n_node=%llu n_dir=%llu n_file=%llu n_fail=%d\n",
+		fhcb.n_node, fhcb.n_dir, fhcb.n_file, n_fail);
+
+	return n_fail ? 5 : 0;
+}
+#endif /* SELF_TEST */
@@ -768,6 +768,16 @@ struct ndmfhdb {
 	FILE *			fp;
 	int			use_dir_node;
 	unsigned long long	root_node;
+
+	/* binary database, see ndmfhdb_bin_open() */
+	int			bin;
+	unsigned long long	n_node;
+	unsigned long long	n_dir;
+	unsigned long long	n_file;
+	off_t			node_off;
+	off_t			dir_off;
+	off_t			file_off;
+	off_t			heap_off;
 };
 
 extern int	ndmfhdb_add_file (struct ndmlog *ixlog, int tagc,
@@ -800,5 +810,49 @@ extern int	ndmfhdb_file_lookup (struct ndmfhdb *fhcb, char *path,
 extern char *	ndm_fstat_to_str (ndmp9_file_stat *fstat, char *buf);
 extern int	ndm_fstat_from_str (ndmp9_file_stat *fstat, char *buf);
 
+/*
+ * The binary File History Database holds the same information in
+ * tables of fixed size records (see ndml_fhdb_bin.c). The CONTROL
+ * builds it as the File History arrives, next to the text file, and
+ * only has to sort the tables, in place, at the end of the backup.
+ * ndmfhdb_open() recognizes it, and the lookups are then binary
+ * searches over the records instead of over lines of text.
+ */
+
+#define NDMFHDB_BIN_MAGIC	"NDMFHDB1"
+
+struct ndmfhdb_build {
+	char *			filename;
+	FILE *			fp[4];		/* node, dir, file, heap */
+	unsigned long long	n_rec[3];
+	unsigned long long	heap_len;
+	unsigned long long	root_node;
+	int			have_root;
+	int			error;
+};
+
+extern struct ndmfhdb_build *ndmfhdb_build_start (char *filename);
+extern int	ndmfhdb_build_add_file (struct ndmfhdb_build *fhb,
+			char *raw_name, ndmp9_file_stat *fstat);
+extern int	ndmfhdb_build_add_dir (struct ndmfhdb_build *fhb,
+			char *raw_name, ndmp9_u_quad dir_node,
+			ndmp9_u_quad node);
+extern int	ndmfhdb_build_add_node (struct ndmfhdb_build *fhb,
+			ndmp9_u_quad node, ndmp9_file_stat *fstat);
+extern int	ndmfhdb_build_add_dirnode_root (struct ndmfhdb_build *fhb,
+			ndmp9_u_quad root_node);
+extern int	ndmfhdb_build_finish (struct ndmfhdb_build *fhb);
+extern void	ndmfhdb_build_abort (struct ndmfhdb_build *fhb);
+
+extern int	ndmfhdb_bin_open (FILE *fp, struct ndmfhdb *fhcb);
+extern int	ndmfhdb_bin_dir_lookup (struct ndmfhdb *fhcb,
+			unsigned long long dir_node,
+			char *name, unsigned long long *node_p);
+extern int	ndmfhdb_bin_node_lookup (struct ndmfhdb *fhcb,
+			unsigned long long node,
+			ndmp9_file_stat *fstat);
+extern int	ndmfhdb_bin_file_lookup (struct ndmfhdb *fhcb, char *path,
+			ndmp9_file_stat *fstat);
+
 
 #endif /* _NDMLIB_H_ */
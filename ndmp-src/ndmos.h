@@ -219,6 +219,11 @@
  *	ready I/O. Only one can be defined. If the common code
  *	doesn't work out, don't define either _OPTION_ and implement
  *	ndmos_chan_poll() in the O/S specific C source file.
+ *
+ * NDMOS_OPTION_USE_EPOLL_FOR_CHAN_POLL  -- use common epoll() code
+ *	Like the above, for Linux. The fds stay registered between
+ *	calls, so the cost of a quantum does not grow with the number
+ *	of idle channels.
  */
 
 /*
@@ -60,7 +60,21 @@
 #define NDMOS_OPTION_TAPE_SIMULATOR
 #define NDMOS_OPTION_ROBOT_SIMULATOR
 
+#ifdef HAVE_SYS_EPOLL_H
+#define NDMOS_OPTION_USE_EPOLL_FOR_CHAN_POLL
+#else
 #define NDMOS_OPTION_USE_SELECT_FOR_CHAN_POLL
+#endif
+
+/* Amanda moves whole dumps through the image stream, so give it and
+ * the formatter pipe room for several tape records at a time.  Both
+ * can be overridden with CPPFLAGS. */
+#ifndef NDM_N_IMAGE_STREAM_BUF
+#define NDM_N_IMAGE_STREAM_BUF	(4*1024*1024)
+#endif
+#ifndef NDMDA_N_FMT_IMAGE_BUF
+#define NDMDA_N_FMT_IMAGE_BUF	(1024*1024)
+#endif
 
 #define NDMOS_API_BCOPY(S,D,N) g_memmove((void*)(D), (void*)(S), (N))
 /* default: NDMOS_API_BZERO */
@@ -407,6 +407,8 @@ use Amanda::Config qw( :getconf );
 use Amanda::Device qw( :constants );
 use Amanda::Debug qw( debug );
 use Amanda::MainLoop;
+use Amanda::Header;
+use Storable;
 require Amanda::Storage;
 
 =head1 NAME
@@ -949,6 +951,19 @@ including a regular C<info_cb> callback.  The C<info> method will wait for
 all C<info_key> invocations to finish, then collect the results or errors that
 occur.
 
+=head2 SHOW
+
+The C<show> method loads each slot in turn to read its label.  Changers whose
+volumes are files holding a vfs volume header can instead define
+C<volume_header_files>, which C<show> calls with the list of requested
+C<slots> (or undef for all slots) and a C<finished_cb>.  The callback is called
+with an error or with an arrayref of hashes, one per slot in the order to
+show, with keys C<slot>, C<file> (the file starting with the volume header,
+undef if the slot is unlabeled), C<in_use>, C<write_protected>, C<meta>,
+C<barcode>, and C<err> if the slot is invalid.  The headers are then read by
+C<< $self->read_volume_headers(files => \%files, jobs => $jobs) >>, using
+C<< $self->{'show-jobs'} >> processes.
+
 =head2 ERROR HANDLING
 
 To create a new error object, use C<< $self->make_error($type, $cb, %args) >>.
@@ -2180,9 +2195,100 @@ sub show {
 	cb_ref => \$finished_cb;
 
     step start => sub {
+	if ($self->can('volume_header_files')) {
+	    return $self->volume_header_files(
+			slots => ($use_slots ? [ @slots ] : undef),
+			finished_cb => $steps->{'header_files_cb'});
+	}
 	$self->info(info => [ 'slots' ], info_cb => $steps->{'info_cb'});
     };
 
+    step header_files_cb => sub {
+	my ($err, $slot_files) = @_;
+
+	if ($err) {
+	    $params{'user_msg'}->($err);
+	    return $steps->{'done'}->();
+	}
+
+	if (!$use_slots) {
+	    $params{'user_msg'}->(Amanda::Changer::Message->new(
+					chg => $self,
+					source_filename => __FILE__,
+					source_line => __LINE__,
+					code   => 1100010,
+					severity => $Amanda::Message::INFO,
+					num_slots  => scalar @$slot_files));
+	}
+
+	my %files = map { ($_->{'slot'}, $_->{'file'}) }
+		    grep { defined $_->{'file'} && !$_->{'in_use'} && !$_->{'err'} }
+		    @$slot_files;
+	my $headers = $self->read_volume_headers(files => \%files,
+						 jobs => $self->{'show-jobs'});
+
+	for my $sf (@$slot_files) {
+	    my $slot = $sf->{'slot'};
+	    my $hdr = $headers->{$slot};
+	    if ($sf->{'err'}) {
+		$params{'user_msg'}->(Amanda::Changer::Message->new(
+					chg => $self,
+					source_filename => __FILE__,
+					source_line => __LINE__,
+					code   => 1100013,
+					severity => $Amanda::Message::ERROR,
+					slot   => $slot,
+					err    => $sf->{'err'}));
+	    } elsif ($sf->{'in_use'}) {
+		$params{'user_msg'}->(Amanda::Changer::Message->new(
+					chg => $self,
+					source_filename => __FILE__,
+					source_line => __LINE__,
+					code   => 1100011,
+					severity => $Amanda::Message::ERROR,
+					slot   => $slot));
+	    } elsif ($hdr && $hdr->{'status'} == $DEVICE_STATUS_SUCCESS) {
+		my $label_match = match_labelstr(
+					$self->{'storage'}->{'labelstr'},
+					$self->{'storage'}->{'autolabel'},
+					$hdr->{'label'},
+					$sf->{'barcode'},
+					$sf->{'meta'},
+					$self->{'storage'}->{'storage_name'});
+		$params{'user_msg'}->(Amanda::Changer::Message->new(
+					chg => $self,
+					source_filename => __FILE__,
+					source_line => __LINE__,
+					code   => 1100015,
+					severity => $Amanda::Message::INFO,
+					slot   => $slot,
+					datestamp  => $hdr->{'datestamp'},
+					label  => $hdr->{'label'},
+					write_protected => $sf->{'write_protected'},
+					label_match => $label_match));
+	    } elsif (!$hdr || $hdr->{'status'} == $DEVICE_STATUS_VOLUME_UNLABELED) {
+		$params{'user_msg'}->(Amanda::Changer::Message->new(
+					chg => $self,
+					source_filename => __FILE__,
+					source_line => __LINE__,
+					code   => 1100016,
+					severity => $Amanda::Message::INFO,
+					slot   => $slot,
+					write_protected => $sf->{'write_protected'}));
+	    } else {
+		$params{'user_msg'}->(Amanda::Changer::Message->new(
+					chg => $self,
+					source_filename => __FILE__,
+					source_line => __LINE__,
+					code   => 1100017,
+					severity => $Amanda::Message::ERROR,
+					slot   => $slot,
+					dev_error    => $hdr->{'error'}));
+	    }
+	}
+	return $steps->{'done'}->();
+    };
+
     step info_cb => sub {
 	my ($err, %info) = @_;
 
@@ -2343,6 +2449,86 @@ sub show {
     };
 }
 
+# size of the volume header of a vfs device (VFS_DEVICE_LABEL_SIZE)
+my $VFS_LABEL_SIZE = 32768;
+
+# Read the volume header at the start of each file of %$files, which maps
+# slots to file names, as a vfs device reads its label.  The files are split
+# between up to $jobs processes.  Returns a hashref mapping each slot to a
+# hash with the 'status' of the volume, its 'label' and 'datestamp' if it is
+# labeled, or an 'error' message.
+sub read_volume_headers {
+    my $self = shift;
+    my %params = @_;
+    my $files = $params{'files'};
+    my $jobs = $params{'jobs'} || 1;
+    my @slots = sort { $a <=> $b } keys %$files;
+    my %headers;
+
+    $jobs = @slots if $jobs > @slots;
+    if ($jobs <= 1) {
+	$headers{$_} = _read_volume_header($files->{$_}) for @slots;
+	return \%headers;
+    }
+
+    my @readers;
+    for my $job (0 .. $jobs-1) {
+	my @share = @slots[grep { $_ % $jobs == $job } 0 .. $#slots];
+	pipe(my $rfh, my $wfh) or die "Can't create pipe: $!";
+	my $pid = fork();
+	die "Can't fork: $!" if !defined $pid;
+	if ($pid == 0) {
+	    close($rfh);
+	    my %share = map { ($_, _read_volume_header($files->{$_})) } @share;
+	    Storable::nstore_fd(\%share, $wfh);
+	    close($wfh);
+	    POSIX::_exit(0);
+	}
+	close($wfh);
+	push @readers, [ $pid, $rfh, \@share ];
+    }
+
+    for my $reader (@readers) {
+	my ($pid, $rfh, $share) = @$reader;
+	my $result = eval { Storable::fd_retrieve($rfh) };
+	close($rfh);
+	waitpid($pid, 0);
+	for my $slot (@$share) {
+	    $headers{$slot} = $result ? $result->{$slot}
+			  : { status => $DEVICE_STATUS_DEVICE_ERROR,
+			      error => "Could not read the volume header" };
+	}
+    }
+
+    return \%headers;
+}
+
+sub _read_volume_header {
+    my ($filename) = @_;
+    my $buffer;
+
+    open(my $fh, "<", $filename)
+	or return { status => $DEVICE_STATUS_VOLUME_UNLABELED };
+    my $len = sysread($fh, $buffer, $VFS_LABEL_SIZE);
+    close($fh);
+    if (!defined $len) {
+	return { status => $DEVICE_STATUS_DEVICE_ERROR | $DEVICE_STATUS_VOLUME_ERROR,
+		 error => "Error reading '$filename': $!" };
+    }
+    return { status => $DEVICE_STATUS_VOLUME_UNLABELED } if $len == 0;
+
+    my $hdr = Amanda::Header->from_string($buffer);
+    if ($hdr->{'type'} == $Amanda::Header::F_TAPESTART) {
+	return { status => $DEVICE_STATUS_SUCCESS,
+		 label => $hdr->{'name'},
+		 datestamp => $hdr->{'datestamp'} };
+    } elsif ($hdr->{'type'} == $Amanda::Header::F_EMPTY) {
+	return { status => $DEVICE_STATUS_VOLUME_UNLABELED };
+    }
+    return { status => $DEVICE_STATUS_VOLUME_ERROR,
+	     error => "Got a bad volume label" };
+}
+
 package Amanda::Changer::Error;
 #use Amanda::Debug qw( :logging );
 use Carp qw( cluck );
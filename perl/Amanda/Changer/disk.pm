@@ -104,6 +104,7 @@ sub new {
     $self->{'lock-timeout'} = $config->get_property('lock-timeout');
 
     $self->{'num-slot'} = $config->get_property('num-slot') || 1;
+    $self->{'show-jobs'} = $config->get_property('show-jobs') || 8;
     $self->{'auto-create-slot'} = $config->get_boolean_property(
 					'auto-create-slot', 0);
     $self->{'removable'} = $params{'removable'};
@@ -269,7 +270,7 @@ sub inventory {
 	    $s->{'reserved'} = $self->_is_slot_in_use($state, $slot);
 	    my $label = $self->_get_slot_label($slot);
 	    if ($label) {
-		$s->{'label'} = $self->_get_slot_label($slot);
+		$s->{'label'} = $label;
 		$s->{'f_type'} = "".$Amanda::Header::F_TAPESTART;
 		$s->{'device_status'} = "".$DEVICE_STATUS_SUCCESS;
 	    } else {
@@ -300,6 +301,41 @@ sub inventory {
     });
 }
 
+sub volume_header_files {
+    my $self = shift;
+    my %params = @_;
+
+    return if $self->check_error($params{'finished_cb'});
+
+    $self->with_disk_locked_state($params{'finished_cb'}, sub {
+	my ($state, $finished_cb) = @_;
+	my @slot_files;
+
+	my @slots = $params{'slots'} ? @{$params{'slots'}} : $self->_all_slots();
+	for my $slot (@slots) {
+	    my $sf = { slot => $slot, meta => $state->{'meta'} };
+	    if (!$self->_slot_exists($slot)) {
+		$sf->{'err'} = Amanda::Changer::Error->new('failed',
+				source_filename => __FILE__,
+				source_line     => __LINE__,
+				module		=> ref $self,
+				severity        => $Amanda::Message::MESSAGE,
+				code		=> 1100033,
+				reason		=> "invalid",
+				slot		=> $slot);
+	    } elsif ($self->_is_slot_in_use($state, $slot)) {
+		$sf->{'in_use'} = 1;
+	    } else {
+		my $label = $self->_get_slot_label($slot);
+		$sf->{'file'} = "$self->{'dir'}/slot$slot/00000.$label" if $label;
+		$sf->{'write_protected'} = !-w "$self->{'dir'}/slot$slot";
+	    }
+	    push @slot_files, $sf;
+	}
+	$finished_cb->(undef, \@slot_files);
+    });
+}
+
 sub set_meta_label {
     my $self = shift;
     my %params = @_;
@@ -572,16 +608,29 @@ sub _is_slot_in_use {
     return 0;
 }
 
+# The label of a slot is cached with the mtime of the slot directory, which
+# changes whenever the 00000.* file is created, renamed or removed.  A
+# directory modified during the current second may change again without a
+# new mtime, so it is not cached.
 sub _get_slot_label {
     my ($self, $slot) = @_;
     my $dir = _quote_glob($self->{'dir'});
 
+    my $mtime = (stat("$self->{'dir'}/slot$slot"))[9];
+    my $cached = $self->{'label_cache'}->{$slot};
+    if (defined $mtime && $cached && $cached->[0] == $mtime) {
+	return $cached->[1];
+    }
+
+    my $label = ''; # known, but blank
     for my $symlink (bsd_glob("$dir/slot$slot/00000.*")) {
-	my ($label) = ($symlink =~ qr{\/00000\.([^/]*)$});
-	return $label;
+	($label) = ($symlink =~ qr{\/00000\.([^/]*)$});
+	last;
     }
 
-    return ''; # known, but blank
+    $self->{'label_cache'}->{$slot} = [ $mtime, $label ]
+	if defined $mtime && $mtime < time();
+    return $label;
 }
 
 # Internal function to point a drive to a slot
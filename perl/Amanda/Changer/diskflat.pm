@@ -105,6 +105,7 @@ sub new {
     $self->{'lock-timeout'} = $config->get_property('lock-timeout');
 
     $self->{'num-slot'} = $config->get_property('num-slot');
+    $self->{'show-jobs'} = $config->get_property('show-jobs') || 8;
     $self->{'num-slot'} = 100 if !defined $self->{'num-slot'};
     $self->{'auto-create-slot'} = $config->get_boolean_property(
 					'auto-create-slot', 0);
@@ -339,6 +340,45 @@ debug("inventory");
     });
 }
 
+sub volume_header_files {
+    my $self = shift;
+    my %params = @_;
+
+    return if $self->check_error($params{'finished_cb'});
+
+    $self->with_disk_locked_state($params{'finished_cb'}, sub {
+	my ($state, $finished_cb) = @_;
+	my @slot_files;
+
+	my @slots = $params{'slots'} ? @{$params{'slots'}} : $self->_all_slots($state);
+	for my $slot (@slots) {
+	    my $sf = { slot => $slot, meta => $state->{'meta'} };
+	    my ($label, $err) = $self->make_new_tape_label(slot => $slot,
+						meta => $state->{'meta'},
+						label_exist => 1);
+	    if ($err || !$self->_slot_exists($slot, $state)) {
+		$sf->{'err'} = Amanda::Changer::Error->new('failed',
+				source_filename => __FILE__,
+				source_line     => __LINE__,
+				module		=> ref $self,
+				severity        => $Amanda::Message::MESSAGE,
+				code		=> 1100033,
+				reason		=> "invalid",
+				slot		=> $slot);
+	    } elsif ($self->_is_slot_in_use($state, $slot)) {
+		$sf->{'in_use'} = 1;
+	    } else {
+		my $slot_file = "$self->{'dir'}/$label";
+		$sf->{'file'} = $slot_file if -s $slot_file;
+		$sf->{'write_protected'} = -e $slot_file ? !-w $slot_file
+							 : !-w $self->{'dir'};
+	    }
+	    push @slot_files, $sf;
+	}
+	$finished_cb->(undef, \@slot_files);
+    });
+}
+
 sub set_meta_label {
     my $self = shift;
     my %params = @_;
@@ -204,6 +204,15 @@ C<write_timestamp> is required to identify a particular on-storage instance of
 a dump.  Note that the part sizes may differ between instances, so it is not
 valid to concatenate parts from different dump instances.
 
+When the catalog is created with C<create> and C<load>, it is loaded from the
+log files in bulk mode: the indexes that are not needed while loading are
+created afterward and, with SQLite, the whole load is a single transaction.
+The C<load_jobs> parameter gives the number of processes reading the log
+files (default: 1).  The deferred indexes are created even if the load fails.
+A catalog created with C<create>, C<empty> and C<bulk> is left in bulk
+mode until C<< $catalog->end_bulk() >> is called, which must be done once it is
+filled, e.g. by C<< $catalog->import_from_file($filename) >>.
+
 =head1 INTERFACES
 
 =head2 SUMMARY DATA
@@ -532,8 +541,9 @@ sub new {
     if ($params{'create'}) {
 	if ($self->can('_create_tableX')) {
 	    $self->{'create_mode'} = 1;
-	    $self->_create_tableX($params{empty});
+	    $self->_create_tableX($params{empty}, $params{'load'} || $params{'bulk'});
 	    $self->{'create_mode'} = 0;
+	    $self->begin_bulk() if $params{'bulk'};
 	}
     }
 
@@ -599,7 +609,13 @@ sub new {
 
 	if ($params{'load'} && $self->{'dbh'}) {
 	    $self->{'create_mode'}=1;
-	    $self->load_table();
+	    $self->{'load_jobs'} = $params{'load_jobs'};
+	    $self->begin_bulk();
+	    # always leave bulk mode, so the deferred indexes get created
+	    eval { $self->load_table(); };
+	    my $err = $@;
+	    $self->end_bulk();
+	    die $err if $err;
 	    $self->compute_retention();
 	    $self->{'create_mode'}=0;
 	}
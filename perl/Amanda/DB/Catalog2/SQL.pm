@@ -36,6 +36,7 @@ use POSIX qw( strftime );
 use Fcntl;
 use Errno;
 use File::Copy qw( move );
+use Storable;
 use Amanda::Config qw( :init :getconf config_dir_relative );
 use Amanda::Util qw( quote_string nicedate weaken_ref :quoting match_disk match_host match_datestamp match_level);
 use Amanda::Debug qw ( :logging );
@@ -991,6 +992,52 @@ sub set_no_reuse {
 			['volumes'], @_);
 }
 
+# The indexes on the catalog tables.  The deferrable ones are not used by
+# the lookups done while loading the catalog, they can be created by
+# _create_deferred_indexes once all the rows are inserted.
+my @indexes = (
+    [ 'VOLUMES_storage_id', 'volumes', 'storage_id', 1 ],
+    [ 'VOLUMES_pool_id',    'volumes', 'pool_id',    0 ],
+    [ 'VOLUMES_meta_id',    'volumes', 'meta_id',    1 ],
+    [ 'HOSTS_config_id',    'hosts',   'config_id',  0 ],
+    [ 'DISKS_host_id',      'disks',   'host_id',    0 ],
+    [ 'IMAGES_disk_id',     'images',  'disk_id',    0 ],
+    [ 'COPYS_image_id',     'copys',   'image_id',   0 ],
+    [ 'COPYS_storage_id',   'copys',   'storage_id', 1 ],
+    [ 'PARTS_copy_id',      'parts',   'copy_id',    1 ],
+    [ 'PARTS_volume_id',    'parts',   'volume_id',  1 ],
+);
+
+sub _create_deferred_indexes {
+    my $self = shift;
+    my $dbh = $self->{'dbh'};
+
+    while (my $index = shift @{$self->{'deferred_indexes'}}) {
+	my ($name, $table, $column) = @$index;
+	debug("creating deferred index $name");
+	$dbh->do("CREATE INDEX $name on $table ($column)")
+	    or die "Cannot do: " . $dbh->errstr();
+    }
+    delete $self->{'deferred_indexes'};
+}
+
+# Bulk mode is used while the catalog is loaded from the log files or
+# imported from a file: the backend can batch the inserts in a single
+# transaction, and the deferred indexes are created by end_bulk.
+sub begin_bulk {
+    my $self = shift;
+
+    $self->{'bulk'} = 1;
+}
+
+sub end_bulk {
+    my $self = shift;
+
+    $self->run_execute($self, $self->can('_create_deferred_indexes'),
+			undef, undef) if $self->{'deferred_indexes'};
+    $self->{'bulk'} = 0;
+}
+
 sub _create_triggers {
     my $self = shift;
     my $dbh = $self->{'dbh'};
@@ -1005,6 +1052,7 @@ sub _create_triggers {
 sub _create_tableX {
     my $self = shift;
     my $empty = shift;
+    my $defer_indexes = shift;
     my $dbh = $self->{'dbh'};
     my $sth;
 
@@ -1170,31 +1218,15 @@ $foreign_key (disk_id) REFERENCES disks (disk_id))")
 	or die "Cannot prepare: " . $dbh->errstr();
     $sth->execute() or die "Cannot execute: " . $sth->errstr();
 
-    $dbh->do("CREATE INDEX VOLUMES_storage_id on volumes (storage_id)")
-	or die "Cannot do: " . $dbh->errstr();
-    $dbh->do("CREATE INDEX VOLUMES_pool_id on volumes (pool_id)")
-	or die "Cannot do: " . $dbh->errstr();
-    $dbh->do("CREATE INDEX VOLUMES_meta_id on volumes (meta_id)")
-	or die "Cannot do: " . $dbh->errstr();
-
-    $dbh->do("CREATE INDEX HOSTS_config_id on hosts (config_id)")
-	or die "Cannot do: " . $dbh->errstr();
-
-    $dbh->do("CREATE INDEX DISKS_host_id on disks (host_id)")
-	or die "Cannot do: " . $dbh->errstr();
-
-    $dbh->do("CREATE INDEX IMAGES_disk_id on images (disk_id)")
-	or die "Cannot do: " . $dbh->errstr();
-
-    $dbh->do("CREATE INDEX COPYS_image_id on copys (image_id)")
-	or die "Cannot do: " . $dbh->errstr();
-    $dbh->do("CREATE INDEX COPYS_storage_id on copys (storage_id)")
-	or die "Cannot do: " . $dbh->errstr();
-
-    $dbh->do("CREATE INDEX PARTS_copy_id on parts (copy_id)")
-	or die "Cannot do: " . $dbh->errstr();
-    $dbh->do("CREATE INDEX PARTS_volume_id on parts (volume_id)")
-	or die "Cannot do: " . $dbh->errstr();
+    foreach my $index (@indexes) {
+	my ($name, $table, $column, $deferrable) = @$index;
+	if ($defer_indexes && $deferrable) {
+	    push @{$self->{'deferred_indexes'}}, $index;
+	    next;
+	}
+	$dbh->do("CREATE INDEX $name on $table ($column)")
+	    or die "Cannot do: " . $dbh->errstr();
+    }
 
     $self->_create_triggers();
 
@@ -1334,7 +1366,7 @@ sub _load_table {
 
     # load the dumps
     my @dumps = Amanda::DB::Catalog::sort_dumps(['hostname','diskname','dump_timestamp','status'],
-						Amanda::DB::Catalog::get_dumps());
+						$self->_read_log_dumps());
     foreach my $dump (@dumps) {
 	if (!defined $dump->{'hostname'} and !defined $dump->{'diskname'}) {
 	    next;
@@ -1408,6 +1440,9 @@ sub _load_table {
     $sth->execute($self->{'config_name'})
             or die "Can't update config $self->{'config_name'}: " . $sth->errstr();
 
+    # the commands are matched against the parts
+    $self->_create_deferred_indexes() if $self->{'deferred_indexes'};
+
     # load the command
     my $conf_cmdfile = config_dir_relative(getconf($CNF_CMDFILE));
     my $cmdfile = Amanda::Cmdfile->new($conf_cmdfile);
@@ -1439,6 +1474,62 @@ sub _load_table {
     }
 }
 
+# Read all the dumps from the log files and the holding disks, as
+# Amanda::DB::Catalog::get_dumps does.  With more than one 'load_jobs',
+# the log files are parsed by forked processes, each one taking a share of
+# the write timestamps; a dump never spans two write timestamps, so the
+# results only have to be concatenated.
+sub _read_log_dumps {
+    my $self = shift;
+    my $jobs = $self->{'load_jobs'} || 1;
+
+    return Amanda::DB::Catalog::get_dumps() if $jobs <= 1;
+
+    my %seen;
+    my @timestamps = grep { !$seen{$_}++ } Amanda::DB::Catalog::get_write_timestamps();
+    $jobs = @timestamps if $jobs > @timestamps;
+    return Amanda::DB::Catalog::get_dumps() if $jobs <= 1;
+
+    my @readers;
+    for my $job (0 .. $jobs-1) {
+	my @share = @timestamps[grep { $_ % $jobs == $job } 0 .. $#timestamps];
+	pipe(my $rfh, my $wfh) or die "Can't create pipe: $!";
+	my $pid = fork();
+	die "Can't fork: $!" if !defined $pid;
+	if ($pid == 0) {
+	    close($rfh);
+	    $self->{'dbh'}->{'InactiveDestroy'} = 1 if $self->{'dbh'};
+	    my $ok = eval {
+		my @dumps = Amanda::DB::Catalog::get_dumps(
+					write_timestamps => \@share);
+		Storable::nstore_fd(\@dumps, $wfh);
+		close($wfh);
+	    };
+	    debug("log reader failed: $@") if !$ok;
+	    POSIX::_exit($ok ? 0 : 1);
+	}
+	close($wfh);
+	push @readers, [ $pid, $rfh ];
+    }
+
+    my @dumps = Amanda::DB::Catalog::get_dumps(holding => 1);
+    my $failed = 0;
+    for my $reader (@readers) {
+	my ($pid, $rfh) = @$reader;
+	my $share = eval { Storable::fd_retrieve($rfh) };
+	close($rfh);
+	waitpid($pid, 0);
+	if (!$share || $? != 0) {
+	    $failed = 1;
+	    next;
+	}
+	push @dumps, @$share;
+    }
+    die "Failed to read the log files" if $failed;
+
+    return @dumps;
+}
+
 sub load_table {
     my $self = shift;
 
@@ -5183,14 +5274,12 @@ sub _finish_copy {
 
     $kb = int($kb);
     $bytes = int($bytes);
-    $sth = $dbh->prepare("UPDATE copys SET nb_parts=?, kb=?, bytes=?, copy_status=?, server_crc=?, copy_message=?, copy_pid=0 WHERE copy_id=?")
-	or die "Cannot prepare: " . $dbh->errstr();
+    $sth = $catalog->make_statement('_finish_copy:up cop', 'UPDATE copys SET nb_parts=?, kb=?, bytes=?, copy_status=?, server_crc=?, copy_message=?, copy_pid=0 WHERE copy_id=?');
     $sth->execute($nb_parts, $kb, $bytes, $copy_status, $server_crc, $copy_message, $copy_id)
 	or die "Cannot execute: " . $sth->errstr();
 
     if ($copy_status ne "OK") {
-	$sth = $dbh->prepare("UPDATE copys SET retention_days=0, retention_full=0, retention_recover=0 WHERE copy_id=?")
-	    or die "Cannot prepare: " . $dbh->errstr();
+	$sth = $catalog->make_statement('_finish_copy:up cop ret', 'UPDATE copys SET retention_days=0, retention_full=0, retention_recover=0 WHERE copy_id=?');
 	$sth->execute($copy_id)
 	    or die "Cannot execute: " . $sth->errstr();
     }
@@ -43,6 +43,9 @@ use Amanda::Header;
 
 my $SQLITE_DB_VERSION = 5;
 
+# page cache used while loading the catalog, in kB
+my $BULK_CACHE_SIZE = 65536;
+
 my $have_usleep = eval { require Time::HiRes ; 1 };
 
 sub new {
@@ -150,11 +153,20 @@ sub run_execute {
     my $stop_loop = 0;
     my $result;
 
+    # in bulk mode, each call is a single transaction instead of one
+    # transaction for each statement
+    my $transaction = $self->{'bulk'} && $dbh->{'AutoCommit'};
+
     do {
 	eval {
+	    $dbh->begin_work if $transaction;
 	    $result = $fn->($obj, @_);
+	    $dbh->commit if $transaction;
 	};
 	my $error = $@;
+	if ($error && $transaction) {
+	    eval { $dbh->rollback; };
+	}
         my $mysql_errno = $dbh->{'mysql_errno'};
         my $mysql_error = $dbh->{'mysql_error'};
         my $errstr = $dbh->errstr;
@@ -179,6 +191,35 @@ sub run_execute {
     return $result;
 }
 
+sub begin_bulk {
+    my $self = shift;
+    my $dbh = $self->{'dbh'};
+
+    $self->SUPER::begin_bulk();
+    # remember the cache size in use, end_bulk restores it
+    if (!defined $self->{'saved_cache_size'}) {
+	($self->{'saved_cache_size'}) = $dbh->selectrow_array("PRAGMA cache_size");
+	die "Cannot select: " . $dbh->errstr() if $dbh->err;
+    }
+    $dbh->do("PRAGMA cache_size = -$BULK_CACHE_SIZE")
+	or die "Cannot do: " . $dbh->errstr();
+}
+
+sub end_bulk {
+    my $self = shift;
+    my $dbh = $self->{'dbh'};
+
+    # restore the cache size even if the deferred indexes can't be created
+    eval { $self->SUPER::end_bulk(); };
+    my $err = $@;
+    if (defined $self->{'saved_cache_size'}) {
+	my $cache_size = delete $self->{'saved_cache_size'};
+	$dbh->do("PRAGMA cache_size = $cache_size")
+	    or die "Cannot do: " . $dbh->errstr();
+    }
+    die $err if $err;
+}
+
 sub table_exists {
     my $self = shift;
     my $table_name = shift;
@@ -90,7 +90,9 @@ holding directory, together representing a single dump file.
 
 A holding chunk is an individual os-level file representing part of a holding
 file.  Chunks are kept small to avoid hitting filesystem size ilmits, and are
-linked together internally by filename.
+linked together internally by filename.  A complete holding file also has a
+manifest, named after it with a C<.manifest> suffix, listing its chunks with
+their sizes and CRCs; it is not itself a holding file.
 
 =back
 
@@ -146,7 +148,8 @@ headers if C<$ignore_headers> is true.
 
 =item C<file_unlink($file)>
 
-unlinks (deletes) all chunks comprising C<$file>, returning true on success.
+unlinks (deletes) all chunks comprising C<$file>, and its manifest, returning
+true on success.
 
 =item C<get_header($file)>
 
@@ -265,6 +268,12 @@ sub _walk {
 		next if $dirent eq '.' or $dirent eq '..' or $dirent eq 'pid';
 
 		my $filename = File::Spec->catfile($disk, $datestr, $dirent);
+
+		# a manifest goes with its holding file
+		if ($filename =~ /^(.*)\.manifest$/ and (-f $1 or -f "$1.tmp")) {
+		    next;
+		}
+
 		if (!-f $filename) {
 		    print $verbose "holding file '$filename' is not a file\n" if $verbose;
 		    next;
@@ -477,6 +486,8 @@ sub file_unlink {
     for my $chunk (file_chunks($filename)) {
 	unlink($chunk) or return 0;
     }
+    # the manifest written along with the chunks, if any
+    unlink("$filename.manifest");
 
     return 1;
 }
@@ -487,6 +498,8 @@ sub filetmp_unlink {
     for my $chunk (filetmp_chunks($filename)) {
 	unlink($chunk) or return 0;
     }
+    (my $hfilename = $filename) =~ s/\.tmp$//;
+    unlink("$hfilename.manifest");
 
     return 1;
 }
@@ -350,6 +350,15 @@ my $STATUS_FAILED  =  4;
 my $STATUS_MISSING =  8;
 my $STATUS_TAPE    = 16;
 
+# The last state parsed by this process for each configuration, so that a
+# long-running reader such as the REST server only parses what was appended
+# to the log since its previous call, without going through the cache file.
+my %live_state;
+
+# Minimum number of seconds between two writes of the cache file while the
+# run is in progress.
+my $CACHE_STORE_INTERVAL = 60;
+
 sub new {
     my $class = shift;
     my %params = @_;
@@ -2117,7 +2126,8 @@ sub current {
     my $self = shift;
     my %params = @_;
 
-    my $cache_dir = $Amanda::Paths::AMANDA_TMPDIR . '/cache_status/' . Amanda::Config::get_config_name();
+    my $config_name = Amanda::Config::get_config_name();
+    my $cache_dir = $Amanda::Paths::AMANDA_TMPDIR . '/cache_status/' . $config_name;
     File::Path::mkpath($cache_dir, { mode => 0700 });
     my $basefile = $self->{'filename'};
     $basefile = readlink $basefile if -l $basefile;
@@ -2125,8 +2135,22 @@ sub current {
     my $cache_file = $cache_dir . '/' . $basefile;
     my $cache_read = 0;
 
+    my ($dev, $ino, $size) = (stat $self->{'fd'})[0, 1, 7];
+    my $live = $live_state{$config_name};
+    $live = undef if $live && ($live->{'cache_file'} ne $cache_file ||
+			       $live->{'dev'} != $dev ||
+			       $live->{'ino'} != $ino ||
+			       ($live->{'state'}->{'filepos'} || 0) > $size ||
+			       !-f $cache_file);
+
     debug("cache_file: $cache_file");
-    if (-f $cache_file) {
+    if ($live) {
+	$self->{'state'} = $live->{'state'};
+	if ($self->{'state'}->{'filepos'}) {
+	    seek $self->{'fd'}, $self->{'state'}->{'filepos'}, 0;
+	}
+	$cache_read = 1;
+    } elsif (-f $cache_file) {
 	debug("cache_file: $cache_file exists\n");
 	# read the cache file
 	$self->{'state'} = retrieve $cache_file;
@@ -2154,11 +2178,25 @@ sub current {
     my $message = $self->parse();
     return $message if defined $message;
 
-    # write the cache file
-    if ($self->{'parsed_line'}) {
+    # write the cache file, not too often while the run is in progress, the
+    # state of a large run takes longer to write than to parse a minute of log
+    my $stored = $live ? $live->{'stored'} : 0;
+    if ($self->{'parsed_line'} &&
+	($self->{'state'}->{'driver_finished'} ||
+	 $self->{'state'}->{'dead_run'} ||
+	 time - $stored >= $CACHE_STORE_INTERVAL)) {
 	store $self->{'state'}, $cache_file;
+	$stored = time;
     }
-
+    $live_state{$config_name} = { cache_file => $cache_file,
+				  dev        => $dev,
+				  ino        => $ino,
+				  state      => $self->{'state'},
+				  stored     => $stored };
+
+    # set_summary changes the state it works on, the live state must stay as
+    # parsed for the next call
+    $self->{'state'} = Storable::dclone($self->{'state'});
     $self->set_summary();
 
     # ref them to the state
@@ -200,6 +200,10 @@ the directory to use for disk caching
 
 the maximum part size to use when caching
 
+=item C<part_size_max>
+
+the largest part size to adapt to, in bytes; see below
+
 =item C<can_cache_inform>
 
 true if the transfer source can call the destination's C<cache_inform> method
@@ -212,6 +216,27 @@ configuration parameters, and have the same default values (when omitted or
 C<undef>).  The method will take this information, along with details of the
 device it intends to use, and set up the transfer destination.
 
+If C<part_size_max> is greater than C<part_size> and the parts are not cached
+(a C<Amanda::Xfer::Dest::Taper::Splitter> is used), the size of each new part
+is chosen between them by C<get_adaptive_part_size>, from the size and
+duration of the parts the Scribe wrote before, in this dump or previous ones.
+The utility function takes:
+
+  my $part_size = get_adaptive_part_size(
+    min => ..,     ## the smallest part size
+    max => ..,     ## the largest part size
+    size => ..,    ## the current part size
+    samples => [ [ $size, $duration ], .. ],
+    gap => ..,     ## seconds between parts, not spent writing
+    failed => ..,  ## true if the last part failed
+  );
+
+It fits the duration of the samples to a fixed cost per part plus a cost per
+byte, and returns the smallest size for which the fixed cost and the gap are
+at most 5% of the time of a part.  The size changes at most twofold for each
+part, and is halved when a part fails, since the whole part must be written
+again.
+
 The utility function C<get_splitting_args_from_config> can determine the
 appropriate C<get_xfer_dest> splitting parameters based on a
 few Amanda configuration parameters.  If a parameter was not seen in the
@@ -235,9 +260,15 @@ should know about.
     part_cache_type_enum => ..., ## one of the enums from tapetype_getconf
     part_cache_dir => ..,
     part_cache_max_size => ..,
+    part_size_max => .., ## in bytes
+    part_size_max_kb => .., ## or use this, in kb
   );
   if ($splitting_args{'error'}) { .. }
 
+C<part_size_max> is returned only when the part size comes from the tapetype
+parameters.  If any of the C<dle_*> parameters is set, or the data path is
+DirectTCP, the part size is not adapted.
+
 An C<Amanda::Taper::Scribe> object can only run one transfer at a time, so
 do not call C<get_xfer_dest> until the C<dump_cb> for the previous C<start_dump>
 has been called.
@@ -438,9 +469,17 @@ use Amanda::Debug qw( :logging );
 use Amanda::MainLoop;
 use Amanda::Label;
 use Amanda::Config qw( :getconf config_dir_relative );
+use Time::HiRes;
 use base qw( Exporter );
 
-our @EXPORT_OK = qw( get_splitting_args_from_config );
+our @EXPORT_OK = qw( get_splitting_args_from_config get_adaptive_part_size );
+
+# the part size is adapted so that the time spent between parts is at most
+# this fraction of the time spent writing them
+use constant ADAPTIVE_OVERHEAD => 0.05;
+
+# number of recent parts used to adapt the part size
+use constant ADAPTIVE_SAMPLES => 8;
 
 sub new {
     my $class = shift;
@@ -762,6 +801,23 @@ sub get_xfer_dest {
 
     $self->{'retry_part_on_peom'} = 0 if !$self->{'allow_split'};
 
+    # each new part can have its own size when parts are not cached; the
+    # samples and the size reached are kept for the next dumps
+    my $part_size_max = $params{'part_size_max'} || 0;
+    if ($dest_type eq 'splitter' and $part_size and $part_size_max > $part_size) {
+	my $adapt = $self->{'adaptive_part_size'} ||= { samples => [] };
+	$adapt->{'min'} = 0 + "$part_size";
+	$adapt->{'max'} = 0 + "$part_size_max";
+	$adapt->{'size'} = $adapt->{'min'}
+	    if (!$adapt->{'size'} or $adapt->{'size'} < $adapt->{'min'});
+	$adapt->{'size'} = $adapt->{'max'} if $adapt->{'size'} > $adapt->{'max'};
+	$adapt->{'last_done'} = undef;
+	$adapt->{'enabled'} = 1;
+	$dest_text .= ", adaptive part size up to $part_size_max";
+    } elsif ($self->{'adaptive_part_size'}) {
+	$self->{'adaptive_part_size'}->{'enabled'} = 0;
+    }
+
     debug("Amanda::Taper::Scribe preparing to write, part size $part_size, "
 	. "$dest_text ($dest_type) "
 	. ($leom_supported? " (LEOM supported)" : " (no LEOM)"));
@@ -929,6 +985,10 @@ sub _start_part {
     if (!defined ($self->{'nparts'}) or $self->{'nparts'} == 0) {
 	$self->{'feedback'}->scribe_ready();
     }
+    my $adapt = $self->{'adaptive_part_size'};
+    if ($adapt and $adapt->{'enabled'} and $self->{'last_part_successful'}) {
+	$self->{'xdt'}->set_part_size($adapt->{'size'});
+    }
     $self->{'xdt'}->start_part(!$self->{'last_part_successful'},
 			       $self->{'dump_header'});
 }
@@ -993,6 +1053,8 @@ sub _xmsg_part_done {
     }
 
     $self->{'last_part_successful'} = $msg->{'successful'};
+    $self->_adapt_part_size($msg)
+	if $self->{'adaptive_part_size'} and $self->{'adaptive_part_size'}->{'enabled'};
 
     if ($msg->{'successful'}) {
 	$self->{'device_size'} += $msg->{'size'};
@@ -1060,6 +1122,45 @@ sub _xmsg_part_done {
     }
 }
 
+# record the size and duration of a part, and pick the size of the next one
+sub _adapt_part_size {
+    my $self = shift;
+    my ($msg) = @_;
+    my $adapt = $self->{'adaptive_part_size'};
+    my $now = Time::HiRes::time();
+    my $gap;
+
+    # the time between the end of the previous part and the start of this
+    # one, unless a volume was loaded in between
+    if (defined $adapt->{'last_done'} and !$adapt->{'new_volume'}) {
+	$gap = $now - $msg->{'duration'} - $adapt->{'last_done'};
+	$gap = 0 if $gap < 0;
+	$adapt->{'gap'} = defined $adapt->{'gap'}
+			? ($adapt->{'gap'} * 3 + $gap) / 4 : $gap;
+    }
+    $adapt->{'last_done'} = $now;
+    $adapt->{'new_volume'} = 0;
+
+    if ($msg->{'successful'}) {
+	return if $msg->{'size'} == 0;
+	push @{$adapt->{'samples'}}, [ 0 + "$msg->{'size'}", $msg->{'duration'} ];
+	shift @{$adapt->{'samples'}}
+	    while (@{$adapt->{'samples'}} > ADAPTIVE_SAMPLES);
+    }
+
+    my $size = get_adaptive_part_size(
+		min => $adapt->{'min'},
+		max => $adapt->{'max'},
+		size => $adapt->{'size'},
+		samples => $adapt->{'samples'},
+		gap => $adapt->{'gap'},
+		failed => !$msg->{'successful'});
+    if ($size != $adapt->{'size'}) {
+	$self->dbg("adaptive part size: $adapt->{'size'} -> $size");
+	$adapt->{'size'} = $size;
+    }
+}
+
 sub _xmsg_ready {
     my $self = shift;
     my ($src, $msg, $xfer) = @_;
@@ -1360,6 +1461,9 @@ sub _release_reservation {
 sub _get_new_volume {
     my $self = shift;
 
+    $self->{'adaptive_part_size'}->{'new_volume'} = 1
+	if $self->{'adaptive_part_size'};
+
     # release first, if necessary
     if ($self->{'reservation'}) {
 	$self->_release_reservation(finished_cb => sub {
@@ -1425,6 +1529,7 @@ sub _volume_cb  {
 	$new_scribe->{'image_id'} = $self->{'image_id'};
 	$new_scribe->{'image'} = $self->{'image'};
 	$new_scribe->{'copy'} = $self->{'copy'};
+	$new_scribe->{'adaptive_part_size'} = $self->{'adaptive_part_size'};
 	$self->{'dump_header'} = undef;
 	$self->{'dump_cb'} = undef;
 	$self->{'xfer'} = undef;
@@ -1724,6 +1829,54 @@ sub dbg {
 #    }
 }
 
+sub get_adaptive_part_size {
+    my %params = @_;
+    my ($min, $max, $size) = @params{'min', 'max', 'size'};
+    my $samples = $params{'samples'} || [];
+    my $gap = $params{'gap'} || 0;
+    my ($overhead, $per_byte, $target);
+
+    my $clamp = sub {
+	my ($s) = @_;
+	$s = $size / 2 if $s < $size / 2;
+	$s = $size * 2 if $s > $size * 2;
+	$s = $min if $s < $min;
+	$s = $max if $s > $max;
+	return int($s);
+    };
+
+    # a failed part has to be written again, so smaller parts cost less
+    return $clamp->($size / 2) if $params{'failed'};
+    return $size if !@$samples;
+
+    # least squares fit of: duration = overhead + size * per_byte
+    my ($n, $ss, $sd, $sss, $ssd) = (0, 0, 0, 0, 0);
+    for my $sample (@$samples) {
+	my ($s, $d) = @$sample;
+	$n++;
+	$ss += $s;
+	$sd += $d;
+	$sss += $s * $s;
+	$ssd += $s * $d;
+    }
+    my $var = $n * $sss - $ss * $ss;
+    if ($var <= 1e-6 * $n * $sss) {
+	# all parts had the same size; try a larger one to see how the
+	# duration changes
+	return $clamp->($size * 2) if $size < $max;
+	($overhead, $per_byte) = (0, $sd / $ss);
+    } else {
+	$per_byte = ($n * $ssd - $ss * $sd) / $var;
+	$overhead = ($sd - $per_byte * $ss) / $n;
+    }
+    return $size if $per_byte <= 0;
+    $overhead = 0 if $overhead < 0;
+    $overhead += $gap;
+
+    $target = $overhead * (1 - ADAPTIVE_OVERHEAD) / (ADAPTIVE_OVERHEAD * $per_byte);
+    return $clamp->($target);
+}
+
 sub get_splitting_args_from_config {
     my %params = @_;
 
@@ -1756,6 +1909,8 @@ sub get_splitting_args_from_config {
     # first, handle the alternate spellings for part_size and part_cache_type
     $params{'part_size'} = $params{'part_size_kb'} * 1024
 	if (defined $params{'part_size_kb'});
+    $params{'part_size_max'} = $params{'part_size_max_kb'} * 1024
+	if (defined $params{'part_size_max_kb'});
 
     if (defined $params{'part_cache_type_enum'}) {
 	$params{'part_cache_type'} = 'none'
@@ -1845,6 +2000,12 @@ sub get_splitting_args_from_config {
 		delete $params{'part_cache_dir'};
 	    }
 	}
+
+	# only a tapetype part size is adapted; a dumptype's tape_splitsize
+	# is used as is
+	$splitting_args{'part_size_max'} = $params{'part_size_max'}
+	    if ($params{'part_size_max'} and defined $ps and $ps > 0
+		and $params{'part_size_max'} > $ps);
     }
 
     $splitting_args{'part_size'} = $params{'part_size'}
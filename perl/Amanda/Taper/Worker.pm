@@ -1025,6 +1025,10 @@ sub setup_and_start_dump {
 	}
 
 	$splitting_args{'leom_supported'} = $device->property_get("leom");
+	if (my $tapetype = $self->{'controller'}->{'storage'}->{'tapetype'}) {
+	    $splitting_args{'part_size_max_kb'} =
+		tapetype_getconf($tapetype, $TAPETYPE_PART_SIZE_MAX);
+	}
 	# and convert those to get_xfer_dest args
         %get_xfer_dest_args = get_splitting_args_from_config(
 		%splitting_args);
@@ -44,7 +44,7 @@ my %subcommands;
 sub usage {
     print STDERR "Usage: amcatalog [--interactive] [--version] [-o configoption]* <conf> <command> {<args>} ...\n";
     print STDERR "    Valid <command>s are:\n";
-    print STDERR "        create                          # create the database\n";
+    print STDERR "        create [--jobs N]               # create the database\n";
     print STDERR "        upgrade                         # upgrade the database\n";
     print STDERR "        retention                       # recompute the retention\n";
     print STDERR "        validate                        # validate the database\n";
@@ -66,6 +66,7 @@ my $opt_exact_match;
 my $opt_interactive;
 my $opt_timestamp;
 my $opt_remove_pool;
+my $opt_jobs = 1;
 
 debug("Arguments: " . join(' ', @ARGV));
 Getopt::Long::Configure(qw(bundling));
@@ -76,6 +77,7 @@ GetOptions(
     'interactive' => \$opt_interactive,
     'timestamp'   => \$opt_timestamp,
     'remove-pool' => \$opt_remove_pool,
+    'jobs=i'      => \$opt_jobs,
     'o=s'        => sub { add_config_override_opt($config_overrides, $_[1]); },
     'version'    => \&Amanda::Util::version_opt,
 ) or usage();
@@ -667,7 +669,12 @@ if ($opt_interactive) {
 	    $opt_all_configs = 1;
 	    @argv = grep { $_ ne '--all-configs' } @argv;
 	}
-	print "BEGIN\n";
+	# a leading ID:<n> is echoed so the caller can match pipelined replies
+	my $reply_id;
+	if (@argv && $argv[0] =~ /^ID:\d+$/) {
+	    $reply_id = shift @argv;
+	}
+	print defined $reply_id ? "BEGIN $reply_id\n" : "BEGIN\n";
 	run_command(@argv);
 	print "\nEND\n";
 	$opt_timestamp = $old_timestamp;
@@ -692,13 +699,18 @@ sub run_command {
 	$catalog = Amanda::DB::Catalog2->new($catalog_conf, config_name => $opt_config,
 							    drop_tables => $drop_tables,
 							    create => 1,
-							    load => 1);
+							    load => 1,
+							    load_jobs => $opt_jobs);
 	return;
     } elsif ($command eq "import") {
 	$catalog = Amanda::DB::Catalog2->new($catalog_conf, config_name => $opt_config,
 							    create => 1,
-							    empty => 1);
-	_import($catalog, $argv[1]);
+							    empty => 1,
+							    bulk => 1);
+	eval { _import($catalog, $argv[1]); };
+	my $err = $@;
+	$catalog->end_bulk();
+	die $err if $err;
 	return;
     } elsif ($command eq "upgrade") {
 	$catalog = Amanda::DB::Catalog2->new($catalog_conf, config_name => $opt_config,
@@ -48,6 +48,7 @@
 #include "clock.h"
 #include "match.h"
 #include "amindex.h"
+#include "indexsort.h"
 #include "disk_history.h"
 #include "list_dir.h"
 #include "logfile.h"
@@ -2003,24 +2004,19 @@ uncompress_file(
     struct stat stat_filename;
     int result;
     int pipe_from_gzip;
-    int pipe_to_sort;
     int indexfd;
     int nullfd;
     int uncompress_errfd;
-    int sort_errfd;
     char line[STR_SIZE];
     FILE *pipe_stream;
     pid_t pid_gzip = 0;
-    pid_t pid_sort = 0;
-    pid_t pid_index = 0;
+    gboolean sort_ok = FALSE;
     int        status;
     char      *msg;
     gpointer  *p;
     gpointer  *p_last;
     GPtrArray *uncompress_err = NULL;
-    GPtrArray *sort_err = NULL;
     FILE      *uncompress_err_stream;
-    FILE      *sort_err_stream;
 
     new_filename = getindex_unsorted_fname(hostname, diskname, timestamps, level);
 
@@ -2119,46 +2115,20 @@ uncompress_file(
     }
 
     if (need_sort) {
-	/* start the sort process */
-	putenv(g_strdup("LC_ALL=C"));
-
-	if (getconf_seen(CNF_TMPDIR)) {
-	    gchar *tmpdir = getconf_str(CNF_TMPDIR);
-	    pid_sort = pipespawn(SORT_PATH, STDIN_PIPE|STDERR_PIPE, 0,
-				 &pipe_to_sort, &indexfd, &sort_errfd,
-				 SORT_PATH, "-k", "6", "-T", tmpdir, NULL);
-	} else {
-	    pid_sort = pipespawn(SORT_PATH, STDIN_PIPE|STDERR_PIPE, 0,
-				 &pipe_to_sort, &indexfd, &sort_errfd,
-				 SORT_PATH, "-k", "6", NULL);
-	}
-	aclose(indexfd);
-
-	/* start a subprocess */
-	/* send all ouput from uncompress process to sort process */
-	pid_index = fork();
-	switch (pid_index) {
-	case -1:
-	    msg = g_strdup_printf(
-			_("fork error: %s"),
-			strerror(errno));
+	/* sort in this process, in the same order as 'LC_ALL=C sort' */
+	indexsort_t *isort = indexsort_new(getconf_str(CNF_TMPDIR), 0);
+
+	sort_ok = indexsort_add_fd(isort, fileno(pipe_stream)) &&
+		  indexsort_write(isort, indexfd);
+	if (!sort_ok) {
+	    msg = g_strdup_printf(_("Can't sort index file '%s': %s"),
+				  filename, indexsort_error(isort));
 	    dbprintf("%s\n", msg);
 	    g_ptr_array_add(*emsg, msg);
-	    unlink(filename);
-	    amfree(filename);
-	    break;
-	default: break;
-	case 0:
-	    while (fgets(line, STR_SIZE, pipe_stream) != NULL) {
-		if (line[0] != '\0') {
-		    full_write(pipe_to_sort,line,strlen(line));
-		}
-	    }
-	    exit(0);
 	}
-
+	indexsort_free(isort);
 	fclose(pipe_stream);
-	aclose(pipe_to_sort);
+	aclose(indexfd);
     }
 
     if (need_uncompress) {
@@ -2179,24 +2149,6 @@ uncompress_file(
 	}
     }
 
-    if (need_sort) {
-	sort_err_stream = fdopen(sort_errfd, "r");
-	sort_err = g_ptr_array_new();
-	if (!sort_err_stream) {
-	    g_ptr_array_add(sort_err,
-		    g_strdup_printf("Can't fdopen sort_err_stream: %s\n",
-				    strerror(errno)));
-	} else {
-	    while (fgets(line, sizeof(line), sort_err_stream) != NULL) {
-		if (strlen(line) > 0 && line[strlen(line)-1] == '\n')
-		    line[strlen(line)-1] = '\0';
-		g_ptr_array_add(sort_err, g_strdup_printf("  %s", line));
-		dbprintf("Sort: %s\n", line);
-	    }
-	    fclose(sort_err_stream);
-	}
-    }
-
     if (need_uncompress) {
 	status = get_pid_status(pid_gzip, UNCOMPRESS_PATH, emsg);
 	if (status == 0 && filename) {
@@ -2212,25 +2164,9 @@ uncompress_file(
 	g_ptr_array_free(uncompress_err, TRUE);
     }
 
-    if (need_sort) {
-	status = get_pid_status(pid_index, "index", emsg);
-	if (status == 0 && filename) {
-	    unlink(filename);
-	    amfree(filename);
-	}
-
-	status = get_pid_status(pid_sort, SORT_PATH, emsg);
-	if (status == 0 && filename) {
-	    unlink(filename);
-	    amfree(filename);
-	}
-	if (sort_err->len > 0) {
-	    p_last = sort_err->pdata + sort_err->len;
-	    for (p = sort_err->pdata; p < p_last ;p++) {
-		g_ptr_array_add(*emsg, (char *)*p);
-	    }
-	}
-	g_ptr_array_free(sort_err, TRUE);
+    if (need_sort && sort_ok && filename) {
+	unlink(filename);
+	amfree(filename);
     }
 
     if (need_sort && new_filename && getconf_boolean(CNF_COMPRESS_INDEX)) {
@@ -40,6 +40,7 @@
 #include "server_util.h"
 #include "amutil.h"
 #include "amindex.h"
+#include "indexsort.h"
 #include "pipespawn.h"
 
 typedef struct inames {
@@ -58,8 +59,8 @@ static pid_t run_compress(int fd_in, int *fd_out, int *fd_err,
 			  char *source_filename, char *dest_filename);
 static pid_t run_uncompress(int fd_in, int *fd_out, int *fd_err,
 			    char *source_filename, char *dest_filename);
-static pid_t run_sort(int fd_in, int *fd_out, int *fd_err,
-		      char *source_filename, char *dest_filename);
+static gboolean sort_index_file(char *source_filename, gboolean uncompress,
+				char *dest_filename, gboolean compress);
 static gboolean wait_process(pid_t pid, int fd_err, char *name);
 
 
@@ -498,13 +499,10 @@ main(
 		gboolean unsorted_exist = FALSE;
 		gboolean unsorted_gz_exist = FALSE;
 
-		int fd;
 		int uncompress_err_fd = -1;
-		int sort_err_fd = -1;
 		int compress_err_fd = -1;
 
 		pid_t uncompress_pid = -1;
-		pid_t sort_pid = -1;
 		pid_t compress_pid = -1;
 
 		iname = g_hash_table_lookup(hash_inames, names[i]);
@@ -530,21 +528,16 @@ main(
 			    unlink(sorted_name);
 			} else if (unsorted_exist) {
 			    // SORT AND COMPRESS
-			    sort_pid = run_sort(-1, &fd, &sort_err_fd, unsorted_name, NULL);
-			    compress_pid = run_compress(fd, NULL, &compress_err_fd, NULL, sorted_gz_name);
-			    unlink(unsorted_name);
+			    if (sort_index_file(unsorted_name, FALSE, sorted_gz_name, TRUE))
+				unlink(unsorted_name);
 			} else if (unsorted_gz_exist) {
 			    // UNCOMPRESS SORT AND COMPRESS
-			    uncompress_pid = run_uncompress(-1, &fd, &uncompress_err_fd, unsorted_gz_name, NULL);
-			    sort_pid = run_sort(fd, &fd, &sort_err_fd, NULL, NULL);
-			    compress_pid = run_compress(fd, NULL, &compress_err_fd, NULL, sorted_gz_name);
-			    unlink(unsorted_gz_name);
+			    if (sort_index_file(unsorted_gz_name, TRUE, sorted_gz_name, TRUE))
+				unlink(unsorted_gz_name);
 			} else if (orig_exist) {
 			    // UNCOMPRESS SORT AND COMPRESS
-			    uncompress_pid = run_uncompress(-1, &fd, &uncompress_err_fd, orig_name, NULL);
-			    sort_pid = run_sort(fd, &fd, &sort_err_fd, NULL, NULL);
-			    compress_pid = run_compress(fd, NULL, &compress_err_fd, NULL, sorted_gz_name);
-			    unlink(orig_name);
+			    if (sort_index_file(orig_name, TRUE, sorted_gz_name, TRUE))
+				unlink(orig_name);
 			}
 		    } else {
 			if (sorted_exist) {
@@ -565,18 +558,16 @@ main(
 			    unlink(sorted_gz_name);
 			} else if (unsorted_exist) {
 			    // SORT
-			    sort_pid = run_sort(-1, NULL, &sort_err_fd, unsorted_name, sorted_name);
-			    unlink(unsorted_name);
+			    if (sort_index_file(unsorted_name, FALSE, sorted_name, FALSE))
+				unlink(unsorted_name);
 			} else if (unsorted_gz_exist) {
 			    // UNCOMPRESS AND SORT
-			    uncompress_pid = run_uncompress(-1, &fd, &uncompress_err_fd, unsorted_gz_name, NULL);
-			    sort_pid = run_sort(fd, NULL, &sort_err_fd, NULL, sorted_name);
-			    unlink(unsorted_gz_name);
+			    if (sort_index_file(unsorted_gz_name, TRUE, sorted_name, FALSE))
+				unlink(unsorted_gz_name);
 			} else if (orig_exist) {
 			    // UNCOMPRESS AND SORT
-			    uncompress_pid = run_uncompress(-1, &fd, &uncompress_err_fd, orig_name, NULL);
-			    sort_pid = run_sort(fd, NULL, &sort_err_fd, NULL, sorted_name);
-			    unlink(orig_name);
+			    if (sort_index_file(orig_name, TRUE, sorted_name, FALSE))
+				unlink(orig_name);
 			}
 		    } else {
 			if (sorted_gz_exist) {
@@ -643,8 +634,6 @@ main(
 		}
 		    if (uncompress_pid != -1)
 			wait_process(uncompress_pid, uncompress_err_fd, "uncompress");
-		    if (sort_pid != -1)
-			wait_process(sort_pid, sort_err_fd, "sort");
 		    if (compress_pid != -1)
 			wait_process(compress_pid, compress_err_fd, "compress");
 
@@ -770,43 +759,73 @@ run_uncompress(
     return pid;
 }
 
-static pid_t
-run_sort(
-    int   fd_in,
-    int  *fd_out,
-    int  *fd_err,
-    char *source_filename,
-    char *dest_filename)
+/* sort an index file in this process, without temporary copies of it; the
+ * source is read completely before the destination is created */
+static gboolean
+sort_index_file(
+    char     *source_filename,
+    gboolean  uncompress,
+    char     *dest_filename,
+    gboolean  compress)
 {
+    indexsort_t *isort;
     int   in_fd;
     int   out_fd;
-    int   create_pipe = STDERR_PIPE;
-    pid_t pid;
-    gchar *tmpdir = getconf_str(CNF_TMPDIR);
+    int   pipe_fd;
+    int   uncompress_err_fd = -1;
+    int   compress_err_fd = -1;
+    pid_t uncompress_pid = -1;
+    pid_t compress_pid = -1;
+    gboolean rval = TRUE;
 
-    if (fd_in == -1) {
-	in_fd = open(source_filename, O_RDONLY);
+    if (uncompress) {
+	uncompress_pid = run_uncompress(-1, &in_fd, &uncompress_err_fd,
+					source_filename, NULL);
     } else {
-	in_fd = fd_in;
-    }
-
-    if (dest_filename) {
-	out_fd = open(dest_filename, O_WRONLY|O_CREAT, S_IRUSR);
-    } else {
-	create_pipe |= STDOUT_PIPE;
+	in_fd = open(source_filename, O_RDONLY);
+	if (in_fd == -1) {
+	    g_debug("Can't open '%s': %s", source_filename, strerror(errno));
+	    return FALSE;
+	}
     }
 
-
-    pid = pipespawn(SORT_PATH, create_pipe, 0,
-		    &in_fd, &out_fd, fd_err,
-		    SORT_PATH, "-T", tmpdir, NULL);
+    isort = indexsort_new(getconf_str(CNF_TMPDIR), 0);
+    if (!indexsort_add_fd(isort, in_fd))
+	rval = FALSE;
     close(in_fd);
-    if (dest_filename) {
+    if (uncompress_pid != -1 &&
+	!wait_process(uncompress_pid, uncompress_err_fd, "uncompress"))
+	rval = FALSE;
+
+    if (rval) {
+	out_fd = open(dest_filename, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR);
+	if (out_fd == -1) {
+	    g_debug("Can't open '%s': %s", dest_filename, strerror(errno));
+	    indexsort_free(isort);
+	    return FALSE;
+	}
+	if (compress) {
+	    compress_pid = pipespawn(COMPRESS_PATH, STDIN_PIPE|STDERR_PIPE, 0,
+				     &pipe_fd, &out_fd, &compress_err_fd,
+				     COMPRESS_PATH, COMPRESS_BEST_OPT, NULL);
+	    if (!indexsort_write(isort, pipe_fd))
+		rval = FALSE;
+	    close(pipe_fd);
+	    if (!wait_process(compress_pid, compress_err_fd, "compress"))
+		rval = FALSE;
+	} else if (!indexsort_write(isort, out_fd)) {
+	    rval = FALSE;
+	}
 	close(out_fd);
-    } else {
-	*fd_out = out_fd;
+	if (!rval)
+	    unlink(dest_filename);
     }
-    return pid;
+
+    if (indexsort_error(isort))
+	g_debug("sort of '%s' failed: %s", source_filename,
+		indexsort_error(isort));
+    indexsort_free(isort);
+    return rval;
 }
 
 static gboolean
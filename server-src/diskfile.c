@@ -42,8 +42,27 @@ static am_host_t *hostlist = NULL;
 static  disklist_t dlist = { NULL, NULL };
 static netif_t *all_netifs = NULL;
 
+/*
+ * Indexes of the hosts and disks, so that lookups and the duplicate checks
+ * of parse_diskline don't walk all hosts, or all disks of a host, for each
+ * line of a large disklist.  The disk keys are "hostname\nname", with the
+ * hostname as stored in the am_host_t.
+ */
+static GHashTable *host_index = NULL;		/* lowercase hostname -> am_host_t */
+static GHashTable *host_sanitised_index = NULL;	/* sanitised hostname -> am_host_t */
+static GHashTable *host_match_index = NULL;	/* host_match_key -> GSList of am_host_t */
+static GSList *glob_hosts = NULL;		/* hosts whose name is a glob */
+static GHashTable *disk_index = NULL;		/* disk name -> disk_t */
+static GHashTable *disk_sanitised_index = NULL;	/* sanitised disk name -> disk_t */
+static GHashTable *disk_match_index = NULL;	/* disk_match_key -> GSList of disk_t */
+
 /* local functions */
 static char *upcase(char *st);
+static void index_host(am_host_t *host);
+static void index_disk(disk_t *disk);
+static void free_indexes(void);
+static am_host_t *find_duplicate_host(const char *hostname);
+static disk_t *find_matching_disk(am_host_t *host, const char *diskname);
 static int parse_diskline(disklist_t *, const char *, FILE *, int *, char **);
 static void disk_parserror(const char *, int, const char *, ...)
 			    G_GNUC_PRINTF(3, 4);
@@ -110,11 +129,15 @@ lookup_host(
     const char *hostname)
 {
     am_host_t *p;
+    char *key;
 
-    for (p = hostlist; p != NULL; p = p->next) {
-	if(strcasecmp(p->hostname, hostname) == 0) return p;
-    }
-    return (NULL);
+    if (!host_index)
+	return (NULL);
+
+    key = g_ascii_strdown(hostname, -1);
+    p = g_hash_table_lookup(host_index, key);
+    g_free(key);
+    return (p);
 }
 
 disk_t *
@@ -124,16 +147,217 @@ lookup_disk(
 {
     am_host_t *host;
     disk_t *disk;
+    char *key;
 
     host = lookup_host(hostname);
     if (host == NULL)
 	return (NULL);
 
-    for (disk = host->disks; disk != NULL; disk = disk->hostnext) {
-	if (g_str_equal(disk->name, diskname))
-	    return (disk);
+    key = g_strconcat(host->hostname, "\n", diskname, NULL);
+    disk = g_hash_table_lookup(disk_index, key);
+    g_free(key);
+    return (disk);
+}
+
+/*
+ * Two hostnames without glob characters match each other (with
+ * match_host) only if they are equal but for case and the dots around
+ * them, so hosts need only be compared to the ones with the same key, and
+ * to the hosts whose name is a glob.
+ */
+static gboolean
+is_host_glob(
+    const char *hostname)
+{
+    return hostname[0] == '=' || strpbrk(hostname, "*?[]{}^$\\") != NULL;
+}
+
+static char *
+host_match_key(
+    const char *hostname)
+{
+    char *key = g_ascii_strdown(hostname, -1);
+    char *p = key;
+    size_t len;
+
+    while (*p == '.')
+	p++;
+    memmove(key, p, strlen(p) + 1);
+    len = strlen(key);
+    while (len > 0 && key[len-1] == '.')
+	key[--len] = '\0';
+    return key;
+}
+
+/*
+ * The duplicate check of parse_diskline compares anchored, escaped disk
+ * names, which only match if they are equal once a Windows share is
+ * written with slashes.
+ */
+static char *
+disk_match_key(
+    am_host_t  *host,
+    const char *diskname)
+{
+    char *key = g_strconcat(host->hostname, "\n", diskname, NULL);
+
+    g_strdelimit(key + strlen(host->hostname) + 1, "\\", '/');
+    return key;
+}
+
+static void
+index_add_to_list(
+    GHashTable *table,
+    char       *key,
+    gpointer    value)
+{
+    GSList *list = g_hash_table_lookup(table, key);
+
+    if (list) {
+	/* appending keeps the head, so the table needs no update */
+	list = g_slist_append(list, value);
+	g_free(key);
+    } else {
+	g_hash_table_insert(table, key, g_slist_append(NULL, value));
+    }
+}
+
+static void
+index_host(
+    am_host_t *host)
+{
+    if (!host_index) {
+	host_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+					   g_free, NULL);
+	host_sanitised_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+						     g_free, NULL);
+	host_match_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+					g_free, (GDestroyNotify)g_slist_free);
+	disk_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+					   g_free, NULL);
+	disk_sanitised_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+						     g_free, NULL);
+	disk_match_index = g_hash_table_new_full(g_str_hash, g_str_equal,
+					g_free, (GDestroyNotify)g_slist_free);
+    }
+
+    g_hash_table_insert(host_index, g_ascii_strdown(host->hostname, -1), host);
+    g_hash_table_insert(host_sanitised_index,
+			sanitise_filename(host->hostname), host);
+    if (is_host_glob(host->hostname)) {
+	glob_hosts = g_slist_prepend(glob_hosts, host);
+    } else {
+	index_add_to_list(host_match_index, host_match_key(host->hostname), host);
     }
-    return (NULL);
+}
+
+static void
+index_disk(
+    disk_t *disk)
+{
+    char *sdisk = sanitise_filename(disk->name);
+
+    g_hash_table_insert(disk_index,
+		g_strconcat(disk->host->hostname, "\n", disk->name, NULL), disk);
+    g_hash_table_insert(disk_sanitised_index,
+		g_strconcat(disk->host->hostname, "\n", sdisk, NULL), disk);
+    index_add_to_list(disk_match_index, disk_match_key(disk->host, disk->name),
+		      disk);
+    g_free(sdisk);
+}
+
+static void
+free_indexes(void)
+{
+    if (!host_index)
+	return;
+
+    g_hash_table_destroy(host_index);
+    g_hash_table_destroy(host_sanitised_index);
+    g_hash_table_destroy(host_match_index);
+    g_hash_table_destroy(disk_index);
+    g_hash_table_destroy(disk_sanitised_index);
+    g_hash_table_destroy(disk_match_index);
+    host_index = NULL;
+    host_sanitised_index = NULL;
+    host_match_index = NULL;
+    disk_index = NULL;
+    disk_sanitised_index = NULL;
+    disk_match_index = NULL;
+    g_slist_free(glob_hosts);
+    glob_hosts = NULL;
+}
+
+/* a host, with another name, that matches hostname and that hostname
+ * matches */
+static am_host_t *
+find_duplicate_host(
+    const char *hostname)
+{
+    am_host_t *p;
+    GSList *candidates = NULL;
+    GSList *iter;
+    char *key;
+
+    if (!host_index)
+	return NULL;
+
+    if (is_host_glob(hostname)) {
+	for (p = hostlist; p != NULL; p = p->next) {
+	    if (strcasecmp(hostname, p->hostname) &&
+		match_host(hostname, p->hostname) &&
+		match_host(p->hostname, hostname))
+		return p;
+	}
+	return NULL;
+    }
+
+    key = host_match_key(hostname);
+    candidates = g_hash_table_lookup(host_match_index, key);
+    g_free(key);
+    for (iter = candidates; iter != NULL; iter = iter->next) {
+	p = (am_host_t *)iter->data;
+	if (strcasecmp(hostname, p->hostname) &&
+	    match_host(hostname, p->hostname) &&
+	    match_host(p->hostname, hostname))
+	    return p;
+    }
+    for (iter = glob_hosts; iter != NULL; iter = iter->next) {
+	p = (am_host_t *)iter->data;
+	if (strcasecmp(hostname, p->hostname) &&
+	    match_host(hostname, p->hostname) &&
+	    match_host(p->hostname, hostname))
+	    return p;
+    }
+    return NULL;
+}
+
+/* a disk of host whose name matches diskname both ways */
+static disk_t *
+find_matching_disk(
+    am_host_t  *host,
+    const char *diskname)
+{
+    GSList *iter;
+    char *key = disk_match_key(host, diskname);
+    disk_t *disk = NULL;
+
+    for (iter = g_hash_table_lookup(disk_match_index, key); iter != NULL;
+	 iter = iter->next) {
+	char *a1, *a2;
+	disk_t *dp = (disk_t *)iter->data;
+
+	a1 = clean_regex(diskname, 1);
+	a2 = clean_regex(dp->name, 1);
+	if (match_disk(a1, dp->name) && match_disk(a2, diskname))
+	    disk = dp;
+	amfree(a1);
+	amfree(a2);
+	if (disk)
+	    break;
+    }
+    g_free(key);
+    return disk;
 }
 
 
@@ -249,12 +473,14 @@ add_disk(
 	host->features = NULL;
 	host->pre_script = 0;
 	host->post_script = 0;
+	index_host(host);
     }
     enqueue_disk(list, disk);
 
     disk->host = host;
     disk->hostnext = host->disks;
     host->disks = disk;
+    index_disk(disk);
 
     return disk;
 }
@@ -377,6 +603,7 @@ unload_disklist(void)
 	amfree(host);
     }
     hostlist=NULL;
+    free_indexes();
     dlist.head = NULL;
     dlist.tail = NULL;
 
@@ -477,24 +704,17 @@ parse_diskline(
     }
 
     shost = sanitise_filename(hostname);
-    for (p = hostlist; p != NULL; p = p->next) {
-	char *shostp = sanitise_filename(p->hostname);
-	if (!g_str_equal(hostname, p->hostname) &&
-	    g_str_equal(shost, shostp)) {
-	    disk_parserror(filename, line_num, _("Two hosts are mapping to the same name: \"%s\" and \"%s\""), p->hostname, hostname);
-	    amfree(shost);
-	    amfree(shostp);
-	    return(-1);
-	}
-	else if (strcasecmp(hostname, p->hostname) &&
-		 match_host(hostname, p->hostname) &&
-		 match_host(p->hostname, hostname)) {
-	    disk_parserror(filename, line_num, _("Duplicate host name: \"%s\" and \"%s\""), p->hostname, hostname);
-	    amfree(shost);
-	    amfree(shostp);
-	    return(-1);
-	}
-	amfree(shostp);
+    p = host_sanitised_index ? g_hash_table_lookup(host_sanitised_index, shost)
+			     : NULL;
+    if (p && !g_str_equal(hostname, p->hostname)) {
+	disk_parserror(filename, line_num, _("Two hosts are mapping to the same name: \"%s\" and \"%s\""), p->hostname, hostname);
+	amfree(shost);
+	return(-1);
+    }
+    if ((p = find_duplicate_host(hostname)) != NULL) {
+	disk_parserror(filename, line_num, _("Duplicate host name: \"%s\" and \"%s\""), p->hostname, hostname);
+	amfree(shost);
+	return(-1);
     }
     amfree(shost);
 
@@ -561,22 +781,8 @@ parse_diskline(
     if (host) {
 	if ((disk = lookup_disk(hostname, diskname)) != NULL) {
 	    dup = 1;
-	} else {
-	    disk = host->disks;
-	    do {
-		char *a1, *a2;
-		a1 = clean_regex(diskname, 1);
-		a2 = clean_regex(disk->name, 1);
-
-		if (match_disk(a1, disk->name) && match_disk(a2, diskname)) {
-		    dup = 1;
-		} else {
-		    disk = disk->hostnext;
-		}
-		amfree(a1);
-		amfree(a2);
-	    }
-	    while (dup == 0 && disk != NULL);
+	} else if ((disk = find_matching_disk(host, diskname)) != NULL) {
+	    dup = 1;
 	}
 	if (dup == 1) {
 	    disk_parserror(filename, line_num,
@@ -601,19 +807,18 @@ parse_diskline(
     }
 
     if (host) {
+	char *key;
+
 	sdisk = sanitise_filename(diskname);
-	for (dp = host->disks; dp != NULL; dp = dp->hostnext) {
-	    char *sdiskp = sanitise_filename(dp->name);
-	    if (!g_str_equal(diskname, dp->name) &&
-		 g_str_equal(sdisk, sdiskp)) {
-		disk_parserror(filename, line_num,
-		 _("Two disks are mapping to the same name: \"%s\" and \"%s\"; you must use different diskname"),
-			       dp->name, diskname);
-		amfree(sdiskp);
-		amfree(sdisk);
-		return(-1);
-	    }
-	    amfree(sdiskp);
+	key = g_strconcat(host->hostname, "\n", sdisk, NULL);
+	dp = g_hash_table_lookup(disk_sanitised_index, key);
+	g_free(key);
+	if (dp && !g_str_equal(diskname, dp->name)) {
+	    disk_parserror(filename, line_num,
+	     _("Two disks are mapping to the same name: \"%s\" and \"%s\"; you must use different diskname"),
+			   dp->name, diskname);
+	    amfree(sdisk);
+	    return(-1);
 	}
 	amfree(sdisk);
     }
@@ -912,6 +1117,7 @@ parse_diskline(
 	host->features = NULL;
 	host->pre_script = 0;
 	host->post_script = 0;
+	index_host(host);
     }
 
     host->netif = netif;
@@ -922,6 +1128,7 @@ parse_diskline(
     disk->hostnext = host->disks;
     host->disks = disk;
     host->maxdumps = disk->maxdumps;
+    index_disk(disk);
 
     return (0);
 }
@@ -67,6 +67,8 @@
 } while (0)
 
 #define HOST_DELAY 0
+#define STATE_INTERVAL 10	/* seconds between unchanged state lines */
+#define HOLDALLOC_MIN_SAMPLE 1.0	/* shortest write, in seconds, used for kps */
 
 static disklist_t  waitq;	// dle waiting estimate result
 static schedlist_t runq;	// dle waiting to be dumped to holding disk
@@ -85,6 +87,7 @@ static int conf_taperalgo;
 static int conf_taper_parallel_write;
 static int conf_runtapes;
 static unsigned long conf_reserve = 100;
+static gboolean conf_dump_to_idle_taper;
 static time_t sleep_time;
 static int idle_reason;
 static char *driver_timestamp;
@@ -119,6 +122,7 @@ static void deallocate_bandwidth(netif_t *ip, unsigned long kps);
 static void dump_schedule(schedlist_t *qp, char *str);
 static assignedhd_t **find_diskspace(off_t size, int *cur_idle,
 					assignedhd_t *preferred);
+static void release_hd_writer(assignedhd_t *h);
 static unsigned long network_free_kps(netif_t *ip);
 static off_t holding_free_space(void);
 static void dumper_chunker_result(job_t *job);
@@ -133,10 +137,10 @@ static void handle_dumpers_time(void *);
 static void handle_taper_result(void *);
 static gboolean dump_match_selection(char *storage_n, sched_t *sp);
 
-static void holdingdisk_state(char *time_str);
+static void holdingdisk_state(GString *state);
 static wtaper_t *idle_wtaper(taper_t *taper);
 static wtaper_t *wtaper_from_name(taper_t *taper, char *name);
-static void interface_state(char *time_str);
+static void interface_state(GString *state);
 static int queue_length(schedlist_t *q);
 static void read_flush(void *cookie);
 static void read_schedule(void *cookie);
@@ -417,6 +421,7 @@ main(
     inparallel	= getconf_int(CNF_INPARALLEL);
 
     conf_reserve = (unsigned long)getconf_int(CNF_RESERVE);
+    conf_dump_to_idle_taper = getconf_boolean(CNF_DUMP_TO_IDLE_TAPER);
 
     total_disksize = (off_t)0;
     ha_last = NULL;
@@ -439,6 +444,8 @@ main(
 	ha->hdisk = hdp;
 	ha->allocated_dumpers = 0;
 	ha->allocated_space = (off_t)0;
+	ha->written = (off_t)0;
+	ha->write_time = 0.0;
 	ha->disksize = holdingdisk_get_disksize(hdp);
 
 	/* get disk size */
@@ -521,6 +528,10 @@ main(
     /* fire up the dumpers now while we are waiting */
     if(!no_dump) startup_dump_processes(dumper_program, inparallel, driver_timestamp);
 
+    /* the children are forked, replies to catalog updates can now be
+     * read from the event loop */
+    amcatalog_use_event_loop();
+
     /*
      * Read schedule from stdin.  Usually, this is a pipe from planner,
      * so the effect is that we wait here for the planner to
@@ -788,6 +799,7 @@ main(
     holding_cleanup(NULL, NULL);
 
     amcatalog_remove_working_cmd(getppid());
+    quit_amcatalog();
 
     amfree(newdir);
 
@@ -1678,6 +1690,81 @@ allow_dump_dle(
     }
 }
 
+/*
+ * With dump-to-idle-taper, a taper worker that sits idle with nothing to
+ * flush is given a dump directly instead of letting it wait for the dump
+ * to land on the holding disk first.  The largest eligible dump in rq is
+ * moved to directq, where the normal direct-to-tape code picks it up.
+ * Dumps that do not find an idle taper still go to holding disk.
+ */
+static void
+feed_idle_taper(
+    schedlist_t *rq,
+    const time_t now)
+{
+    taper_t *taper;
+    wtaper_t *wtaper;
+    TapeAction result_tape_action;
+    char    *why_no_new_tape = NULL;
+    GList   *slist;
+    sched_t *sp, *best_sp;
+    disk_t  *diskp;
+    char    *qname;
+    char    *wall_time;
+
+    if (!conf_dump_to_idle_taper || rq == &directq || !empty(directq) ||
+	!all_tapeq_empty() || !no_taper_flushing()) {
+	return;
+    }
+
+    for (taper = tapetable; taper < tapetable+nb_storage; taper++) {
+	if (!taper->storage_name || !taper->flush_storage ||
+	    taper->degraded_mode || taper->down ||
+	    taper->current_tape >= taper->runtapes) {
+	    continue;
+	}
+	wtaper = idle_wtaper(taper);
+	if (!wtaper)
+	    continue;
+	result_tape_action = tape_action(wtaper, &why_no_new_tape, TRUE);
+	if (!(result_tape_action & TAPE_ACTION_START_A_FLUSH) &&
+	    !(result_tape_action & TAPE_ACTION_START_A_FLUSH_FIT))
+	    continue;
+
+	best_sp = NULL;
+	for (slist = rq->head; slist != NULL; slist = slist->next) {
+	    sp = get_sched(slist);
+	    diskp = sp->disk;
+	    if (diskp->to_holdingdisk != HOLD_AUTO ||
+		diskp->host->start_t > now || diskp->start_t > now ||
+		!dump_match_selection(taper->storage_name, sp))
+		continue;
+	    /* same admission checks as a dump started by start_some_dumps */
+	    if (diskp->host->netif->curusage > 0 &&
+		sp->est_kps > network_free_kps(diskp->host->netif))
+		continue;
+	    if (client_constrained(diskp))
+		continue;
+	    if (!best_sp || sp->est_size > best_sp->est_size)
+		best_sp = sp;
+	}
+	if (!best_sp)
+	    continue;
+
+	diskp = best_sp->disk;
+	qname = quote_string(diskp->name);
+	wall_time = walltime_str(curclock());
+	remove_sched(rq, best_sp);
+	best_sp->action = ACTION_DUMP_TO_TAPE;
+	best_sp->prefered_taper = taper;
+	best_sp->idle_taper = 1;
+	g_printf("driver: idle taper dump_to_tape time %s %s %s %s\n", wall_time, diskp->host->hostname, qname, best_sp->datestamp);
+	enqueue_sched(&directq, best_sp);
+	amfree(qname);
+	return;
+    }
+}
+
 static void
 start_some_dumps(
     schedlist_t *rq)
@@ -1710,7 +1797,8 @@ start_some_dumps(
 
     for(dumper = dmptable; dumper < (dmptable+inparallel); dumper++) {
 	if (dumper->busy && dumper->job &&
-	    dumper->job->sched->disk->to_holdingdisk != HOLD_NEVER) {
+	    dumper->job->sched->disk->to_holdingdisk != HOLD_NEVER &&
+	    !dumper->job->sched->idle_taper) {
 	    dumper_to_holding++;
 	}
     }
@@ -1765,6 +1853,7 @@ start_some_dumps(
 	sp = NULL;
 	//diskp = NULL;
 	wtaper = NULL;
+	feed_idle_taper(rq, now);
 	directq_is_empty = empty(directq);
 	if (!empty(directq)) {  /* to the first allowed storage only */
 	    for (slist = directq.head; slist != NULL; slist = slist_next) {
@@ -2987,7 +3076,7 @@ vault_taper_result(
                         cmddata->working_pid = getppid();
                         cmddata->status = CMD_TODO;
                         cmddata->start_time = now + v->days * 60*60*24;
-			amcatalog_add_cmd(cmddata);
+			amcatalog_queue_add_cmd(cmddata);
 			free_cmddata(cmddata);
 			// JLM Should call cmdfile_vault
                     }
@@ -3136,7 +3225,7 @@ file_taper_result(
 			    cmddata->working_pid = getppid();
 			    cmddata->status = CMD_TODO;
 			    cmddata->start_time = now + v->days * 60*60*24;
-			    amcatalog_add_cmd(cmddata);
+			    amcatalog_queue_add_cmd(cmddata);
 			    free_cmddata(cmddata);
 			    // JLM Should call cmdfile_vault
 			}
@@ -3238,10 +3327,19 @@ dumper_taper_result_finish(
 	sp->dump_attempted < dp->retry_dump &&
 	sp->taper_attempted < dp->retry_dump) {
 	char *wall_time = walltime_str(curclock());
-	sp->action = ACTION_DUMP_TO_TAPE;
-	enqueue_sched(&directq, sp);
 	qname = quote_string(dp->name); /*quote to take care of spaces*/
-	g_printf("driver: requeue dump_to_tape time %s %s %s %s %s\n", wall_time, sp->disk->host->hostname, qname, sp->datestamp, wtaper->taper->storage_name);
+	if (sp->idle_taper) {
+	    /* it was only sent to tape because a taper was idle */
+	    sp->idle_taper = 0;
+	    sp->prefered_taper = NULL;
+	    sp->action = ACTION_DUMP_TO_HOLDING;
+	    enqueue_sched(&runq, sp);
+	    g_printf("driver: requeue dump time %s %s %s %s\n", wall_time, sp->disk->host->hostname, qname, sp->datestamp);
+	} else {
+	    sp->action = ACTION_DUMP_TO_TAPE;
+	    enqueue_sched(&directq, sp);
+	    g_printf("driver: requeue dump_to_tape time %s %s %s %s %s\n", wall_time, sp->disk->host->hostname, qname, sp->datestamp, wtaper->taper->storage_name);
+	}
 	amfree(qname);
     }
 
@@ -3278,7 +3376,7 @@ dumper_taper_result_finish(
 			cmddata->working_pid = getppid();
 			cmddata->status = CMD_TODO;
 			cmddata->start_time = now + v->days * 60*60*24;
-			amcatalog_add_cmd(cmddata);
+			amcatalog_queue_add_cmd(cmddata);
 			free_cmddata(cmddata);
 			// JLM Should call cmdfile_vault
 		    }
@@ -3463,7 +3561,7 @@ dumper_chunker_result_finish(
 
     size = holding_file_size(sp->destname, 0);
     h[activehd]->used = size - dummy;
-    h[activehd]->disk->allocated_dumpers--;
+    release_hd_writer(h[activehd]);
     adjust_diskspace(sp, DONE);
 
     if (dumper->result != RETRY) {
@@ -4028,8 +4126,8 @@ handle_chunker_result(
 		error(_("!h || activehd < 0"));
 		/*NOTREACHED*/
 	    }
-	    h[activehd]->disk->allocated_dumpers--;
 	    h[activehd]->used = h[activehd]->reserved;
+	    release_hd_writer(h[activehd]);
 	    if( h[++activehd] ) { /* There's still some allocated space left.
 				   * Tell the dumper about it. */
 		sp->activehd++;
@@ -5021,16 +5119,14 @@ network_free_kps(
 
 static void
 interface_state(
-    char *time_str)
+    GString *state)
 {
     netif_t *ip;
 
-    g_printf(_("driver: interface-state time %s"), time_str);
-
     for(ip = disklist_netifs(); ip != NULL; ip = ip->next) {
-	g_printf(_(" if %s: free %lu"), interface_name(ip->config), network_free_kps(ip));
+	g_string_append_printf(state, _(" if %s: free %lu"),
+			       interface_name(ip->config), network_free_kps(ip));
     }
-    g_printf("\n");
 }
 
 static void
@@ -5068,11 +5164,46 @@ holding_free_space(void)
 }
 
 /*
- * We return an array of pointers to assignedhd_t. The array contains at
- * most one entry per holding disk. The list of pointers is terminated by
- * a NULL pointer. Each entry contains a pointer to a holdingdisk and
- * how much diskspace to use on that disk. Later on, assign_holdingdisk
- * will allocate the given amount of space.
+ * A chunker stopped writing to a holding disk; account for the data it
+ * wrote so that find_diskspace can tell fast holding disks from slow ones.
+ */
+static void
+release_hd_writer(
+    assignedhd_t *h)
+{
+    double elapsed;
+
+    h->disk->allocated_dumpers--;
+    if (h->start_time < 0.0)
+	return;
+    elapsed = g_timeval_to_double(curclock()) - h->start_time;
+    /* a short write says more about the page cache than about the disk */
+    if (elapsed >= HOLDALLOC_MIN_SAMPLE && h->used > (off_t)0) {
+	h->disk->written += h->used;
+	h->disk->write_time += elapsed;
+    }
+    h->start_time = -1.0;
+}
+
+/* observed write rate of a holding disk in KB/s, 0 if not known yet */
+static double
+holdalloc_kps(
+    holdalloc_t *ha)
+{
+    if (ha->write_time <= 0.0)
+	return 0.0;
+    return (double)ha->written / ha->write_time;
+}
+
+/*
+ * We return an array of pointers to assignedhd_t. The list of pointers is
+ * terminated by a NULL pointer. Each entry contains a pointer to a
+ * holdingdisk and how much diskspace to use on that disk. Later on,
+ * assign_holdingdisk will allocate the given amount of space.
+ * Without holding-stripe, the array contains at most one entry per holding
+ * disk.  With holding-stripe, each entry is at most one chunksize and the
+ * entries go round-robin over the holding disks, so that the chunk files
+ * of a large dump are spread over all of them.
  * If there is not enough room on the holdingdisks, NULL is returned.
  */
 
@@ -5083,11 +5214,14 @@ find_diskspace(
     assignedhd_t *	pref)
 {
     assignedhd_t **result = NULL;
-    holdalloc_t *ha, *minp;
+    holdalloc_t *ha, *minp, *lastp = NULL;
     int i=0;
     int j, minj;
-    char *used;
-    off_t halloc, dalloc, hfree, dfree;
+    int nresult;
+    int *used;
+    off_t *talloc;
+    off_t halloc, dalloc, hfree, dfree, chunksize;
+    gboolean stripe = getconf_boolean(CNF_HOLDING_STRIPE);
 
     (void)cur_idle;	/* Quiet unused parameter warning */
 
@@ -5103,29 +5237,44 @@ find_diskspace(
     hold_debug(1, _("find_diskspace: want %lld K\n"),
 		   (long long)size);
 
-    used = g_malloc(sizeof(*used) * num_holdalloc);/*disks used during this run*/
-    memset( used, 0, (size_t)num_holdalloc );
-    result = g_malloc(sizeof(assignedhd_t *) * (num_holdalloc + 1));
+    /* number of times each disk was used during this run */
+    used = g_new0(int, num_holdalloc);
+    /* space allocated on each disk during this run */
+    talloc = g_new0(off_t, num_holdalloc);
+    nresult = num_holdalloc;
+    result = g_malloc(sizeof(assignedhd_t *) * (nresult + 1));
     result[0] = NULL;
 
-    while( i < num_holdalloc && size > (off_t)0 ) {
-	/* find the holdingdisk with the fewest active dumpers and among
-	 * those the one with the biggest free space
+    /* the preferred disk is only used to continue on the same disk */
+    if (stripe)
+	pref = NULL;
+
+    while( size > (off_t)0 ) {
+	/* find the holdingdisk used the fewest times in this run, then with
+	 * the fewest active dumpers, then the fastest one, and among those
+	 * the one with the biggest free space
 	 */
 	minp = NULL; minj = -1;
 	for(j = 0, ha = holdalloc; ha != NULL; ha = ha->next, j++ ) {
+	    off_t allocated = ha->allocated_space + talloc[j];
+
+	    if (used[j] && !stripe)
+		continue;
 	    if( pref && pref->disk == ha && !used[j] &&
-		ha->allocated_space <= ha->disksize - (off_t)DISK_BLOCK_KB) {
+		allocated <= ha->disksize - (off_t)DISK_BLOCK_KB) {
 		minp = ha;
 		minj = j;
 		break;
 	    }
-	    else if( ha->allocated_space <= ha->disksize - (off_t)(2*DISK_BLOCK_KB) &&
-		!used[j] &&
+	    else if( allocated <= ha->disksize - (off_t)(2*DISK_BLOCK_KB) &&
 		(!minp ||
-		 ha->allocated_dumpers < minp->allocated_dumpers ||
-		 (ha->allocated_dumpers == minp->allocated_dumpers &&
-		  ha->disksize-ha->allocated_space > minp->disksize-minp->allocated_space)) ) {
+		 used[j] < used[minj] ||
+		 (used[j] == used[minj] &&
+		  (ha->allocated_dumpers < minp->allocated_dumpers ||
+		   (ha->allocated_dumpers == minp->allocated_dumpers &&
+		    (holdalloc_kps(ha) > holdalloc_kps(minp) ||
+		     (holdalloc_kps(ha) == holdalloc_kps(minp) &&
+		      ha->disksize-allocated > minp->disksize-minp->allocated_space-talloc[minj]))))))) {
 		minp = ha;
 		minj = j;
 	    }
@@ -5133,19 +5282,22 @@ find_diskspace(
 
 	pref = NULL;
 	if( !minp ) { break; } /* all holding disks are full */
-	used[minj] = 1;
+	used[minj]++;
+	chunksize = holdingdisk_get_chunksize(minp->hdisk);
 
 	/* hfree = free space on the disk */
-	hfree = minp->disksize - minp->allocated_space;
+	hfree = minp->disksize - minp->allocated_space - talloc[minj];
 
 	/* dfree = free space for data, remove 1 header for each chunksize */
-	dfree = hfree - (((hfree-(off_t)1)/holdingdisk_get_chunksize(minp->hdisk))+(off_t)1) * (off_t)DISK_BLOCK_KB;
+	dfree = hfree - (((hfree-(off_t)1)/chunksize)+(off_t)1) * (off_t)DISK_BLOCK_KB;
 
 	/* dalloc = space I can allocate for data */
 	dalloc = ( dfree < size ) ? dfree : size;
+	if (stripe && dalloc > chunksize - (off_t)DISK_BLOCK_KB)
+	    dalloc = chunksize - (off_t)DISK_BLOCK_KB;
 
 	/* halloc = space to allocate, including 1 header for each chunksize */
-	halloc = dalloc + (((dalloc-(off_t)1)/holdingdisk_get_chunksize(minp->hdisk))+(off_t)1) * (off_t)DISK_BLOCK_KB;
+	halloc = dalloc + (((dalloc-(off_t)1)/chunksize)+(off_t)1) * (off_t)DISK_BLOCK_KB;
 
 	hold_debug(1, _("find_diskspace: find diskspace: size %lld hf %lld df %lld da %lld ha %lld\n"),
 		       (long long)size,
@@ -5154,17 +5306,32 @@ find_diskspace(
 		       (long long)dalloc,
 		       (long long)halloc);
 	size -= dalloc;
+	talloc[minj] += halloc;
+
+	if (minp == lastp) {
+	    /* only one disk with free space, keep writing to it */
+	    result[i-1]->reserved += halloc;
+	    continue;
+	}
+	lastp = minp;
+
+	if (i == nresult) {
+	    nresult *= 2;
+	    result = g_renew(assignedhd_t *, result, nresult + 1);
+	}
 	result[i] = g_malloc(sizeof(assignedhd_t));
 	result[i]->disk = minp;
 	result[i]->reserved = halloc;
 	result[i]->used = (off_t)0;
 	result[i]->destname = NULL;
+	result[i]->start_time = -1.0;
 	result[i+1] = NULL;
 	i++;
     }
     amfree(used);
+    amfree(talloc);
 
-    if(size != (off_t)0) { /* not enough space available */
+    if(size > (off_t)0) { /* not enough space available */
 	g_printf(_("find diskspace: not enough diskspace. Left with %lld K\n"), (long long)size);
 	fflush(stdout);
 	free_assignedhd(result);
@@ -5173,12 +5340,13 @@ find_diskspace(
 
     if (debug_holding > 1) {
 	for( i = 0; result && result[i]; i++ ) {
-	    hold_debug(1, _("find_diskspace: find diskspace: selected %s free %lld reserved %lld dumpers %d\n"),
+	    hold_debug(1, _("find_diskspace: find diskspace: selected %s free %lld reserved %lld dumpers %d kps %.0f\n"),
 			   holdingdisk_get_diskdir(result[i]->disk->hdisk),
 			   (long long)(result[i]->disk->disksize -
 			     result[i]->disk->allocated_space),
 			   (long long)result[i]->reserved,
-			   result[i]->disk->allocated_dumpers);
+			   result[i]->disk->allocated_dumpers,
+			   holdalloc_kps(result[i]->disk));
 	}
     }
 
@@ -5438,6 +5606,7 @@ build_diskspace(
 	    result[i]->reserved = used[j];
 	    result[i]->used = used[j];
 	    result[i]->destname = g_strdup(destname);
+	    result[i]->start_time = -1.0;
 	    result[i+1] = NULL;
 	    i++;
 	}
@@ -5449,20 +5618,17 @@ build_diskspace(
 
 static void
 holdingdisk_state(
-    char *	time_str)
+    GString *	state)
 {
     holdalloc_t *ha;
     int dsk;
     off_t diff;
 
-    g_printf(_("driver: hdisk-state time %s"), time_str);
-
     for(ha = holdalloc, dsk = 0; ha != NULL; ha = ha->next, dsk++) {
 	diff = ha->disksize - ha->allocated_space;
-	g_printf(_(" hdisk %d: free %lld dumpers %d"), dsk,
-	       (long long)diff, ha->allocated_dumpers);
+	g_string_append_printf(state, _(" hdisk %d: free %lld dumpers %d kps %.0f"), dsk,
+	       (long long)diff, ha->allocated_dumpers, holdalloc_kps(ha));
     }
-    g_printf("\n");
 }
 
 static void
@@ -5493,14 +5659,23 @@ queue_length(
 static void
 short_dump_state(void)
 {
+    static char    *last_state = NULL;
+    static times_t  last_time;
+    GString *state, *if_state, *hdisk_state;
+    char    *key;
+    times_t  now;
     int      i, nidle;
     char    *wall_time;
     taper_t *taper;
 
-    wall_time = walltime_str(curclock());
-
-    g_printf(_("driver: state time %s "), wall_time);
-    g_printf(_("free kps: %lu space: %lld taper: "),
+    /* The driver calls this after nearly every event, and on a large run the
+     * state lines make up most of the amdump log that amstatus has to read.
+     * Only print the state when it changed, or periodically so that the
+     * time keeps moving. */
+    state = g_string_new(NULL);
+    if_state = g_string_new(NULL);
+    hdisk_state = g_string_new(NULL);
+    g_string_append_printf(state, _("free kps: %lu space: %lld taper: "),
 	   network_free_kps(NULL),
 	   (long long)holding_free_space());
     {
@@ -5523,16 +5698,16 @@ short_dump_state(void)
 	    }
 	}
 	if (down)
-	    g_printf(_("down"));
+	    g_string_append(state, _("down"));
 	else if (writing)
-	    g_printf(_("writing"));
+	    g_string_append(state, _("writing"));
 	else
-	    g_printf(_("idle"));
+	    g_string_append(state, _("idle"));
     }
     nidle = 0;
     for(i = 0; i < inparallel; i++) if(!dmptable[i].busy) nidle++;
-    g_printf(_(" idle-dumpers: %d"), nidle);
-    g_printf(" qlen");
+    g_string_append_printf(state, _(" idle-dumpers: %d"), nidle);
+    g_string_append(state, " qlen");
     for (taper = tapetable; taper < tapetable+nb_storage ; taper++) {
 	if (taper->storage_name) {
 	    wtaper_t *wtaper;
@@ -5546,17 +5721,36 @@ short_dump_state(void)
 		 wtaper++) {
 		nb_vault += queue_length(&wtaper->vaultqs.vaultq);
 	    }
-	    g_printf(_(" tapeq %s: %d:%d"), taper->name, queue_length(&taper->tapeq), nb_vault);
+	    g_string_append_printf(state, _(" tapeq %s: %d:%d"), taper->name, queue_length(&taper->tapeq), nb_vault);
 	}
     }
-    g_printf(_(" runq: %d"), queue_length(&runq));
-    g_printf(_(" directq: %d"), queue_length(&directq));
-    g_printf(_(" roomq: %d"), queue_length(&roomq));
-    g_printf(_(" wakeup: %d"), (int)sleep_time);
-    g_printf(_(" driver-idle: %s\n"), _(idle_strings[idle_reason]));
-    interface_state(wall_time);
-    holdingdisk_state(wall_time);
-    fflush(stdout);
+    g_string_append_printf(state, _(" runq: %d"), queue_length(&runq));
+    g_string_append_printf(state, _(" directq: %d"), queue_length(&directq));
+    g_string_append_printf(state, _(" roomq: %d"), queue_length(&roomq));
+    g_string_append_printf(state, _(" wakeup: %d"), (int)sleep_time);
+    g_string_append_printf(state, _(" driver-idle: %s"), _(idle_strings[idle_reason]));
+    interface_state(if_state);
+    holdingdisk_state(hdisk_state);
+
+    key = g_strconcat(state->str, if_state->str, hdisk_state->str, NULL);
+    now = curclock();
+    if (last_state && g_str_equal(key, last_state) &&
+	timesub(now, last_time).tv_sec < STATE_INTERVAL) {
+	g_free(key);
+    } else {
+	wall_time = walltime_str(now);
+	g_printf(_("driver: state time %s %s\n"), wall_time, state->str);
+	g_printf(_("driver: interface-state time %s%s\n"), wall_time, if_state->str);
+	g_printf(_("driver: hdisk-state time %s%s\n"), wall_time, hdisk_state->str);
+	fflush(stdout);
+
+	g_free(last_state);
+	last_state = key;
+	last_time = now;
+    }
+    g_string_free(state, TRUE);
+    g_string_free(if_state, TRUE);
+    g_string_free(hdisk_state, TRUE);
 }
 
 static TapeAction
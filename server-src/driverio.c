@@ -1007,6 +1007,7 @@ chunker_cmd(
 	    qname = quote_string(dp->name);
 	    qdest = quote_string(sp->destname);
 	    h[activehd]->disk->allocated_dumpers++;
+	    h[activehd]->start_time = g_timeval_to_double(curclock());
 	    g_snprintf(number, sizeof(number), "%d", sp->level);
 	    g_snprintf(chunksize, sizeof(chunksize), "%lld",
 		    (long long)holdingdisk_get_chunksize(h[0]->disk->hdisk));
@@ -1048,6 +1049,7 @@ chunker_cmd(
 	    qname = quote_string(dp->name);
 	    qdest = quote_string(h[activehd]->destname);
 	    h[activehd]->disk->allocated_dumpers++;
+	    h[activehd]->start_time = g_timeval_to_double(curclock());
 	    g_snprintf(chunksize, sizeof(chunksize), "%lld",
 		     (long long)holdingdisk_get_chunksize(h[activehd]->disk->hdisk));
 	    g_snprintf(use, sizeof(use), "%lld",
@@ -89,6 +89,8 @@ typedef struct holdalloc_s {
     off_t disksize;
     int allocated_dumpers;
     off_t allocated_space;
+    off_t written;		/* KB written by completed writers */
+    double write_time;		/* seconds those writers took */
 } holdalloc_t;
 
 typedef struct assignedhd_s {
@@ -96,6 +98,8 @@ typedef struct assignedhd_s {
     off_t		used;
     off_t		reserved;
     char		*destname;
+    double		start_time;	/* curclock() when the chunker started
+					 * on it, < 0 if it is not writing */
 } assignedhd_t;
 
 
@@ -232,6 +236,7 @@ typedef struct sched_s {
     int   src_fileno;
     char *try_again_message;
     taper_t *prefered_taper;
+    int idle_taper;				/* sent to tape by dump-to-idle-taper */
 } sched_t;
 
 /* command/result tokens */
@@ -31,6 +31,7 @@
  */
 #include "amanda.h"
 #include "amindex.h"
+#include "indexsort.h"
 #include "clock.h"
 #include "conffile.h"
 #include "event.h"
@@ -142,6 +143,9 @@ static char *based_on_timestamp = NULL;
 static char *dumper_timestamp = NULL;
 static time_t conf_dtimeout;
 static int indexfderror;
+static indexsort_t *index_sort = NULL;
+static GThread *index_sort_thread = NULL;
+static int index_sort_fd = -1;
 static int set_datafd;
 static char *dle_str = NULL;
 static cmd_t chunker_taper_result = BOGUS;
@@ -252,6 +256,7 @@ static int	startup_dump(const char *, const char *, const char *, int,
 static void	stop_dump(void);
 
 static void	read_indexfd(void *, void *, ssize_t);
+static gpointer	index_sort_write_thread(gpointer);
 static void	read_datafd(void *, void *, ssize_t);
 static void	read_statefd(void *, void *, ssize_t);
 static void	read_mesgfd(void *, void *, ssize_t);
@@ -1692,10 +1697,20 @@ do_dump(
 						COMPRESS_SUFFIX);
 
     if (streams[INDEXFD].fd != NULL) {
+	gboolean sort_index = getconf_boolean(CNF_SORT_INDEX);
+
+	/* with sort-index, the index is sorted as it arrives, so amtrmidx
+	 * and amindexd have nothing left to do */
 	if (getconf_boolean(CNF_COMPRESS_INDEX)) {
-	    indexfile_real = getindex_unsorted_gz_fname(hostname, diskname, dumper_timestamp, level);
+	    if (sort_index)
+		indexfile_real = getindex_sorted_gz_fname(hostname, diskname, dumper_timestamp, level);
+	    else
+		indexfile_real = getindex_unsorted_gz_fname(hostname, diskname, dumper_timestamp, level);
 	} else {
-	    indexfile_real = getindex_unsorted_fname(hostname, diskname, dumper_timestamp, level);
+	    if (sort_index)
+		indexfile_real = getindex_sorted_fname(hostname, diskname, dumper_timestamp, level);
+	    else
+		indexfile_real = getindex_unsorted_fname(hostname, diskname, dumper_timestamp, level);
 	}
 	indexfile_tmp = g_strconcat(indexfile_real, ".tmp", NULL);
 
@@ -1720,6 +1735,9 @@ do_dump(
 	    }
 	}
 	indexfderror = 0;
+	if (sort_index) {
+	    index_sort = indexsort_new(getconf_str(CNF_TMPDIR), 0);
+	}
 	/*
 	 * Schedule the indexfd for relaying to the index file
 	 */
@@ -1827,6 +1845,20 @@ do_dump(
 	shm_thread_cond  = NULL;
     }
 
+    if (index_sort_thread) {
+	if (!GPOINTER_TO_INT(g_thread_join(index_sort_thread)) &&
+	    indexfderror == 0) {
+	    indexfderror = 1;
+	    log_add(L_INFO, _("Index corrupted for %s:%s"), hostname, qdiskname);
+	}
+	index_sort_thread = NULL;
+    }
+
+    if (index_sort) {
+	indexsort_free(index_sort);
+	index_sort = NULL;
+    }
+
     if (ISSET(status, GOT_RETRY)) {
 	if (indexfile_tmp) {
 	    unlink(indexfile_tmp);
@@ -2002,6 +2034,10 @@ failed:
 	amfree(indexfile_tmp);
 	amfree(indexfile_real);
     }
+    if (index_sort) {
+	indexsort_free(index_sort);
+	index_sort = NULL;
+    }
 
     amfree(errstr);
 
@@ -2834,6 +2870,20 @@ read_cmdfd(
 /*
  * Callback for reads on the index stream
  */
+/*
+ * Write the sorted index to index_sort_fd, then close it so the compress
+ * process sees EOF.
+ */
+static gpointer
+index_sort_write_thread(
+    gpointer data G_GNUC_UNUSED)
+{
+    gboolean ok = indexsort_write(index_sort, index_sort_fd);
+
+    aclose(index_sort_fd);
+    return GINT_TO_POINTER(ok);
+}
+
 static void
 read_indexfd(
     void *	cookie,
@@ -2868,6 +2918,17 @@ read_indexfd(
      * EOF.  Stop and return.
      */
     if (size == 0) {
+	/*
+	 * The merge can take a while for a large index, write the sorted
+	 * index in a thread so the other streams are still served.  The
+	 * thread owns indexout from now on, do_dump joins it.
+	 */
+	if (index_sort && fd >= 0) {
+	    index_sort_fd = indexout;
+	    indexout = -1;
+	    index_sort_thread = g_thread_create(index_sort_write_thread,
+						NULL, TRUE, NULL);
+	}
 	if (shm_thread) {
 	    g_mutex_lock(shm_thread_mutex);
 	}
@@ -2923,7 +2984,12 @@ read_indexfd(
     /*
      * We ignore error while writing to the index file.
      */
-    if (full_write(fd, buf, (size_t)size) < (size_t)size) {
+    if (index_sort) {
+	if (!indexsort_add(index_sort, buf, (gsize)size) && indexfderror == 0) {
+	    indexfderror = 1;
+	    log_add(L_INFO, _("Index corrupted for %s:%s"), hostname, qdiskname);
+	}
+    } else if (full_write(fd, buf, (size_t)size) < (size_t)size) {
 	/* Ignore error, but schedule another read. */
 	if(indexfderror == 0) {
 	    indexfderror = 1;
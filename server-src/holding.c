@@ -63,6 +63,16 @@ static int is_emptyfile(char *fname);
  */
 static int is_datestr(char *fname);
 
+/* Is fname the manifest of a holding file that exists, complete or not?
+ *
+ * @param fname: filename (fully qualified)
+ * @returns: boolean
+ */
+static int is_manifest_of_existing_file(char *fname);
+
+#define MANIFEST_SUFFIX ".manifest"
+#define MANIFEST_MAGIC "AMANDA: HOLDING MANIFEST 1"
+
 gboolean take_holding_pid(char *diskdir, int pid);
 static int can_take_holding(char *pid_file, int remove);
 /*
@@ -138,6 +148,27 @@ is_datestr(
     return 1;
 }
 
+static int
+is_manifest_of_existing_file(
+    char *fname)
+{
+    char *hfile;
+    char *hfile_tmp;
+    struct stat statbuf;
+    int result;
+
+    if (!g_str_has_suffix(fname, MANIFEST_SUFFIX))
+	return 0;
+
+    hfile = g_strndup(fname, strlen(fname) - strlen(MANIFEST_SUFFIX));
+    hfile_tmp = g_strconcat(hfile, ".tmp", NULL);
+    result = stat(hfile, &statbuf) == 0 || stat(hfile_tmp, &statbuf) == 0;
+    g_free(hfile);
+    g_free(hfile_tmp);
+
+    return result;
+}
+
 /*
  * Recursion functions
  *
@@ -262,6 +293,10 @@ static void holding_walk_dir(
         g_free(hfile);
         hfile = g_strconcat(hdir, "/", workdir->d_name, NULL);
 
+        /* a manifest goes with its holding file; without one, it's cruft */
+        if (is_manifest_of_existing_file(hfile))
+            continue;
+
         /* filter out various undesirables */
         if (is_emptyfile(hfile))
             is_cruft = 1;
@@ -540,10 +575,25 @@ GSList *
 holding_get_file_chunks(char *hfile)
 {
     holding_get_datap_t data;
+    GSList *manifest;
+    GSList *chunk;
+
     data.result = NULL;
     data.fullpaths = 1;
     data.take_pid_lock = 0;
 
+    manifest = holding_manifest_read(hfile);
+    if (manifest) {
+	for (chunk = manifest; chunk != NULL; chunk = chunk->next) {
+	    holding_chunk_t *hc = (holding_chunk_t *)chunk->data;
+	    data.result = g_slist_insert_sorted(data.result,
+		    g_strdup(hc->filename),
+		    g_compare_strings);
+	}
+	holding_manifest_free(manifest);
+	return data.result;
+    }
+
     holding_walk_file(hfile, (gpointer)&data,
 	holding_get_walk_fn);
 
@@ -638,6 +688,21 @@ holding_file_size(
     char *filename;
     off_t size = (off_t)0;
     struct stat finfo;
+    GSList *manifest;
+    GSList *chunk;
+
+    /* the manifest has the sizes, checked against the chunks */
+    manifest = holding_manifest_read(hfile);
+    if (manifest) {
+	for (chunk = manifest; chunk != NULL; chunk = chunk->next) {
+	    holding_chunk_t *hc = (holding_chunk_t *)chunk->data;
+	    size += (hc->size + DISK_BLOCK_BYTES + (off_t)1023)/(off_t)1024;
+	    if (strip_headers)
+		size -= (off_t)(DISK_BLOCK_BYTES / 1024);
+	}
+	holding_manifest_free(manifest);
+	return size;
+    }
 
     /* (note: we don't use holding_get_file_chunks here because that would
      * entail opening each file twice) */
@@ -681,6 +746,21 @@ holding_file_size_bytes(
     char *filename;
     off_t size = (off_t)0;
     struct stat finfo;
+    GSList *manifest;
+    GSList *chunk;
+
+    /* the manifest has the sizes, checked against the chunks */
+    manifest = holding_manifest_read(hfile);
+    if (manifest) {
+	for (chunk = manifest; chunk != NULL; chunk = chunk->next) {
+	    holding_chunk_t *hc = (holding_chunk_t *)chunk->data;
+	    size += hc->size;
+	    if (!strip_headers)
+		size += (off_t)DISK_BLOCK_BYTES;
+	}
+	holding_manifest_free(manifest);
+	return size;
+    }
 
     /* (note: we don't use holding_get_file_chunks here because that would
      * entail opening each file twice) */
@@ -721,11 +801,19 @@ holding_file_unlink(
 {
     GSList *chunklist;
     GSList *chunk;
+    char *manifest;
 
     chunklist = holding_get_file_chunks(hfile);
     if (!chunklist)
         return 0;
 
+    manifest = holding_manifest_filename(hfile);
+    if (unlink(manifest) < 0 && errno != ENOENT) {
+	dbprintf(_("holding_file_unlink: could not unlink %s: %s\n"),
+		 manifest, strerror(errno));
+    }
+    g_free(manifest);
+
     for (chunk = chunklist; chunk != NULL; chunk = chunk->next) {
         if (unlink((char *)chunk->data)<0) {
 	    dbprintf(_("holding_file_unlink: could not unlink %s: %s\n"),
@@ -763,6 +851,144 @@ holding_file_get_dumpfile(
     return 1;
 }
 
+/*
+ * Manifest
+ *
+ * The manifest is a text file:
+ *
+ *   AMANDA: HOLDING MANIFEST 1
+ *   CHUNK <data size> <crc32 in hex> <filename>
+ *   ...
+ *   END <number of chunks>
+ *
+ * The END line tells a complete manifest from a truncated one.
+ */
+
+char *
+holding_manifest_filename(
+    char *holding_file)
+{
+    return g_strconcat(holding_file, MANIFEST_SUFFIX, NULL);
+}
+
+int
+holding_manifest_write(
+    char *holding_file,
+    GSList *chunks)
+{
+    char *filename = holding_manifest_filename(holding_file);
+    FILE *manifest;
+    GSList *chunk;
+    int nchunks = 0;
+
+    if ((manifest = fopen(filename, "w")) == NULL) {
+	dbprintf(_("holding_manifest_write: could not open %s: %s\n"),
+		 filename, strerror(errno));
+	g_free(filename);
+	return 0;
+    }
+
+    g_fprintf(manifest, "%s\n", MANIFEST_MAGIC);
+    for (chunk = chunks; chunk != NULL; chunk = chunk->next) {
+	holding_chunk_t *hc = (holding_chunk_t *)chunk->data;
+	g_fprintf(manifest, "CHUNK %lld %08x %s\n",
+		  (long long)hc->size, hc->crc, hc->filename);
+	nchunks++;
+    }
+    g_fprintf(manifest, "END %d\n", nchunks);
+
+    if (ferror(manifest) || fclose(manifest) != 0) {
+	dbprintf(_("holding_manifest_write: could not write %s: %s\n"),
+		 filename, strerror(errno));
+	unlink(filename);
+	g_free(filename);
+	return 0;
+    }
+
+    g_free(filename);
+    return 1;
+}
+
+GSList *
+holding_manifest_read(
+    char *holding_file)
+{
+    char *filename = holding_manifest_filename(holding_file);
+    FILE *manifest;
+    GSList *chunks = NULL;
+    char *line;
+    int nchunks = 0;
+    gboolean complete = FALSE;
+    gboolean valid = TRUE;
+
+    if ((manifest = fopen(filename, "r")) == NULL) {
+	g_free(filename);
+	return NULL;
+    }
+
+    line = agets(manifest);
+    if (!line || !g_str_equal(line, MANIFEST_MAGIC))
+	valid = FALSE;
+    amfree(line);
+
+    while (valid && !complete && (line = agets(manifest)) != NULL) {
+	long long size;
+	unsigned int crc;
+	int n;
+	int pos = 0;
+
+	if (sscanf(line, "CHUNK %lld %x %n", &size, &crc, &pos) == 2 &&
+	    pos > 0 && line[pos] != '\0') {
+	    holding_chunk_t *hc = g_new0(holding_chunk_t, 1);
+	    struct stat finfo;
+
+	    hc->filename = g_strdup(line + pos);
+	    hc->size = (off_t)size;
+	    hc->crc = crc;
+	    chunks = g_slist_prepend(chunks, hc);
+	    nchunks++;
+
+	    /* the chunk must still be what was written */
+	    if (stat(hc->filename, &finfo) == -1 ||
+		finfo.st_size != hc->size + DISK_BLOCK_BYTES) {
+		dbprintf(_("holding_manifest_read: %s does not match %s\n"),
+			 filename, hc->filename);
+		valid = FALSE;
+	    }
+	} else if (sscanf(line, "END %d", &n) == 1 && n == nchunks) {
+	    complete = TRUE;
+	} else {
+	    valid = FALSE;
+	}
+	amfree(line);
+    }
+    fclose(manifest);
+
+    chunks = g_slist_reverse(chunks);
+    if (!valid || !complete || !chunks ||
+	!g_str_equal(((holding_chunk_t *)chunks->data)->filename, holding_file)) {
+	holding_manifest_free(chunks);
+	chunks = NULL;
+    }
+
+    g_free(filename);
+    return chunks;
+}
+
+void
+holding_manifest_free(
+    GSList *chunks)
+{
+    GSList *chunk;
+
+    for (chunk = chunks; chunk != NULL; chunk = chunk->next) {
+	holding_chunk_t *hc = (holding_chunk_t *)chunk->data;
+	g_free(hc->filename);
+	g_free(hc);
+    }
+    g_slist_free(chunks);
+}
+
 /*
  * Cleanup
  */
@@ -141,6 +141,57 @@ int
 holding_file_get_dumpfile(char *fname,
                           dumpfile_t *file);
 
+/*
+ * Manifest
+ *
+ * When a holding file is complete, a manifest named after it with a
+ * '.manifest' suffix lists all its chunks, so that they can be found and
+ * read ahead without opening each one in turn to find the next.  A
+ * manifest is only used if it matches the chunks on disk; callers fall
+ * back to following cont_filename otherwise.
+ */
+
+typedef struct holding_chunk_s {
+    char   *filename;	/* full pathname of the chunk */
+    off_t   size;	/* bytes of data, without the header */
+    guint32 crc;	/* crc32 of the data */
+} holding_chunk_t;
+
+/* Get the name of the manifest of a holding file.
+ *
+ * @param holding_file: full pathname of holding file
+ * @returns: newly allocated pathname
+ */
+char *
+holding_manifest_filename(char *holding_file);
+
+/* Write the manifest of a holding file.
+ *
+ * @param holding_file: full pathname of holding file
+ * @param chunks: GSList of holding_chunk_t, in order
+ * @returns: 1 on success, else 0
+ */
+int
+holding_manifest_write(char *holding_file,
+                       GSList *chunks);
+
+/* Read the manifest of a holding file, and check that the size of each
+ * chunk matches it.
+ *
+ * @param holding_file: full pathname of holding file
+ * @returns: newly allocated GSList of holding_chunk_t, or NULL if there is
+ * no usable manifest
+ */
+GSList *
+holding_manifest_read(char *holding_file);
+
+/* Free a list returned by holding_manifest_read.
+ *
+ * @param chunks: GSList of holding_chunk_t
+ */
+void
+holding_manifest_free(GSList *chunks);
+
 /*
  * Maintenance
  */
@@ -0,0 +1,588 @@
+/*
+ * Amanda, The Advanced Maryland Automatic Network Disk Archiver
+ * Copyright (c) 2013-2016 Carbonite, Inc.  All Rights Reserved.
+ * All Rights Reserved.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of U.M. not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  U.M. makes no representations about the
+ * suitability of this software for any purpose.  It is provided "as is"
+ * without express or implied warranty.
+ *
+ */
+/*
+ * in-process sort of index files
+ */
+
+#include "amanda.h"
+#include "amutil.h"
+#include "indexsort.h"
+
+/* lines are copied into blocks of this size */
+#define INDEXSORT_BLOCK_SIZE (1024*1024)
+
+/* at most this many runs are merged at once, to bound the open files */
+#define INDEXSORT_MAX_MERGE 64
+
+#define INDEXSORT_READ_SIZE (64*1024)
+
+struct indexsort_s {
+    char      *tmpdir;
+    gsize      max_memory;
+    gsize      memory;		/* used by blocks and lines */
+    GPtrArray *lines;		/* char *, pointing into the blocks */
+    GSList    *blocks;
+    char      *block;		/* the block being filled */
+    gsize      block_used;
+    gsize      block_size;
+    GString   *partial;		/* the last line, until its newline */
+    GPtrArray *runs;		/* FILE * of the sorted temporary files */
+    char      *errmsg;
+};
+
+typedef struct indexsort_run_s {
+    FILE    *stream;
+    GString *line;
+} indexsort_run_t;
+
+static void
+set_error(
+    indexsort_t *isort,
+    const char  *fmt,
+    ...)
+{
+    va_list argp;
+
+    if (isort->errmsg)
+	return;
+
+    va_start(argp, fmt);
+    isort->errmsg = g_strdup_vprintf(fmt, argp);
+    va_end(argp);
+    g_debug("indexsort: %s", isort->errmsg);
+}
+
+static void
+store_line(
+    indexsort_t *isort,
+    const char  *line,
+    gsize        len)
+{
+    char *p;
+
+    if (len + 1 > isort->block_size - isort->block_used) {
+	isort->block_size = MAX(INDEXSORT_BLOCK_SIZE, len + 1);
+	isort->block = g_malloc(isort->block_size);
+	isort->block_used = 0;
+	isort->blocks = g_slist_prepend(isort->blocks, isort->block);
+	isort->memory += isort->block_size;
+    }
+
+    p = isort->block + isort->block_used;
+    memcpy(p, line, len);
+    p[len] = '\0';
+    isort->block_used += len + 1;
+    g_ptr_array_add(isort->lines, p);
+    isort->memory += sizeof(char *);
+}
+
+static void
+free_lines(
+    indexsort_t *isort)
+{
+    slist_free_full(isort->blocks, g_free);
+    isort->blocks = NULL;
+    isort->block = NULL;
+    isort->block_used = 0;
+    isort->block_size = 0;
+    g_ptr_array_set_size(isort->lines, 0);
+    isort->memory = 0;
+}
+
+static gint
+compare_lines(
+    gconstpointer a,
+    gconstpointer b)
+{
+    return strcmp(*(char **)a, *(char **)b);
+}
+
+static void
+write_lines(
+    indexsort_t *isort,
+    FILE        *out)
+{
+    guint i;
+
+    g_ptr_array_sort(isort->lines, compare_lines);
+    for (i = 0; i < isort->lines->len; i++) {
+	fputs(g_ptr_array_index(isort->lines, i), out);
+	putc('\n', out);
+    }
+}
+
+static FILE *
+open_temp(
+    indexsort_t *isort)
+{
+    char *filename;
+    FILE *stream;
+    int   fd;
+
+    filename = g_strdup_printf("%s/amindexsort.XXXXXX", isort->tmpdir);
+    fd = g_mkstemp(filename);
+    if (fd < 0) {
+	set_error(isort, _("Can't create temporary file '%s': %s"),
+		  filename, strerror(errno));
+	g_free(filename);
+	return NULL;
+    }
+    /* nothing to clean up if we die */
+    unlink(filename);
+
+    stream = fdopen(fd, "w+");
+    if (!stream) {
+	set_error(isort, _("Can't fdopen temporary file '%s': %s"),
+		  filename, strerror(errno));
+	close(fd);
+    }
+    g_free(filename);
+    return stream;
+}
+
+/* write the lines in memory, sorted, to a new run */
+static gboolean
+spill_lines(
+    indexsort_t *isort)
+{
+    FILE *stream;
+
+    if (isort->lines->len == 0)
+	return TRUE;
+
+    stream = open_temp(isort);
+    if (!stream)
+	return FALSE;
+
+    write_lines(isort, stream);
+    if (fflush(stream) != 0 || ferror(stream)) {
+	set_error(isort, _("Error writing temporary file: %s"),
+		  strerror(errno));
+	fclose(stream);
+	return FALSE;
+    }
+    g_ptr_array_add(isort->runs, stream);
+    free_lines(isort);
+
+    return TRUE;
+}
+
+static gboolean
+read_run_line(
+    indexsort_run_t *run)
+{
+    char buf[1024];
+
+    g_string_truncate(run->line, 0);
+    while (fgets(buf, sizeof(buf), run->stream) != NULL) {
+	g_string_append(run->line, buf);
+	if (run->line->len > 0 && run->line->str[run->line->len-1] == '\n') {
+	    g_string_truncate(run->line, run->line->len-1);
+	    return TRUE;
+	}
+    }
+
+    return run->line->len > 0;
+}
+
+static void
+sift_down(
+    indexsort_run_t **heap,
+    guint             n,
+    guint             i)
+{
+    for (;;) {
+	guint smallest = i;
+	guint c = 2*i + 1;
+	indexsort_run_t *tmp;
+
+	if (c < n && strcmp(heap[c]->line->str, heap[smallest]->line->str) < 0)
+	    smallest = c;
+	c++;
+	if (c < n && strcmp(heap[c]->line->str, heap[smallest]->line->str) < 0)
+	    smallest = c;
+	if (smallest == i)
+	    return;
+
+	tmp = heap[i];
+	heap[i] = heap[smallest];
+	heap[smallest] = tmp;
+	i = smallest;
+    }
+}
+
+/* merge nruns runs to out, and close them */
+static gboolean
+merge_runs(
+    indexsort_t *isort,
+    FILE       **streams,
+    guint        nruns,
+    FILE        *out)
+{
+    indexsort_run_t  *runs = g_new0(indexsort_run_t, nruns);
+    indexsort_run_t **heap = g_new0(indexsort_run_t *, nruns);
+    gboolean          rval = TRUE;
+    guint             n = 0;
+    guint             i;
+
+    for (i = 0; i < nruns; i++) {
+	runs[i].stream = streams[i];
+	runs[i].line = g_string_sized_new(256);
+	rewind(runs[i].stream);
+	if (read_run_line(&runs[i]))
+	    heap[n++] = &runs[i];
+    }
+    for (i = n / 2; i > 0; i--)
+	sift_down(heap, n, i - 1);
+
+    while (n > 0) {
+	fputs(heap[0]->line->str, out);
+	putc('\n', out);
+	if (!read_run_line(heap[0]))
+	    heap[0] = heap[--n];
+	sift_down(heap, n, 0);
+    }
+
+    for (i = 0; i < nruns; i++) {
+	if (ferror(runs[i].stream)) {
+	    set_error(isort, _("Error reading temporary file: %s"),
+		      strerror(errno));
+	    rval = FALSE;
+	}
+	fclose(runs[i].stream);
+	g_string_free(runs[i].line, TRUE);
+    }
+    g_free(heap);
+    g_free(runs);
+
+    return rval;
+}
+
+indexsort_t *
+indexsort_new(
+    const char *tmpdir,
+    gsize       max_memory)
+{
+    indexsort_t *isort = g_new0(indexsort_t, 1);
+
+    isort->tmpdir = g_strdup(tmpdir ? tmpdir : "/tmp");
+    isort->max_memory = max_memory ? max_memory : INDEXSORT_MAX_MEMORY;
+    isort->lines = g_ptr_array_new();
+    isort->partial = g_string_new(NULL);
+    isort->runs = g_ptr_array_new();
+
+    return isort;
+}
+
+gboolean
+indexsort_add(
+    indexsort_t *isort,
+    const char  *buf,
+    gsize        size)
+{
+    const char *p = buf;
+    const char *end = buf + size;
+    const char *nl;
+
+    if (isort->errmsg)
+	return FALSE;
+
+    while (p < end) {
+	nl = memchr(p, '\n', end - p);
+	if (!nl) {
+	    g_string_append_len(isort->partial, p, end - p);
+	    break;
+	}
+
+	if (isort->partial->len > 0) {
+	    g_string_append_len(isort->partial, p, nl - p);
+	    store_line(isort, isort->partial->str, isort->partial->len);
+	    g_string_truncate(isort->partial, 0);
+	} else {
+	    store_line(isort, p, nl - p);
+	}
+	p = nl + 1;
+
+	if (isort->memory >= isort->max_memory && !spill_lines(isort))
+	    return FALSE;
+    }
+
+    return TRUE;
+}
+
+gboolean
+indexsort_add_fd(
+    indexsort_t *isort,
+    int          fd)
+{
+    char    *buf = g_malloc(INDEXSORT_READ_SIZE);
+    ssize_t  size;
+    gboolean rval = TRUE;
+
+    while ((size = read(fd, buf, INDEXSORT_READ_SIZE)) != 0) {
+	if (size < 0) {
+	    if (errno == EINTR)
+		continue;
+	    set_error(isort, _("Error reading index: %s"), strerror(errno));
+	    rval = FALSE;
+	    break;
+	}
+	if (!indexsort_add(isort, buf, size)) {
+	    rval = FALSE;
+	    break;
+	}
+    }
+    g_free(buf);
+
+    return rval;
+}
+
+gboolean
+indexsort_write(
+    indexsort_t *isort,
+    int          fd)
+{
+    FILE    *out;
+    gboolean rval = TRUE;
+    int      out_fd;
+
+    if (isort->errmsg)
+	return FALSE;
+
+    /* a last line without a newline */
+    if (isort->partial->len > 0) {
+	store_line(isort, isort->partial->str, isort->partial->len);
+	g_string_truncate(isort->partial, 0);
+    }
+
+    /* merge the runs in groups until they can all be merged at once */
+    if (isort->runs->len > 0 && !spill_lines(isort))
+	return FALSE;
+    while (isort->runs->len > INDEXSORT_MAX_MERGE) {
+	FILE *stream = open_temp(isort);
+
+	if (!stream)
+	    return FALSE;
+	if (!merge_runs(isort, (FILE **)isort->runs->pdata,
+			INDEXSORT_MAX_MERGE, stream)) {
+	    g_ptr_array_remove_range(isort->runs, 0, INDEXSORT_MAX_MERGE);
+	    fclose(stream);
+	    return FALSE;
+	}
+	g_ptr_array_remove_range(isort->runs, 0, INDEXSORT_MAX_MERGE);
+	if (fflush(stream) != 0 || ferror(stream)) {
+	    set_error(isort, _("Error writing temporary file: %s"),
+		      strerror(errno));
+	    fclose(stream);
+	    return FALSE;
+	}
+	g_ptr_array_add(isort->runs, stream);
+    }
+
+    out_fd = dup(fd);
+    if (out_fd < 0 || (out = fdopen(out_fd, "w")) == NULL) {
+	set_error(isort, _("Can't open index output: %s"), strerror(errno));
+	if (out_fd >= 0)
+	    close(out_fd);
+	return FALSE;
+    }
+
+    if (isort->runs->len > 0) {
+	rval = merge_runs(isort, (FILE **)isort->runs->pdata,
+			  isort->runs->len, out);
+	g_ptr_array_set_size(isort->runs, 0);
+    } else {
+	write_lines(isort, out);
+	free_lines(isort);
+    }
+
+    if (ferror(out)) {
+	set_error(isort, _("Error writing index: %s"), strerror(errno));
+	rval = FALSE;
+    }
+    if (fclose(out) != 0) {
+	set_error(isort, _("Error writing index: %s"), strerror(errno));
+	rval = FALSE;
+    }
+
+    return rval;
+}
+
+char *
+indexsort_error(
+    indexsort_t *isort)
+{
+    return isort->errmsg;
+}
+
+void
+indexsort_free(
+    indexsort_t *isort)
+{
+    guint i;
+
+    free_lines(isort);
+    g_ptr_array_free(isort->lines, TRUE);
+    for (i = 0; i < isort->runs->len; i++)
+	fclose(g_ptr_array_index(isort->runs, i));
+    g_ptr_array_free(isort->runs, TRUE);
+    g_string_free(isort->partial, TRUE);
+    g_free(isort->tmpdir);
+    g_free(isort->errmsg);
+    g_free(isort);
+}
+
+#ifdef TEST
+
+#include "simpleprng.h"
+
+/*
+ * Sort lines with the given memory limit and check the output against
+ * g_ptr_array_sort.  The lines are fed in chunks of chunk bytes, so lines
+ * span several indexsort_add calls.
+ */
+static gboolean
+check_sort(
+    const char *name,
+    GPtrArray  *lines,
+    gsize       max_memory,
+    gsize       chunk,
+    gboolean    last_newline)
+{
+    indexsort_t *isort = indexsort_new(NULL, max_memory);
+    GString     *input = g_string_new(NULL);
+    GString     *expected = g_string_new(NULL);
+    GPtrArray   *sorted = g_ptr_array_sized_new(lines->len);
+    char        *filename = g_strdup("/tmp/amindexsort-test.XXXXXX");
+    char        *output = NULL;
+    gsize        output_len;
+    gsize        i;
+    int          fd;
+    gboolean     ok = TRUE;
+
+    for (i = 0; i < lines->len; i++) {
+	g_string_append(input, g_ptr_array_index(lines, i));
+	if (last_newline || i + 1 < lines->len)
+	    g_string_append_c(input, '\n');
+	g_ptr_array_add(sorted, g_ptr_array_index(lines, i));
+    }
+    g_ptr_array_sort(sorted, compare_lines);
+    for (i = 0; i < sorted->len; i++) {
+	g_string_append(expected, g_ptr_array_index(sorted, i));
+	g_string_append_c(expected, '\n');
+    }
+
+    for (i = 0; i < input->len; i += chunk) {
+	if (!indexsort_add(isort, input->str + i, MIN(chunk, input->len - i))) {
+	    g_fprintf(stderr, "%s: indexsort_add: %s\n", name,
+		      indexsort_error(isort));
+	    ok = FALSE;
+	    goto done;
+	}
+    }
+
+    fd = g_mkstemp(filename);
+    if (fd < 0) {
+	g_fprintf(stderr, "%s: mkstemp: %s\n", name, strerror(errno));
+	ok = FALSE;
+	goto done;
+    }
+    if (!indexsort_write(isort, fd)) {
+	g_fprintf(stderr, "%s: indexsort_write: %s\n", name,
+		  indexsort_error(isort));
+	ok = FALSE;
+    }
+    close(fd);
+
+    if (ok && !g_file_get_contents(filename, &output, &output_len, NULL)) {
+	g_fprintf(stderr, "%s: can't read the output\n", name);
+	ok = FALSE;
+    }
+    if (ok && (output_len != expected->len ||
+	       memcmp(output, expected->str, output_len) != 0)) {
+	g_fprintf(stderr, "%s: output is not sorted as expected\n", name);
+	ok = FALSE;
+    }
+    unlink(filename);
+
+done:
+    g_fprintf(stderr, "%s %s\n", ok ? "PASS" : "FAIL", name);
+    indexsort_free(isort);
+    g_string_free(input, TRUE);
+    g_string_free(expected, TRUE);
+    g_ptr_array_free(sorted, TRUE);
+    g_free(filename);
+    g_free(output);
+    return ok;
+}
+
+int
+main(
+    int		argc G_GNUC_UNUSED,
+    char **	argv G_GNUC_UNUSED)
+{
+    static char *fixed[] = {
+	"/usr/", "/usr/bin/", "/", "/Usr", "/usr/bin/sort", "",
+	"/\303\251t\303\251/", "/usr/", "/a b", "/a\tb", "/~",
+    };
+    GPtrArray *lines = g_ptr_array_new();
+    GPtrArray *random_lines = g_ptr_array_new_with_free_func(g_free);
+    simpleprng_state_t prng;
+    gboolean   ok = TRUE;
+    guint      i;
+
+    glib_init();
+
+    setlocale(LC_MESSAGES, "C");
+    textdomain("amanda");
+
+    safe_fd(-1, 0);
+
+    set_pname("indexsort");
+
+    simpleprng_seed(&prng, 0xC0FFEE);
+
+    for (i = 0; i < G_N_ELEMENTS(fixed); i++)
+	g_ptr_array_add(lines, fixed[i]);
+
+    /* bytewise order, duplicates, an empty line, lines split across adds */
+    ok &= check_sort("in memory", lines, 0, 3, TRUE);
+    ok &= check_sort("no final newline", lines, 0, 1000, FALSE);
+
+    for (i = 0; i < 300; i++) {
+	guint len = simpleprng_rand(&prng) % 40;
+	char *line = g_malloc(len + 2);
+	guint j;
+
+	line[0] = '/';
+	for (j = 1; j <= len; j++)
+	    line[j] = (char)(' ' + simpleprng_rand(&prng) % (0x7f - ' '));
+	line[len + 1] = '\0';
+	g_ptr_array_add(random_lines, line);
+    }
+
+    /* a run for each line: more runs than INDEXSORT_MAX_MERGE */
+    ok &= check_sort("one run per line", random_lines, 1, 7, TRUE);
+    ok &= check_sort("random in memory", random_lines, 0, 4096, TRUE);
+
+    g_ptr_array_free(lines, TRUE);
+    g_ptr_array_free(random_lines, TRUE);
+
+    return ok ? 0 : 1;
+}
+
+#endif /* TEST */
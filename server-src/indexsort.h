@@ -0,0 +1,82 @@
+/*
+ * Amanda, The Advanced Maryland Automatic Network Disk Archiver
+ * Copyright (c) 2013-2016 Carbonite, Inc.  All Rights Reserved.
+ * All Rights Reserved.
+ *
+ * Permission to use, copy, modify, distribute, and sell this software and its
+ * documentation for any purpose is hereby granted without fee, provided that
+ * the above copyright notice appear in all copies and that both that
+ * copyright notice and this permission notice appear in supporting
+ * documentation, and that the name of U.M. not be used in advertising or
+ * publicity pertaining to distribution of the software without specific,
+ * written prior permission.  U.M. makes no representations about the
+ * suitability of this software for any purpose.  It is provided "as is"
+ * without express or implied warranty.
+ *
+ */
+/*
+ * Sort the lines of an index in bounded memory, replacing an external sort
+ * process.  Lines are collected in memory; when max_memory is reached they
+ * are sorted and written to an unlinked temporary file in tmpdir, and the
+ * runs are merged when the result is written.  Lines are compared bytewise,
+ * as 'LC_ALL=C sort' does.
+ */
+#ifndef INDEXSORT_H
+#define INDEXSORT_H
+
+#include "amanda.h"
+
+/* default memory used before lines are spilled to a temporary file */
+#define INDEXSORT_MAX_MEMORY (64*1024*1024)
+
+typedef struct indexsort_s indexsort_t;
+
+/* Create a new sorter.
+ *
+ * @param tmpdir: directory for the temporary files, NULL for /tmp
+ * @param max_memory: memory to use for the lines, 0 for INDEXSORT_MAX_MEMORY
+ * @returns: the new sorter
+ */
+indexsort_t *indexsort_new(const char *tmpdir, gsize max_memory);
+
+/* Add data to the sorter.  The data is split at newlines; a line may span
+ * several calls.
+ *
+ * @param isort: the sorter
+ * @param buf: the data
+ * @param size: its length
+ * @returns: FALSE on error, see indexsort_error
+ */
+gboolean indexsort_add(indexsort_t *isort, const char *buf, gsize size);
+
+/* Add everything that can be read from fd to the sorter.
+ *
+ * @param isort: the sorter
+ * @param fd: the file descriptor to read until EOF
+ * @returns: FALSE on error, see indexsort_error
+ */
+gboolean indexsort_add_fd(indexsort_t *isort, int fd);
+
+/* Write all the lines added, sorted and each followed by a newline, to fd.
+ * The sorter is empty afterward.
+ *
+ * @param isort: the sorter
+ * @param fd: the file descriptor to write to; it is not closed
+ * @returns: FALSE on error, see indexsort_error
+ */
+gboolean indexsort_write(indexsort_t *isort, int fd);
+
+/* The message for the first error, or NULL.  It belongs to the sorter.
+ *
+ * @param isort: the sorter
+ * @returns: the error message
+ */
+char *indexsort_error(indexsort_t *isort);
+
+/* Free the sorter and its temporary files.
+ *
+ * @param isort: the sorter
+ */
+void indexsort_free(indexsort_t *isort);
+
+#endif /* INDEXSORT_H */
@@ -107,6 +107,7 @@ typedef struct est_s {
     int level_days;
     int promote;
     int post_dle;
+    int prep_done;	/* all estimates received in a PREP */
     double fullrate, incrrate;
     double fullcomp, incrcomp;
     char *errstr;
@@ -193,6 +194,8 @@ static void insert_est(estlist_t *list, est_t *est, int (*cmp)(est_t *a, est_t *
 static est_t *find_est_for_dp(disk_t *dp);
 static est_t *dequeue_est(estlist_t *list);
 static void remove_est(estlist_t *list, est_t *	est);
+static gboolean est_is_complete(est_t *ep);
+static void analyze_prep_done(void);
 static void est_dump_queue(char      *st,
 			   estlist_t  q,
 			   int        npr,
@@ -707,6 +710,17 @@ main(
     waitq.head = waitq.tail = NULL;
     failq.head = failq.tail = NULL;
 
+    /*
+     * Estimates are analyzed as soon as they are complete (see
+     * handle_result), so the schedule must be ready before asking.
+     */
+			/* an empty tape still has a label and an endmark */
+    total_size = ((gint64)tt_blocksize_kb + (gint64)tape_mark) * (gint64)2;
+    total_lev0 = 0.0;
+    balanced_size = 0.0;
+
+    schedq.head = schedq.tail = NULL;
+
     get_estimates();
 
     g_fprintf(stderr, _("%s: time %s: getting estimates took %s secs\n"),
@@ -715,9 +729,9 @@ main(
 		    walltime_str(timessub(curclock(), section_start)));
 
     /*
-     * At this point, all disks with estimates are in estq, and
-     * all the disks on hosts that didn't respond to our inquiry
-     * are in failq.
+     * At this point, all disks with estimates are in estq, except those
+     * already analyzed from a PREP, and all the disks on hosts that didn't
+     * respond to our inquiry are in failq.
      */
 
     est_dump_queue("FAILED", failq, 15, stderr);
@@ -739,12 +753,6 @@ main(
     g_fprintf(stderr,_("\nANALYZING ESTIMATES...\n"));
     section_start = curclock();
 
-			/* an empty tape still has a label and an endmark */
-    total_size = ((gint64)tt_blocksize_kb + (gint64)tape_mark) * (gint64)2;
-    total_lev0 = 0.0;
-    balanced_size = 0.0;
-
-    schedq.head = schedq.tail = NULL;
     while(!empty(estq)) analyze_estimate(dequeue_est(&estq));
     while(!empty(failq)) handle_failed(dequeue_est(&failq));
 
@@ -2262,6 +2270,10 @@ static void handle_result(
 	}
 
 	ep = find_est_for_dp(dp);
+	if (ep->state == DISK_DONE) {
+	    /* already complete in a previous PREP */
+	    goto next_line;
+	}
 	size = (gint64)-1;
 	if (strncmp_const(t-1,"SIZE ") == 0) {
 	    if (sscanf(t - 1, "SIZE %lld", &size_) != 1) {
@@ -2336,7 +2348,16 @@ next_line:
 	    remove_est(&pestq, ep);
 	}
 
-	if(pkt->type == P_REP) {
+	/*
+	 * A PREP holding all requested estimates is final for that disk,
+	 * it can be scheduled without waiting for the rest of the host.
+	 * Server estimates are already filled in, so they can't tell.
+	 */
+	if(pkt->type == P_PREP && !ep->allow_server && est_is_complete(ep)) {
+	    ep->prep_done = 1;
+	}
+
+	if(pkt->type == P_REP || ep->prep_done) {
 	    ep->state = DISK_DONE;
 	}
 	else if(pkt->type == P_PREP) {
@@ -2347,7 +2368,7 @@ next_line:
 
 
 	qname = quote_string(dp->name);
-	if(pkt->type == P_PREP) {
+	if(pkt->type == P_PREP && !ep->prep_done) {
 		g_fprintf(stderr,_("%s: time %s: got partial result for host %s disk %s:"),
 			get_pname(), walltime_str(curclock()),
 			dp->host->hostname, qname);
@@ -2360,7 +2381,7 @@ next_line:
                           (long long)ep->estimate[2].nsize);
 	    enqueue_est(&pestq, ep);
 	}
-	else if(pkt->type == P_REP) {
+	else if(pkt->type == P_REP || ep->prep_done) {
 		g_fprintf(stderr,_("%s: time %s: got result for host %s disk %s:"),
 			get_pname(), walltime_str(curclock()),
 			dp->host->hostname, qname);
@@ -2402,7 +2423,8 @@ next_line:
 		    }
 		}
 	    }
-	    hostp->status = HOST_DONE;
+	    if (pkt->type == P_REP)
+		hostp->status = HOST_DONE;
 	}
 	if (ep->post_dle == 0 &&
 	    (pkt->type == P_REP ||
@@ -2420,6 +2442,16 @@ next_line:
 	amfree(qname);
     }
 
+    /* the REP is final even if every disk was done in a PREP */
+    if (pkt->type == P_REP && hostp->status != HOST_DONE) {
+	for(dp = hostp->disks; dp != NULL; dp = dp->hostnext) {
+	    if (dp->todo && find_est_for_dp(dp)->prep_done) {
+		hostp->status = HOST_DONE;
+		break;
+	    }
+	}
+    }
+
     if(hostp->status == HOST_DONE) {
 	if (pkt->type == P_REP) {
 	    security_close_connection(sech, hostp->hostname);
@@ -2431,6 +2463,7 @@ next_line:
     }
 
     getsize(hostp);
+
     /* try to clean up any defunct processes, since Amanda doesn't wait() for
        them explicitly */
     while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
@@ -2438,6 +2471,8 @@ next_line:
     }
     if (errbuf)
 	goto error_return;
+
+    analyze_prep_done();
     return;
 
  NAK_parse_failed:
@@ -2495,11 +2530,16 @@ next_line:
 	for (dp = hostp->disks; dp != NULL; dp = dp->hostnext) {
 	    if (dp->todo) {
 		ep = find_est_for_dp(dp);
+		/* finished by an earlier PREP, its estimates are good */
+		if (ep->prep_done)
+		    continue;
 		qname = quote_string(dp->name);
 		if(ep->state == DISK_ACTIVE) {
 		    remove_est(&waitq, ep);
 		} else if(ep->state == DISK_PARTIALY_DONE) {
 		    remove_est(&pestq, ep);
+		} else if(ep->state == DISK_DONE) {
+		    remove_est(&estq, ep);
 		} else {
 		    remove_est(&startq, ep);
 		}
@@ -3635,6 +3675,43 @@ server_estimate(
 }
 
 
+/* Has the client sent an estimate for every requested level? */
+static gboolean
+est_is_complete(
+    est_t *ep)
+{
+    int i;
+
+    for (i = 0; i < MAX_LEVELS; i++) {
+	if (ep->estimate[i].level != -1 &&
+	    ep->estimate[i].nsize <= (gint64)0) {
+	    return FALSE;
+	}
+    }
+    return TRUE;
+}
+
+/*
+ * Analyze the disks finished by a PREP while other hosts are still
+ * estimating.  The other disks of estq wait for the end of the estimates,
+ * so that an error later in the reply can still fail them.
+ */
+static void
+analyze_prep_done(void)
+{
+    GList *elist, *next;
+
+    for (elist = estq.head; elist != NULL; elist = next) {
+	est_t *ep = get_est(elist);
+
+	next = elist->next;
+	if (ep->prep_done) {
+	    remove_est(&estq, ep);
+	    analyze_estimate(ep);
+	}
+    }
+}
+
 static void
 est_dump_queue(
     char *      st,
@@ -39,6 +39,7 @@
 #include "conffile.h"
 #include "diskfile.h"
 #include "pipespawn.h"
+#include "event.h"
 #include "conffile.h"
 #include "infofile.h"
 #include "backup_support_option.h"
@@ -808,7 +809,42 @@ int amcatalog_infd = -1;
 int amcatalog_outfd = -1;
 int amcatalog_errfd = 2;
 FILE *amcatalog_in = NULL;
-FILE *amcatalog_out = NULL;
+
+/*
+ * Requests are written to amcatalog as soon as they are made, each tagged
+ * with an ID:<n> token that amcatalog echoes on its BEGIN line.  Replies come
+ * back in order, so the pending queue is matched against them head first.
+ * A caller that needs the answer waits for its own request; the others are
+ * completed by amcatalog_read_event from the event loop, or by the next
+ * caller that waits.
+ */
+#define AMCATALOG_MAX_PENDING 256
+
+typedef void (*amcatalog_reply_fn)(gpointer data, GPtrArray *lines);
+
+typedef struct amcatalog_request_s {
+    guint64             id;
+    amcatalog_reply_fn  callback;
+    gpointer            data;
+    gboolean            wait;		/* the caller frees it */
+    gboolean            in_reply;
+    gboolean            done;
+    GPtrArray          *lines;
+} amcatalog_request_t;
+
+static pid_t           amcatalog_owner = -1;
+static guint64         amcatalog_next_id = 1;
+static GQueue         *amcatalog_pending = NULL;
+static GString        *amcatalog_outbuf = NULL;
+static gboolean        amcatalog_event_loop = FALSE;
+static event_handle_t *amcatalog_ev_read = NULL;
+
+/* copy commands added by this process whose add-copy-cmd reply is not read
+ * yet, as "host disk timestamp level storage" keys; once the reply is read,
+ * another process may have removed the command, so amcatalog is asked */
+static GHashTable     *amcatalog_image_cmds = NULL;
+
+static void amcatalog_read_event(void *cookie);
 
 static void
 start_amcatalog(void)
@@ -820,32 +856,186 @@ start_amcatalog(void)
 			      &amcatalog_infd, &amcatalog_outfd, &amcatalog_errfd,
 			      amcatalog, get_config_name(), "--interactive", NULL);
     amcatalog_in = fdopen(amcatalog_infd, "w");
-    amcatalog_out = fdopen(amcatalog_outfd, "r");
+    amcatalog_owner = getpid();
+    amcatalog_pending = g_queue_new();
+    amcatalog_outbuf = g_string_sized_new(1024);
     g_free(amcatalog);
 }
 
-char *
-run_amcatalog(
+static void
+amcatalog_free_request(
+    amcatalog_request_t *req)
+{
+    guint i;
+
+    for (i = 0; i < req->lines->len; i++) {
+	g_free(g_ptr_array_index(req->lines, i));
+    }
+    g_ptr_array_free(req->lines, TRUE);
+    g_free(req);
+}
+
+static void
+amcatalog_update_event(void)
+{
+    gboolean want = amcatalog_event_loop &&
+		    !g_queue_is_empty(amcatalog_pending);
+
+    if (want && !amcatalog_ev_read) {
+	amcatalog_ev_read = event_create(amcatalog_outfd, EV_READFD,
+					 amcatalog_read_event, NULL);
+	event_activate(amcatalog_ev_read);
+    } else if (!want && amcatalog_ev_read) {
+	event_release(amcatalog_ev_read);
+	amcatalog_ev_read = NULL;
+    }
+}
+
+static void
+amcatalog_process_line(
+    char *line)
+{
+    amcatalog_request_t *req = g_queue_peek_head(amcatalog_pending);
+
+    if (!req) {
+	g_debug("amcatalog result without request: %s", line);
+	return;
+    }
+
+    if (!req->in_reply) {
+	if (g_str_has_prefix(line, "BEGIN")) {
+	    if (line[5] == ' ' &&
+		g_ascii_strtoull(line+9, NULL, 10) != req->id) {
+		g_debug("amcatalog reply %s for request ID:%llu",
+			line+6, (unsigned long long)req->id);
+	    }
+	    req->in_reply = TRUE;
+	} else {
+	    g_debug("result before BEGIN line: %s", line);
+	}
+	return;
+    }
+
+    if (g_str_equal(line, "END")) {
+	g_queue_pop_head(amcatalog_pending);
+	req->done = TRUE;
+	if (!req->wait) {
+	    if (req->callback)
+		req->callback(req->data, req->lines);
+	    amcatalog_free_request(req);
+	}
+	return;
+    }
+
+    if (req->lines->len < 10) {
+	g_debug("run_amcatalog result ID:%llu: %s",
+		(unsigned long long)req->id, line);
+    } else if (req->lines->len == 10) {
+	g_debug("run_amcatalog result ID:%llu: ...",
+		(unsigned long long)req->id);
+    }
+    g_ptr_array_add(req->lines, g_strdup(line));
+}
+
+/* read what amcatalog has written and complete the replies it contains;
+ * return FALSE if amcatalog is gone */
+static gboolean
+amcatalog_read_replies(void)
+{
+    char     buf[8192];
+    ssize_t  n;
+    char    *nl;
+
+    do {
+	n = read(amcatalog_outfd, buf, sizeof(buf));
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+	if (n < 0)
+	    g_debug("read from amcatalog failed: %s", strerror(errno));
+	else
+	    g_debug("amcatalog closed its output");
+	return FALSE;
+    }
+    g_string_append_len(amcatalog_outbuf, buf, n);
+
+    while ((nl = memchr(amcatalog_outbuf->str, '\n',
+			amcatalog_outbuf->len)) != NULL) {
+	gsize len = nl - amcatalog_outbuf->str;
+	*nl = '\0';
+	amcatalog_process_line(amcatalog_outbuf->str);
+	g_string_erase(amcatalog_outbuf, 0, len + 1);
+    }
+    return TRUE;
+}
+
+static void
+amcatalog_read_event(
+    void *cookie G_GNUC_UNUSED)
+{
+    if (!amcatalog_read_replies()) {
+	/* drop what will never be answered */
+	amcatalog_request_t *req;
+	while ((req = g_queue_pop_head(amcatalog_pending)) != NULL) {
+	    req->done = TRUE;
+	    if (!req->wait)
+		amcatalog_free_request(req);
+	}
+    }
+    amcatalog_update_event();
+}
+
+/* read replies until req is complete, or until amcatalog_pending is empty
+ * if req is NULL */
+static void
+amcatalog_wait(
+    amcatalog_request_t *req)
+{
+    while (req ? !req->done : !g_queue_is_empty(amcatalog_pending)) {
+	if (!amcatalog_read_replies()) {
+	    amcatalog_read_event(NULL);
+	    break;
+	}
+    }
+    amcatalog_update_event();
+}
+
+static amcatalog_request_t *
+amcatalog_vsend(
+    amcatalog_reply_fn callback,
+    gpointer data,
+    gboolean wait,
     char *command,
     int n_args,
-    ...)
+    va_list ap)
 {
     gchar     *arg;
     GPtrArray *argv_ptr = g_ptr_array_new();
     char      *out_line;
-    char       line[1000];
-    char      *result;
-    char      *return_result = NULL;
-    va_list    ap;
+    char       id_str[NUM_STR_SIZE+3];
+    amcatalog_request_t *req;
     int        i;
-    gboolean   in_reply = FALSE;
-    gboolean   first_reply = TRUE;
 
     if (amcatalog_pid == -1) {
 	start_amcatalog();
     }
 
-    va_start(ap, n_args);
+    /* bound the replies amcatalog may have to buffer in the pipe */
+    while (g_queue_get_length(amcatalog_pending) >= AMCATALOG_MAX_PENDING) {
+	if (!amcatalog_read_replies()) {
+	    amcatalog_read_event(NULL);
+	    break;
+	}
+    }
+
+    req = g_new0(amcatalog_request_t, 1);
+    req->id = amcatalog_next_id++;
+    req->callback = callback;
+    req->data = data;
+    req->wait = wait;
+    req->lines = g_ptr_array_new();
+
+    g_snprintf(id_str, sizeof(id_str), "ID:%llu", (unsigned long long)req->id);
+    g_ptr_array_add(argv_ptr, id_str);
     g_ptr_array_add(argv_ptr, command);
     for (i=0; i<n_args; i++) {
 	arg = va_arg(ap, char *);
@@ -856,7 +1046,6 @@ run_amcatalog(
 	}
     }
     g_ptr_array_add(argv_ptr, NULL);
-    va_end(ap);
 
     out_line = g_strjoinv(" ", (char **)argv_ptr->pdata);
     g_debug("run_amcatalog cmd: %s", out_line);
@@ -865,27 +1054,47 @@ run_amcatalog(
     g_free(out_line);
     g_ptr_array_free(argv_ptr, TRUE);
 
-    while((result = fgets(line, 1000, amcatalog_out))) {
-	if (result[strlen(result)-1] == '\n')
-	    result[strlen(result)-1] = '\0';
-	g_debug("run_amcatalog result: %s", result);
-	if (!in_reply) {
-	    if (strcmp(result, "BEGIN") == 0) {
-		in_reply = 1;
-	    } else {
-		g_debug("result before BEGIN line: %s", result);
-	    }
-	} else {
-	    if (strcmp(result, "END") == 0) {
-		break;
-	    } else if (first_reply) {
-		return_result = g_strdup(result);
-		first_reply = FALSE;
-	    } else {
-		g_debug("ignore result: %s", result);
-	    }
-	}
+    g_queue_push_tail(amcatalog_pending, req);
+    amcatalog_update_event();
+    return req;
+}
+
+/* send a request without waiting for its reply; callback, if not NULL, is
+ * called with the reply lines when it arrives */
+static void
+amcatalog_send(
+    amcatalog_reply_fn callback,
+    gpointer data,
+    char *command,
+    int n_args,
+    ...)
+{
+    va_list ap;
+
+    va_start(ap, n_args);
+    amcatalog_vsend(callback, data, FALSE, command, n_args, ap);
+    va_end(ap);
+}
+
+char *
+run_amcatalog(
+    char *command,
+    int n_args,
+    ...)
+{
+    amcatalog_request_t *req;
+    char      *return_result = NULL;
+    va_list    ap;
+
+    va_start(ap, n_args);
+    req = amcatalog_vsend(NULL, NULL, TRUE, command, n_args, ap);
+    va_end(ap);
+
+    amcatalog_wait(req);
+    if (req->lines->len > 0) {
+	return_result = g_strdup(g_ptr_array_index(req->lines, 0));
     }
+    amcatalog_free_request(req);
 
     g_debug("run_amcatalog return_result: %s", return_result);
     return return_result;
@@ -897,78 +1106,78 @@ run_amcatalog_multi(
     int n_args,
     ...)
 {
-    gchar     *arg;
-    GPtrArray *argv_ptr = g_ptr_array_new();
-    char      *out_line;
-    char       line[1000];
-    char      *result;
+    amcatalog_request_t *req;
     GPtrArray *return_result = g_ptr_array_new();
     va_list    ap;
-    int        i;
-    gboolean   in_reply = FALSE;
-    int        result_count = 0;
-
-    if (amcatalog_pid == -1) {
-	start_amcatalog();
-    }
+    guint      i;
 
     va_start(ap, n_args);
-    g_ptr_array_add(argv_ptr, command);
-    for (i=0; i<n_args; i++) {
-	arg = va_arg(ap, char *);
-	if (arg) {
-	    g_ptr_array_add(argv_ptr, arg);
-	} else {
-	    g_ptr_array_add(argv_ptr, "");
-	}
-    }
-    g_ptr_array_add(argv_ptr, NULL);
+    req = amcatalog_vsend(NULL, NULL, TRUE, command, n_args, ap);
     va_end(ap);
 
-    out_line = g_strjoinv(" ", (char **)argv_ptr->pdata);
-    g_debug("run_amcatalog_multi cmd: %s", out_line);
-    fprintf(amcatalog_in, "%s\n", out_line);
-    fflush(amcatalog_in);
-    g_free(out_line);
-    g_ptr_array_free(argv_ptr, TRUE);
-
-    while((result = fgets(line, 1000, amcatalog_out))) {
-	if (result[strlen(result)-1] == '\n')
-	    result[strlen(result)-1] = '\0';
-	result_count++;
-	if (result_count < 11) {
-	    g_debug("run_amcatalog_multi result: %s", result);
-	} else if (result_count == 11) {
-	    g_debug("run_amcatalog_multi result: ...");
-	}
-	if (!in_reply) {
-	    if (strcmp(result, "BEGIN") == 0) {
-		in_reply = 1;
-	    } else {
-		g_debug("result before BEGIN line: %s", result);
-	    }
+    amcatalog_wait(req);
+    for (i = 0; i < req->lines->len; i++) {
+	char *result = g_ptr_array_index(req->lines, i);
+	if (*result == '\0') {
+	    // ignore empty line
+	    g_free(result);
 	} else {
-	    if (strcmp(result, "END") == 0) {
-		break;
-	    } else if (*result == '\0') {
-		// ignore empty line
-	    } else {
-		g_ptr_array_add(return_result, g_strdup(result));
-	    }
+	    g_ptr_array_add(return_result, result);
 	}
     }
+    g_ptr_array_set_size(req->lines, 0);
+    amcatalog_free_request(req);
 
     return return_result;
 }
 
+void
+amcatalog_use_event_loop(void)
+{
+    amcatalog_event_loop = TRUE;
+}
+
 void
 quit_amcatalog(void)
 {
+    amcatalog_request_t *req;
+
     if (amcatalog_pid != -1) {
+	/* a forked child must leave the replies to its parent */
+	if (getpid() == amcatalog_owner) {
+	    amcatalog_wait(NULL);
+	}
+	if (amcatalog_ev_read) {
+	    event_release(amcatalog_ev_read);
+	    amcatalog_ev_read = NULL;
+	}
+	while ((req = g_queue_pop_head(amcatalog_pending)) != NULL) {
+	    amcatalog_free_request(req);
+	}
+	g_queue_free(amcatalog_pending);
+	amcatalog_pending = NULL;
+	g_string_free(amcatalog_outbuf, TRUE);
+	amcatalog_outbuf = NULL;
 	fclose(amcatalog_in);
-	fclose(amcatalog_out);
+	close(amcatalog_outfd);
 	amcatalog_pid = -1;
     }
+    if (amcatalog_image_cmds) {
+	g_hash_table_destroy(amcatalog_image_cmds);
+	amcatalog_image_cmds = NULL;
+    }
+}
+
+static char *
+amcatalog_image_key(
+    char *hostname,
+    char *diskname,
+    char *dump_timestamp,
+    int   level,
+    char *dst_storage)
+{
+    return g_strdup_printf("%s %s %s %d %s", hostname, diskname,
+			   dump_timestamp, level, dst_storage);
 }
 
 void
@@ -976,11 +1185,9 @@ amcatalog_remove_working_cmd(
     int pid)
 {
     char  pid_str[50];
-    char *result;
 
     g_snprintf(pid_str, 50, "%d", pid);
-    result = run_amcatalog("remove-working-cmd", 1, pid_str);
-    g_free(result);
+    amcatalog_send(NULL, NULL, "remove-working-cmd", 1, pid_str);
 }
 
 void
@@ -988,18 +1195,32 @@ amcatalog_remove_cmd(
     int id)
 {
     char  id_str[50];
-    char *result;
 
     g_snprintf(id_str, 50, "%d", id);
-    result = run_amcatalog("remove-cmd", 1, id_str);
-    g_free(result);
+    amcatalog_send(NULL, NULL, "remove-cmd", 1, id_str);
 }
 
-int
-amcatalog_add_cmd(
-    cmddata_t *cmddata)
+static void
+amcatalog_add_copy_cmd_reply(
+    gpointer data,
+    GPtrArray *lines G_GNUC_UNUSED)
 {
-    int id;
+    char *key = data;
+
+    /* the command is in the catalog now (or was not added), where another
+     * process can remove it */
+    if (amcatalog_image_cmds) {
+	g_hash_table_remove(amcatalog_image_cmds, key);
+    }
+    g_free(key);
+}
+
+static int
+amcatalog_send_add_cmd(
+    cmddata_t *cmddata,
+    gboolean   wait)
+{
+    int id = 0;
     char *line = NULL;
     char *config = quote_string(cmddata->config);
     char *hostname = quote_string(cmddata->hostname);
@@ -1016,13 +1237,23 @@ amcatalog_add_cmd(
 	char working_pid_str[NUM_STR_SIZE];
 	g_snprintf(level_str, sizeof(level_str), "%d", cmddata->level);
 	g_snprintf(working_pid_str, sizeof(working_pid_str), "%ld", (long)cmddata->working_pid);
-	line = run_amcatalog("add-flush-cmd", 9, config, holding_file,
+	if (wait) {
+	    line = run_amcatalog("add-flush-cmd", 9, config, holding_file,
 				hostname, diskname, dump_timestamp, level_str,
 				dst_storage, working_pid_str, status_str);
+	} else {
+	    amcatalog_send(NULL, NULL, "add-flush-cmd", 9, config,
+				holding_file, hostname, diskname,
+				dump_timestamp, level_str, dst_storage,
+				working_pid_str, status_str);
+	}
 	amfree(holding_file);
     } else if (cmddata->operation == CMD_COPY) {
 	char *src_storage = quote_string(cmddata->src_storage);
 	char *src_label = quote_string(cmddata->src_label);
+	char *key = amcatalog_image_key(cmddata->hostname, cmddata->diskname,
+					cmddata->dump_timestamp,
+					cmddata->level, cmddata->dst_storage);
 	char level_str[NUM_STR_SIZE];
 	char working_pid_str[NUM_STR_SIZE];
 	char size_str[NUM_STR_SIZE];
@@ -1031,10 +1262,25 @@ amcatalog_add_cmd(
 	g_snprintf(working_pid_str, sizeof(working_pid_str), "%ld", (long)cmddata->working_pid);
 	g_snprintf(size_str, sizeof(size_str), "%lld", (long long)cmddata->size);
 	g_snprintf(start_time_str, sizeof(start_time_str), "%ld", cmddata->start_time);
-	line = run_amcatalog("add-copy-cmd", 12, config, src_storage, src_label,
-				hostname, diskname, dump_timestamp, level_str,
-				dst_storage, working_pid_str, status_str,
-				size_str, start_time_str);
+	if (wait) {
+	    line = run_amcatalog("add-copy-cmd", 12, config, src_storage,
+				src_label, hostname, diskname, dump_timestamp,
+				level_str, dst_storage, working_pid_str,
+				status_str, size_str, start_time_str);
+	    g_free(key);
+	} else {
+	    if (!amcatalog_image_cmds) {
+		amcatalog_image_cmds = g_hash_table_new_full(g_str_hash,
+							     g_str_equal,
+							     g_free, NULL);
+	    }
+	    g_hash_table_replace(amcatalog_image_cmds, g_strdup(key), NULL);
+	    amcatalog_send(amcatalog_add_copy_cmd_reply, key,
+				"add-copy-cmd", 12, config, src_storage,
+				src_label, hostname, diskname, dump_timestamp,
+				level_str, dst_storage, working_pid_str,
+				status_str, size_str, start_time_str);
+	}
 	amfree(src_label);
 	amfree(src_storage);
     } else if (cmddata->operation == CMD_RESTORE) {
@@ -1042,11 +1288,13 @@ amcatalog_add_cmd(
     } else {
 	g_critical("add UNKNOWN command unimplemented");
     }
-    if (!line) {
-	g_critical("no output from amcatalog");
+    if (wait) {
+	if (!line) {
+	    g_critical("no output from amcatalog");
+	}
+	id = atoi(line);
+	g_free(line);
     }
-    id = atoi(line);
-    g_free(line);
     amfree(dst_storage);
     amfree(dump_timestamp);
     amfree(diskname);
@@ -1056,6 +1304,21 @@ amcatalog_add_cmd(
     return id;
 }
 
+int
+amcatalog_add_cmd(
+    cmddata_t *cmddata)
+{
+    return amcatalog_send_add_cmd(cmddata, TRUE);
+}
+
+/* add a command without waiting for its id; cmddata->id is left at 0 */
+void
+amcatalog_queue_add_cmd(
+    cmddata_t *cmddata)
+{
+    amcatalog_send_add_cmd(cmddata, FALSE);
+}
+
 cmddata_t *
 amcatalog_get_cmd_from_id(
     int id)
@@ -1084,6 +1347,17 @@ amcatalog_get_nb_image_cmd_for_storage(
     char *line;
     char  level_str[50];
 
+    /* a copy command this process is still adding is enough of an answer */
+    if (amcatalog_image_cmds) {
+	char *key = amcatalog_image_key(hostname, diskname, dump_timestamp,
+					level, dst_storage);
+	gboolean found = g_hash_table_lookup_extended(amcatalog_image_cmds,
+						      key, NULL, NULL);
+	g_free(key);
+	if (found)
+	    return 1;
+    }
+
     g_snprintf(level_str, 50, "%d", level);
     line = run_amcatalog("get-nb-image-cmd-for-storage", 5, hostname, diskname, dump_timestamp, level_str, dst_storage);
     if (line) {
@@ -139,9 +139,11 @@ int server_can_do_estimate(disk_t *dp, info_t *info, int level,
 
 char *run_amcatalog(char *command, int n_args, ...);
 void quit_amcatalog(void);
+void amcatalog_use_event_loop(void);
 void amcatalog_remove_working_cmd(int pid);
 void amcatalog_remove_cmd(int id);
 int amcatalog_add_cmd(cmddata_t *cmddata);
+void amcatalog_queue_add_cmd(cmddata_t *cmddata);
 cmddata_t * amcatalog_get_cmd_from_id(int id);
 int         amcatalog_get_nb_image_cmd_for_storage(char *hostname, char *diskname, char *dump_timestamp, int level, char *dst_storage);
 GPtrArray * amcatalog_get_flush_cmd(void);
@@ -92,6 +92,9 @@ typedef struct XferDestHolding {
     guint64     header_bytes_written;
     guint64     chunk_offset;         /* bytes written to the current */
 				      /* chunk, including header      */
+    crc_t       chunk_crc;            /* of the data of the current chunk */
+    GSList     *chunks;               /* holding_chunk_t of the closed chunks, */
+				      /* for the manifest */
 
     enum { CHUNK_OK	 = 0,		/* */
 	   CHUNK_EOF	 = 1,		/* we read the complete input */
@@ -278,6 +281,8 @@ failure_port_write_data:
 	}
 	crc32_add((uint8_t *)(self->mem_ring->buffer + self->mem_ring->read_offset),
 			 to_write, &elt->crc);
+	crc32_add((uint8_t *)(self->mem_ring->buffer + self->mem_ring->read_offset),
+			 to_write, &self->chunk_crc);
 	self->chunk_offset += count;
 
 	self->data_bytes_written += count;
@@ -434,6 +439,7 @@ failure_port_write_header:
 	    self->fd = fd;
 	    self->header_bytes_written = HEADER_BLOCK_BYTES;
 	    self->chunk_offset = HEADER_BLOCK_BYTES;
+	    crc32_init(&self->chunk_crc);
 	}
 
 	DBG(2, "beginning to write chunk");
@@ -600,6 +606,8 @@ failure_shm_write_data:
 	}
 	crc32_add((uint8_t *)(elt->shm_ring->data + elt->shm_ring->mc->read_offset),
 			 to_write, &elt->crc);
+	crc32_add((uint8_t *)(elt->shm_ring->data + elt->shm_ring->mc->read_offset),
+			 to_write, &self->chunk_crc);
 	self->chunk_offset += count;
 
 	self->data_bytes_written += count;
@@ -759,6 +767,7 @@ failure_shm_write_header:
 	    self->fd = fd;
 	    self->header_bytes_written = HEADER_BLOCK_BYTES;
 	    self->chunk_offset = HEADER_BLOCK_BYTES;
+	    crc32_init(&self->chunk_crc);
 	}
 
 	DBG(2, "beginning to write chunk");
@@ -913,7 +922,9 @@ finish_chunk_impl(
     char *mesg = NULL;
 
     g_mutex_lock(self->state_mutex);
-    if (close_chunk(self, NULL, &mesg) == -1) {
+    if (close_chunk(self, NULL, &mesg) == 0 && self->first_filename) {
+	/* the chunks stay in the manifest under their final names */
+	holding_manifest_write(self->first_filename, self->chunks);
     }
     g_mutex_unlock(self->state_mutex);
     return mesg;
@@ -981,6 +992,12 @@ failure_close_chunk_close:
 #endif
     if (close_result == -1) {
 	*mesg = g_strdup_printf("Failed to close holding file '%s': %s", self->filename, strerror(save_errno));
+    } else {
+	holding_chunk_t *hc = g_new0(holding_chunk_t, 1);
+	hc->filename = g_strdup(self->filename);
+	hc->size = self->chunk_offset - HEADER_BLOCK_BYTES;
+	hc->crc = crc32_finish(&self->chunk_crc);
+	self->chunks = g_slist_append(self->chunks, hc);
     }
     self->fd = -1;
     g_free(self->filename);
@@ -1020,7 +1037,9 @@ instance_init(
     self->new_filename = NULL;
     self->data_bytes_written = 0;
     self->header_bytes_written = 0;
+    self->chunks = NULL;
     crc32_init(&elt->crc);
+    crc32_init(&self->chunk_crc);
 }
 
 static gboolean
@@ -1053,6 +1072,8 @@ finalize_impl(
     amfree(self->filename);
     amfree(self->first_filename);
     amfree(self->new_filename);
+    holding_manifest_free(self->chunks);
+    self->chunks = NULL;
     self->chunk_header = NULL;
 
     /* chain up */
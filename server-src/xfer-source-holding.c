@@ -25,6 +25,7 @@
 #include "amutil.h"
 #include "xfer-server.h"
 #include "xfer-device.h"
+#include "holding.h"
 
 /*
  * Class declaration
@@ -63,6 +64,16 @@ typedef struct XferSourceHolding {
     off_t fsize;
     gboolean paused;
 
+    /* the chunks from the manifest, if it is usable, and the current one */
+    GSList *manifest;
+    GSList *chunk;
+    crc_t chunk_crc;		/* of the data read from the current chunk */
+    gboolean chunk_verify;	/* chunk_crc covers all data read so far */
+
+    /* the next chunk, opened in advance by prefetch_next_chunk */
+    int next_fd;
+    char *next_fd_filename;
+
     GThread *holding_thread;
     GMutex     *state_mutex;
     GCond      *state_cond;
@@ -84,6 +95,7 @@ typedef struct {
 } XferSourceHoldingClass;
 
 static gboolean start_new_chunk(XferSourceHolding *self);
+static void chunk_data_read(XferSourceHolding *self, gpointer buf, size_t size);
 
 /*
  * Implementation
@@ -91,6 +103,9 @@ static gboolean start_new_chunk(XferSourceHolding *self);
 
 #define HOLDING_BLOCK_BYTES DISK_BLOCK_BYTES
 
+/* start reading the next chunk when this much is left in the current one */
+#define HOLDING_READAHEAD_BYTES (64*1024*1024)
+
 /*
  * Debug logging
  */
@@ -183,6 +198,7 @@ holding_thread(
 	    self->current_offset += bytes_read;
 	    self->bytes_read += bytes_read;
 	    crc32_add((uint8_t *)self->mem_ring->buffer + self->mem_ring->write_offset, bytes_read, &elt->crc);
+	    chunk_data_read(self, self->mem_ring->buffer + self->mem_ring->write_offset, bytes_read);
 	    write_offset += bytes_read;
 	    write_offset %= mem_ring_size;
 	    g_mutex_lock(self->mem_ring->mutex);
@@ -237,6 +253,100 @@ return_eof:
     return NULL;
 }
 
+/*
+ * When the current chunk has less than HOLDING_READAHEAD_BYTES left, open
+ * the next chunk of the manifest and have the kernel start reading it.
+ * The chunks are often on different holding disks, so the next one is read
+ * while the current one is finished, and the taper doesn't wait at each
+ * chunk boundary.
+ */
+static void
+prefetch_next_chunk(
+    XferSourceHolding *self)
+{
+    holding_chunk_t *hc;
+
+    if (self->next_fd != -1 || !self->chunk || !self->chunk->next)
+	return;
+    if (self->offset_file + self->fsize - self->current_offset > HOLDING_READAHEAD_BYTES)
+	return;
+
+    hc = (holding_chunk_t *)self->chunk->next->data;
+    self->next_fd = open(hc->filename, O_RDONLY);
+    if (self->next_fd < 0) {
+	/* reported when the chunk is opened to be read */
+	self->next_fd = -1;
+	return;
+    }
+    self->next_fd_filename = g_strdup(hc->filename);
+#ifdef HAVE_POSIX_FADVISE
+    (void)posix_fadvise(self->next_fd, 0,
+		MIN(hc->size + DISK_BLOCK_BYTES, HOLDING_READAHEAD_BYTES),
+		POSIX_FADV_WILLNEED);
+#endif
+    DBG(2, "reading ahead '%s'", hc->filename);
+}
+
+static void
+chunk_data_read(
+    XferSourceHolding *self,
+    gpointer buf,
+    size_t size)
+{
+    if (self->chunk_verify)
+	crc32_add((uint8_t *)buf, size, &self->chunk_crc);
+    prefetch_next_chunk(self);
+}
+
+/* Check the crc of the current chunk against the manifest, if all of its
+ * data was read in order. */
+static gboolean
+verify_chunk(
+    XferSourceHolding *self)
+{
+    holding_chunk_t *hc;
+    uint32_t crc;
+
+    if (!self->chunk_verify || !self->chunk)
+	return TRUE;
+
+    hc = (holding_chunk_t *)self->chunk->data;
+    if (self->chunk_crc.size != hc->size)
+	return TRUE;
+
+    crc = crc32_finish(&self->chunk_crc);
+    if (crc != hc->crc) {
+	xfer_cancel_with_error(XFER_ELEMENT(self),
+		"holding file '%s' has crc %08x, but its manifest has %08x",
+		hc->filename, crc, hc->crc);
+	wait_until_xfer_cancelled(XFER_ELEMENT(self)->xfer);
+	return FALSE;
+    }
+    return TRUE;
+}
+
+static int
+open_chunk(
+    XferSourceHolding *self,
+    char *filename)
+{
+    int fd;
+
+    if (self->next_fd != -1) {
+	if (g_str_equal(self->next_fd_filename, filename)) {
+	    fd = self->next_fd;
+	    self->next_fd = -1;
+	    amfree(self->next_fd_filename);
+	    return fd;
+	}
+	close(self->next_fd);
+	self->next_fd = -1;
+	amfree(self->next_fd_filename);
+    }
+
+    return open(filename, O_RDONLY);
+}
+
 static gboolean
 start_new_chunk(
     XferSourceHolding *self)
@@ -247,6 +357,7 @@ start_new_chunk(
     size_t bytes_read;
     struct stat finfo;
     gboolean seek_done = FALSE;
+    GSList *next_chunk;
 
     while (!seek_done &&
 	   (self->fd == -1 ||
@@ -257,6 +368,8 @@ start_new_chunk(
 	if (self->fd != -1 &&
 	    (elt->offset < self->offset_file ||
 	     elt->offset >= self->offset_file + self->fsize)) {
+	    if (!verify_chunk(self))
+		return FALSE;
 	    if (close(self->fd) < 0) {
 		xfer_cancel_with_error(XFER_ELEMENT(self),
 			"while closing holding file: %s", strerror(errno));
@@ -272,6 +385,7 @@ start_new_chunk(
 	    self->fsize = 0;
 	    g_free(self->next_filename);
 	    self->next_filename = g_strdup(self->first_filename);
+	    self->chunk = NULL;
 	}
 
 	if (self->fd == -1) {
@@ -282,7 +396,7 @@ start_new_chunk(
 	    }
 
 	    /* otherwise, open up the next file */
-	    self->fd = open(self->next_filename, O_RDONLY);
+	    self->fd = open_chunk(self, self->next_filename);
 	    if (self->fd < 0) {
 		xfer_cancel_with_error(XFER_ELEMENT(self),
 			"while opening holding file '%s': %s",
@@ -327,6 +441,36 @@ start_new_chunk(
 		st.st_size - DISK_BLOCK_BYTES);
 	}
 
+	/* the manifest has the size and filename of the next chunk */
+	next_chunk = self->chunk ? self->chunk->next : self->manifest;
+	if (next_chunk &&
+	    !g_str_equal(((holding_chunk_t *)next_chunk->data)->filename,
+			 self->next_filename)) {
+	    g_debug("holding manifest does not match '%s'; not using it",
+		    self->next_filename);
+	    holding_manifest_free(self->manifest);
+	    self->manifest = NULL;
+	    next_chunk = NULL;
+	}
+	self->chunk = next_chunk;
+	crc32_init(&self->chunk_crc);
+	self->chunk_verify = (next_chunk != NULL);
+	if (next_chunk) {
+	    holding_chunk_t *hc = (holding_chunk_t *)next_chunk->data;
+
+	    self->current_offset = self->offset_file += self->fsize;	/* fsize of previous chunk */
+	    self->fsize = hc->size;
+
+	    g_free(self->next_filename);
+	    if (next_chunk->next) {
+		hc = (holding_chunk_t *)next_chunk->next->data;
+		self->next_filename = g_strdup(hc->filename);
+	    } else {
+		self->next_filename = NULL;
+	    }
+	    continue;
+	}
+
 	/* read the header from the file and determine the size and
 	 * filename of the next chunk
 	 */
@@ -388,6 +532,13 @@ start_new_chunk(
     }
     self->current_offset = elt->offset;
 
+    /* a seek leaves a gap in the crc of the chunk */
+    if (self->chunk_verify &&
+	elt->offset - self->offset_file != self->chunk_crc.size)
+	self->chunk_verify = FALSE;
+
+    prefetch_next_chunk(self);
+
     return TRUE;
 }
 
@@ -466,6 +617,7 @@ pull_buffer_impl(
 	    *size = bytes_read;
 	    self->bytes_read += bytes_read;
 	    crc32_add((uint8_t *)buf, bytes_read, &elt->crc);
+	    chunk_data_read(self, buf, bytes_read);
 	    g_mutex_unlock(self->start_recovery_mutex);
 	    return buf;
 	}
@@ -555,6 +707,7 @@ pull_buffer_static_impl(
 	    *size = bytes_read;
 	    self->bytes_read += bytes_read;
 	    crc32_add((uint8_t *)buf, bytes_read, &elt->crc);
+	    chunk_data_read(self, buf, bytes_read);
 	    g_mutex_unlock(self->start_recovery_mutex);
 	    return buf;
 	}
@@ -665,6 +818,11 @@ instance_init(
 
     elt->can_generate_eof = TRUE;
     self->fd = -1;
+    self->next_fd = -1;
+    self->next_fd_filename = NULL;
+    self->manifest = NULL;
+    self->chunk = NULL;
+    self->chunk_verify = FALSE;
     self->paused = TRUE;
     self->current_offset = 0;
     self->offset_file = -1;
@@ -694,6 +852,10 @@ finalize_impl(
     g_mutex_free(self->start_recovery_mutex);
     if (self->fd != -1)
 	close(self->fd); /* ignore error; we were probably already cancelled */
+    if (self->next_fd != -1)
+	close(self->next_fd);
+    g_free(self->next_fd_filename);
+    holding_manifest_free(self->manifest);
 
     G_OBJECT_CLASS(parent_class)->finalize(obj_self);
 }
@@ -762,6 +924,7 @@ xfer_source_holding(
     self->first_filename = g_strdup(filename);
     self->next_filename = g_strdup(filename);
     self->bytes_read = 0;
+    self->manifest = holding_manifest_read(self->first_filename);
 
     return elt;
 }
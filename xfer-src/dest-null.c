@@ -77,7 +77,7 @@ push_buffer_impl(
     XferDestNull *self = (XferDestNull *)elt;
 
     if (buf) {
-	crc32_add(buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, buf, len);
     } else {
 	XMsg *msg = xmsg_new((XferElement *)self, XMSG_CRC, 0);
 	msg->crc = crc32_finish(&elt->crc);
@@ -118,7 +118,7 @@ push_buffer_static_impl(
     XferDestNull *self = (XferDestNull *)elt;
 
     if (buf && len != 0) {
-	crc32_add(buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, buf, len);
     } else {
 	XMsg *msg = xmsg_new((XferElement *)self, XMSG_CRC, 0);
 	msg->crc = crc32_finish(&elt->crc);
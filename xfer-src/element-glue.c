@@ -393,6 +393,51 @@ close_write_fd(XferElementGlue *self)
  * Worker thread utility functions
  */
 
+/* Charge the time since START to ELT's wait_in (IN) or wait_out counter */
+static void
+stats_add_wait(
+    XferElement *elt,
+    gint64 start,
+    gboolean in)
+{
+    gint64 wait = xfer_element_stats_clock() - start;
+
+    if (in)
+	xfer_element_stats_add(elt, 0, 0, 0, wait, 0, 0);
+    else
+	xfer_element_stats_add(elt, 0, 0, 0, 0, wait, 0);
+}
+
+/* Wait on a mem_ring condition or shm_ring semaphore, charging the time
+ * spent to ELT's wait_in (IN) or wait_out counter */
+static void
+stats_cond_wait(
+    XferElement *elt,
+    GCond *cond,
+    GMutex *mutex,
+    gboolean in)
+{
+    gint64 start = xfer_element_stats_clock();
+
+    g_cond_wait(cond, mutex);
+    stats_add_wait(elt, start, in);
+}
+
+static int
+stats_sem_wait(
+    XferElement *elt,
+    shm_ring_t *shm_ring,
+    sem_t *sem,
+    gboolean in)
+{
+    gint64 start = xfer_element_stats_clock();
+    int result;
+
+    result = shm_ring_sem_wait(shm_ring, sem);
+    stats_add_wait(elt, start, in);
+    return result;
+}
+
 static void
 pull_and_write(XferElementGlue *self)
 {
@@ -415,7 +460,7 @@ pull_and_write(XferElementGlue *self)
 
 	/* write it */
 	if (!elt->downstream->drain_mode) {
-	    written = full_write(fd, buf, len);
+	    written = xfer_element_full_write(elt, fd, buf, len);
 	    if (written < len) {
 		if (elt->downstream->must_drain) {
 		    g_debug("Error writing to fd %d: %s", fd, strerror(errno));
@@ -432,7 +477,7 @@ pull_and_write(XferElementGlue *self)
 		elt->downstream->drain_mode = TRUE;
 	    }
         }
-	crc32_add((uint8_t *)buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, len);
 
 	amfree(buf);
     }
@@ -483,7 +528,7 @@ pull_static_and_write(XferElementGlue *self)
 
 	/* write it */
 	if (!elt->downstream->drain_mode) {
-	    written = full_write(fd, buf, len);
+	    written = xfer_element_full_write(elt, fd, buf, len);
 	    if (written < len) {
 		if (elt->downstream->must_drain) {
 		    g_debug("Error writing to fd %d: %s", fd, strerror(errno));
@@ -500,7 +545,7 @@ pull_static_and_write(XferElementGlue *self)
 		elt->downstream->drain_mode = TRUE;
 	    }
         }
-	crc32_add((uint8_t *)buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, len);
     }
 
     if (elt->cancelled && elt->expect_eof)
@@ -537,7 +582,7 @@ read_and_write(XferElementGlue *self)
 	size_t len;
 
 	/* read from upstream */
-	len = read_fully(rfd, buf, GLUE_BUFFER_SIZE, NULL);
+	len = xfer_element_read_fully(elt, rfd, buf, GLUE_BUFFER_SIZE, NULL);
 	if (len < GLUE_BUFFER_SIZE) {
 	    if (errno) {
 		if (!elt->cancelled) {
@@ -552,7 +597,7 @@ read_and_write(XferElementGlue *self)
 	}
 
 	/* write the buffer fully */
-	if (!elt->downstream->drain_mode && full_write(wfd, buf, len) < len) {
+	if (!elt->downstream->drain_mode && xfer_element_full_write(elt, wfd, buf, len) < len) {
 	    if (elt->downstream->must_drain) {
 		g_debug("Could not write to fd %d: %s",  wfd, strerror(errno));
 	    } else if (elt->downstream->ignore_broken_pipe && errno == EPIPE) {
@@ -566,7 +611,7 @@ read_and_write(XferElementGlue *self)
 		break;
 	    }
 	}
-	crc32_add((uint8_t *)buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, len);
     }
 
     if (elt->cancelled && elt->expect_eof)
@@ -614,7 +659,7 @@ read_and_push(
 	int read_error;
 
 	/* read a buffer from upstream */
-	len = read_fully(fd, buf, GLUE_BUFFER_SIZE, &read_error);
+	len = xfer_element_read_fully(elt, fd, buf, GLUE_BUFFER_SIZE, &read_error);
 	if (len < GLUE_BUFFER_SIZE) {
 	    if (read_error) {
 		if (!elt->cancelled) {
@@ -631,7 +676,7 @@ read_and_push(
 		break;
 	    }
 	}
-	crc32_add((uint8_t *)buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, len);
 
 	xfer_element_push_buffer(elt->downstream, buf, len);
     }
@@ -671,7 +716,7 @@ read_and_push_static(
 	int read_error;
 
 	/* read a buffer from upstream */
-	len = read_fully(fd, buf, GLUE_BUFFER_SIZE, &read_error);
+	len = xfer_element_read_fully(elt, fd, buf, GLUE_BUFFER_SIZE, &read_error);
 	if (len < GLUE_BUFFER_SIZE) {
 	    if (read_error) {
 		if (!elt->cancelled) {
@@ -686,7 +731,7 @@ read_and_push_static(
 		break;
 	    }
 	}
-	crc32_add((uint8_t *)buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, len);
 
 	xfer_element_push_buffer_static(elt->downstream, buf, len);
     }
@@ -747,7 +792,8 @@ read_to_mem_ring(
 		g_mutex_unlock(self->mem_ring->mutex);
 		goto return_eof;
 	    }
-	    g_cond_wait(self->mem_ring->free_cond, self->mem_ring->mutex);
+	    stats_cond_wait(elt, self->mem_ring->free_cond,
+			    self->mem_ring->mutex, FALSE);
 	    write_offset = self->mem_ring->write_offset;
 	    read_offset = self->mem_ring->read_offset;
 	}
@@ -755,9 +801,9 @@ read_to_mem_ring(
 
 	/* read a buffer from upstream */
 	if (write_offset + self->mem_ring->producer_block_size <= mem_ring_size) {
-	    len = read_fully(fd, self->mem_ring->buffer+write_offset, producer_block_size, &read_error);
+	    len = xfer_element_read_fully(elt, fd, self->mem_ring->buffer+write_offset, producer_block_size, &read_error);
 	    if (len > 0) {
-		crc32_add((uint8_t *)self->mem_ring->buffer+write_offset, len, &elt->crc);
+		xfer_element_crc32_add(elt, (uint8_t *)self->mem_ring->buffer+write_offset, len);
 		write_offset += len;
 		write_offset %= mem_ring_size;
 		g_mutex_lock(self->mem_ring->mutex);
@@ -785,15 +831,15 @@ read_to_mem_ring(
 		}
 	    }
 	} else {
-	    len = read_fully(fd, self->mem_ring->buffer+write_offset, mem_ring_size - write_offset, &read_error);
+	    len = xfer_element_read_fully(elt, fd, self->mem_ring->buffer+write_offset, mem_ring_size - write_offset, &read_error);
 	    if (len > 0) {
-		crc32_add((uint8_t *)self->mem_ring->buffer+write_offset, len, &elt->crc);
+		xfer_element_crc32_add(elt, (uint8_t *)self->mem_ring->buffer+write_offset, len);
 	    }
 	    len2 = 0;
 	    if (len == mem_ring_size - write_offset) {
-		len2 = read_fully(fd, self->mem_ring->buffer, producer_block_size - (mem_ring_size - write_offset), &read_error);
+		len2 = xfer_element_read_fully(elt, fd, self->mem_ring->buffer, producer_block_size - (mem_ring_size - write_offset), &read_error);
 		if (len2 > 0) {
-		    crc32_add((uint8_t *)self->mem_ring->buffer, len2, &elt->crc);
+		    xfer_element_crc32_add(elt, (uint8_t *)self->mem_ring->buffer, len2);
 		    len += len2;
 		}
 	    }
@@ -863,6 +909,7 @@ read_to_shm_ring(
     int          iov_count;
     ssize_t      n;
     size_t      consumer_block_size;
+    gint64       io_start;
 
     g_debug("read_to_shm_ring");
 
@@ -879,7 +926,8 @@ read_to_shm_ring(
 	    readx = elt->shm_ring->mc->readx;
 	    if (shm_ring_size - (written - readx) > elt->shm_ring->block_size)
 		break;
-	    if (shm_ring_sem_wait(elt->shm_ring, elt->shm_ring->sem_write) != 0)
+	    if (stats_sem_wait(elt, elt->shm_ring, elt->shm_ring->sem_write,
+			       FALSE) != 0)
 		break;
 	}
 
@@ -897,7 +945,10 @@ read_to_shm_ring(
 	    iov_count = 2;
 	}
 
+	io_start = xfer_element_stats_clock();
 	n = readv(fd, iov, iov_count);
+	xfer_element_stats_add(elt, n > 0 ? n : 0, 0, 1,
+			       xfer_element_stats_clock() - io_start, 0, 0);
 	if (n > 0) {
 
 	    write_offset += n;
@@ -910,10 +961,10 @@ read_to_shm_ring(
 		elt->shm_ring->data_avail -= consumer_block_size;
 	    }
 	    if (n <= (ssize_t)iov[0].iov_len) {
-		crc32_add((uint8_t *)iov[0].iov_base, n, &elt->crc);
+		xfer_element_crc32_add(elt, (uint8_t *)iov[0].iov_base, n);
 	    } else {
-		crc32_add((uint8_t *)iov[0].iov_base, iov[0].iov_len, &elt->crc);
-		crc32_add((uint8_t *)iov[1].iov_base, n - iov[0].iov_len, &elt->crc);
+		xfer_element_crc32_add(elt, (uint8_t *)iov[0].iov_base, iov[0].iov_len);
+		xfer_element_crc32_add(elt, (uint8_t *)iov[1].iov_base, n - iov[0].iov_len);
 	    }
 	} else {
 	    elt->shm_ring->mc->eof_flag = TRUE;
@@ -936,7 +987,8 @@ read_to_shm_ring(
 	   !elt->shm_ring->mc->cancelled &&
 	   (elt->shm_ring->mc->written != elt->shm_ring->mc->readx ||
 	    !elt->shm_ring->mc->eof_flag)) {
-	if (shm_ring_sem_wait(elt->shm_ring, elt->shm_ring->sem_write) != 0)
+	if (stats_sem_wait(elt, elt->shm_ring, elt->shm_ring->sem_write,
+			       FALSE) != 0)
 	    break;
     }
 
@@ -987,7 +1039,8 @@ pull_static_to_shm_ring(
 	    readx = elt->shm_ring->mc->readx;
 	    if (shm_ring_size - (written - readx) > elt->shm_ring->block_size)
 		break;
-	    if (shm_ring_sem_wait(elt->shm_ring, elt->shm_ring->sem_write) != 0)
+	    if (stats_sem_wait(elt, elt->shm_ring, elt->shm_ring->sem_write,
+			       FALSE) != 0)
 		break;
 	}
 
@@ -1012,7 +1065,7 @@ pull_static_to_shm_ring(
 		sem_post(elt->shm_ring->sem_read);
 		elt->shm_ring->data_avail -= consumer_block_size;
 	    }
-	    crc32_add((uint8_t *)base, len, &elt->crc);
+	    xfer_element_crc32_add(elt, (uint8_t *)base, len);
 	} else {
 	    elt->shm_ring->mc->eof_flag = TRUE;
 	    break;
@@ -1033,7 +1086,8 @@ pull_static_to_shm_ring(
 	   !elt->shm_ring->mc->cancelled &&
 	   (elt->shm_ring->mc->written != elt->shm_ring->mc->readx ||
 	    !elt->shm_ring->mc->eof_flag)) {
-	if (shm_ring_sem_wait(elt->shm_ring, elt->shm_ring->sem_write) != 0)
+	if (stats_sem_wait(elt, elt->shm_ring, elt->shm_ring->sem_write,
+			       FALSE) != 0)
 	    break;
     }
 
@@ -1066,7 +1120,8 @@ shm_ring_and_push_buffer_static(XferElementGlue *self)
 	do {
 	    usable = elt->shm_ring->mc->written - elt->shm_ring->mc->readx;
 	    eof_flag = elt->shm_ring->mc->eof_flag;
-            if (shm_ring_sem_wait(elt->shm_ring, elt->shm_ring->sem_read) != 0)
+            if (stats_sem_wait(elt, elt->shm_ring, elt->shm_ring->sem_read,
+			       TRUE) != 0)
                 break;
         } while (!elt->shm_ring->mc->cancelled &&
                  usable < elt->shm_ring->block_size && !eof_flag);
@@ -1798,6 +1853,7 @@ pull_buffer_impl(
     size_t *size)
 {
     XferElementGlue *self = XFER_ELEMENT_GLUE(elt);
+    gint64 wait_start;
 
     g_debug("pUll_buffer_impl");
     /* accept first, if required */
@@ -1853,7 +1909,9 @@ pull_buffer_impl(
 	    }
 
 	    /* make sure there's at least one element available */
+	    wait_start = xfer_element_stats_clock();
 	    amsemaphore_down(self->ring_used_sem);
+	    stats_add_wait(elt, wait_start, TRUE);
 
 	    /* get it */
 	    buf = self->ring[self->ring_tail].buf;
@@ -1888,7 +1946,7 @@ pull_buffer_impl(
 	    buf = g_malloc(GLUE_BUFFER_SIZE);
 
 	    /* read from upstream */
-	    len = read_fully(fd, buf, GLUE_BUFFER_SIZE, NULL);
+	    len = xfer_element_read_fully(elt, fd, buf, GLUE_BUFFER_SIZE, NULL);
 	    if (len < GLUE_BUFFER_SIZE) {
 		if (errno) {
 		    if (!elt->cancelled) {
@@ -1937,6 +1995,7 @@ pull_buffer_static_impl(
     size_t *size)
 {
     XferElementGlue *self = XFER_ELEMENT_GLUE(elt);
+    gint64 wait_start;
 
     g_debug("pUll_buffer_impl");
     /* accept first, if required */
@@ -1993,7 +2052,9 @@ g_critical("PULL_FROM_RING_BUFFER unimplemented");
 	    }
 
 	    /* make sure there's at least one element available */
+	    wait_start = xfer_element_stats_clock();
 	    amsemaphore_down(self->ring_used_sem);
+	    stats_add_wait(elt, wait_start, TRUE);
 
 	    /* get it */
 	    buf = self->ring[self->ring_tail].buf;
@@ -2025,7 +2086,7 @@ g_critical("PULL_FROM_RING_BUFFER unimplemented");
 	    }
 
 	    /* read from upstream */
-	    len = read_fully(fd, buf, block_size, NULL);
+	    len = xfer_element_read_fully(elt, fd, buf, block_size, NULL);
 	    if (len < (ssize_t)block_size) {
 		if (errno) {
 		    if (!elt->cancelled) {
@@ -2073,6 +2134,7 @@ push_buffer_impl(
 {
     XferElementGlue *self = (XferElementGlue *)elt;
     XMsg *msg;
+    gint64 wait_start;
 
     g_debug("push_buffer_impl");
     /* accept first, if required */
@@ -2124,7 +2186,9 @@ push_buffer_impl(
 	    }
 
 	    /* make sure there's at least one element free */
+	    wait_start = xfer_element_stats_clock();
 	    amsemaphore_down(self->ring_free_sem);
+	    stats_add_wait(elt, wait_start, FALSE);
 
 	    /* set it */
 	    self->ring[self->ring_head].buf = buf;
@@ -2162,7 +2226,7 @@ push_buffer_impl(
 	    /* write the full buffer to the fd, or close on EOF */
 	    if (buf) {
 		if (!elt->downstream->drain_mode &&
-		    full_write(fd, buf, len) < len) {
+		    xfer_element_full_write(elt, fd, buf, len) < len) {
 		    if (elt->downstream->must_drain) {
 			g_debug("Error writing to fd %d: %s",
 				fd, strerror(errno));
@@ -2179,7 +2243,7 @@ push_buffer_impl(
 		    }
 		    elt->downstream->drain_mode = TRUE;
 		}
-		crc32_add((uint8_t *)buf, len, &elt->crc);
+		xfer_element_crc32_add(elt, (uint8_t *)buf, len);
 		amfree(buf);
 	    } else {
 		g_debug("sending XMSG_CRC message");
@@ -2210,6 +2274,7 @@ push_buffer_static_impl(
 {
     XferElementGlue *self = (XferElementGlue *)elt;
     XMsg *msg;
+    gint64 wait_start;
 
     /* accept first, if required */
     if (self->on_push & PUSH_ACCEPT_FIRST) {
@@ -2260,7 +2325,9 @@ push_buffer_static_impl(
 	    }
 g_critical("PUSH_TO_RING_BUFFER not implemented");
 	    /* make sure there's at least one element free */
+	    wait_start = xfer_element_stats_clock();
 	    amsemaphore_down(self->ring_free_sem);
+	    stats_add_wait(elt, wait_start, FALSE);
 
 	    /* set it */
 	    self->ring[self->ring_head].buf = buf;
@@ -2296,7 +2363,7 @@ g_critical("PUSH_TO_RING_BUFFER not implemented");
 	    /* write the full buffer to the fd, or close on EOF */
 	    if (buf) {
 		if (!elt->downstream->drain_mode &&
-		    full_write(fd, buf, len) < len) {
+		    xfer_element_full_write(elt, fd, buf, len) < len) {
 		    if (elt->downstream->must_drain) {
 			g_debug("Error writing to fd %d: %s",
 				fd, strerror(errno));
@@ -2313,7 +2380,7 @@ g_critical("PUSH_TO_RING_BUFFER not implemented");
 		    }
 		    elt->downstream->drain_mode = TRUE;
 		}
-		crc32_add((uint8_t *)buf, len, &elt->crc);
+		xfer_element_crc32_add(elt, (uint8_t *)buf, len);
 	    } else {
 		g_debug("sending XMSG_CRC message");
 		g_debug("push_to_fd CRC: %08x", crc32_finish(&elt->crc));
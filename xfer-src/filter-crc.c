@@ -87,7 +87,7 @@ pull_buffer_impl(
     /* get a buffer from upstream, crc it, and hand it back */
     buf = xfer_element_pull_buffer(XFER_ELEMENT(self)->upstream, size);
     if (buf) {
-	crc32_add((uint8_t *)buf, *size, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, *size);
     } else {
 	g_debug("sending XMSG_CRC message");
 	g_debug("crc pull_buffer CRC: %08x",
@@ -124,7 +124,7 @@ pull_buffer_static_impl(
     /* get a buffer from upstream, crc it, and hand it back */
     xfer_element_pull_buffer_static(XFER_ELEMENT(self)->upstream, buf, block_size, size);
     if (size) {
-	crc32_add((uint8_t *)buf, *size, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, *size);
     } else {
 	g_debug("sending XMSG_CRC message");
 	g_debug("crc pull_buffer CRC: %08x",
@@ -155,7 +155,7 @@ push_buffer_impl(
 
     /* crc the given buffer and pass it downstream */
     if (buf) {
-	crc32_add((uint8_t *)buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, len);
     } else {
 	g_debug("sending XMSG_CRC message to %p", elt);
 	g_debug("crc push_buffer CRC: %08x",
@@ -186,7 +186,7 @@ push_buffer_static_impl(
 
     /* crc the given buffer and pass it downstream */
     if (buf && len != 0) {
-	crc32_add((uint8_t *)buf, len, &elt->crc);
+	xfer_element_crc32_add(elt, (uint8_t *)buf, len);
     } else {
 	g_debug("sending XMSG_CRC message to %p", elt);
 	g_debug("crc push_buffer CRC: %08x",
@@ -46,6 +46,7 @@ xfer_element_init(
     xe->must_drain = FALSE;
     xe->cancel_on_success = FALSE;
     xe->ignore_broken_pipe = FALSE;
+    xe->stats_mutex = g_mutex_new();
 }
 
 static gboolean
@@ -197,6 +198,8 @@ xfer_element_finalize(
     if (fd != -1 && close(fd) != 0)
 	g_warning("error closing fd %d: %s", fd, strerror(errno));
 
+    g_mutex_free(elt->stats_mutex);
+
     /* chain up */
     G_OBJECT_CLASS(parent_class)->finalize(obj_self);
 }
@@ -341,12 +344,157 @@ xfer_element_cancel(
     return XFER_ELEMENT_GET_CLASS(elt)->cancel(elt, expect_eof);
 }
 
+/*
+ * Statistics
+ */
+
+gint64
+xfer_element_stats_clock(void)
+{
+#if GLIB_CHECK_VERSION(2,28,0)
+    return g_get_monotonic_time();
+#else
+    GTimeVal tv;
+
+    g_get_current_time(&tv);
+    return (gint64)tv.tv_sec * G_USEC_PER_SEC + tv.tv_usec;
+#endif
+}
+
+void
+xfer_element_stats_add(
+    XferElement *elt,
+    guint64 bytes_in,
+    guint64 bytes_out,
+    guint64 io_calls,
+    gint64 wait_in,
+    gint64 wait_out,
+    gint64 crc_time)
+{
+    g_mutex_lock(elt->stats_mutex);
+    elt->stats.bytes_in += bytes_in;
+    elt->stats.bytes_out += bytes_out;
+    elt->stats.io_calls += io_calls;
+    elt->stats.wait_in += wait_in;
+    elt->stats.wait_out += wait_out;
+    elt->stats.crc_time += crc_time;
+    g_mutex_unlock(elt->stats_mutex);
+}
+
+void
+xfer_element_get_stats(
+    XferElement *elt,
+    XferElementStats *stats)
+{
+    g_mutex_lock(elt->stats_mutex);
+    *stats = elt->stats;
+    g_mutex_unlock(elt->stats_mutex);
+}
+
+/* ELT's wait_in (IN) or wait_out counter */
+static gint64
+stats_wait(
+    XferElement *elt,
+    gboolean in)
+{
+    XferElementStats stats;
+
+    xfer_element_get_stats(elt, &stats);
+    return in? stats.wait_in : stats.wait_out;
+}
+
+/* Account for a call to CALLEE's push_buffer or pull_buffer made by CALLER,
+ * which started at START and transferred SIZE bytes.  NESTED is the part of
+ * the call CALLEE itself spent waiting on its own neighbours; it is not
+ * charged to CALLER. */
+static void
+account_call(
+    XferElement *callee,
+    XferElement *caller,
+    gint64 start,
+    gint64 nested,
+    size_t size,
+    gboolean push)
+{
+    gint64 elapsed = xfer_element_stats_clock() - start - nested;
+
+    if (elapsed < 0)
+	elapsed = 0;
+
+    if (push) {
+	xfer_element_stats_add(callee, size, 0, 0, 0, 0, 0);
+	if (caller)
+	    xfer_element_stats_add(caller, 0, size, 0, 0, elapsed, 0);
+    } else {
+	xfer_element_stats_add(callee, 0, size, 0, 0, 0, 0);
+	if (caller)
+	    xfer_element_stats_add(caller, size, 0, 0, elapsed, 0, 0);
+    }
+}
+
+gsize
+xfer_element_read_fully(
+    XferElement *elt,
+    int fd,
+    gpointer buf,
+    gsize count,
+    int *err)
+{
+    gint64 start = xfer_element_stats_clock();
+    gsize len;
+    int save_errno;
+
+    len = read_fully(fd, buf, count, err);
+    save_errno = errno;
+    xfer_element_stats_add(elt, len, 0, 1,
+			   xfer_element_stats_clock() - start, 0, 0);
+    errno = save_errno;
+
+    return len;
+}
+
+gsize
+xfer_element_full_write(
+    XferElement *elt,
+    int fd,
+    gconstpointer buf,
+    gsize count)
+{
+    gint64 start = xfer_element_stats_clock();
+    gsize len;
+    int save_errno;
+
+    len = full_write(fd, buf, count);
+    save_errno = errno;
+    xfer_element_stats_add(elt, 0, len, 1,
+			   0, xfer_element_stats_clock() - start, 0);
+    errno = save_errno;
+
+    return len;
+}
+
+void
+xfer_element_crc32_add(
+    XferElement *elt,
+    gconstpointer buf,
+    size_t len)
+{
+    gint64 start = xfer_element_stats_clock();
+
+    crc32_add((uint8_t *)buf, len, &elt->crc);
+    xfer_element_stats_add(elt, 0, 0, 0, 0, 0,
+			   xfer_element_stats_clock() - start);
+}
+
 gpointer
 xfer_element_pull_buffer(
     XferElement *elt,
     size_t *size)
 {
     xfer_status status;
+    gpointer buf;
+    gint64 before, start;
+
     /* Make sure that the xfer is running before calling upstream's
      * pull_buffer method; this avoids a race condition where upstream
      * hasn't finished its xfer_element_start yet, and isn't ready for
@@ -357,7 +505,13 @@ xfer_element_pull_buffer(
     if (status == XFER_START)
 	wait_until_xfer_running(elt->xfer);
 
-    return XFER_ELEMENT_GET_CLASS(elt)->pull_buffer(elt, size);
+    before = stats_wait(elt, TRUE);
+    start = xfer_element_stats_clock();
+    buf = XFER_ELEMENT_GET_CLASS(elt)->pull_buffer(elt, size);
+    account_call(elt, elt->downstream, start, stats_wait(elt, TRUE) - before,
+		 buf? *size : 0, FALSE);
+
+    return buf;
 }
 
 gpointer
@@ -368,6 +522,9 @@ xfer_element_pull_buffer_static(
     size_t *size)
 {
     xfer_status status;
+    gpointer result;
+    gint64 before, start;
+
     /* Make sure that the xfer is running before calling upstream's
      * pull_bufferi_static method; this avoids a race condition where upstream
      * hasn't finished its xfer_element_start yet, and isn't ready for
@@ -378,7 +535,13 @@ xfer_element_pull_buffer_static(
     if (status == XFER_START)
 	wait_until_xfer_running(elt->xfer);
 
-    return XFER_ELEMENT_GET_CLASS(elt)->pull_buffer_static(elt, buf, block_size, size);
+    before = stats_wait(elt, TRUE);
+    start = xfer_element_stats_clock();
+    result = XFER_ELEMENT_GET_CLASS(elt)->pull_buffer_static(elt, buf, block_size, size);
+    account_call(elt, elt->downstream, start, stats_wait(elt, TRUE) - before,
+		 result? *size : 0, FALSE);
+
+    return result;
 }
 
 void
@@ -387,9 +550,14 @@ xfer_element_push_buffer(
     gpointer buf,
     size_t size)
 {
+    gint64 before = stats_wait(elt, FALSE);
+    gint64 start = xfer_element_stats_clock();
+
     /* There is no race condition with push_buffer, because downstream
      * elements are started first. */
     XFER_ELEMENT_GET_CLASS(elt)->push_buffer(elt, buf, size);
+    account_call(elt, elt->upstream, start, stats_wait(elt, FALSE) - before,
+		 buf? size : 0, TRUE);
 }
 
 void
@@ -398,9 +566,14 @@ xfer_element_push_buffer_static(
     gpointer buf,
     size_t size)
 {
+    gint64 before = stats_wait(elt, FALSE);
+    gint64 start = xfer_element_stats_clock();
+
     /* There is no race condition with push_buffer, because downstream
      * elements are started first. */
     XFER_ELEMENT_GET_CLASS(elt)->push_buffer_static(elt, buf, size);
+    account_call(elt, elt->upstream, start, stats_wait(elt, FALSE) - before,
+		 buf? size : 0, TRUE);
 }
 
 xfer_element_mech_pair_t *
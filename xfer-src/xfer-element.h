@@ -121,6 +121,34 @@ GType xfer_element_get_type(void);
 #define IS_XFER_ELEMENT(obj) G_TYPE_CHECK_INSTANCE_TYPE((obj), xfer_element_get_type ())
 #define XFER_ELEMENT_GET_CLASS(obj) G_TYPE_INSTANCE_GET_CLASS((obj), xfer_element_get_type(), XferElementClass)
 
+/*
+ * Per-element statistics, reported in XMSG_STATS when the transfer is done.
+ *
+ * The wait times are charged to the element that is waiting: an element
+ * blocked in its downstream's push_buffer, on a full ring, or in write()
+ * is waiting for output; one blocked in its upstream's pull_buffer, on an
+ * empty ring, or in read() is waiting for input.  Time spent in a
+ * neighbour's push_buffer or pull_buffer only counts the neighbour's own
+ * work, not the further neighbours it waits on in turn.  A slow element
+ * therefore shows up as a large wait_out in its upstream and a large wait_in
+ * in its downstream, even if it is an external process or a device that is
+ * not instrumented itself.
+ *
+ * A neighbour's thread may charge an element's counters while the element
+ * updates them itself, so they are only changed through
+ * xfer_element_stats_add and read through xfer_element_get_stats, both of
+ * which hold the element's stats_mutex.  All times are in microseconds.
+ */
+
+typedef struct XferElementStats {
+    guint64 bytes_in;		/* bytes received from upstream */
+    guint64 bytes_out;		/* bytes sent to downstream */
+    guint64 io_calls;		/* read/write calls on file descriptors */
+    gint64 wait_in;		/* time waiting for input */
+    gint64 wait_out;		/* time waiting for output */
+    gint64 crc_time;		/* time computing the crc */
+} XferElementStats;
+
 /*
  * Main object structure
  */
@@ -187,6 +215,10 @@ typedef struct XferElement {
     gboolean drain_mode;
     gboolean cancel_on_success;
     gboolean ignore_broken_pipe;
+
+    /* statistics for XMSG_STATS; reset by xfer_start */
+    XferElementStats stats;
+    GMutex *stats_mutex;
 } XferElement;
 
 /*
@@ -415,6 +447,54 @@ void xfer_element_drain_buffers(XferElement *upstream);
  */
 void xfer_element_drain_fd(int fd);
 
+/* Current time in microseconds, for the XferElementStats counters.  This
+ * is monotonic where glib supports it.
+ *
+ * @returns: a timestamp in microseconds
+ */
+gint64 xfer_element_stats_clock(void);
+
+/* Add to ELT's statistics, from any thread.
+ *
+ * @param elt: the element
+ * @param bytes_in, bytes_out, io_calls, wait_in, wait_out, crc_time: the
+ *        amounts to add to each counter
+ */
+void xfer_element_stats_add(XferElement *elt, guint64 bytes_in,
+			    guint64 bytes_out, guint64 io_calls,
+			    gint64 wait_in, gint64 wait_out, gint64 crc_time);
+
+/* Copy ELT's statistics into STATS, from any thread.
+ *
+ * @param elt: the element
+ * @param stats (output): the counters
+ */
+void xfer_element_get_stats(XferElement *elt, XferElementStats *stats);
+
+/* Like read_fully and full_write, but update ELT's statistics: the bytes
+ * are counted as bytes_in or bytes_out, and the time spent in the call as
+ * wait_in or wait_out.  errno is preserved.
+ *
+ * @param elt: the element doing the I/O
+ * @param fd: the file descriptor
+ * @param buf: the buffer
+ * @param count: number of bytes to read or write
+ * @param err (output): as for read_fully
+ * @returns: number of bytes transferred
+ */
+gsize xfer_element_read_fully(XferElement *elt, int fd, gpointer buf,
+			      gsize count, int *err);
+gsize xfer_element_full_write(XferElement *elt, int fd, gconstpointer buf,
+			      gsize count);
+
+/* Add BUF to ELT's crc, counting the time spent in crc_time.
+ *
+ * @param elt: the element
+ * @param buf: the data
+ * @param len: length of the data
+ */
+void xfer_element_crc32_add(XferElement *elt, gconstpointer buf, size_t len);
+
 /* Atomically swap a value into elt->_input_fd and _output_fd, respectively.
  * Always use these methods to access the field.
  *
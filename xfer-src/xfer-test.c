@@ -1491,6 +1491,105 @@ test_xfer_simple(void)
     return 1;
 }
 
+/****
+ * Check that XMSG_STATS is sent for each element with sensible counters
+ */
+
+static guint64 stats_dest_bytes_in;
+static guint64 stats_src_bytes_out;
+static int stats_count;
+static gboolean stats_before_done;
+static gboolean stats_after_done;
+static gboolean stats_bad_busy;
+
+static void
+test_xfer_stats_callback(
+    gpointer data G_GNUC_UNUSED,
+    XMsg *msg,
+    Xfer *xfer)
+{
+    XferElement *src = g_ptr_array_index(xfer->elements, 0);
+    XferElement *dest = g_ptr_array_index(xfer->elements, xfer->elements->len-1);
+
+    tu_dbg("Received message %s\n", xmsg_repr(msg));
+
+    switch (msg->type) {
+	case XMSG_STATS:
+	    stats_count++;
+	    stats_before_done |= (xfer->status != XFER_DONE);
+	    stats_after_done |= (xfer->status == XFER_DONE);
+	    if (msg->elt == src)
+		stats_src_bytes_out = msg->bytes_out;
+	    if (msg->elt == dest)
+		stats_dest_bytes_in = msg->bytes_in;
+	    if (msg->busy < 0 || msg->busy > 1)
+		stats_bad_busy = TRUE;
+	    break;
+
+	case XMSG_DONE:
+	    if (xfer->status == XFER_DONE)
+		g_main_loop_quit(default_main_loop());
+	    break;
+
+	default:
+	    break;
+    }
+}
+
+static int
+test_xfer_stats(void)
+{
+    unsigned int i;
+    GSource *src;
+    XferElement *elements[] = {
+	xfer_source_random(100*1024, RANDOM_SEED),
+	xfer_filter_xor('d'),
+	xfer_dest_null(RANDOM_SEED),
+    };
+
+    Xfer *xfer = xfer_new(elements, G_N_ELEMENTS(elements));
+    src = xfer_get_source(xfer);
+    g_source_set_callback(src, (GSourceFunc)test_xfer_stats_callback, NULL, NULL);
+    g_source_attach(src, NULL);
+
+    for (i = 0; i < G_N_ELEMENTS(elements); i++) {
+	g_object_unref(elements[i]);
+	elements[i] = NULL;
+    }
+
+    stats_count = 0;
+    stats_before_done = FALSE;
+    stats_after_done = FALSE;
+    stats_bad_busy = FALSE;
+    xfer_start(xfer, 0, 0);
+
+    g_main_loop_run(default_main_loop());
+    g_assert(xfer->status == XFER_DONE);
+
+    if (stats_count != (int)xfer->elements->len) {
+	g_fprintf(stderr, "got %d XMSG_STATS for %d elements\n",
+		  stats_count, xfer->elements->len);
+	return 0;
+    }
+    if (!stats_before_done || stats_after_done) {
+	g_fprintf(stderr, "XMSG_STATS not sent before XMSG_DONE\n");
+	return 0;
+    }
+    if (stats_bad_busy) {
+	g_fprintf(stderr, "XMSG_STATS with a busy value outside [0,1]\n");
+	return 0;
+    }
+    if (stats_src_bytes_out != 100*1024 || stats_dest_bytes_in != 100*1024) {
+	g_fprintf(stderr, "bad byte counts: source sent %lld, dest received %lld\n",
+		  (long long)stats_src_bytes_out, (long long)stats_dest_bytes_in);
+	return 0;
+    }
+
+    xfer_unref(xfer);
+
+    return 1;
+}
+
 /****
  * Run a transfer between two files, with or without filters
  */
@@ -1660,6 +1759,7 @@ main(int argc, char **argv)
 {
     static TestUtilsTest tests[] = {
 	TU_TEST(test_xfer_simple, 90),
+	TU_TEST(test_xfer_stats, 90),
 	TU_TEST(test_xfer_files_simple, 90),
 	TU_TEST(test_xfer_files_filter, 90),
         TU_TEST(test_glue_READFD_READFD, 90),
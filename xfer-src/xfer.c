@@ -210,6 +210,13 @@ xfer_start(
      * xfer->elements */
     link_elements(xfer);
 
+    /* reset the statistics, as the transfer may be restarted */
+    for (i = 0; i < xfer->elements->len; i++) {
+	XferElement *xe = (XferElement *)g_ptr_array_index(xfer->elements, i);
+	memset(&xe->stats, 0, sizeof(xe->stats));
+    }
+    xfer->start_time = xfer_element_stats_clock();
+
     /* Tell all elements to set up.  This is done before upstream and downstream
      * are set so that elements cannot interfere with one another before setup()
      * is completed. */
@@ -568,6 +575,87 @@ xmsgsource_check(
     return xms->xfer && g_async_queue_length(xms->xfer->queue) > 0;
 }
 
+/* Send an XMSG_STATS message for each element to CALLBACK, and log the
+ * statistics along with the element the transfer was waiting on most.  An
+ * element is "busy" while its upstream waits to push data into it or its
+ * downstream waits to pull data out of it. */
+static void
+send_stats(
+    Xfer *xfer,
+    XMsgCallback callback,
+    gpointer user_data)
+{
+    gint64 elapsed = xfer_element_stats_clock() - xfer->start_time;
+    XferElement *bottleneck = NULL;
+    double bottleneck_busy = 0;
+    guint len = xfer->elements->len;
+    XferElementStats *stats = g_new(XferElementStats, len);
+    guint i;
+
+    if (elapsed <= 0)
+	elapsed = 1;
+
+    for (i = 0; i < len; i++)
+	xfer_element_get_stats(g_ptr_array_index(xfer->elements, i), &stats[i]);
+
+    for (i = 0; i < len; i++) {
+	XferElement *elt = g_ptr_array_index(xfer->elements, i);
+	gint64 waited = 0;
+	int nwaiters = 0;
+	double busy;
+	XMsg *msg;
+
+	if (i > 0) {
+	    waited += stats[i-1].wait_out;
+	    nwaiters++;
+	}
+	if (i < len-1) {
+	    waited += stats[i+1].wait_in;
+	    nwaiters++;
+	}
+	busy = nwaiters? (double)waited / nwaiters / elapsed : 0;
+	if (busy > 1)
+	    busy = 1;
+
+	g_debug("xfer stats %s: in %lld out %lld io_calls %lld wait_in %.3fs "
+		"wait_out %.3fs crc %.3fs busy %d%%",
+		xfer_element_repr(elt),
+		(long long)stats[i].bytes_in, (long long)stats[i].bytes_out,
+		(long long)stats[i].io_calls,
+		stats[i].wait_in / (double)G_USEC_PER_SEC,
+		stats[i].wait_out / (double)G_USEC_PER_SEC,
+		stats[i].crc_time / (double)G_USEC_PER_SEC,
+		(int)(busy * 100));
+
+	if (busy > bottleneck_busy) {
+	    bottleneck = elt;
+	    bottleneck_busy = busy;
+	}
+
+	if (!callback)
+	    continue;
+
+	msg = xmsg_new(elt, XMSG_STATS, 0);
+	msg->bytes_in = stats[i].bytes_in;
+	msg->bytes_out = stats[i].bytes_out;
+	msg->io_calls = stats[i].io_calls;
+	msg->wait_in = stats[i].wait_in / (double)G_USEC_PER_SEC;
+	msg->wait_out = stats[i].wait_out / (double)G_USEC_PER_SEC;
+	msg->crc_time = stats[i].crc_time / (double)G_USEC_PER_SEC;
+	msg->duration = elapsed / (double)G_USEC_PER_SEC;
+	msg->busy = busy;
+	callback(user_data, msg, xfer);
+	xmsg_free(msg);
+    }
+
+    g_free(stats);
+
+    if (bottleneck) {
+	g_debug("%s bottleneck: %s, %d%% busy", xfer_repr(xfer),
+		xfer_element_repr(bottleneck), (int)(bottleneck_busy * 100));
+    }
+}
+
 static gboolean
 xmsgsource_dispatch(
     GSource *source G_GNUC_UNUSED,
@@ -596,6 +684,10 @@ xmsgsource_dispatch(
 	     * the entire transfer is finished. */
 	    case XMSG_DONE:
 		if (--xfer->num_active_elements <= 0) {
+		    /* all elements are finished, so report their statistics
+		     * before the final XMSG_DONE */
+		    send_stats(xfer, my_cb, user_data);
+
 		    /* mark the transfer as done, and take a note to break out
 		     * of this loop after delivering the message to the user */
 		    xfer_set_status(xfer, XFER_DONE);
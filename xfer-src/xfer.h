@@ -94,6 +94,9 @@ typedef struct Xfer {
     GMutex *fd_mutex;
 
     int cancelled;
+
+    /* when the transfer started, for XMSG_STATS */
+    gint64 start_time;
 } Xfer;
 
 /* Note that all functions must be called from the main thread unless
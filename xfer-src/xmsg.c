@@ -82,6 +82,7 @@ xmsg_repr(
 	    case XMSG_CRC: typ = "CRC"; break;
 	    case XMSG_NO_SPACE: typ = "NO_SPACE"; break;
 	    case XMSG_SEGMENT_DONE: typ = "SEGMENT_DONE"; break;
+	    case XMSG_STATS: typ = "STATS"; break;
 	    default: typ = "**UNKNOWN**"; break;
 	}
 
@@ -130,6 +130,23 @@ typedef enum {
      */
     XMSG_SEGMENT_DONE = 10,
 
+    /* XMSG_STATS: throughput and stall statistics for one element, sent for
+     * each element just before the XMSG_DONE.  See XferElementStats in
+     * xfer-element.h for the meaning of the counters.
+     *
+     * Attributes:
+     *  - bytes_in (bytes received from upstream)
+     *  - bytes_out (bytes sent to downstream)
+     *  - io_calls (read/write calls on file descriptors)
+     *  - wait_in (seconds spent waiting for input)
+     *  - wait_out (seconds spent waiting for output)
+     *  - crc_time (seconds spent computing the crc)
+     *  - duration (seconds the transfer ran)
+     *  - busy (fraction of the transfer its neighbours spent waiting on this
+     *		element; the element with the highest value is the bottleneck)
+     */
+    XMSG_STATS = 11,
+
 } xmsg_type;
 
 /*
@@ -208,6 +225,15 @@ typedef struct XMsg {
 
     /* value */
     uint32_t crc;
+
+    /* statistics */
+    guint64 bytes_in;
+    guint64 bytes_out;
+    guint64 io_calls;
+    double wait_in;
+    double wait_out;
+    double crc_time;
+    double busy;
 } XMsg;
 
 /*